@@ -72,6 +72,34 @@ Popup {
             }
         }
 
+        Button {
+            id: spectateButton
+            text: "Spectate"
+            Layout.fillWidth: true
+
+            implicitHeight: 34
+            implicitWidth: 148
+
+            background: Rectangle {
+                radius: 2
+                anchors.fill: parent
+                color: "#3e4042"
+            }
+
+            contentItem: Text {
+                text: spectateButton.text
+                font: spectateButton.font
+                color: "#f2f2f2"
+                horizontalAlignment: Text.AlignHCenter
+                verticalAlignment: Text.AlignVCenter
+            }
+
+            onClicked: {
+                Client.spectate_friend(friendID, true)
+                popup.close()
+            }
+        }
+
         Button {
             id: unfriendButton
             text: "Remove"
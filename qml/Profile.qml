@@ -25,7 +25,15 @@ Item {
     Layout.fillWidth: true
     Layout.fillHeight: true
 
-    // Elo's on the left and match history on the right.
+    // Selected mode, the leaderboard is only shown for ranked modes.
+    property int selectedMode: QueueType.NO_MODE
+    property bool rankedSelected: selectedMode >= QueueType.RankedTwoPlayer
+                                  && selectedMode < QueueType.NO_MODE
+
+    // Whether the leaderboard shows the top or the players around us.
+    property bool aroundMe: false
+
+    // Elo's and the leaderboard on the left, match history on the right.
     RowLayout {
         id: profileContent
 
@@ -53,6 +61,8 @@ Item {
                     allModes.append({label:"Casual 3 player", mode: QueueType.ClassicThreePlayer})
                     allModes.append({label:"Casual 5 player", mode: QueueType.ClassicFivePlayer})
                     allModes.append({label:"Ranked 1v1", mode: QueueType.RankedTwoPlayer})
+                    allModes.append({label:"Ranked 3 player", mode: QueueType.RankedThreePlayer})
+                    allModes.append({label:"Ranked 5 player", mode: QueueType.RankedFivePlayer})
                 }
 
                 ModeMenus {
@@ -80,6 +90,13 @@ Item {
                         HistoryModel.set_current_history_mode(modeData.mode)
 
                         Client.fetch_match_history(modeData.mode)
+
+                        profileRoot.selectedMode = modeData.mode
+
+                        if (profileRoot.rankedSelected)
+                        {
+                            Client.fetch_leaderboard(modeData.mode, profileRoot.aroundMe)
+                        }
                     }
 
                     Layout.alignment: Qt.AlignHCenter
@@ -102,7 +119,107 @@ Item {
                     Layout.alignment: Qt.AlignHCenter
                 }
 
+                Text {
+                    id: rankText
+                    visible: profileRoot.rankedSelected
+                    font.pointSize: 12
+                    text: LeaderboardModel.my_rank > 0
+                          ? "Rank " + LeaderboardModel.my_rank + " of " + LeaderboardModel.players
+                          : "Unranked"
+                    color: "#a2a3a4"
+                    Layout.alignment: Qt.AlignHCenter
+                }
+
+                // Top of the leaderboard or the players around us.
+                RowLayout {
+                    visible: profileRoot.rankedSelected
+                    spacing: 4
+                    Layout.alignment: Qt.AlignHCenter
+
+                    Repeater {
+                        model: [
+                            { label: "Top", around: false },
+                            { label: "Around Me", around: true }
+                        ]
+
+                        delegate: Button {
+                            id: leaderboardButton
+
+                            text: modelData.label
+
+                            implicitHeight: 30
+                            implicitWidth: 84
+
+                            contentItem: Text {
+                                text: leaderboardButton.text
+                                font: leaderboardButton.font
+                                color: "#eaeaea"
+                                horizontalAlignment: Text.AlignHCenter
+                                verticalAlignment: Text.AlignVCenter
+                            }
+
+                            background: Rectangle {
+                                color: leaderboardButton.down ? "#202122" :
+                                       (leaderboardButton.hovered
+                                        || profileRoot.aroundMe === modelData.around)
+                                       ? "#3e4042" : "#323436"
+                                radius: 2
+                            }
+
+                            onClicked: {
+                                profileRoot.aroundMe = modelData.around
+                                Client.fetch_leaderboard(profileRoot.selectedMode,
+                                                         profileRoot.aroundMe)
+                            }
+                        }
+                    }
+                }
+
+                ListView {
+                    id: leaderboardList
+                    visible: profileRoot.rankedSelected
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                    Layout.margins: 4
+                    model: LeaderboardModel
+                    clip: true
+
+                    // [Rank | Username | Elo], our own row is highlighted.
+                    delegate: Rectangle {
+                        height: 28
+                        width: leaderboardList.width
+                        color: model.username === Client.username ? "#2a2c2e" : "transparent"
+
+                        RowLayout {
+                            anchors.fill: parent
+                            anchors.leftMargin: 6
+                            anchors.rightMargin: 6
+                            spacing: 6
+
+                            Text {
+                                text: model.rank
+                                color: "#a2a3a4"
+                                Layout.preferredWidth: 56
+                            }
+
+                            Text {
+                                text: model.username
+                                color: "#f2f2f2"
+                                elide: Text.ElideRight
+                                Layout.fillWidth: true
+                            }
+
+                            Text {
+                                text: model.elo
+                                color: "#f2f2f2"
+                                horizontalAlignment: Text.AlignRight
+                            }
+                        }
+                    }
+                }
+
                 Item {
+                    visible: !profileRoot.rankedSelected
                     Layout.fillHeight: true
                     Layout.fillWidth: true
                 }
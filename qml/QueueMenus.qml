@@ -51,6 +51,8 @@ Item {
             casualModel.append({label:"Casual 5 player", mode: QueueType.ClassicFivePlayer})
 
             rankedModel.append({label:"Ranked 1v1", mode: QueueType.RankedTwoPlayer})
+            rankedModel.append({label:"Ranked 3 player", mode: QueueType.RankedThreePlayer})
+            rankedModel.append({label:"Ranked 5 player", mode: QueueType.RankedFivePlayer})
         }
 
         ModeMenus {
@@ -0,0 +1,77 @@
+-- Copyright (c) 2025 Liam Mercier
+--
+-- This file is part of SilentTanks.
+--
+-- SilentTanks is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU Affero General Public License Version 3.0
+-- as published by the Free Software Foundation.
+--
+-- SilentTanks is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+-- for more details.
+--
+-- You should have received a copy of the GNU Affero General Public License v3.0
+-- along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+-- Upgrades a database created before old replays were archived.
+--
+-- Run after migrate-replays.sql. Existing tables stay unpartitioned, the
+-- server skips partition upkeep for them and archives replays as usual.
+-- Converting them means recreating the tables as in create-tables.sql
+-- and copying the rows over, which is left to the operator.
+
+BEGIN;
+
+ALTER TABLE Matches ADD COLUMN IF NOT EXISTS archive_segment BIGINT;
+ALTER TABLE Matches DROP CONSTRAINT IF EXISTS matches_replay_present;
+ALTER TABLE Matches DROP CONSTRAINT IF EXISTS matches_check;
+ALTER TABLE Matches ADD CONSTRAINT matches_replay_present
+    CHECK (replay IS NOT NULL OR move_history IS NOT NULL OR archive_segment IS NOT NULL);
+
+CREATE INDEX IF NOT EXISTS idx_matches_unarchived ON Matches(match_id)
+    WHERE archive_segment IS NULL;
+
+-- Called by the server for partition upkeep, see create-tables.sql.
+CREATE OR REPLACE FUNCTION ensure_match_partitions(partition_size BIGINT, ahead INT)
+RETURNS INT
+LANGUAGE plpgsql
+SECURITY DEFINER
+SET search_path = public
+AS $$
+DECLARE
+    last_id BIGINT;
+    first_id BIGINT;
+    part_name TEXT;
+    parent TEXT;
+    created INT := 0;
+BEGIN
+    EXECUTE format('SELECT last_value FROM %s',
+                   pg_get_serial_sequence('matches', 'match_id'))
+    INTO last_id;
+
+    first_id := (last_id / partition_size) * partition_size;
+
+    FOR i IN 0..ahead LOOP
+        FOREACH parent IN ARRAY ARRAY['matches', 'matchplayers', 'elohistory'] LOOP
+            part_name := format('%s_p%s', parent, first_id / partition_size);
+
+            -- Tables from before partitioning are left as they are.
+            IF to_regclass(part_name) IS NULL
+               AND (SELECT relkind FROM pg_class WHERE oid = to_regclass(parent)) = 'p'
+            THEN
+                EXECUTE format('CREATE TABLE %I PARTITION OF %I FOR VALUES FROM (%s) TO (%s)',
+                               part_name, parent, first_id, first_id + partition_size);
+                created := created + 1;
+            END IF;
+        END LOOP;
+
+        first_id := first_id + partition_size;
+    END LOOP;
+
+    RETURN created;
+END;
+$$;
+
+COMMIT;
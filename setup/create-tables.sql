@@ -79,14 +79,42 @@ CREATE TABLE BannedIPs(
     original_expiration TIMESTAMPTZ NOT NULL
 );
 
+-- Match tables are partitioned by ranges of match_id. Ids come from one
+-- sequence, so every partition holds a contiguous stretch of time, and
+-- unlike finished_at the id is in every primary and foreign key.
+--
+-- Partitions are created ahead by ensure_match_partitions, which the
+-- server calls on startup and periodically.
+
 -- Create the matches table
 CREATE TABLE Matches(
     match_id BIGSERIAL PRIMARY KEY,
     game_mode SMALLINT NOT NULL,
     finished_at TIMESTAMPTZ NOT NULL DEFAULT now(),
     settings JSONB NOT NULL,
-    move_history JSONB NOT NULL
-);
+    -- Encoded move list, see src/server/replay-codec.cpp.
+    replay BYTEA,
+    -- Legacy JSON move list, moved into replay by the MigrateReplays command.
+    move_history JSONB,
+    -- First match of the archive segment holding the replay, once moved
+    -- out of the table, see src/server/replay-archive.h. -1 if it could
+    -- not be archived and is still in the table.
+    archive_segment BIGINT,
+    -- Set by the write-behind recorder, to replay its spill file safely.
+    record_id UUID,
+    CHECK (replay IS NOT NULL OR move_history IS NOT NULL OR archive_segment IS NOT NULL)
+) PARTITION BY RANGE (match_id);
+
+-- Not unique, that would need match_id in the key. The recorder looks up
+-- its record ids before inserting.
+CREATE INDEX idx_matches_record ON Matches(record_id) WHERE record_id IS NOT NULL;
+
+-- Replays still stored in the table, oldest first, for the archiver.
+CREATE INDEX idx_matches_unarchived ON Matches(match_id) WHERE archive_segment IS NULL;
+
+-- Mode and finish time of a match for its history row, without visiting
+-- the table and its replay.
+CREATE INDEX idx_matches_history ON Matches(match_id) INCLUDE (game_mode, finished_at);
 
 -- Create the match player's table
 CREATE TABLE MatchPlayers(
@@ -96,17 +124,74 @@ CREATE TABLE MatchPlayers(
     placement SMALLINT NOT NULL,
     PRIMARY KEY (match_id, user_id),
     UNIQUE (match_id, player_id)
-);
+) PARTITION BY RANGE (match_id);
+
+-- A user's matches in id order, which is finish order, so a history page
+-- is one range scan backwards from its cursor however deep it is.
+CREATE INDEX idx_match_players_user ON MatchPlayers(user_id, match_id) INCLUDE (placement);
 
 -- Create the elo history table
 CREATE TABLE EloHistory(
-    history_id BIGSERIAL PRIMARY KEY,
+    history_id BIGSERIAL,
     user_id UUID NOT NULL REFERENCES Users(user_id) ON DELETE RESTRICT,
-    match_id BIGINT REFERENCES Matches(match_id) ON DELETE SET NULL,
+    match_id BIGINT NOT NULL REFERENCES Matches(match_id) ON DELETE CASCADE,
     game_mode INT NOT NULL,
     old_elo INT NOT NULL,
-    new_elo INT NOT NULL
-);
+    new_elo INT NOT NULL,
+    PRIMARY KEY (match_id, history_id)
+) PARTITION BY RANGE (match_id);
+
+-- Elo change of a player in a match, for the match history.
+CREATE INDEX idx_elo_history_match_user ON EloHistory(match_id, user_id, game_mode)
+    INCLUDE (old_elo, new_elo);
+
+-- Creates the partition holding the newest match and the next ahead
+-- ones, for each match table. Returns how many were created.
+--
+-- The partition size must never change once partitions exist. Runs as
+-- its owner, so the server role needs no CREATE privilege.
+CREATE FUNCTION ensure_match_partitions(partition_size BIGINT, ahead INT)
+RETURNS INT
+LANGUAGE plpgsql
+SECURITY DEFINER
+SET search_path = public
+AS $$
+DECLARE
+    last_id BIGINT;
+    first_id BIGINT;
+    part_name TEXT;
+    parent TEXT;
+    created INT := 0;
+BEGIN
+    EXECUTE format('SELECT last_value FROM %s',
+                   pg_get_serial_sequence('matches', 'match_id'))
+    INTO last_id;
+
+    first_id := (last_id / partition_size) * partition_size;
+
+    FOR i IN 0..ahead LOOP
+        FOREACH parent IN ARRAY ARRAY['matches', 'matchplayers', 'elohistory'] LOOP
+            part_name := format('%s_p%s', parent, first_id / partition_size);
+
+            -- Tables from before partitioning are left as they are.
+            IF to_regclass(part_name) IS NULL
+               AND (SELECT relkind FROM pg_class WHERE oid = to_regclass(parent)) = 'p'
+            THEN
+                EXECUTE format('CREATE TABLE %I PARTITION OF %I FOR VALUES FROM (%s) TO (%s)',
+                               part_name, parent, first_id, first_id + partition_size);
+                created := created + 1;
+            END IF;
+        END LOOP;
+
+        first_id := first_id + partition_size;
+    END LOOP;
+
+    RETURN created;
+END;
+$$;
+
+-- Keep in step with MATCH_PARTITION_SIZE and MATCH_PARTITIONS_AHEAD.
+SELECT ensure_match_partitions(1000000, 2);
 
 -- Create the elo table
 CREATE TABLE UserElos(
@@ -0,0 +1,29 @@
+-- Copyright (c) 2025 Liam Mercier
+--
+-- This file is part of SilentTanks.
+--
+-- SilentTanks is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU Affero General Public License Version 3.0
+-- as published by the Free Software Foundation.
+--
+-- SilentTanks is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+-- for more details.
+--
+-- You should have received a copy of the GNU Affero General Public License v3.0
+-- along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+-- Upgrades a database created before replays were stored encoded.
+--
+-- Existing matches keep their JSON move list and still load. Run the
+-- MigrateReplays server command afterwards to convert them.
+
+BEGIN;
+
+ALTER TABLE Matches ADD COLUMN IF NOT EXISTS replay BYTEA;
+ALTER TABLE Matches ALTER COLUMN move_history DROP NOT NULL;
+ALTER TABLE Matches ADD CONSTRAINT matches_replay_present
+    CHECK (replay IS NOT NULL OR move_history IS NOT NULL);
+
+COMMIT;
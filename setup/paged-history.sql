@@ -0,0 +1,31 @@
+-- Copyright (c) 2025 Liam Mercier
+--
+-- This file is part of SilentTanks.
+--
+-- SilentTanks is free software: you can redistribute it and/or modify
+-- it under the terms of the GNU Affero General Public License Version 3.0
+-- as published by the Free Software Foundation.
+--
+-- SilentTanks is distributed in the hope that it will be useful, but
+-- WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+-- or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+-- for more details.
+--
+-- You should have received a copy of the GNU Affero General Public License v3.0
+-- along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+-- Upgrades a database created before match history was paged.
+--
+-- Rebuilds the player index ordered by match, and adds the index that
+-- history pages join through to each match's mode and finish time.
+
+BEGIN;
+
+DROP INDEX IF EXISTS idx_match_players_user;
+CREATE INDEX idx_match_players_user ON MatchPlayers(user_id, match_id) INCLUDE (placement);
+
+CREATE INDEX IF NOT EXISTS idx_matches_history ON Matches(match_id)
+    INCLUDE (game_mode, finished_at);
+
+COMMIT;
@@ -16,12 +16,26 @@
 
 #include "client-session.h"
 
-ClientSession::ClientSession(asio::io_context & cntx)
+// asio owns the context's app data, so we reserve our own index to find
+// the session from the new session callback.
+static int client_session_index()
+{
+    static const int index = SSL_CTX_get_ex_new_index(0,
+                                                      nullptr,
+                                                      nullptr,
+                                                      nullptr,
+                                                      nullptr);
+    return index;
+}
+
+ClientSession::ClientSession(asio::io_context & cntx,
+                             std::shared_ptr<TlsSessionStore> session_store)
 :ssl_cntx_(asio::ssl::context::tls_client),
 ssl_socket_(cntx, ssl_cntx_),
 strand_(cntx.get_executor()),
 resolver_(cntx),
-connect_timer_(cntx)
+connect_timer_(cntx),
+session_store_(std::move(session_store))
 {
     ssl_cntx_.set_options(
         asio::ssl::context::default_workarounds
@@ -30,6 +44,33 @@ connect_timer_(cntx)
         | asio::ssl::context::no_tlsv1
         | asio::ssl::context::no_tlsv1_1
     );
+
+    // Hand sessions to the store instead of the context, since each
+    // ClientSession has its own context and would lose them on reconnect.
+    SSL_CTX * native_cntx = ssl_cntx_.native_handle();
+
+    SSL_CTX_set_session_cache_mode(native_cntx,
+                                   SSL_SESS_CACHE_CLIENT
+                                   | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+    SSL_CTX_set_ex_data(native_cntx, client_session_index(), this);
+    SSL_CTX_sess_set_new_cb(native_cntx, &ClientSession::on_new_tls_session);
+}
+
+int ClientSession::on_new_tls_session(SSL * ssl, SSL_SESSION * session)
+{
+    auto * self = static_cast<ClientSession *>(
+                    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl),
+                                        client_session_index()));
+
+    if (!self || !self->session_store_)
+    {
+        return 0;
+    }
+
+    // Returning 1 tells OpenSSL that the store now owns the reference.
+    self->session_store_->store(self->session_key_, session);
+    return 1;
 }
 
 void ClientSession::set_message_handler(MessageHandler m_handler,
@@ -47,6 +88,7 @@ void ClientSession::start(ServerIdentity identity)
 {
     std::cout << "Starting client session!\n\n";
 
+    session_key_ = identity.get_hashmap_string();
     in_fingerprint_ = std::move(identity.display_hash);
 
     ssl_cntx_.set_default_verify_paths();
@@ -199,6 +241,16 @@ void ClientSession::on_connect(boost::system::error_code ec,
               << ep
               << " starting TLS handshake\n\n";
 
+    // Try to resume a previous session with this server. If the server
+    // no longer accepts it, OpenSSL falls back to a full handshake.
+    if (session_store_)
+    {
+        if (auto resumable = session_store_->get(session_key_))
+        {
+            SSL_set_session(ssl_socket_.native_handle(), resumable.get());
+        }
+    }
+
     ssl_socket_.async_handshake(asio::ssl::stream_base::client,
         asio::bind_executor(strand_,
             [self = shared_from_this()](boost::system::error_code ec)
@@ -235,6 +287,12 @@ void ClientSession::on_connect(boost::system::error_code ec,
 
                     self->on_alert_relay_(std::move(bad_tls));
 
+                    // Do not retry with a session that may be the problem.
+                    if (self->session_store_)
+                    {
+                        self->session_store_->forget(self->session_key_);
+                    }
+
                     self->force_close_session();
                     return;
                 }
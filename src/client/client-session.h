@@ -28,6 +28,7 @@
 #include "message.h"
 #include "header.h"
 #include "server-identity.h"
+#include "tls-session-store.h"
 
 constexpr int CONNECTION_WAIT_TIME = 5;
 
@@ -45,7 +46,8 @@ public:
     using DisconnectHandler = std::function<void()>;
     using AlertHandler = std::function<void(std::string alert)>;
 
-    ClientSession(asio::io_context & cntx);
+    ClientSession(asio::io_context & cntx,
+                  std::shared_ptr<TlsSessionStore> session_store);
 
     void set_message_handler(MessageHandler handler,
                              ConnectionHandler c_handler,
@@ -97,6 +99,9 @@ private:
 
     void force_close_session();
 
+    // Called by OpenSSL when the server issues a session we can resume.
+    static int on_new_tls_session(SSL * ssl, SSL_SESSION * session);
+
 public:
 
 private:
@@ -110,6 +115,10 @@ private:
 
     std::string in_fingerprint_;
 
+    // Shared between sessions so reconnects can resume the TLS session.
+    std::shared_ptr<TlsSessionStore> session_store_;
+    std::string session_key_;
+
     // Data related members.
     Header incoming_header_;
     std::vector<uint8_t> incoming_body_;
@@ -47,6 +47,8 @@ enum class QueueType : uint8_t
     ClassicThreePlayer,
     ClassicFivePlayer,
     RankedTwoPlayer,
+    RankedThreePlayer,
+    RankedFivePlayer,
     NO_MODE
 };
 
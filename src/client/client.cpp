@@ -57,7 +57,10 @@ Client::Client(asio::io_context & cntx,
                QueueUpdateCallback queue_update_callback,
                DisplayMessageCallback display_message_callback,
                MatchHistoryCallback match_history_callback,
+               LeaderboardCallback leaderboard_callback,
                ViewUpdateCallback view_callback,
+               MoveRejectedCallback move_rejected_callback,
+               TurnBatchResultCallback turn_batch_result_callback,
                MatchDataCallback match_data_callback,
                MatchReplayCallback match_replay_callback,
                ShutdownCallback shutdown_callback)
@@ -71,7 +74,10 @@ users_updated_callback_(std::move(users_updated_callback)),
 queue_update_callback_(std::move(queue_update_callback)),
 display_message_callback_(std::move(display_message_callback)),
 match_history_callback_(std::move(match_history_callback)),
+leaderboard_callback_(std::move(leaderboard_callback)),
 view_callback_(std::move(view_callback)),
+move_rejected_callback_(std::move(move_rejected_callback)),
+turn_batch_result_callback_(std::move(turn_batch_result_callback)),
 match_data_callback_(std::move(match_data_callback)),
 match_replay_callback_(std::move(match_replay_callback)),
 shutdown_callback_(std::move(shutdown_callback))
@@ -92,7 +98,8 @@ void Client::connect(ServerIdentity identity)
 
         this->current_session_ = std::make_shared<ClientSession>
                                     (
-                                        io_context_
+                                        io_context_,
+                                        tls_sessions_
                                     );
 
         this->current_session_->set_message_handler
@@ -641,6 +648,33 @@ void Client::send_command(Command cmd)
     });
 }
 
+void Client::send_turn_batch(TurnBatch batch)
+{
+    // Prevent commands when not playing.
+    {
+        std::lock_guard lock(state_mutex_);
+        if (state_ != ClientState::Playing)
+        {
+            return;
+        }
+    }
+
+    if (batch.commands.empty() || batch.commands.size() > MAX_TURN_BATCH)
+    {
+        return;
+    }
+
+    asio::post(client_strand_,
+        [this,
+        batch = std::move(batch)]{
+
+        Message command;
+        command.create_serialized(batch);
+        current_session_->deliver(command);
+
+    });
+}
+
 void Client::forfeit_request()
 {
     // Prevent forfeit when not playing.
@@ -652,6 +686,13 @@ void Client::forfeit_request()
         }
     }
 
+    // Leaving a spectated match is not a forfeit.
+    if (spectating_.load(std::memory_order_acquire))
+    {
+        stop_spectating();
+        return;
+    }
+
     asio::post(client_strand_,
         [this]{
 
@@ -662,6 +703,74 @@ void Client::forfeit_request()
     });
 }
 
+void Client::spectate_match(uint64_t match_id, bool fogged)
+{
+    // Prevent spectating from inside a match.
+    if (get_state() == ClientState::Playing)
+    {
+        return;
+    }
+
+    asio::post(client_strand_,
+        [this,
+        match_id,
+        fogged]{
+
+        SpectateRequest req;
+        req.fogged = fogged;
+        req.match_id = match_id;
+
+        Message spectate;
+        spectate.create_serialized(req);
+        current_session_->deliver(spectate);
+
+    });
+}
+
+void Client::spectate_friend(boost::uuids::uuid friend_id, bool fogged)
+{
+    // Prevent spectating from inside a match.
+    if (get_state() == ClientState::Playing)
+    {
+        return;
+    }
+
+    asio::post(client_strand_,
+        [this,
+        friend_id,
+        fogged]{
+
+        SpectateRequest req;
+        req.fogged = fogged;
+        req.by_user = true;
+        req.user_id = friend_id;
+
+        Message spectate;
+        spectate.create_serialized(req);
+        current_session_->deliver(spectate);
+
+    });
+}
+
+void Client::stop_spectating()
+{
+    if (!spectating_.exchange(false, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    asio::post(client_strand_,
+        [this]{
+
+        Message stop;
+        stop.create_serialized(HeaderType::StopSpectating);
+        current_session_->deliver(stop);
+
+    });
+
+    change_state(ClientState::Lobby);
+}
+
 void Client::interpret_message(std::string message)
 {
     if (message.size() < 1)
@@ -777,13 +886,17 @@ void Client::interpret_message(std::string message)
     });
 }
 
-void Client::fetch_match_history(GameMode mode)
+void Client::fetch_match_history(GameMode mode,
+                                 MatchHistoryCursor after,
+                                 uint8_t page_size)
 {
     asio::post(client_strand_,
         [this,
-        mode]{
+        mode,
+        after,
+        page_size]{
 
-        MatchHistoryRequest history_req(mode);
+        MatchHistoryPageRequest history_req{mode, page_size, after};
 
         Message match_history_request;
         match_history_request.create_serialized(history_req);
@@ -791,6 +904,24 @@ void Client::fetch_match_history(GameMode mode)
     });
 }
 
+void Client::fetch_leaderboard(GameMode mode,
+                               LeaderboardRequest::Kind kind,
+                               uint8_t count)
+{
+    asio::post(client_strand_,
+        [this,
+        mode,
+        kind,
+        count]{
+
+        LeaderboardRequest leaderboard_req{mode, kind, count};
+
+        Message leaderboard_request;
+        leaderboard_request.create_serialized(leaderboard_req);
+        current_session_->deliver(leaderboard_request);
+    });
+}
+
 void Client::request_match_replay(uint64_t match_id)
 {
     asio::post(client_strand_,
@@ -1405,14 +1536,107 @@ try {
 
             break;
         }
+        case HeaderType::SpectatorView:
+        {
+            bool status;
+            PlayerView current_view = msg.to_player_view(status);
+
+            if (status == false)
+            {
+                std::cerr << TERM_RED
+                          << "Failed to convert spectator view.\n"
+                          << TERM_RESET;
+                break;
+            }
+
+            // Frames can still arrive just after we stop watching.
+            if (!spectating_.load(std::memory_order_acquire)
+                && get_state() == ClientState::Playing)
+            {
+                break;
+            }
+
+            spectating_.store(true, std::memory_order_release);
+
+            view_callback_(current_view);
+
+            if (get_state() != ClientState::Playing)
+            {
+                change_state(ClientState::Playing);
+            }
+
+            break;
+        }
+        case HeaderType::SpectateFailed:
+        {
+            std::cout << "Could not spectate the match.\n";
+            popup_callback_(Popup(
+                            PopupType::Info,
+                            "Spectate Failed",
+                            "The match could not be found or is not open to you."),
+                            STANDARD_POPUP);
+            break;
+        }
+        case HeaderType::SpectateEnded:
+        {
+            std::cout << "The spectated match has ended.\n";
+
+            if (!spectating_.exchange(false, std::memory_order_acq_rel))
+            {
+                break;
+            }
+
+            popup_callback_(Popup(
+                            PopupType::Info,
+                            "Match Ended",
+                            "The match you were watching has ended."),
+                            STANDARD_POPUP);
+
+            change_state(ClientState::Lobby);
+            break;
+        }
         case HeaderType::FailedMove:
         {
             std::cerr << "Failed to execute move.\n";
+            move_rejected_callback_();
             break;
         }
         case HeaderType::StaleMove:
         {
             std::cerr << "Stale move detected.\n";
+            move_rejected_callback_();
+            break;
+        }
+        case HeaderType::TurnBatchResult:
+        {
+            bool status;
+            TurnBatchResult result = msg.to_turn_batch_result(status);
+
+            if (status == false)
+            {
+                std::cerr << TERM_RED
+                          << "Failed to convert turn batch result.\n"
+                          << TERM_RESET;
+                break;
+            }
+
+            for (size_t i = 0; i < result.status.size(); i++)
+            {
+                if (result.status[i] == BatchStatus::Failed)
+                {
+                    std::cerr << "Failed to execute move "
+                              << i
+                              << " of turn batch.\n";
+                }
+                else if (result.status[i] == BatchStatus::Skipped)
+                {
+                    std::cerr << "Move "
+                              << i
+                              << " of turn batch was skipped.\n";
+                }
+            }
+
+            turn_batch_result_callback_(std::move(result));
             break;
         }
         case HeaderType::Eliminated:
@@ -1590,11 +1814,26 @@ try {
             display_message_callback_(std::move(callback_formatted_string));
             break;
         }
-        case HeaderType::MatchHistory:
+        case HeaderType::MatchHistoryPage:
         {
-            MatchResultList results = msg.to_results_list();
+            bool op_status = false;
+            MatchHistoryPage page = msg.to_history_page(op_status);
 
-            match_history_callback_(std::move(results));
+            if (op_status)
+            {
+                match_history_callback_(std::move(page));
+            }
+            break;
+        }
+        case HeaderType::Leaderboard:
+        {
+            bool op_status = false;
+            LeaderboardPage page = msg.to_leaderboard_page(op_status);
+
+            if (op_status)
+            {
+                leaderboard_callback_(std::move(page));
+            }
             break;
         }
         case HeaderType::NoNewMatches:
@@ -41,10 +41,18 @@ public:
 
     using DisplayMessageCallback = std::function<void(std::string message)>;
 
-    using MatchHistoryCallback = std::function<void(MatchResultList results)>;
+    using MatchHistoryCallback = std::function<void(MatchHistoryPage page)>;
+
+    using LeaderboardCallback = std::function<void(LeaderboardPage page)>;
 
     using ViewUpdateCallback = std::function<void(PlayerView new_view)>;
 
+    // Called when the server refuses one of our commands.
+    using MoveRejectedCallback = std::function<void()>;
+
+    // Called with the outcome of each command in our last turn batch.
+    using TurnBatchResultCallback = std::function<void(TurnBatchResult result)>;
+
     using MatchDataCallback = std::function<void(StaticMatchData data)>;
 
     using MatchReplayCallback = std::function<void(MatchReplay replay)>;
@@ -59,7 +67,10 @@ public:
            QueueUpdateCallback queue_update_callback,
            DisplayMessageCallback display_message_callback,
            MatchHistoryCallback match_history_callback,
+           LeaderboardCallback leaderboard_callback,
            ViewUpdateCallback view_callback,
+           MoveRejectedCallback move_rejected_callback,
+           TurnBatchResultCallback turn_batch_result_callback,
            MatchDataCallback match_data_callback,
            MatchReplayCallback match_replay_callback,
            ShutdownCallback shutdown_callback);
@@ -95,11 +106,29 @@ public:
 
     void send_command(Command cmd);
 
+    // Send a whole turn of commands to be applied together.
+    void send_turn_batch(TurnBatch batch);
+
     void forfeit_request();
 
+    // Watch a live match by its ID, or the match a friend is playing.
+    void spectate_match(uint64_t match_id, bool fogged);
+
+    void spectate_friend(boost::uuids::uuid friend_id, bool fogged);
+
+    void stop_spectating();
+
     void interpret_message(std::string message);
 
-    void fetch_match_history(GameMode mode);
+    // Up to page_size matches older than the cursor, newest first.
+    void fetch_match_history(GameMode mode,
+                             MatchHistoryCursor after,
+                             uint8_t page_size);
+
+    // The top count players of a ranked mode, or count players around us.
+    void fetch_leaderboard(GameMode mode,
+                           LeaderboardRequest::Kind kind,
+                           uint8_t count);
 
     void request_match_replay(uint64_t match_id);
 
@@ -126,12 +155,18 @@ private:
 
     std::atomic<bool> playing_{true};
 
+    std::atomic<bool> spectating_{false};
+
     mutable std::mutex data_mutex_;
     ClientData client_data_;
     GameMode last_queued_mode_{GameMode::NO_MODE};
 
     ClientSession::ptr current_session_;
 
+    // Outlives each session so reconnects can resume TLS.
+    std::shared_ptr<TlsSessionStore> tls_sessions_{
+        std::make_shared<TlsSessionStore>()};
+
     std::atomic<bool> shutting_down_{false};
 
     LoginCallback login_callback_;
@@ -141,7 +176,10 @@ private:
     QueueUpdateCallback queue_update_callback_;
     DisplayMessageCallback display_message_callback_;
     MatchHistoryCallback match_history_callback_;
+    LeaderboardCallback leaderboard_callback_;
     ViewUpdateCallback view_callback_;
+    MoveRejectedCallback move_rejected_callback_;
+    TurnBatchResultCallback turn_batch_result_callback_;
     MatchDataCallback match_data_callback_;
     MatchReplayCallback match_replay_callback_;
     ShutdownCallback shutdown_callback_;
@@ -16,6 +16,8 @@
 
 #include "game-manager.h"
 
+#include <algorithm>
+
 // Helper to compare usernames.
 constexpr bool same_username(const std::string & a, const std::string & b)
 {
@@ -143,8 +145,42 @@ void GameManager::update_view(PlayerView new_view)
     bool width_changed = (new_view.width() != current_view_.width());
     bool height_changed = (new_view.height() != current_view_.height());
 
+    server_view_ = std::move(new_view);
+
+    // The turn ended before we finished it, e.g. we ran out of time,
+    // so the held commands will never be sent.
+    if (!held_.commands.empty() && server_view_.current_player != player_id_)
+    {
+        std::vector<uint16_t> sequences;
+
+        for (const Command & held : held_.commands)
+        {
+            sequences.push_back(held.sequence_number);
+        }
+
+        drop_pending(sequences);
+        held_.commands.clear();
+    }
+
+    // Carry on from the server's count, which is not zero when we
+    // rejoin a match already under way.
+    if (seed_sequence_)
+    {
+        sequence_number_ = server_view_.last_sequence;
+        seed_sequence_ = false;
+    }
+
+    // Drop the commands this view already includes. Compare with
+    // wraparound in case a long match overflows the sequence number.
+    while (!pending_.empty()
+           && static_cast<int16_t>(pending_.front().sequence_number
+                                   - server_view_.last_sequence) <= 0)
+    {
+        pending_.pop_front();
+    }
+
     beginResetModel();
-    current_view_ = new_view;
+    rebuild_view();
     players_.set_timers(current_view_.timers);
     endResetModel();
 
@@ -158,6 +194,252 @@ void GameManager::update_view(PlayerView new_view)
         }
     }
 
+    notify_view_changed(width_changed, height_changed);
+}
+
+Command GameManager::predict(Command cmd)
+{
+    // Start at 1 so that a view acknowledging 0 confirms nothing.
+    sequence_number_ += 1;
+    cmd.sequence_number = sequence_number_;
+
+    pending_.push_back(cmd);
+
+    beginResetModel();
+    apply_prediction(cmd, current_view_);
+    endResetModel();
+
+    notify_view_changed(false, false);
+
+    return cmd;
+}
+
+void GameManager::reject_prediction()
+{
+    if (pending_.empty())
+    {
+        return;
+    }
+
+    pending_.pop_front();
+
+    beginResetModel();
+    rebuild_view();
+    endResetModel();
+
+    notify_view_changed(false, false);
+}
+
+std::optional<TurnBatch> GameManager::queue(Command cmd)
+{
+    cmd = predict(std::move(cmd));
+    held_.commands.push_back(cmd);
+
+    // Anything after a shot may depend on what it hit.
+    if (!turn_spent_
+        && cmd.type != CommandType::Fire
+        && held_.commands.size() < MAX_TURN_BATCH)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<uint16_t> sequences;
+
+    for (const Command & held : held_.commands)
+    {
+        sequences.push_back(held.sequence_number);
+    }
+
+    sent_batches_.push_back(std::move(sequences));
+
+    TurnBatch batch = std::move(held_);
+    held_.commands.clear();
+
+    return batch;
+}
+
+void GameManager::batch_result(const TurnBatchResult & result)
+{
+    if (sent_batches_.empty())
+    {
+        return;
+    }
+
+    std::vector<uint16_t> sequences = std::move(sent_batches_.front());
+    sent_batches_.pop_front();
+
+    // Applied commands are confirmed by the view that follows.
+    std::vector<uint16_t> dropped;
+
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+        if (i >= result.status.size()
+            || result.status[i] != BatchStatus::Applied)
+        {
+            dropped.push_back(sequences[i]);
+        }
+    }
+
+    if (dropped.empty())
+    {
+        return;
+    }
+
+    drop_pending(dropped);
+
+    beginResetModel();
+    rebuild_view();
+    endResetModel();
+
+    notify_view_changed(false, false);
+}
+
+void GameManager::drop_pending(const std::vector<uint16_t> & sequences)
+{
+    std::erase_if(pending_, [&sequences](const Command & cmd){
+        return std::find(sequences.begin(),
+                         sequences.end(),
+                         cmd.sequence_number) != sequences.end();
+    });
+}
+
+void GameManager::rebuild_view()
+{
+    current_view_ = server_view_;
+    turn_spent_ = false;
+
+    for (const Command & cmd : pending_)
+    {
+        apply_prediction(cmd, current_view_);
+    }
+}
+
+bool GameManager::apply_prediction(const Command & cmd, PlayerView & view)
+{
+    if (view.current_player != player_id_ || turn_spent_)
+    {
+        return false;
+    }
+
+    // Tank placement ends the turn in setup, the tank itself
+    // shows up once the server assigns it an ID.
+    if (view.current_state == GameState::Setup)
+    {
+        turn_spent_ = (cmd.type == CommandType::Place);
+        return false;
+    }
+
+    // Every command uses fuel, even ones we can not predict.
+    // A rejection rebuilds the view and gives it back.
+    view.current_fuel = (view.current_fuel > 0) ? view.current_fuel - 1 : 0;
+    turn_spent_ = (view.current_fuel == 0);
+
+    // Firing depends on what we can not see, wait for the server.
+    if (cmd.type == CommandType::Fire || cmd.type == CommandType::Place)
+    {
+        return false;
+    }
+
+    Tank * tank = nullptr;
+
+    for (auto & visible : view.visible_tanks)
+    {
+        if (visible.id_ == cmd.tank_id)
+        {
+            tank = &visible;
+            break;
+        }
+    }
+
+    if (!tank || tank->owner_ != player_id_ || tank->health_ == 0)
+    {
+        return false;
+    }
+
+    switch (cmd.type)
+    {
+        case CommandType::Move:
+        {
+            uint8_t dir = tank->current_direction_;
+
+            if (cmd.payload_first)
+            {
+                dir = (dir + 4) % 8;
+            }
+
+            // Out of bounds wraps past the width or height, same as the
+            // check done by the server.
+            vec2 next = tank->pos_ + dir_to_vec[dir];
+
+            if (next.x_ >= view.width() || next.y_ >= view.height())
+            {
+                return false;
+            }
+
+            GridCell & from = view.map_view[view.indx(tank->pos_.x_, tank->pos_.y_)];
+            GridCell & to = view.map_view[view.indx(next.x_, next.y_)];
+
+            if (to.type_ == CellType::Terrain || to.occupant_ != NO_OCCUPANT)
+            {
+                return false;
+            }
+
+            // Same diagonal rule as GameInstance::move_tank.
+            if (cuts_between_terrain(view.map_view, tank->pos_, next))
+            {
+                return false;
+            }
+
+            from.occupant_ = NO_OCCUPANT;
+            to.occupant_ = tank->id_;
+            to.visible_ = true;
+
+            tank->pos_ = next;
+            return true;
+        }
+        case CommandType::RotateTank:
+        {
+            if (cmd.payload_first == 0)
+            {
+                tank->turn_clockwise();
+            }
+            else
+            {
+                tank->turn_counter_clockwise();
+            }
+            return true;
+        }
+        case CommandType::RotateBarrel:
+        {
+            if (cmd.payload_first == 0)
+            {
+                tank->barrel_clockwise();
+            }
+            else
+            {
+                tank->barrel_counter_clockwise();
+            }
+            return true;
+        }
+        case CommandType::Load:
+        {
+            if (tank->loaded_)
+            {
+                return false;
+            }
+
+            tank->loaded_ = true;
+            return true;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+void GameManager::notify_view_changed(bool width_changed, bool height_changed)
+{
     if (width_changed)
     {
         emit map_width_changed();
@@ -179,10 +461,17 @@ void GameManager::update_match_data(StaticMatchData data, std::string username)
     current_data_ = data;
     players_.set_users(data.player_list);
 
-    // Game server will dump old commands, so just reset our sequence number.
-    sequence_number_ = 0;
+    // Game server will dump old commands, the next view seeds our
+    // sequence number.
+    seed_sequence_ = true;
+    pending_.clear();
+    held_.commands.clear();
+    sent_batches_.clear();
+    turn_spent_ = false;
+
+    // find our player ID, spectators are not in the player list.
+    player_id_ = UINT8_MAX;
 
-    // find our player ID.
     for (unsigned int i = 0; i < current_data_.player_list.users.size(); i++)
     {
         if (same_username(current_data_.player_list.users[i].username, username))
@@ -231,11 +520,6 @@ QString GameManager::player() const
     return QString::fromStdString(username);
 }
 
-uint16_t GameManager::sequence_number()
-{
-    return sequence_number_;
-}
-
 uint8_t GameManager::tank_at(int x, int y)
 {
     return current_view_.map_view[current_view_.indx(x, y)].occupant_;
@@ -243,7 +527,7 @@ uint8_t GameManager::tank_at(int x, int y)
 
 Q_INVOKABLE bool GameManager::is_turn()
 {
-    return current_view_.current_player == player_id_;
+    return current_view_.current_player == player_id_ && !turn_spent_;
 }
 
 Q_INVOKABLE bool GameManager::is_friendly_tank(uint8_t tank_id)
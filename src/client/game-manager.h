@@ -20,10 +20,15 @@
 #include <QVariantMap>
 #include <QObject>
 
+#include <deque>
+#include <optional>
+#include <vector>
+
 #include "client-state.h"
 #include "user-list-model.h"
 #include "player-view.h"
 #include "message-structs.h"
+#include "command.h"
 
 class GameManager : public QAbstractListModel
 {
@@ -77,6 +82,22 @@ public:
     // Callable from C++ code for changing the view.
     void update_view(PlayerView new_view);
 
+    // Apply one of our own commands to the displayed view before the
+    // server confirms it. Returns the command with its sequence number
+    // set, ready to send.
+    Command predict(Command cmd);
+
+    // The server refused our oldest unconfirmed command, undo it.
+    void reject_prediction();
+
+    // Predict a command and hold it with the rest of the turn. Returns
+    // the held commands as one batch once the turn is used up, or once
+    // a shot needs the server to resolve it.
+    std::optional<TurnBatch> queue(Command cmd);
+
+    // The server answered our oldest batch, undo what it did not apply.
+    void batch_result(const TurnBatchResult & result);
+
     void update_match_data(StaticMatchData data, std::string username);
 
     int map_width() const;
@@ -89,8 +110,6 @@ public:
 
     QString player() const;
 
-    uint16_t sequence_number();
-
     uint8_t tank_at(int x, int y);
 
     Q_INVOKABLE bool is_turn();
@@ -117,7 +136,39 @@ signals:
     void timers_changed();
 
 private:
+    // Rebuild the displayed view from the server view and the
+    // unconfirmed commands.
+    void rebuild_view();
+
+    // Returns false if the command could not be predicted.
+    bool apply_prediction(const Command & cmd, PlayerView & view);
+
+    // Remove the given commands from pending_.
+    void drop_pending(const std::vector<uint16_t> & sequences);
+
+    void notify_view_changed(bool width_changed, bool height_changed);
+
+private:
+    // What we display, server_view_ with pending_ applied on top.
     PlayerView current_view_;
+
+    // Last authoritative view from the server.
+    PlayerView server_view_;
+
+    // Commands sent but not yet reflected in server_view_, oldest first.
+    // The server applies commands in sequence order, so confirmations
+    // and rejections always refer to the front.
+    std::deque<Command> pending_;
+
+    // Set when the pending commands use up the rest of our turn.
+    bool turn_spent_{false};
+
+    // Commands predicted this turn but not sent yet, also in pending_.
+    TurnBatch held_;
+
+    // Sequence numbers of each batch sent but not answered, oldest first.
+    std::deque<std::vector<uint16_t>> sent_batches_;
+
     StaticMatchData current_data_;
     UserListModel players_;
 
@@ -126,5 +177,9 @@ private:
     // Increasing number across a game,
     uint16_t sequence_number_{0};
 
+    // Set for a new match, the first view then seeds sequence_number_
+    // with the last sequence the server applied for us.
+    bool seed_sequence_{true};
+
     PlaySoundCallback sound_callback_;
 };
@@ -104,14 +104,20 @@ client_
         },
         Qt::QueuedConnection);
     },
-    [this](MatchResultList results){
-        QMetaObject::invokeMethod(this, [this, results]{
+    [this](MatchHistoryPage page){
+        QMetaObject::invokeMethod(this, [this, page = std::move(page)]{
             {
-                this->match_history_.set_history_row(results);
+                this->match_history_.add_page(page);
             }
         },
         Qt::QueuedConnection);
     },
+    [this](LeaderboardPage page){
+        QMetaObject::invokeMethod(this, [this, page = std::move(page)]{
+            this->leaderboard_.set_page(page);
+        },
+        Qt::QueuedConnection);
+    },
     [this](PlayerView new_view){
         QMetaObject::invokeMethod(this, [this, view = std::move(new_view)]{
             {
@@ -120,6 +126,18 @@ client_
         },
         Qt::QueuedConnection);
     },
+    [this](){
+        QMetaObject::invokeMethod(this, [this]{
+            this->game_manager_.reject_prediction();
+        },
+        Qt::QueuedConnection);
+    },
+    [this](TurnBatchResult result){
+        QMetaObject::invokeMethod(this, [this, result = std::move(result)]{
+            this->game_manager_.batch_result(result);
+        },
+        Qt::QueuedConnection);
+    },
     [this](StaticMatchData data){
         QMetaObject::invokeMethod(this, [this, data = std::move(data)]{
             {
@@ -144,6 +162,12 @@ server_list_(server_list_filename),
 friends_(this),
 friend_requests_(this),
 blocked_(this),
+match_history_(nullptr,
+    [this](GameMode mode, MatchHistoryCursor after, uint8_t page_size){
+        client_.fetch_match_history(mode, after, page_size);
+    }
+),
+leaderboard_(nullptr),
 game_manager_(nullptr,
     [this](SoundType sound){
         emit play_sound(sound);
@@ -244,6 +268,11 @@ MatchHistoryModel* GUIClient::history_model()
     return & match_history_;
 }
 
+LeaderboardModel* GUIClient::leaderboard_model()
+{
+    return & leaderboard_;
+}
+
 GameManager* GUIClient::game_manager()
 {
     return & game_manager_;
@@ -441,7 +470,24 @@ Q_INVOKABLE QVariant GUIClient::get_elo(QueueType mode)
 
 Q_INVOKABLE void GUIClient::fetch_match_history(QueueType mode)
 {
-    client_.fetch_match_history(static_cast<GameMode>(mode));
+    match_history_.reload(static_cast<GameMode>(mode));
+}
+
+Q_INVOKABLE void GUIClient::fetch_leaderboard(QueueType mode, bool around_me)
+{
+    if (static_cast<uint8_t>(mode) < RANKED_MODES_START
+        || mode == QueueType::NO_MODE)
+    {
+        return;
+    }
+
+    LeaderboardRequest::Kind kind = around_me
+                                    ? LeaderboardRequest::Kind::AroundMe
+                                    : LeaderboardRequest::Kind::Top;
+
+    client_.fetch_leaderboard(static_cast<GameMode>(mode),
+                              kind,
+                              LEADERBOARD_PAGE_SIZE);
 }
 
 Q_INVOKABLE void GUIClient::download_match_by_id(qint64 match_id)
@@ -465,6 +511,18 @@ Q_INVOKABLE void GUIClient::send_forfeit()
     client_.forfeit_request();
 }
 
+Q_INVOKABLE void GUIClient::spectate_friend(const QString & uuid, bool fogged)
+{
+    boost::uuids::string_generator gen;
+    boost::uuids::uuid user_id = gen(uuid.toStdString());
+    client_.spectate_friend(user_id, fogged);
+}
+
+Q_INVOKABLE void GUIClient::spectate_match(qint64 match_id, bool fogged)
+{
+    client_.spectate_match(static_cast<uint64_t>(match_id), fogged);
+}
+
 Q_INVOKABLE void GUIClient::send_place_tank(int x,
                                             int y,
                                             int placement_direction)
@@ -478,7 +536,6 @@ Q_INVOKABLE void GUIClient::send_place_tank(int x,
 
     // Fetch from game manager.
     cmd.type = CommandType::Place;
-    cmd.sequence_number = game_manager_.sequence_number();
     cmd.payload_first = x;
     cmd.payload_second = y;
 
@@ -489,7 +546,7 @@ Q_INVOKABLE void GUIClient::send_place_tank(int x,
     cmd.sender = 0;
 
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 }
 
 Q_INVOKABLE void GUIClient::send_rotate_barrel(int x, int y, int rotation)
@@ -502,7 +559,6 @@ Q_INVOKABLE void GUIClient::send_rotate_barrel(int x, int y, int rotation)
     Command cmd;
 
     cmd.type = CommandType::RotateBarrel;
-    cmd.sequence_number = game_manager_.sequence_number();
     cmd.tank_id = game_manager_.tank_at(x, y);
     cmd.payload_first = rotation;
 
@@ -510,7 +566,7 @@ Q_INVOKABLE void GUIClient::send_rotate_barrel(int x, int y, int rotation)
     cmd.payload_second = 0;
     cmd.sender = 0;
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 
     emit play_sound(SoundType::Rotate);
 }
@@ -525,7 +581,6 @@ Q_INVOKABLE void GUIClient::send_move_tank(int x, int y, int dir)
     Command cmd;
 
     cmd.type = CommandType::Move;
-    cmd.sequence_number = game_manager_.sequence_number();
     cmd.tank_id = game_manager_.tank_at(x, y);
     cmd.payload_first = dir;
 
@@ -533,7 +588,7 @@ Q_INVOKABLE void GUIClient::send_move_tank(int x, int y, int dir)
     cmd.payload_second = 0;
     cmd.sender = 0;
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 
     emit play_sound(SoundType::Move);
 }
@@ -548,7 +603,6 @@ Q_INVOKABLE void GUIClient::send_rotate_tank(int x, int y, int rotation)
     Command cmd;
 
     cmd.type = CommandType::RotateTank;
-    cmd.sequence_number = game_manager_.sequence_number();
     cmd.tank_id = game_manager_.tank_at(x, y);
     cmd.payload_first = rotation;
 
@@ -556,7 +610,7 @@ Q_INVOKABLE void GUIClient::send_rotate_tank(int x, int y, int rotation)
     cmd.payload_second = 0;
     cmd.sender = 0;
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 
     emit play_sound(SoundType::Rotate);
 }
@@ -580,14 +634,13 @@ Q_INVOKABLE void GUIClient::send_fire_tank(int x, int y)
 
     // If we have ammo, send firing command.
     cmd.type = CommandType::Fire;
-    cmd.sequence_number = game_manager_.sequence_number();
 
     // Fill empty fields with 0.
     cmd.payload_first = 0;
     cmd.payload_second = 0;
     cmd.sender = 0;
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 
     emit play_sound(SoundType::CannonFiring);
 }
@@ -602,7 +655,6 @@ Q_INVOKABLE void GUIClient::send_reload_tank(int x, int y)
     Command cmd;
 
     cmd.type = CommandType::Load;
-    cmd.sequence_number = game_manager_.sequence_number();
     cmd.tank_id = game_manager_.tank_at(x, y);
 
     // Fill empty fields with 0.
@@ -610,11 +662,21 @@ Q_INVOKABLE void GUIClient::send_reload_tank(int x, int y)
     cmd.payload_second = 0;
     cmd.sender = 0;
 
-    client_.send_command(std::move(cmd));
+    queue_command(std::move(cmd));
 
     emit play_sound(SoundType::Reload);
 }
 
+void GUIClient::queue_command(Command cmd)
+{
+    std::optional<TurnBatch> batch = game_manager_.queue(std::move(cmd));
+
+    if (batch)
+    {
+        client_.send_turn_batch(std::move(*batch));
+    }
+}
+
 Q_INVOKABLE void GUIClient::shutdown_client()
 {
     client_.shutdown();
@@ -21,6 +21,7 @@
 #include "user-list-model.h"
 #include "message-model.h"
 #include "match-history-model.h"
+#include "leaderboard-model.h"
 #include "game-manager.h"
 #include "replay-manager.h"
 
@@ -101,6 +102,8 @@ public:
 
     MatchHistoryModel* history_model();
 
+    LeaderboardModel* leaderboard_model();
+
     GameManager* game_manager();
 
     ReplayManager* replay_manager();
@@ -148,8 +151,13 @@ public:
 
     Q_INVOKABLE QVariant get_elo(QueueType mode);
 
+    // Reloads the mode from its newest match, older pages follow as the
+    // history view scrolls.
     Q_INVOKABLE void fetch_match_history(QueueType mode);
 
+    // The top of a ranked mode, or the players either side of us.
+    Q_INVOKABLE void fetch_leaderboard(QueueType mode, bool around_me);
+
     Q_INVOKABLE void download_match_by_id(qint64 match_id);
 
     Q_INVOKABLE void start_replay(qint64 match_id);
@@ -158,6 +166,10 @@ public:
 
     Q_INVOKABLE void send_forfeit();
 
+    Q_INVOKABLE void spectate_friend(const QString & uuid, bool fogged);
+
+    Q_INVOKABLE void spectate_match(qint64 match_id, bool fogged);
+
     Q_INVOKABLE void send_place_tank(int x, int y, int placement_direction);
 
     Q_INVOKABLE void send_rotate_barrel(int x, int y, int rotation);
@@ -174,6 +186,9 @@ public:
 private:
     void try_show_popup();
 
+    // Predict a command and send the turn once it is complete.
+    void queue_command(Command cmd);
+
 signals:
     // Defined by compiler.
     void state_changed(ClientState new_state);
@@ -226,6 +241,9 @@ private:
     // Match history view.
     MatchHistoryModel match_history_;
 
+    // Leaderboard view.
+    LeaderboardModel leaderboard_;
+
     // For managing client's view of the game.
     GameManager game_manager_;
 
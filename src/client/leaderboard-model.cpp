@@ -0,0 +1,86 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "leaderboard-model.h"
+
+LeaderboardModel::LeaderboardModel(QObject* parent)
+:QAbstractListModel(parent)
+{
+
+}
+
+void LeaderboardModel::set_page(LeaderboardPage page)
+{
+    beginResetModel();
+    page_ = std::move(page);
+    endResetModel();
+
+    emit page_changed();
+}
+
+int LeaderboardModel::rowCount(const QModelIndex & parent) const
+{
+    return static_cast<int>(page_.entries.size());
+}
+
+QVariant LeaderboardModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid()
+        || index.row() >= static_cast<int>(page_.entries.size())
+        || index.row() < 0)
+    {
+        return {};
+    }
+
+    const LeaderboardEntry & entry = page_.entries[index.row()];
+
+    switch (role)
+    {
+        case RankRole:
+        {
+            return static_cast<qint64>(entry.rank);
+        }
+        case UsernameRole:
+        {
+            return QString::fromStdString(entry.username);
+        }
+        case EloRole:
+        {
+            return entry.elo;
+        }
+        default:
+            return {};
+    }
+}
+
+QHash<int, QByteArray> LeaderboardModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[RankRole] = "rank";
+    roles[UsernameRole] = "username";
+    roles[EloRole] = "elo";
+    return roles;
+}
+
+int LeaderboardModel::my_rank() const
+{
+    return static_cast<int>(page_.my_rank);
+}
+
+int LeaderboardModel::players() const
+{
+    return static_cast<int>(page_.players);
+}
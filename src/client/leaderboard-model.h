@@ -0,0 +1,71 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <QObject>
+#include <QAbstractListModel>
+
+#include "leaderboard-structs.h"
+
+// Players shown in the profile leaderboard.
+constexpr uint8_t LEADERBOARD_PAGE_SIZE = 25;
+
+// The last leaderboard page received, either the top of a mode or the
+// players around us.
+class LeaderboardModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int my_rank
+               READ my_rank
+               NOTIFY page_changed)
+
+    Q_PROPERTY(int players
+               READ players
+               NOTIFY page_changed)
+
+public:
+    enum Roles {
+        RankRole = Qt::UserRole + 1,
+        UsernameRole,
+        EloRole
+    };
+
+    Q_ENUM(Roles)
+
+    explicit LeaderboardModel(QObject* parent = nullptr);
+
+    void set_page(LeaderboardPage page);
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+
+    QVariant data(const QModelIndex & index, int role) const override;
+
+    // Map role enums to string names.
+    QHash<int, QByteArray> roleNames() const override;
+
+    // Zero if we have no rating in the mode.
+    int my_rank() const;
+
+    int players() const;
+
+signals:
+    void page_changed();
+
+private:
+    LeaderboardPage page_{};
+};
@@ -124,14 +124,17 @@ int main(int argc, char* argv[])
         engine.rootContext()->setContextProperty("BlockedModel",
                                                  client.blocked_model());
 
-        // Message history, match history, game manager, replay manager, players for
-        // the game, players for replay.
+        // Message history, match history, leaderboard, game manager, replay
+        // manager, players for the game, players for replay.
         engine.rootContext()->setContextProperty("MessagesModel",
                                                  client.messages_model());
 
         engine.rootContext()->setContextProperty("HistoryModel",
                                                  client.history_model());
 
+        engine.rootContext()->setContextProperty("LeaderboardModel",
+                                                 client.leaderboard_model());
+
         engine.rootContext()->setContextProperty("GameManager",
                                                  client.game_manager());
 
@@ -16,40 +16,40 @@
 
 #include "match-history-model.h"
 
-MatchHistoryModel::MatchHistoryModel(QObject* parent)
+MatchHistoryModel::MatchHistoryModel(QObject* parent,
+                                     FetchPageCallback fetch_page_callback)
 :QAbstractListModel(parent),
-history_rows_(NUMBER_OF_MODES)
+history_(NUMBER_OF_MODES),
+fetch_page_callback_(std::move(fetch_page_callback))
 {
 }
 
 int MatchHistoryModel::rowCount(const QModelIndex & parent = QModelIndex()) const
 {
-    if (current_history_mode_ < 0
-        || current_history_mode_ >= static_cast<int>(history_rows_.size()))
+    if (parent.isValid() || !valid_mode(current_history_mode_))
     {
         return 0;
     }
 
-    return static_cast<int>(history_rows_[current_history_mode_].size());
+    return static_cast<int>(history_[current_history_mode_].rows.size());
 }
 
 QVariant MatchHistoryModel::data(const QModelIndex & index, int role) const
 {
-    if (current_history_mode_ < 0
-        || current_history_mode_ >= static_cast<int>(history_rows_.size()))
+    if (!valid_mode(current_history_mode_))
     {
         return {};
     }
 
+    const auto & mode_history = history_[current_history_mode_].rows;
+
     if (!index.isValid()
-        || index.row() >= static_cast<int>(history_rows_[current_history_mode_].size())
+        || index.row() >= static_cast<int>(mode_history.size())
         || index.row() < 0)
     {
         return {};
     }
 
-    const auto & mode_history = history_rows_[current_history_mode_];
-
     const MatchResultRow & row = mode_history[index.row()];
 
     switch (role)
@@ -87,6 +87,33 @@ QHash<int, QByteArray> MatchHistoryModel::roleNames() const
     return roles;
 }
 
+bool MatchHistoryModel::canFetchMore(const QModelIndex & parent) const
+{
+    if (parent.isValid() || !valid_mode(current_history_mode_))
+    {
+        return false;
+    }
+
+    const ModeHistory & history = history_[current_history_mode_];
+
+    return history.more && history.pending == 0;
+}
+
+void MatchHistoryModel::fetchMore(const QModelIndex & parent)
+{
+    if (!canFetchMore(parent) || !fetch_page_callback_)
+    {
+        return;
+    }
+
+    ModeHistory & history = history_[current_history_mode_];
+    history.pending++;
+
+    fetch_page_callback_(static_cast<GameMode>(current_history_mode_),
+                         history.next,
+                         HISTORY_PAGE_SIZE);
+}
+
 int MatchHistoryModel::current_history_mode() const
 {
     return current_history_mode_;
@@ -103,18 +130,91 @@ Q_INVOKABLE void MatchHistoryModel::set_current_history_mode(int mode)
     emit current_history_mode_changed(mode);
 }
 
-void MatchHistoryModel::set_history_row(MatchResultList results)
+void MatchHistoryModel::reload(GameMode mode)
 {
+    int index = static_cast<int>(mode);
+
+    if (!valid_mode(index) || !fetch_page_callback_)
+    {
+        return;
+    }
+
+    bool visible = (index == current_history_mode_);
+
+    if (visible)
+    {
+        beginResetModel();
+    }
+
+    ModeHistory & history = history_[index];
+    history.rows.clear();
+    history.next = MatchHistoryCursor{};
+    history.more = false;
+    history.stale = history.pending;
+    history.pending++;
+
+    if (visible)
+    {
+        endResetModel();
+    }
+
+    fetch_page_callback_(mode, MatchHistoryCursor{}, HISTORY_PAGE_SIZE);
+}
+
+void MatchHistoryModel::add_page(MatchHistoryPage page)
+{
+    int index = static_cast<int>(page.mode);
+
     // Prevent accessing rows that don't exist.
-    if (static_cast<uint8_t>(results.mode) >= static_cast<uint8_t>(GameMode::NO_MODE))
+    if (!valid_mode(index))
     {
         return;
     }
 
-    beginResetModel();
+    ModeHistory & history = history_[index];
 
-    // Set this match result list to the new results.
-    history_rows_[static_cast<uint8_t>(results.mode)] = results.match_results;
+    // Not something we asked for.
+    if (history.pending == 0)
+    {
+        return;
+    }
 
-    endResetModel();
+    history.pending--;
+
+    if (history.stale > 0)
+    {
+        history.stale--;
+        return;
+    }
+
+    history.next = page.next;
+    history.more = page.more;
+
+    if (page.match_results.empty())
+    {
+        return;
+    }
+
+    bool visible = (index == current_history_mode_);
+    int first = static_cast<int>(history.rows.size());
+    int last = first + static_cast<int>(page.match_results.size()) - 1;
+
+    if (visible)
+    {
+        beginInsertRows(QModelIndex(), first, last);
+    }
+
+    history.rows.insert(history.rows.end(),
+                        page.match_results.begin(),
+                        page.match_results.end());
+
+    if (visible)
+    {
+        endInsertRows();
+    }
+}
+
+bool MatchHistoryModel::valid_mode(int mode) const
+{
+    return mode >= 0 && mode < static_cast<int>(history_.size());
 }
@@ -21,8 +21,15 @@
 #include <QDateTime>
 #include <QTimeZone>
 
+#include <functional>
+
 #include "match-result-structs.h"
 
+// Rows asked for per page, a few screens of history.
+constexpr uint8_t HISTORY_PAGE_SIZE = 20;
+
+// Match history of each mode, loaded a page at a time as the view
+// scrolls to the end, through canFetchMore and fetchMore.
 class MatchHistoryModel : public QAbstractListModel
 {
     Q_OBJECT
@@ -32,6 +39,9 @@ class MatchHistoryModel : public QAbstractListModel
                NOTIFY current_history_mode_changed)
 
 public:
+    using FetchPageCallback = std::function<void(GameMode mode,
+                                                 MatchHistoryCursor after,
+                                                 uint8_t page_size)>;
 
     enum Roles {
         MatchIDRole = Qt::UserRole + 1,
@@ -42,7 +52,8 @@ public:
 
     Q_ENUM(Roles)
 
-    explicit MatchHistoryModel(QObject* parent = nullptr);
+    explicit MatchHistoryModel(QObject* parent = nullptr,
+                               FetchPageCallback fetch_page_callback = nullptr);
 
     int rowCount(const QModelIndex & parent) const override;
 
@@ -51,16 +62,42 @@ public:
     // Map role enums to string names.
     QHash<int, QByteArray> roleNames() const override;
 
+    // True while the current mode has older pages and none is in flight.
+    bool canFetchMore(const QModelIndex & parent) const override;
+
+    // Requests the page after the last one received.
+    void fetchMore(const QModelIndex & parent) override;
+
     int current_history_mode() const;
 
     Q_INVOKABLE void set_current_history_mode(int mode);
 
-    void set_history_row(MatchResultList results);
+    // Drops what we have of a mode and starts again from the newest match.
+    void reload(GameMode mode);
+
+    void add_page(MatchHistoryPage page);
 
 signals:
     void current_history_mode_changed(int newMode);
 
 private:
-    std::vector<std::vector<MatchResultRow>> history_rows_;
+    struct ModeHistory
+    {
+        std::vector<MatchResultRow> rows;
+        MatchHistoryCursor next;
+        bool more{false};
+
+        // Pages requested and not yet received. Replies come back in
+        // order, so after a reload the first stale of them are dropped.
+        size_t pending{0};
+        size_t stale{0};
+    };
+
+    bool valid_mode(int mode) const;
+
+private:
+    std::vector<ModeHistory> history_;
     int current_history_mode_{0};
+
+    FetchPageCallback fetch_page_callback_;
 };
@@ -0,0 +1,66 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "tls-session-store.h"
+
+#include <ctime>
+
+void TlsSessionStore::store(const std::string & server_key,
+                            SSL_SESSION * session)
+{
+    SessionPtr owned(session);
+
+    if (!owned || !SSL_SESSION_is_resumable(owned.get()))
+    {
+        return;
+    }
+
+    std::lock_guard lock(sessions_mutex_);
+    sessions_[server_key] = std::move(owned);
+}
+
+TlsSessionStore::SessionPtr TlsSessionStore::get(const std::string & server_key)
+{
+    std::lock_guard lock(sessions_mutex_);
+
+    auto itr = sessions_.find(server_key);
+
+    if (itr == sessions_.end())
+    {
+        return nullptr;
+    }
+
+    SSL_SESSION * session = itr->second.get();
+
+    // Drop sessions the server would refuse anyways.
+    long expires_at = SSL_SESSION_get_time(session)
+                      + SSL_SESSION_get_timeout(session);
+
+    if (expires_at <= static_cast<long>(std::time(nullptr)))
+    {
+        sessions_.erase(itr);
+        return nullptr;
+    }
+
+    SSL_SESSION_up_ref(session);
+    return SessionPtr(session);
+}
+
+void TlsSessionStore::forget(const std::string & server_key)
+{
+    std::lock_guard lock(sessions_mutex_);
+    sessions_.erase(server_key);
+}
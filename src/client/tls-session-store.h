@@ -0,0 +1,56 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <openssl/ssl.h>
+
+// Keeps the most recent resumable TLS session for each server so that
+// a new ClientSession can skip the full handshake when reconnecting.
+//
+// Sessions are keyed by the server's hashmap string, which includes the
+// fingerprint, so a changed server key never resumes an old session.
+class TlsSessionStore
+{
+public:
+    struct SessionDeleter
+    {
+        void operator()(SSL_SESSION * session) const
+        {
+            SSL_SESSION_free(session);
+        }
+    };
+
+    using SessionPtr = std::unique_ptr<SSL_SESSION, SessionDeleter>;
+
+    // Takes ownership of the session reference.
+    void store(const std::string & server_key, SSL_SESSION * session);
+
+    // Returns a new reference to the stored session, or null if there is
+    // no session for this server that can still be resumed.
+    SessionPtr get(const std::string & server_key);
+
+    void forget(const std::string & server_key);
+
+private:
+    std::mutex sessions_mutex_;
+    std::unordered_map<std::string, SessionPtr> sessions_;
+};
@@ -85,6 +85,24 @@ tanks_(num_tanks_ * num_players_)
     }
 }
 
+void GameInstance::reset(GameMap map)
+{
+    num_players_ = map.map_settings.num_players;
+    num_tanks_ = map.map_settings.num_tanks;
+    game_env_ = std::move(map.env);
+    placement_mask_ = std::move(map.mask);
+
+    tanks_.assign(num_tanks_ * num_players_, Tank{});
+
+    players_.clear();
+    players_.reserve(num_players_);
+
+    for (uint8_t i = 0; i < num_players_; ++i)
+    {
+        players_.emplace_back(num_tanks_, i);
+    }
+}
+
 // Rotate a tank of given ID
 void GameInstance::rotate_tank(uint8_t ID, uint8_t dir)
 {
@@ -195,17 +213,7 @@ bool GameInstance::move_tank(uint8_t ID, bool reverse)
 
             // When we move diagonally we need to check
             // that we aren't cutting through two mountains
-            //
-            // this is when we only do part of our movement, so
-            // create two possible mountain positions and check.
-            vec2 m1 = vec2(curr_tank.pos_.x_, prev.y_);
-            vec2 m2 = vec2(prev.x_, curr_tank.pos_.y_);
-
-            GridCell m1_cell = game_env_[idx(m1)];
-            GridCell m2_cell = game_env_[idx(m2)];
-
-            // Prevent passage diagonally when blocked in
-            if (m1_cell.type_ == CellType::Terrain && m2_cell.type_ == CellType::Terrain)
+            if (cuts_between_terrain(game_env_, prev, curr_tank.pos_))
             {
                 curr_tank.pos_.y_ = prev.y_;
                 curr_tank.pos_.x_ = prev.x_;
@@ -261,17 +269,7 @@ bool GameInstance::move_tank(uint8_t ID, bool reverse)
 
             // When we move diagonally we need to check
             // that we aren't cutting through two mountains
-            //
-            // this is when we only do part of our movement, so
-            // create two possible mountain positions and check.
-            vec2 m1 = vec2(curr_tank.pos_.x_, prev.y_);
-            vec2 m2 = vec2(prev.x_, curr_tank.pos_.y_);
-
-            GridCell m1_cell = game_env_[idx(m1)];
-            GridCell m2_cell = game_env_[idx(m2)];
-
-            // Prevent passage diagonally when blocked in
-            if (m1_cell.type_ == CellType::Terrain && m2_cell.type_ == CellType::Terrain)
+            if (cuts_between_terrain(game_env_, prev, curr_tank.pos_))
             {
                 curr_tank.pos_.y_ = prev.y_;
                 curr_tank.pos_.x_ = prev.x_;
@@ -327,17 +325,7 @@ bool GameInstance::move_tank(uint8_t ID, bool reverse)
 
             // When we move diagonally we need to check
             // that we aren't cutting through two mountains
-            //
-            // this is when we only do part of our movement, so
-            // create two possible mountain positions and check.
-            vec2 m1 = vec2(curr_tank.pos_.x_, prev.y_);
-            vec2 m2 = vec2(prev.x_, curr_tank.pos_.y_);
-
-            GridCell m1_cell = game_env_[idx(m1)];
-            GridCell m2_cell = game_env_[idx(m2)];
-
-            // Prevent passage diagonally when blocked in
-            if (m1_cell.type_ == CellType::Terrain && m2_cell.type_ == CellType::Terrain)
+            if (cuts_between_terrain(game_env_, prev, curr_tank.pos_))
             {
                 curr_tank.pos_.y_ = prev.y_;
                 curr_tank.pos_.x_ = prev.x_;
@@ -392,17 +380,7 @@ bool GameInstance::move_tank(uint8_t ID, bool reverse)
 
             // When we move diagonally we need to check
             // that we aren't cutting through two mountains
-            //
-            // this is when we only do part of our movement, so
-            // create two possible mountain positions and check.
-            vec2 m1 = vec2(curr_tank.pos_.x_, prev.y_);
-            vec2 m2 = vec2(prev.x_, curr_tank.pos_.y_);
-
-            GridCell m1_cell = game_env_[idx(m1)];
-            GridCell m2_cell = game_env_[idx(m2)];
-
-            // Prevent passage diagonally when blocked in
-            if (m1_cell.type_ == CellType::Terrain && m2_cell.type_ == CellType::Terrain)
+            if (cuts_between_terrain(game_env_, prev, curr_tank.pos_))
             {
                 curr_tank.pos_.y_ = prev.y_;
                 curr_tank.pos_.x_ = prev.x_;
@@ -584,22 +562,39 @@ void GameInstance::repair_tank(vec2 pos)
 // We start with the current game environment and set all cells
 // to having no vision
 PlayerView GameInstance::compute_view(uint8_t player_ID, uint8_t & num_live_tanks)
+{
+    PlayerView view(game_env_.get_width(), game_env_.get_height());
+
+    compute_view(player_ID, num_live_tanks, view);
+
+    return view;
+}
+
+// Same as above, but reuses the buffers of an existing view so that
+// computing views every turn does not allocate.
+void GameInstance::compute_view(uint8_t player_ID,
+                                 uint8_t & num_live_tanks,
+                                 PlayerView & view)
 {
     uint8_t width = game_env_.get_width();
     uint8_t height = game_env_.get_height();
     uint16_t total = width * height;
 
-    PlayerView view(width, height);
+    if (view.width() != width || view.height() != height)
+    {
+        view.map_view = FlatArray<GridCell>(width, height);
+    }
+
+    view.visible_tanks.clear();
 
     FlatArray<GridCell> & player_view = view.map_view;
 
-    // copy the cell types
-    //
-    // visibility was already set to zero during initialization
+    // copy the cell types and clear any previous visibility
     for (int i = 0; i < total; i++)
     {
         player_view[i].type_ = game_env_[i].type_;
         player_view[i].occupant_ = NO_OCCUPANT;
+        player_view[i].visible_ = false;
     }
 
     // now, go through every tank and compute visible tiles
@@ -958,24 +953,34 @@ PlayerView GameInstance::compute_view(uint8_t player_ID, uint8_t & num_live_tank
             }
         }
     }
+}
+
+PlayerView GameInstance::dump_global_view()
+{
+    PlayerView view(game_env_.get_width(), game_env_.get_height());
+
+    dump_global_view(view);
 
     return view;
 }
 
-PlayerView GameInstance::dump_global_view()
+void GameInstance::dump_global_view(PlayerView & view)
 {
     uint8_t width = game_env_.get_width();
     uint8_t height = game_env_.get_height();
     uint16_t total = width * height;
 
-    PlayerView view(width, height);
+    if (view.width() != width || view.height() != height)
+    {
+        view.map_view = FlatArray<GridCell>(width, height);
+    }
 
-    // Copy the entire board.
-    view.map_view = game_env_;
+    view.visible_tanks.clear();
 
-    // Set each cell to visible.
+    // Copy the entire board, with each cell visible.
     for (int i = 0; i < total; i++)
     {
+        view.map_view[i] = game_env_[i];
         view.map_view[i].visible_ = true;
     }
 
@@ -987,8 +992,6 @@ PlayerView GameInstance::dump_global_view()
             view.visible_tanks.push_back(tank);
         }
     }
-
-    return view;
 }
 
 // Given <x_0, y_0> and a slope vector <x_s, y_x> we
@@ -41,6 +41,9 @@ public:
 
     GameInstance(const MapSettings & map);
 
+    // Reinitialize for a new match, reusing existing buffers where possible.
+    void reset(GameMap map);
+
     ~GameInstance() = default;
 
     // Print the current instance state to the console
@@ -60,8 +63,15 @@ public:
 
     PlayerView compute_view(uint8_t player_ID, uint8_t & num_live_tanks);
 
+    void compute_view(uint8_t player_ID,
+                      uint8_t & num_live_tanks,
+                      PlayerView & view);
+
     PlayerView dump_global_view();
 
+    // Same as above, but reuses the buffers of an existing view.
+    void dump_global_view(PlayerView & view);
+
     void cast_ray(PlayerView & player_view,
                   vec2 start,
                   vec2 slope,
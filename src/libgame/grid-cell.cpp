@@ -20,3 +20,13 @@ std::ostream& operator<<(std::ostream& os, const GridCell& cell) {
     os <<  +((uint8_t) cell.type_);
     return os;
 }
+
+bool cuts_between_terrain(const FlatArray<GridCell> & grid, vec2 from, vec2 to)
+{
+    // The two cells beside the step, only distinct from the ends when
+    // the step is diagonal.
+    const GridCell & m1 = grid[grid.idx(to.x_, from.y_)];
+    const GridCell & m2 = grid[grid.idx(from.x_, to.y_)];
+
+    return m1.type_ == CellType::Terrain && m2.type_ == CellType::Terrain;
+}
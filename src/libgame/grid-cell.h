@@ -18,6 +18,8 @@
 
 #include "cell-type.h"
 #include "constants.h"
+#include "flat-array.h"
+#include "vec2.h"
 #include <iostream>
 
 struct GridCell
@@ -34,3 +36,8 @@ struct GridCell
 };
 
 std::ostream& operator<<(std::ostream& os, const GridCell& cell);
+
+// True if a diagonal step from one cell to the next passes between
+// two terrain cells, which blocks it. Shared by the game and the
+// client's move prediction so both agree.
+bool cuts_between_terrain(const FlatArray<GridCell> & grid, vec2 from, vec2 to);
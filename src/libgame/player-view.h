@@ -73,4 +73,8 @@ struct PlayerView
     uint8_t current_player;
     uint8_t current_fuel;
     GameState current_state;
+
+    // Sequence number of the last command from this player that was
+    // applied, so the client can drop confirmed predictions.
+    uint16_t last_sequence{0};
 };
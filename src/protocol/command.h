@@ -18,6 +18,9 @@
 
 #include <glaze/glaze.hpp>
 #include <cstdint>
+#include <vector>
+
+#include "constants.h"
 
 enum class CommandType : uint8_t
 {
@@ -48,6 +51,29 @@ struct Command
                                                 + sizeof(uint16_t);
 };
 
+// A player can not spend more than a full turn of fuel in one batch.
+static constexpr size_t MAX_TURN_BATCH = TURN_PLAYER_FUEL;
+
+// Commands for a whole turn, applied in order with a single view update.
+struct TurnBatch
+{
+    std::vector<Command> commands;
+};
+
+enum class BatchStatus : uint8_t
+{
+    Applied,
+    Failed,
+    // Not attempted, the turn ended or it was not the sender's turn.
+    Skipped
+};
+
+// Outcome of each command in a TurnBatch, in the same order.
+struct TurnBatchResult
+{
+    std::vector<BatchStatus> status;
+};
+
 // Data structure to record game moves without sequence numbers
 struct CommandHead
 {
@@ -23,6 +23,8 @@ enum class GameMode : uint8_t
     ClassicThreePlayer,
     ClassicFivePlayer,
     RankedTwoPlayer,
+    RankedThreePlayer,
+    RankedFivePlayer,
     NO_MODE
 };
 
@@ -16,6 +16,8 @@
 
 #include "header.h"
 #include "command.h"
+#include "match-result-structs.h"
+#include "leaderboard-structs.h"
 #include <iostream>
 
 bool Header::valid_server()
@@ -64,6 +66,17 @@ bool Header::valid_server()
             }
             break;
         }
+        case HeaderType::SendTurnBatch:
+        {
+            // Count byte followed by at least one command.
+            if (payload_len < 1 + Command::COMMAND_SIZE
+                || payload_len > 1 + MAX_TURN_BATCH * Command::COMMAND_SIZE
+                || (payload_len - 1) % Command::COMMAND_SIZE != 0)
+            {
+                return false;
+            }
+            break;
+        }
         case HeaderType::DirectTextMessage:
         {
             if (payload_len < 17)
@@ -128,6 +141,39 @@ bool Header::valid_server()
             }
             break;
         }
+        case HeaderType::FetchMatchHistoryPage:
+        {
+            if (payload_len != MatchHistoryPageRequest::DATA_SIZE)
+            {
+                return false;
+            }
+            break;
+        }
+        case HeaderType::FetchLeaderboard:
+        {
+            if (payload_len != LeaderboardRequest::DATA_SIZE)
+            {
+                return false;
+            }
+            break;
+        }
+        case HeaderType::SpectateMatch:
+        {
+            // Fogged flag, then a match ID or a user UUID.
+            if (payload_len != 1 + sizeof(uint64_t) && payload_len != 17)
+            {
+                return false;
+            }
+            break;
+        }
+        case HeaderType::StopSpectating:
+        {
+            if (payload_len != 0)
+            {
+                return false;
+            }
+            break;
+        }
         default:
         {
             break;
@@ -191,6 +237,32 @@ bool Header::valid_client()
             }
             break;
         }
+        case HeaderType::MatchHistoryPage:
+        {
+            if (payload_len < MatchHistoryPage::HEADER_SIZE
+                || (payload_len - MatchHistoryPage::HEADER_SIZE)
+                   % MatchResultRow::DATA_SIZE != 0)
+            {
+                return false;
+            }
+            break;
+        }
+        case HeaderType::Leaderboard:
+        {
+            if (payload_len < LeaderboardPage::HEADER_SIZE)
+            {
+                return false;
+            }
+            break;
+        }
+        case HeaderType::TurnBatchResult:
+        {
+            if (payload_len < 1 || payload_len > 1 + MAX_TURN_BATCH)
+            {
+                return false;
+            }
+            break;
+        }
         default:
         {
             break;
@@ -107,6 +107,25 @@ enum class HeaderType : uint8_t
     MatchReplay,
     NoReplay,
 
+    // Whole turn command batches.
+    SendTurnBatch,
+    TurnBatchResult,
+
+    // Live spectating.
+    SpectateMatch,
+    StopSpectating,
+    SpectateFailed,
+    SpectatorView,
+    SpectateEnded,
+
+    // Paged match history.
+    FetchMatchHistoryPage,
+    MatchHistoryPage,
+
+    // Ranked leaderboards.
+    FetchLeaderboard,
+    Leaderboard,
+
     MAX_TYPE
 };
 
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include "gamemodes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Most entries sent in one leaderboard page.
+constexpr uint8_t MAX_LEADERBOARD_ENTRIES = 50;
+
+struct LeaderboardRequest
+{
+    enum class Kind : uint8_t
+    {
+        // The highest rated players.
+        Top = 0,
+
+        // Players either side of the requester, who is in the middle.
+        AroundMe
+    };
+
+    GameMode mode;
+    Kind kind;
+    uint8_t count;
+
+    static constexpr std::size_t DATA_SIZE = sizeof(uint8_t)
+                                             + sizeof(kind)
+                                             + sizeof(count);
+};
+
+struct LeaderboardEntry
+{
+    // Players with the same elo share a rank.
+    uint32_t rank;
+    int32_t elo;
+    std::string username;
+};
+
+struct LeaderboardPage
+{
+    GameMode mode;
+
+    // Rated players in the mode.
+    uint32_t players{0};
+
+    // Zero if the requester has no rating in the mode.
+    uint32_t my_rank{0};
+
+    std::vector<LeaderboardEntry> entries;
+
+    // Size of everything before the entries.
+    static constexpr std::size_t HEADER_SIZE = sizeof(uint8_t)
+                                               + sizeof(players)
+                                               + sizeof(my_rank);
+};
@@ -41,6 +41,52 @@ struct MatchResultList
     std::vector<MatchResultRow> match_results;
 };
 
+// Position in a user's match history, just past the last row sent.
+// Opaque to the client, which sends back the cursor of one page to get
+// the next.
+struct MatchHistoryCursor
+{
+    int64_t finished_at{0};
+    int64_t match_id{0};
+
+    // The default cursor starts from the newest match.
+    bool empty() const
+    {
+        return match_id == 0;
+    }
+
+    static constexpr std::size_t DATA_SIZE = sizeof(finished_at)
+                                             + sizeof(match_id);
+};
+
+// Up to page_size matches older than the cursor, newest first.
+struct MatchHistoryPageRequest
+{
+    GameMode mode;
+    uint8_t page_size;
+    MatchHistoryCursor after;
+
+    static constexpr std::size_t DATA_SIZE = sizeof(uint8_t)
+                                             + sizeof(page_size)
+                                             + MatchHistoryCursor::DATA_SIZE;
+};
+
+struct MatchHistoryPage
+{
+    GameMode mode;
+
+    // Set when older matches remain, fetched by passing next.
+    bool more{false};
+    MatchHistoryCursor next;
+
+    std::vector<MatchResultRow> match_results;
+
+    // Size of everything before the rows.
+    static constexpr std::size_t HEADER_SIZE = sizeof(uint8_t)
+                                               + sizeof(uint8_t)
+                                               + MatchHistoryCursor::DATA_SIZE;
+};
+
 struct MatchReplay
 {
     size_t get_size_in_bytes()
@@ -74,6 +74,20 @@ struct ReplayRequest
     uint64_t match_id;
 };
 
+// Watch a live match, either by its ID or by a friend playing in it.
+struct SpectateRequest
+{
+    // Follow the fogged view of a player instead of the global view.
+    // When spectating by match ID, this is the first player's view.
+    bool fogged{false};
+
+    // Set when spectating a friend, otherwise match_id is used.
+    bool by_user{false};
+
+    uint64_t match_id{0};
+    boost::uuids::uuid user_id{};
+};
+
 struct BadRegNotification
 {
     enum class Reason : uint8_t
@@ -32,6 +32,154 @@ int64_t htonll(int64_t host_long_long)
 template<class>
 struct always_false : std::false_type {};
 
+// Decode a command from COMMAND_SIZE bytes of network data.
+static Command decode_command(const uint8_t * data)
+{
+    Command cmd;
+
+    // Most of our Command values are uint8_t and
+    // thus are fine for network transfer.
+    cmd.sender = data[0];
+    cmd.type = static_cast<CommandType>(data[1]);
+    cmd.tank_id = data[2];
+    cmd.payload_first = data[3];
+    cmd.payload_second = data[4];
+
+    // Handle network ordering of the sequence number.
+    // This would be bytes data[5], data[6]
+    uint16_t net_sequence;
+    std::memcpy(&net_sequence, data + 5, sizeof(net_sequence));
+
+    // Which we then convert with network to host short.
+    cmd.sequence_number = ntohs(net_sequence);
+
+    return cmd;
+}
+
+// Append the COMMAND_SIZE byte network form of a command.
+static void encode_command(const Command & cmd, std::vector<uint8_t> & buffer)
+{
+    // Start with the single byte data members.
+    buffer.push_back(cmd.sender);
+    buffer.push_back(static_cast<uint8_t>(cmd.type));
+    buffer.push_back(cmd.tank_id);
+    buffer.push_back(cmd.payload_first);
+    buffer.push_back(cmd.payload_second);
+
+    // Now load in the sequence number.
+    uint16_t net_sequence = htons(cmd.sequence_number);
+
+    // Copy the bytes as they are laid out in memory, which is
+    // already network order.
+    const uint8_t * sequence_bytes = reinterpret_cast<const uint8_t *>(&net_sequence);
+    buffer.insert(buffer.end(),
+                  sequence_bytes,
+                  sequence_bytes + sizeof(net_sequence));
+}
+
+// Decode a MatchResultRow from DATA_SIZE bytes of network data.
+static MatchResultRow decode_result_row(const uint8_t * data)
+{
+    size_t index = 0;
+
+    MatchResultRow row{};
+
+    // Copy and convert id from network.
+    int64_t net_id;
+    std::memcpy(&net_id, data + index, sizeof(net_id));
+    index += sizeof(net_id);
+    row.match_id = htonll(net_id);
+
+    // Copy and convert network time.
+    int64_t net_time;
+    std::memcpy(&net_time, data + index, sizeof(net_time));
+    index += sizeof(net_time);
+
+    int64_t host_time = htonll(net_time);
+    std::time_t finish_time = static_cast<std::time_t>(host_time);
+    row.finished_at = std::chrono::system_clock::from_time_t(finish_time);
+
+    // Copy and convert placement.
+    uint16_t net_placement;
+    std::memcpy(&net_placement, data + index, sizeof(net_placement));
+    index += sizeof(net_placement);
+    row.placement = ntohs(net_placement);
+
+    // Copy and convert elo change.
+    int32_t net_elo;
+    std::memcpy(&net_elo, data + index, sizeof(net_elo));
+    index += sizeof(net_elo);
+    row.elo_change = ntohl(net_elo);
+
+    return row;
+}
+
+// Append the DATA_SIZE byte network form of a MatchResultRow.
+static void encode_result_row(const MatchResultRow & row, std::vector<uint8_t> & buffer)
+{
+    // Insert match ID.
+    int64_t net_match_id = htonll(row.match_id);
+
+    uint8_t* id_bytes = reinterpret_cast<uint8_t*>(&net_match_id);
+    buffer.insert(buffer.end(),
+                  id_bytes,
+                  id_bytes + sizeof(net_match_id));
+
+    // Insert finished at time.
+    int64_t network_time = htonll(static_cast<int64_t>(
+                                std::chrono::system_clock::to_time_t(
+                                    row.finished_at
+                                )));
+
+    uint8_t* time_bytes = reinterpret_cast<uint8_t*>(&network_time);
+    buffer.insert(buffer.end(),
+                  time_bytes,
+                  time_bytes + sizeof(network_time));
+
+    // Insert placement.
+    uint16_t net_placement = htons(row.placement);
+
+    uint8_t* placement_bytes = reinterpret_cast<uint8_t*>(&net_placement);
+    buffer.insert(buffer.end(),
+                  placement_bytes,
+                  placement_bytes + sizeof(net_placement));
+
+    // Insert elo.
+    uint32_t net_elo = htonl(static_cast<uint32_t>(row.elo_change));
+
+    uint8_t* elo_bytes = reinterpret_cast<uint8_t*>(&net_elo);
+    buffer.insert(buffer.end(),
+                  elo_bytes,
+                  elo_bytes + sizeof(net_elo));
+}
+
+// Cursors are two network order integers.
+static MatchHistoryCursor decode_history_cursor(const uint8_t * data)
+{
+    MatchHistoryCursor cursor;
+
+    int64_t net_value;
+    std::memcpy(&net_value, data, sizeof(net_value));
+    cursor.finished_at = htonll(net_value);
+
+    std::memcpy(&net_value, data + sizeof(net_value), sizeof(net_value));
+    cursor.match_id = htonll(net_value);
+
+    return cursor;
+}
+
+static void encode_history_cursor(const MatchHistoryCursor & cursor,
+                                  std::vector<uint8_t> & buffer)
+{
+    for (int64_t value : {cursor.finished_at, cursor.match_id})
+    {
+        int64_t net_value = htonll(value);
+
+        const uint8_t * bytes = reinterpret_cast<const uint8_t *>(&net_value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(net_value));
+    }
+}
+
 bool Message::valid_matching_command() const
 {
     return (payload[0] < uint8_t(GameMode::NO_MODE));
@@ -51,6 +199,10 @@ template void Message::create_serialized<PlayerView>(PlayerView const&);
 
 template void Message::create_serialized<Command>(Command const&);
 
+template void Message::create_serialized<TurnBatch>(TurnBatch const&);
+
+template void Message::create_serialized<TurnBatchResult>(TurnBatchResult const&);
+
 template void Message::create_serialized<BadRegNotification>(BadRegNotification const&);
 
 template void Message::create_serialized<BadAuthNotification>(BadAuthNotification const&);
@@ -81,10 +233,20 @@ template void Message::create_serialized<ExternalMatchMessage>(ExternalMatchMess
 
 template void Message::create_serialized<MatchResultList>(MatchResultList const&);
 
+template void Message::create_serialized<MatchHistoryPageRequest>(MatchHistoryPageRequest const&);
+
+template void Message::create_serialized<MatchHistoryPage>(MatchHistoryPage const&);
+
+template void Message::create_serialized<LeaderboardRequest>(LeaderboardRequest const&);
+
+template void Message::create_serialized<LeaderboardPage>(LeaderboardPage const&);
+
 template void Message::create_serialized<ReplayRequest>(ReplayRequest const&);
 
 template void Message::create_serialized<MatchReplay>(MatchReplay const&);
 
+template void Message::create_serialized<SpectateRequest>(SpectateRequest const&);
+
 template void Message::create_serialized<StaticMatchData>(StaticMatchData const&);
 
 std::array<int, RANKED_MODES_COUNT> Message::to_elos()
@@ -174,26 +336,71 @@ Command Message::to_command()
         return cmd;
     }
 
-    // Start creating the command from the message.
-    //
-    // Most of our Command values are uint8_t and
-    // thus are fine for network transfer.
-    cmd.sender = payload[0];
-    cmd.type = static_cast<CommandType>(payload[1]);
-    cmd.tank_id = payload[2];
-    cmd.payload_first = payload[3];
-    cmd.payload_second = payload[4];
+    return decode_command(payload.data());
+}
 
-    // Handle network ordering of the sequence number.
-    // This would be bytes payload[5], payload[6]
-    uint16_t net_sequence;
-    std::memcpy(&net_sequence, payload.data() + 5, sizeof(net_sequence));
+TurnBatch Message::to_turn_batch(bool & op_status)
+{
+    TurnBatch batch;
+    op_status = false;
 
-    // Which we then convert with network to host short.
-    cmd.sequence_number = ntohs(net_sequence);
+    if (payload.empty())
+    {
+        return batch;
+    }
 
-    return cmd;
+    size_t count = payload[0];
+
+    if (count == 0
+        || count > MAX_TURN_BATCH
+        || payload.size() != 1 + count * Command::COMMAND_SIZE)
+    {
+        return batch;
+    }
+
+    batch.commands.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        batch.commands.push_back(
+            decode_command(payload.data() + 1 + i * Command::COMMAND_SIZE));
+    }
+
+    op_status = true;
+    return batch;
+}
+
+TurnBatchResult Message::to_turn_batch_result(bool & op_status)
+{
+    TurnBatchResult result;
+    op_status = false;
 
+    if (payload.empty())
+    {
+        return result;
+    }
+
+    size_t count = payload[0];
+
+    if (count > MAX_TURN_BATCH || payload.size() != 1 + count)
+    {
+        return result;
+    }
+
+    result.status.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (payload[1 + i] > static_cast<uint8_t>(BatchStatus::Skipped))
+        {
+            return result;
+        }
+
+        result.status.push_back(static_cast<BatchStatus>(payload[1 + i]));
+    }
+
+    op_status = true;
+    return result;
 }
 
 StaticMatchData Message::to_static_match_data(bool & op_status)
@@ -297,7 +504,7 @@ StaticMatchData Message::to_static_match_data(bool & op_status)
 // Modify view with success return type.
 PlayerView Message::to_player_view(bool & op_status)
 {
-    constexpr size_t FIXED_BYTES_SIZE = 7;
+    constexpr size_t FIXED_BYTES_SIZE = 9;
 
     // If our payload is not able to be turned into
     // a view then return failure.
@@ -315,7 +522,10 @@ PlayerView Message::to_player_view(bool & op_status)
     GameState current_state = static_cast<GameState>(payload[5]);
     uint8_t n_timers = payload[6];
 
-    // Start at payload[7] since we already read the first 7 bytes
+    uint16_t net_sequence;
+    std::memcpy(&net_sequence, payload.data() + 7, sizeof(net_sequence));
+
+    // Start at payload[9] since we already read the first 9 bytes
     size_t index = FIXED_BYTES_SIZE;
 
     // If we have malformed data, simply return false
@@ -330,6 +540,7 @@ PlayerView Message::to_player_view(bool & op_status)
     view.current_player = current_player;
     view.current_fuel = current_fuel;
     view.current_state = current_state;
+    view.last_sequence = ntohs(net_sequence);
 
     // Otherwise, create the player view from the message data
     FlatArray<GridCell> & map_view = view.map_view;
@@ -726,39 +937,152 @@ MatchResultList Message::to_results_list()
     // While remaining bytes is at least one MatchResultRow in size.
     while (payload.size() - index >= MatchResultRow::DATA_SIZE)
     {
-        MatchResultRow row{};
+        MatchResultRow row = decode_result_row(payload.data() + index);
+        index += MatchResultRow::DATA_SIZE;
 
-        // Copy and convert id from network.
-        int64_t net_id;
-        std::memcpy(&net_id, payload.data() + index, sizeof(net_id));
-        index += sizeof(net_id);
-        row.match_id = htonll(net_id);
+        results.match_results.push_back(row);
+    }
 
-        // Copy and convert network time.
-        int64_t net_time;
-        std::memcpy(&net_time, payload.data() + index, sizeof(net_time));
-        index += sizeof(net_time);
+    return results;
+}
 
-        int64_t host_time = htonll(net_time);
-        std::time_t finish_time = static_cast<std::time_t>(host_time);
-        row.finished_at = std::chrono::system_clock::from_time_t(finish_time);
+MatchHistoryPageRequest Message::to_history_page_request(bool & op_status)
+{
+    MatchHistoryPageRequest req{};
+    op_status = false;
 
-        // Copy and convert placement.
-        uint16_t net_placement;
-        std::memcpy(&net_placement, payload.data() + index, sizeof(net_placement));
-        index += sizeof(net_placement);
-        row.placement = ntohs(net_placement);
+    if (payload.size() != MatchHistoryPageRequest::DATA_SIZE
+        || payload[0] >= static_cast<uint8_t>(GameMode::NO_MODE))
+    {
+        return req;
+    }
 
-        // Copy and convert elo change.
-        int32_t net_elo;
-        std::memcpy(&net_elo, payload.data() + index, sizeof(net_elo));
-        index += sizeof(net_elo);
-        row.elo_change = ntohl(net_elo);
+    req.mode = static_cast<GameMode>(payload[0]);
+    req.page_size = payload[1];
+    req.after = decode_history_cursor(payload.data() + 2);
 
-        results.match_results.push_back(row);
+    op_status = true;
+    return req;
+}
+
+MatchHistoryPage Message::to_history_page(bool & op_status)
+{
+    MatchHistoryPage page{};
+    op_status = false;
+
+    if (payload.size() < MatchHistoryPage::HEADER_SIZE
+        || payload[0] >= static_cast<uint8_t>(GameMode::NO_MODE))
+    {
+        return page;
     }
 
-    return results;
+    page.mode = static_cast<GameMode>(payload[0]);
+    page.more = (payload[1] != 0);
+    page.next = decode_history_cursor(payload.data() + 2);
+
+    size_t index = MatchHistoryPage::HEADER_SIZE;
+
+    while (payload.size() - index >= MatchResultRow::DATA_SIZE)
+    {
+        page.match_results.push_back(decode_result_row(payload.data() + index));
+        index += MatchResultRow::DATA_SIZE;
+    }
+
+    op_status = true;
+    return page;
+}
+
+LeaderboardRequest Message::to_leaderboard_request(bool & op_status)
+{
+    LeaderboardRequest req{};
+    op_status = false;
+
+    // Only ranked modes have a leaderboard.
+    if (payload.size() != LeaderboardRequest::DATA_SIZE
+        || payload[0] < RANKED_MODES_START
+        || payload[0] >= static_cast<uint8_t>(GameMode::NO_MODE)
+        || payload[1] > static_cast<uint8_t>(LeaderboardRequest::Kind::AroundMe))
+    {
+        return req;
+    }
+
+    req.mode = static_cast<GameMode>(payload[0]);
+    req.kind = static_cast<LeaderboardRequest::Kind>(payload[1]);
+    req.count = payload[2];
+
+    op_status = true;
+    return req;
+}
+
+LeaderboardPage Message::to_leaderboard_page(bool & op_status)
+{
+    LeaderboardPage page{};
+    op_status = false;
+
+    if (payload.size() < LeaderboardPage::HEADER_SIZE
+        || payload[0] < RANKED_MODES_START
+        || payload[0] >= static_cast<uint8_t>(GameMode::NO_MODE))
+    {
+        return page;
+    }
+
+    page.mode = static_cast<GameMode>(payload[0]);
+
+    size_t offset = 1;
+
+    uint32_t net_value;
+    std::memcpy(&net_value, payload.data() + offset, sizeof(net_value));
+    page.players = ntohl(net_value);
+    offset += sizeof(net_value);
+
+    std::memcpy(&net_value, payload.data() + offset, sizeof(net_value));
+    page.my_rank = ntohl(net_value);
+    offset += sizeof(net_value);
+
+    // Each entry is a rank, an elo and a length prefixed username.
+    while (offset < payload.size())
+    {
+        if (offset + 2 * sizeof(uint32_t) + 1 > payload.size())
+        {
+            return {};
+        }
+
+        LeaderboardEntry entry;
+
+        std::memcpy(&net_value, payload.data() + offset, sizeof(net_value));
+        entry.rank = ntohl(net_value);
+        offset += sizeof(net_value);
+
+        std::memcpy(&net_value, payload.data() + offset, sizeof(net_value));
+        entry.elo = static_cast<int32_t>(ntohl(net_value));
+        offset += sizeof(net_value);
+
+        uint8_t username_len = payload[offset++];
+
+        if (username_len > MAX_USERNAME_LENGTH
+            || offset + username_len > payload.size())
+        {
+            return {};
+        }
+
+        for (size_t i = 0; i < username_len; i++)
+        {
+            unsigned char c = payload[offset + i];
+
+            if (!allowed_username_characters[c])
+            {
+                return {};
+            }
+
+            entry.username.push_back(c);
+        }
+
+        offset += username_len;
+        page.entries.push_back(std::move(entry));
+    }
+
+    op_status = true;
+    return page;
 }
 
 ReplayRequest Message::to_replay_request()
@@ -778,6 +1102,34 @@ ReplayRequest Message::to_replay_request()
     return req;
 }
 
+SpectateRequest Message::to_spectate_request(bool & op_status)
+{
+    SpectateRequest req;
+    op_status = false;
+
+    if (payload.size() == 1 + sizeof(uint64_t))
+    {
+        uint64_t net_match_id;
+        std::memcpy(&net_match_id, payload.data() + 1, sizeof(net_match_id));
+
+        req.match_id = htonll(net_match_id);
+    }
+    else if (payload.size() == 1 + req.user_id.size())
+    {
+        req.by_user = true;
+        std::memcpy(req.user_id.data, payload.data() + 1, req.user_id.size());
+    }
+    else
+    {
+        return req;
+    }
+
+    req.fogged = (payload[0] != 0);
+
+    op_status = true;
+    return req;
+}
+
 MatchReplay Message::to_match_replay(bool & op_status)
 {
     MatchReplay replay{};
@@ -1020,40 +1372,65 @@ void Message::create_serialized(const mType & req)
         // element using network order.
         for (const MatchResultRow & result : req.match_results)
         {
-            // Insert match ID.
-            int64_t net_match_id = htonll(result.match_id);
+            encode_result_row(result, payload_buffer);
+        }
+    }
+    else if constexpr (std::is_same_v<mType, MatchHistoryPageRequest>)
+    {
+        header.type_ = HeaderType::FetchMatchHistoryPage;
+        payload_buffer.push_back(static_cast<uint8_t>(req.mode));
+        payload_buffer.push_back(req.page_size);
+        encode_history_cursor(req.after, payload_buffer);
+    }
+    else if constexpr (std::is_same_v<mType, MatchHistoryPage>)
+    {
+        header.type_ = HeaderType::MatchHistoryPage;
+        payload_buffer.push_back(static_cast<uint8_t>(req.mode));
+        payload_buffer.push_back(static_cast<uint8_t>(req.more));
+        encode_history_cursor(req.next, payload_buffer);
 
-            uint8_t* id_bytes = reinterpret_cast<uint8_t*>(&net_match_id);
-            payload_buffer.insert(payload_buffer.end(),
-                                  id_bytes,
-                                  id_bytes + sizeof(net_match_id));
+        for (const MatchResultRow & result : req.match_results)
+        {
+            encode_result_row(result, payload_buffer);
+        }
+    }
+    else if constexpr (std::is_same_v<mType, LeaderboardRequest>)
+    {
+        header.type_ = HeaderType::FetchLeaderboard;
+        payload_buffer.push_back(static_cast<uint8_t>(req.mode));
+        payload_buffer.push_back(static_cast<uint8_t>(req.kind));
+        payload_buffer.push_back(req.count);
+    }
+    else if constexpr (std::is_same_v<mType, LeaderboardPage>)
+    {
+        header.type_ = HeaderType::Leaderboard;
+        payload_buffer.push_back(static_cast<uint8_t>(req.mode));
 
-            // Insert finished at time.
-            int64_t network_time = htonll(static_cast<int64_t>(
-                                        std::chrono::system_clock::to_time_t(
-                                            result.finished_at
-                                        )));
+        for (uint32_t value : {req.players, req.my_rank})
+        {
+            uint32_t net_value = htonl(value);
 
-            uint8_t* time_bytes = reinterpret_cast<uint8_t*>(&network_time);
-            payload_buffer.insert(payload_buffer.end(),
-                                  time_bytes,
-                                  time_bytes + sizeof(network_time));
+            const uint8_t * bytes = reinterpret_cast<const uint8_t *>(&net_value);
+            payload_buffer.insert(payload_buffer.end(), bytes, bytes + sizeof(net_value));
+        }
 
-            // Insert placement.
-            uint16_t net_placement = htons(result.placement);
+        for (const LeaderboardEntry & entry : req.entries)
+        {
+            for (uint32_t value : {entry.rank, static_cast<uint32_t>(entry.elo)})
+            {
+                uint32_t net_value = htonl(value);
 
-            uint8_t* placement_bytes = reinterpret_cast<uint8_t*>(&net_placement);
-            payload_buffer.insert(payload_buffer.end(),
-                                  placement_bytes,
-                                  placement_bytes + sizeof(net_placement));
+                const uint8_t * bytes = reinterpret_cast<const uint8_t *>(&net_value);
+                payload_buffer.insert(payload_buffer.end(), bytes, bytes + sizeof(net_value));
+            }
 
-            // Insert elo.
-            uint32_t net_elo = htonl(static_cast<uint32_t>(result.elo_change));
+            // Usernames are at most MAX_USERNAME_LENGTH, so fit a byte.
+            uint8_t username_len = static_cast<uint8_t>(entry.username.size());
+            payload_buffer.push_back(username_len);
 
-            uint8_t* elo_bytes = reinterpret_cast<uint8_t*>(&net_elo);
             payload_buffer.insert(payload_buffer.end(),
-                                  elo_bytes,
-                                  elo_bytes + sizeof(net_elo));
+                                  entry.username.begin(),
+                                  entry.username.begin() + username_len);
         }
     }
     else if constexpr (std::is_same_v<mType, ReplayRequest>)
@@ -1066,6 +1443,27 @@ void Message::create_serialized(const mType & req)
                               id_bytes,
                               id_bytes + sizeof(net_match_id));
     }
+    else if constexpr (std::is_same_v<mType, SpectateRequest>)
+    {
+        header.type_ = HeaderType::SpectateMatch;
+
+        payload_buffer.push_back(static_cast<uint8_t>(req.fogged));
+
+        if (req.by_user)
+        {
+            payload_buffer.insert(payload_buffer.end(),
+                                  req.user_id.begin(),
+                                  req.user_id.end());
+        }
+        else
+        {
+            uint64_t net_match_id = htonll(req.match_id);
+            uint8_t* id_bytes = reinterpret_cast<uint8_t*>(&net_match_id);
+            payload_buffer.insert(payload_buffer.end(),
+                                  id_bytes,
+                                  id_bytes + sizeof(net_match_id));
+        }
+    }
     else if constexpr (std::is_same_v<mType, MatchReplay>)
     {
         header.type_ = HeaderType::MatchReplay;
@@ -1413,6 +1811,13 @@ void Message::create_serialized(const mType & req)
         uint8_t n_timers = static_cast<uint8_t>(req.timers.size());
         payload_buffer.push_back(n_timers);
 
+        // And the last applied sequence number.
+        uint16_t net_sequence = htons(req.last_sequence);
+        const uint8_t * sequence_bytes = reinterpret_cast<const uint8_t *>(&net_sequence);
+        payload_buffer.insert(payload_buffer.end(),
+                              sequence_bytes,
+                              sequence_bytes + sizeof(net_sequence));
+
         // Then all of the environment data
         for (int y = 0; y < map_view.get_height(); y++)
         {
@@ -1464,26 +1869,34 @@ void Message::create_serialized(const mType & req)
         payload_buffer.reserve(Command::COMMAND_SIZE);
 
         // Copy all the command data into the payload.
-        //
-        // Start with the single byte data members.
-        payload_buffer.push_back(req.sender);
-        payload_buffer.push_back(static_cast<uint8_t>(req.type));
-        payload_buffer.push_back(req.tank_id);
-        payload_buffer.push_back(req.payload_first);
-        payload_buffer.push_back(req.payload_second);
-
-        // Now load in the sequence number.
-        uint16_t net_sequence = htons(req.sequence_number);
-
-        // Copy into the vector, 1 byte at a time.
-        //
-        // If net_sequence = 0xABCD then we push back:
-        //
-        // 0xABCD >> 8 which is 0x00AB and thus is cast to 0xAB
-        // 0xABCD & 0xFF which is 0x00CD and thus is cast to 0xCD
-        payload_buffer.push_back(static_cast<uint8_t>(net_sequence >> 8));
-        payload_buffer.push_back(static_cast<uint8_t>(net_sequence & 0xFF));
+        encode_command(req, payload_buffer);
+    }
+    else if constexpr (std::is_same_v<mType, TurnBatch>)
+    {
+        header.type_ = HeaderType::SendTurnBatch;
+
+        payload_buffer.reserve(1 + req.commands.size() * Command::COMMAND_SIZE);
+
+        // Command count, then each command back to back.
+        payload_buffer.push_back(static_cast<uint8_t>(req.commands.size()));
+
+        for (const Command & cmd : req.commands)
+        {
+            encode_command(cmd, payload_buffer);
+        }
+    }
+    else if constexpr (std::is_same_v<mType, TurnBatchResult>)
+    {
+        header.type_ = HeaderType::TurnBatchResult;
+
+        payload_buffer.reserve(1 + req.status.size());
 
+        payload_buffer.push_back(static_cast<uint8_t>(req.status.size()));
+
+        for (BatchStatus status : req.status)
+        {
+            payload_buffer.push_back(static_cast<uint8_t>(status));
+        }
     }
     else
     {
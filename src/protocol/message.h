@@ -20,6 +20,7 @@
 #include "player-view.h"
 #include "command.h"
 #include "match-result-structs.h"
+#include "leaderboard-structs.h"
 #include "message-structs.h"
 
 #include <type_traits>
@@ -59,6 +60,8 @@ constexpr std::array<uint8_t, NUMBER_OF_MODES> players_for_gamemode = []
     a[static_cast<uint8_t>(GameMode::RankedTwoPlayer)] = 2;
     a[static_cast<uint8_t>(GameMode::ClassicThreePlayer)] = 3;
     a[static_cast<uint8_t>(GameMode::ClassicFivePlayer)] = 5;
+    a[static_cast<uint8_t>(GameMode::RankedThreePlayer)] = 3;
+    a[static_cast<uint8_t>(GameMode::RankedFivePlayer)] = 5;
 
     return a;
 }();
@@ -68,6 +71,10 @@ constexpr uint8_t MAX_PLAYERS = players_for_gamemode[static_cast<uint8_t>(
 
 constexpr int LATEST_MATCHES_COUNT = 10;
 
+// Largest page of match history served at once, keeps pages well inside
+// MAX_CLIENT_PAYLOAD_LEN.
+constexpr uint8_t MAX_HISTORY_PAGE_SIZE = 50;
+
 struct Message
 {
 public:
@@ -79,6 +86,10 @@ public:
 
     Command to_command();
 
+    TurnBatch to_turn_batch(bool & op_status);
+
+    TurnBatchResult to_turn_batch_result(bool & op_status);
+
     StaticMatchData to_static_match_data(bool & op_status);
 
     // Modify view with success return type.
@@ -104,8 +115,18 @@ public:
 
     MatchResultList to_results_list();
 
+    MatchHistoryPageRequest to_history_page_request(bool & op_status);
+
+    MatchHistoryPage to_history_page(bool & op_status);
+
+    LeaderboardRequest to_leaderboard_request(bool & op_status);
+
+    LeaderboardPage to_leaderboard_page(bool & op_status);
+
     ReplayRequest to_replay_request();
 
+    SpectateRequest to_spectate_request(bool & op_status);
+
     MatchReplay to_match_replay(bool & op_status);
 
     template <typename mType>
@@ -0,0 +1,572 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "async-pg.h"
+#include "console.h"
+
+#include <algorithm>
+
+PgResult::PgResult(PGresult * result)
+:result_(result, PQclear)
+{
+}
+
+bool PgResult::empty() const
+{
+    return size() == 0;
+}
+
+size_t PgResult::size() const
+{
+    return result_ ? static_cast<size_t>(PQntuples(result_.get())) : 0;
+}
+
+bool PgResult::is_null(size_t row, const char * column) const
+{
+    int index = column_index(column);
+
+    return index < 0 || PQgetisnull(result_.get(), static_cast<int>(row), index);
+}
+
+std::string_view PgResult::view(size_t row, const char * column) const
+{
+    int index = column_index(column);
+
+    if (index < 0 || row >= size())
+    {
+        return {};
+    }
+
+    return std::string_view(PQgetvalue(result_.get(), static_cast<int>(row), index),
+                            PQgetlength(result_.get(), static_cast<int>(row), index));
+}
+
+std::string PgResult::bytes(size_t row, const char * column) const
+{
+    std::string_view text = view(row, column);
+
+    if (text.empty())
+    {
+        return {};
+    }
+
+    size_t length = 0;
+    unsigned char * raw = PQunescapeBytea(reinterpret_cast<const unsigned char *>(text.data()),
+                                          &length);
+
+    if (!raw)
+    {
+        return {};
+    }
+
+    std::string result(reinterpret_cast<const char *>(raw), length);
+    PQfreemem(raw);
+
+    return result;
+}
+
+int PgResult::column_index(const char * column) const
+{
+    return result_ ? PQfnumber(result_.get(), column) : -1;
+}
+
+PgConnection::PgConnection(asio::io_context & cntx,
+                           std::string conninfo,
+                           std::shared_ptr<const PgStatements> statements)
+:cntx_(cntx),
+strand_(cntx.get_executor()),
+socket_(cntx),
+retry_timer_(cntx),
+conninfo_(std::move(conninfo)),
+statements_(std::move(statements))
+{
+}
+
+PgConnection::~PgConnection()
+{
+    // libpq owns the socket, never let asio close it.
+    if (socket_.is_open())
+    {
+        socket_.release();
+    }
+
+    if (conn_)
+    {
+        PQfinish(conn_);
+    }
+}
+
+void PgConnection::start()
+{
+    asio::post(strand_, [self = shared_from_this()]{
+
+        self->conn_ = PQconnectStart(self->conninfo_.c_str());
+
+        if (!self->conn_ || PQstatus(self->conn_) == CONNECTION_BAD)
+        {
+            self->fail("Could not start a database connection.");
+            return;
+        }
+
+        self->state_ = State::Connecting;
+        self->assign_socket();
+        self->poll_connect(PGRES_POLLING_WRITING);
+    });
+}
+
+void PgConnection::exec(std::string statement,
+                        std::vector<std::optional<std::string>> params,
+                        PgHandler handler)
+{
+    in_flight_count_.fetch_add(1, std::memory_order_relaxed);
+
+    asio::post(strand_,
+        [self = shared_from_this(),
+         query = Query{std::move(statement), std::move(params), std::move(handler)}]() mutable {
+
+        switch (self->state_)
+        {
+            case State::Ready:
+                self->send(std::move(query));
+                self->flush();
+                self->wait_readable();
+                break;
+
+            case State::Connecting:
+                self->waiting_.push_back(std::move(query));
+                break;
+
+            default:
+                self->in_flight_count_.fetch_sub(1, std::memory_order_relaxed);
+
+                asio::post(self->cntx_, [handler = std::move(query.handler)]{
+                    handler("Database connection unavailable.", PgResult{});
+                });
+                break;
+        }
+    });
+}
+
+void PgConnection::close()
+{
+    asio::post(strand_, [self = shared_from_this()]{
+        self->state_ = State::Closed;
+        self->retry_timer_.cancel();
+        self->fail("Database connection closed.");
+    });
+}
+
+size_t PgConnection::in_flight() const
+{
+    return in_flight_count_.load(std::memory_order_relaxed);
+}
+
+void PgConnection::poll_connect(PostgresPollingStatusType status)
+{
+    if (status == PGRES_POLLING_OK)
+    {
+        on_connected();
+        return;
+    }
+
+    if (status == PGRES_POLLING_FAILED)
+    {
+        fail(PQerrorMessage(conn_));
+        return;
+    }
+
+    auto wait_type = (status == PGRES_POLLING_READING)
+                     ? asio::posix::stream_descriptor::wait_read
+                     : asio::posix::stream_descriptor::wait_write;
+
+    socket_.async_wait(wait_type, asio::bind_executor(strand_,
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+            if (ec || self->state_ != State::Connecting)
+            {
+                return;
+            }
+
+            PostgresPollingStatusType next = PQconnectPoll(self->conn_);
+
+            // libpq may move to a new socket while connecting.
+            if (PQsocket(self->conn_) != self->socket_.native_handle())
+            {
+                self->assign_socket();
+            }
+
+            self->poll_connect(next);
+        }));
+}
+
+void PgConnection::on_connected()
+{
+    if (PQsetnonblocking(conn_, 1) != 0 || PQenterPipelineMode(conn_) != 1)
+    {
+        fail(PQerrorMessage(conn_));
+        return;
+    }
+
+    state_ = State::Ready;
+
+    // Prepare ahead of everything else, in the same pipeline.
+    for (const auto & [name, sql] : *statements_)
+    {
+        if (!PQsendPrepare(conn_, name.c_str(), sql.c_str(), 0, nullptr)
+            || !PQpipelineSync(conn_))
+        {
+            fail(PQerrorMessage(conn_));
+            return;
+        }
+
+        in_flight_count_.fetch_add(1, std::memory_order_relaxed);
+        in_flight_.push_back(InFlight{
+            [name](std::string error, PgResult)
+            {
+                if (!error.empty())
+                {
+                    Console::instance().log("Failed to prepare " + name + ": " + error,
+                                            LogLevel::ERROR);
+                }
+            }});
+        pending_syncs_++;
+    }
+
+    while (!waiting_.empty())
+    {
+        Query query = std::move(waiting_.front());
+        waiting_.pop_front();
+
+        send(std::move(query));
+    }
+
+    flush();
+    wait_readable();
+}
+
+void PgConnection::send(Query query)
+{
+    std::vector<const char *> values;
+    values.reserve(query.params.size());
+
+    for (const auto & param : query.params)
+    {
+        values.push_back(param ? param->c_str() : nullptr);
+    }
+
+    bool sent = PQsendQueryPrepared(conn_,
+                                    query.statement.c_str(),
+                                    static_cast<int>(values.size()),
+                                    values.data(),
+                                    nullptr,
+                                    nullptr,
+                                    0)
+                && PQpipelineSync(conn_);
+
+    if (!sent)
+    {
+        in_flight_count_.fetch_sub(1, std::memory_order_relaxed);
+
+        asio::post(cntx_,
+            [handler = std::move(query.handler),
+             error = std::string(PQerrorMessage(conn_))]{
+            handler(error, PgResult{});
+        });
+        return;
+    }
+
+    in_flight_.push_back(InFlight{std::move(query.handler)});
+    pending_syncs_++;
+}
+
+void PgConnection::flush()
+{
+    if (writing_ || state_ != State::Ready)
+    {
+        return;
+    }
+
+    int status = PQflush(conn_);
+
+    if (status < 0)
+    {
+        fail(PQerrorMessage(conn_));
+        return;
+    }
+
+    // Rest of the output did not fit, continue when the socket drains.
+    if (status == 1)
+    {
+        writing_ = true;
+
+        socket_.async_wait(asio::posix::stream_descriptor::wait_write,
+            asio::bind_executor(strand_,
+            [self = shared_from_this()](boost::system::error_code ec)
+            {
+                self->writing_ = false;
+
+                if (!ec)
+                {
+                    self->flush();
+                }
+            }));
+    }
+}
+
+void PgConnection::wait_readable()
+{
+    if (reading_
+        || state_ != State::Ready
+        || (in_flight_.empty() && pending_syncs_ == 0))
+    {
+        return;
+    }
+
+    reading_ = true;
+
+    socket_.async_wait(asio::posix::stream_descriptor::wait_read,
+        asio::bind_executor(strand_,
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+            self->reading_ = false;
+
+            if (!ec)
+            {
+                self->read_results();
+            }
+        }));
+}
+
+void PgConnection::read_results()
+{
+    if (state_ != State::Ready)
+    {
+        return;
+    }
+
+    if (!PQconsumeInput(conn_))
+    {
+        fail(PQerrorMessage(conn_));
+        return;
+    }
+
+    while ((!in_flight_.empty() || pending_syncs_ > 0) && !PQisBusy(conn_))
+    {
+        PGresult * result = PQgetResult(conn_);
+
+        if (!result)
+        {
+            // Nothing for the oldest query yet, wait for more input.
+            if (in_flight_.empty() || !in_flight_.front().result)
+            {
+                break;
+            }
+
+            // All results of the oldest query are in.
+            InFlight done = std::move(in_flight_.front());
+            in_flight_.pop_front();
+            in_flight_count_.fetch_sub(1, std::memory_order_relaxed);
+
+            PgResult query_result(done.result);
+            ExecStatusType status = PQresultStatus(done.result);
+
+            std::string error;
+
+            if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK)
+            {
+                error = PQresultErrorMessage(done.result);
+
+                if (error.empty())
+                {
+                    error = PQresStatus(status);
+                }
+            }
+
+            asio::post(cntx_,
+                [handler = std::move(done.handler),
+                 error = std::move(error),
+                 query_result = std::move(query_result)]{
+                handler(error, query_result);
+            });
+
+            continue;
+        }
+
+        if (PQresultStatus(result) == PGRES_PIPELINE_SYNC)
+        {
+            PQclear(result);
+
+            if (pending_syncs_ > 0)
+            {
+                pending_syncs_--;
+            }
+
+            continue;
+        }
+
+        if (in_flight_.empty())
+        {
+            PQclear(result);
+            continue;
+        }
+
+        // Statements are single queries, so keep the last result.
+        InFlight & front = in_flight_.front();
+
+        if (front.result)
+        {
+            PQclear(front.result);
+        }
+
+        front.result = result;
+    }
+
+    // Reading may have unblocked output waiting to be sent.
+    flush();
+    wait_readable();
+}
+
+void PgConnection::fail(std::string error)
+{
+    if (state_ != State::Closed)
+    {
+        Console::instance().log("Database connection failed: " + error,
+                                LogLevel::ERROR);
+    }
+
+    std::vector<PgHandler> handlers;
+
+    for (auto & query : waiting_)
+    {
+        handlers.push_back(std::move(query.handler));
+    }
+
+    for (auto & flight : in_flight_)
+    {
+        handlers.push_back(std::move(flight.handler));
+
+        if (flight.result)
+        {
+            PQclear(flight.result);
+        }
+    }
+
+    waiting_.clear();
+    in_flight_.clear();
+    pending_syncs_ = 0;
+
+    // Only take back what we fail here, exec may be counting a new
+    // query that has not reached the strand yet.
+    in_flight_count_.fetch_sub(handlers.size(), std::memory_order_relaxed);
+
+    for (auto & handler : handlers)
+    {
+        asio::post(cntx_, [handler = std::move(handler), error]{
+            handler(error, PgResult{});
+        });
+    }
+
+    if (socket_.is_open())
+    {
+        socket_.release();
+    }
+
+    if (conn_)
+    {
+        PQfinish(conn_);
+        conn_ = nullptr;
+    }
+
+    if (state_ != State::Closed)
+    {
+        state_ = State::Broken;
+        retry_later();
+    }
+}
+
+void PgConnection::retry_later()
+{
+    retry_timer_.expires_after(ASYNC_PG_RETRY_INTERVAL);
+    retry_timer_.async_wait(asio::bind_executor(strand_,
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+            if (!ec && self->state_ == State::Broken)
+            {
+                self->state_ = State::Closed;
+                self->start();
+            }
+        }));
+}
+
+void PgConnection::assign_socket()
+{
+    if (socket_.is_open())
+    {
+        socket_.release();
+    }
+
+    boost::system::error_code ec;
+    socket_.assign(PQsocket(conn_), ec);
+
+    if (ec)
+    {
+        fail("Could not watch the database socket: " + ec.message());
+    }
+}
+
+PgPool::PgPool(asio::io_context & cntx,
+               std::string conninfo,
+               PgStatements statements,
+               size_t n_connections)
+{
+    auto shared_statements = std::make_shared<const PgStatements>(std::move(statements));
+
+    for (size_t i = 0; i < n_connections; i++)
+    {
+        connections_.push_back(std::make_shared<PgConnection>(cntx,
+                                                              conninfo,
+                                                              shared_statements));
+        connections_.back()->start();
+    }
+}
+
+PgPool::~PgPool()
+{
+    close();
+}
+
+void PgPool::exec(std::string statement,
+                  std::vector<std::optional<std::string>> params,
+                  PgHandler handler)
+{
+    // Least loaded connection, counts may be slightly stale.
+    auto target = std::min_element(connections_.begin(),
+                                   connections_.end(),
+                                   [](const auto & a, const auto & b)
+                                   {
+                                       return a->in_flight() < b->in_flight();
+                                   });
+
+    (*target)->exec(std::move(statement), std::move(params), std::move(handler));
+}
+
+void PgPool::close()
+{
+    for (auto & connection : connections_)
+    {
+        connection->close();
+    }
+}
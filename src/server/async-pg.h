@@ -0,0 +1,209 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <libpq-fe.h>
+
+namespace asio = boost::asio;
+
+// Connections for queries that do not need a pool thread.
+constexpr size_t ASYNC_PG_CONNECTIONS = 4;
+
+// Wait before reconnecting a connection that failed.
+constexpr std::chrono::seconds ASYNC_PG_RETRY_INTERVAL{5};
+
+// Result of one query, in text format.
+class PgResult
+{
+public:
+    PgResult() = default;
+
+    explicit PgResult(PGresult * result);
+
+    bool empty() const;
+
+    size_t size() const;
+
+    bool is_null(size_t row, const char * column) const;
+
+    std::string_view view(size_t row, const char * column) const;
+
+    // Raw bytes of a bytea column, which arrives hex escaped.
+    std::string bytes(size_t row, const char * column) const;
+
+    // Integers and strings, a null reads as a default value.
+    template <typename T>
+    T as(size_t row, const char * column) const;
+
+private:
+    int column_index(const char * column) const;
+
+private:
+    std::shared_ptr<PGresult> result_;
+};
+
+template <typename T>
+T PgResult::as(size_t row, const char * column) const
+{
+    std::string_view text = view(row, column);
+
+    if constexpr (std::is_same_v<T, std::string>)
+    {
+        return std::string(text);
+    }
+    else
+    {
+        T value{};
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+}
+
+// Empty error on success.
+using PgHandler = std::function<void(std::string error, PgResult result)>;
+
+// Prepared statements to create on every connection, name then SQL.
+using PgStatements = std::vector<std::pair<std::string, std::string>>;
+
+// One libpq connection driven by the io_context.
+//
+// The socket is non-blocking and the connection is in pipeline mode, so
+// any number of prepared statements can be in flight at once. Each query
+// is followed by a sync, so it runs in its own implicit transaction and
+// an error only fails that query. Results come back in order and each
+// handler is called on the connection's strand.
+class PgConnection : public std::enable_shared_from_this<PgConnection>
+{
+public:
+    PgConnection(asio::io_context & cntx,
+                 std::string conninfo,
+                 std::shared_ptr<const PgStatements> statements);
+
+    ~PgConnection();
+
+    void start();
+
+    // Parameters are in text format, nullopt is a SQL null.
+    void exec(std::string statement,
+              std::vector<std::optional<std::string>> params,
+              PgHandler handler);
+
+    void close();
+
+    // Queries sent but not yet answered, for load balancing.
+    size_t in_flight() const;
+
+private:
+    enum class State
+    {
+        Connecting,
+        Ready,
+        Broken,
+        Closed
+    };
+
+    struct Query
+    {
+        std::string statement;
+        std::vector<std::optional<std::string>> params;
+        PgHandler handler;
+    };
+
+    struct InFlight
+    {
+        PgHandler handler;
+        PGresult * result{nullptr};
+    };
+
+    void poll_connect(PostgresPollingStatusType status);
+
+    void on_connected();
+
+    void send(Query query);
+
+    void flush();
+
+    void wait_readable();
+
+    void read_results();
+
+    void fail(std::string error);
+
+    void retry_later();
+
+    void assign_socket();
+
+private:
+    asio::io_context & cntx_;
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::posix::stream_descriptor socket_;
+    asio::steady_timer retry_timer_;
+
+    std::string conninfo_;
+    std::shared_ptr<const PgStatements> statements_;
+
+    // Strand only.
+    PGconn * conn_{nullptr};
+    State state_{State::Closed};
+    bool reading_{false};
+    bool writing_{false};
+
+    // Queries made before the connection was ready.
+    std::deque<Query> waiting_;
+
+    // Sent queries, oldest first, and syncs whose result is still due.
+    std::deque<InFlight> in_flight_;
+    size_t pending_syncs_{0};
+
+    std::atomic<size_t> in_flight_count_{0};
+};
+
+// Spreads queries over a few non-blocking connections.
+class PgPool
+{
+public:
+    PgPool(asio::io_context & cntx,
+           std::string conninfo,
+           PgStatements statements,
+           size_t n_connections = ASYNC_PG_CONNECTIONS);
+
+    ~PgPool();
+
+    // The handler runs on an io_context thread, never inline.
+    void exec(std::string statement,
+              std::vector<std::optional<std::string>> params,
+              PgHandler handler);
+
+    void close();
+
+private:
+    std::vector<std::shared_ptr<PgConnection>> connections_;
+};
@@ -0,0 +1,366 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "ban-index.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
+namespace ip = boost::asio::ip;
+
+// Offset of an IPv4 address inside an IPv4 mapped IPv6 address, in bits.
+static constexpr uint8_t V4_MAPPED_OFFSET = 96;
+
+static inline int bit_at(const std::array<uint8_t, 16> & bytes, uint8_t index)
+{
+    return (bytes[index / 8] >> (7 - (index % 8))) & 1;
+}
+
+// Length of the common prefix of a and b, up to limit bits.
+static uint8_t common_length(const std::array<uint8_t, 16> & a,
+                             const std::array<uint8_t, 16> & b,
+                             uint8_t limit)
+{
+    uint8_t length = 0;
+
+    for (size_t i = 0; i < 16 && length < limit; i++)
+    {
+        uint8_t diff = a[i] ^ b[i];
+
+        if (diff == 0)
+        {
+            length += 8;
+            continue;
+        }
+
+        length += static_cast<uint8_t>(std::countl_zero(diff));
+        break;
+    }
+
+    return std::min(length, limit);
+}
+
+static std::array<uint8_t, 16> masked(std::array<uint8_t, 16> bytes,
+                                      uint8_t length)
+{
+    for (size_t i = 0; i < 16; i++)
+    {
+        int keep = std::clamp(static_cast<int>(length) - static_cast<int>(i * 8),
+                              0,
+                              8);
+
+        bytes[i] &= static_cast<uint8_t>(0xFF00 >> keep);
+    }
+
+    return bytes;
+}
+
+std::optional<IPPrefix> IPPrefix::parse(std::string_view text)
+{
+    std::string_view address_text = text;
+    std::optional<int> length;
+
+    if (auto slash = text.find('/'); slash != std::string_view::npos)
+    {
+        address_text = text.substr(0, slash);
+        std::string_view length_text = text.substr(slash + 1);
+
+        int value = 0;
+        auto [end, ec] = std::from_chars(length_text.data(),
+                                         length_text.data() + length_text.size(),
+                                         value);
+
+        if (ec != std::errc() || end != length_text.data() + length_text.size())
+        {
+            return std::nullopt;
+        }
+
+        length = value;
+    }
+
+    boost::system::error_code ec;
+    ip::address address = ip::make_address(std::string(address_text), ec);
+
+    if (ec)
+    {
+        return std::nullopt;
+    }
+
+    IPPrefix prefix = from_address(address);
+
+    if (length)
+    {
+        int max_length = address.is_v4() ? 32 : 128;
+
+        if (*length < 0 || *length > max_length)
+        {
+            return std::nullopt;
+        }
+
+        prefix.length = static_cast<uint8_t>(
+                            *length + (address.is_v4() ? V4_MAPPED_OFFSET : 0));
+        prefix.bytes = masked(prefix.bytes, prefix.length);
+    }
+
+    return prefix;
+}
+
+IPPrefix IPPrefix::from_address(const ip::address & address)
+{
+    IPPrefix prefix;
+    prefix.length = 128;
+
+    if (address.is_v4())
+    {
+        prefix.bytes = ip::make_address_v6(ip::v4_mapped,
+                                           address.to_v4()).to_bytes();
+    }
+    else
+    {
+        prefix.bytes = address.to_v6().to_bytes();
+    }
+
+    return prefix;
+}
+
+std::string IPPrefix::to_string() const
+{
+    ip::address_v6 v6(bytes);
+
+    if (v6.is_v4_mapped() && length >= V4_MAPPED_OFFSET)
+    {
+        std::string text = ip::make_address_v4(ip::v4_mapped, v6).to_string();
+
+        if (length != 128)
+        {
+            text += "/" + std::to_string(length - V4_MAPPED_OFFSET);
+        }
+
+        return text;
+    }
+
+    std::string text = v6.to_string();
+
+    if (length != 128)
+    {
+        text += "/" + std::to_string(length);
+    }
+
+    return text;
+}
+
+BanIndex::BanIndex()
+{
+    std::lock_guard lock(writer_mutex_);
+    publish();
+}
+
+void BanIndex::load(const std::unordered_map<std::string, time_point> & bans)
+{
+    std::lock_guard lock(writer_mutex_);
+
+    bans_.clear();
+
+    for (const auto & [text, banned_until] : bans)
+    {
+        auto prefix = IPPrefix::parse(text);
+
+        if (!prefix)
+        {
+            continue;
+        }
+
+        auto & entry = bans_[*prefix];
+        entry = std::max(entry, banned_until);
+    }
+
+    publish();
+}
+
+void BanIndex::add(const IPPrefix & prefix, time_point banned_until)
+{
+    std::lock_guard lock(writer_mutex_);
+
+    // Console bans overwrite, same as the database entry.
+    bans_[prefix] = banned_until;
+
+    publish();
+}
+
+std::vector<IPPrefix> BanIndex::prune_expired(time_point now)
+{
+    std::lock_guard lock(writer_mutex_);
+
+    std::vector<IPPrefix> expired;
+
+    for (auto itr = bans_.begin(); itr != bans_.end();)
+    {
+        if (itr->second <= now)
+        {
+            expired.push_back(itr->first);
+            itr = bans_.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+
+    if (!expired.empty())
+    {
+        publish();
+    }
+
+    return expired;
+}
+
+BanLookup BanIndex::check(const ip::address & address, time_point now) const
+{
+    BanLookup result;
+
+    std::shared_ptr<const Trie> trie = trie_.load(std::memory_order_acquire);
+    const Trie & nodes = *trie;
+
+    IPPrefix key = IPPrefix::from_address(address);
+
+    int32_t index = 0;
+
+    while (index != -1)
+    {
+        const Node & node = nodes[index];
+
+        // Check the node actually matches, path compression may have
+        // skipped over bits that differ from our key.
+        if (common_length(node.prefix.bytes, key.bytes, node.prefix.length)
+            < node.prefix.length)
+        {
+            break;
+        }
+
+        if (node.banned)
+        {
+            if (node.banned_until > now)
+            {
+                result.banned_until = std::max(result.banned_until.value_or(now),
+                                               node.banned_until);
+            }
+            else
+            {
+                result.saw_expired = true;
+            }
+        }
+
+        if (node.prefix.length == 128)
+        {
+            break;
+        }
+
+        index = node.children[bit_at(key.bytes, node.prefix.length)];
+    }
+
+    return result;
+}
+
+std::shared_ptr<const BanIndex::Trie>
+BanIndex::build(const std::map<IPPrefix, time_point> & bans)
+{
+    auto trie = std::make_shared<Trie>();
+
+    // Each insert adds at most a leaf and a split node.
+    trie->reserve(2 * bans.size() + 1);
+    trie->emplace_back();
+
+    Trie & nodes = *trie;
+
+    for (const auto & [prefix, banned_until] : bans)
+    {
+        int32_t index = 0;
+
+        while (true)
+        {
+            if (nodes[index].prefix.length == prefix.length)
+            {
+                nodes[index].banned = true;
+                nodes[index].banned_until = banned_until;
+                break;
+            }
+
+            int bit = bit_at(prefix.bytes, nodes[index].prefix.length);
+            int32_t child = nodes[index].children[bit];
+
+            // Empty slot, hang a leaf here.
+            if (child == -1)
+            {
+                Node leaf;
+                leaf.prefix = prefix;
+                leaf.banned = true;
+                leaf.banned_until = banned_until;
+
+                nodes[index].children[bit] = static_cast<int32_t>(nodes.size());
+                nodes.push_back(leaf);
+                break;
+            }
+
+            uint8_t common = common_length(prefix.bytes,
+                                           nodes[child].prefix.bytes,
+                                           std::min(prefix.length,
+                                                    nodes[child].prefix.length));
+
+            // The child's prefix contains ours, descend.
+            if (common == nodes[child].prefix.length)
+            {
+                index = child;
+                continue;
+            }
+
+            // Otherwise split the edge at the first differing bit.
+            Node split;
+            split.prefix.bytes = masked(prefix.bytes, common);
+            split.prefix.length = common;
+            split.children[bit_at(nodes[child].prefix.bytes, common)] = child;
+
+            int32_t split_index = static_cast<int32_t>(nodes.size());
+            nodes[index].children[bit] = split_index;
+
+            if (common == prefix.length)
+            {
+                split.banned = true;
+                split.banned_until = banned_until;
+                nodes.push_back(split);
+                break;
+            }
+
+            Node leaf;
+            leaf.prefix = prefix;
+            leaf.banned = true;
+            leaf.banned_until = banned_until;
+
+            split.children[bit_at(prefix.bytes, common)] = split_index + 1;
+
+            nodes.push_back(split);
+            nodes.push_back(leaf);
+            break;
+        }
+    }
+
+    return trie;
+}
+
+void BanIndex::publish()
+{
+    trie_.store(build(bans_), std::memory_order_release);
+}
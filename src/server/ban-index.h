@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/ip/address.hpp>
+
+// An IPv4 or IPv6 network prefix. IPv4 prefixes are stored as IPv4 mapped
+// IPv6 prefixes so both families share a single trie.
+struct IPPrefix
+{
+    std::array<uint8_t, 16> bytes{};
+    uint8_t length{0};
+
+    auto operator<=>(const IPPrefix &) const = default;
+
+    // Parse "a.b.c.d", "a.b.c.d/n", "x::y" or "x::y/n". Host bits are
+    // cleared. Returns nullopt on malformed input.
+    static std::optional<IPPrefix> parse(std::string_view text);
+
+    static IPPrefix from_address(const boost::asio::ip::address & address);
+
+    // Text form accepted by postgres INET columns.
+    std::string to_string() const;
+};
+
+struct BanLookup
+{
+    // Latest expiration of any active ban covering the address.
+    std::optional<std::chrono::system_clock::time_point> banned_until;
+
+    // Set if an expired ban covered the address and should be pruned.
+    bool saw_expired{false};
+};
+
+// Index of IP bans supporting CIDR ranges.
+//
+// Lookups walk an immutable, path compressed binary radix trie that is
+// published through an atomic shared pointer, so the accept loop never
+// takes a lock. Writers (console bans, pruning) are rare, so they take
+// the writer mutex, rebuild the trie from the full ban list, and publish
+// the new snapshot. Readers still holding the old snapshot keep it alive
+// until they are done with it.
+class BanIndex
+{
+    using time_point = std::chrono::system_clock::time_point;
+
+public:
+    BanIndex();
+
+    // Replace all bans, skipping entries that fail to parse.
+    void load(const std::unordered_map<std::string, time_point> & bans);
+
+    void add(const IPPrefix & prefix, time_point banned_until);
+
+    // Remove bans that have expired, returning them so the caller can
+    // clear them from the database.
+    std::vector<IPPrefix> prune_expired(time_point now);
+
+    BanLookup check(const boost::asio::ip::address & address,
+                    time_point now) const;
+
+private:
+    struct Node
+    {
+        IPPrefix prefix;
+
+        // Indices into the node array, -1 if there is no child.
+        std::array<int32_t, 2> children{-1, -1};
+
+        // Ban on exactly this prefix, if any.
+        bool banned{false};
+        time_point banned_until{};
+    };
+
+    // Nodes are stored contiguously, the root (the empty prefix)
+    // is always at index 0.
+    using Trie = std::vector<Node>;
+
+    static std::shared_ptr<const Trie>
+    build(const std::map<IPPrefix, time_point> & bans);
+
+    // Must be called with writer_mutex_ held.
+    void publish();
+
+private:
+    std::atomic<std::shared_ptr<const Trie>> trie_;
+
+    // Source of truth for rebuilding the trie, only touched by writers.
+    std::mutex writer_mutex_;
+    std::map<IPPrefix, time_point> bans_;
+};
@@ -92,16 +92,15 @@ inline void console_dispatch(Server & server, std::string line)
         if (!(iss >> ip >> length) || length <= 0)
         {
             Console::instance().log(
-                "Usage: BanIP <ipv4_address> <duration (minutes)>",
+                "Usage: BanIP <ip_address[/prefix_length]> <duration (minutes)>",
                 LogLevel::CONSOLE
             );
             return;
         }
 
-        // Check that the IP is valid.
-        boost::system::error_code ec;
-        asio::ip::make_address_v4(ip, ec);
-        if (ec)
+        // Check that the IP or range is valid.
+        auto prefix = IPPrefix::parse(ip);
+        if (!prefix)
         {
             Console::instance().log(
                 "IP " + ip + " is not valid.",
@@ -115,7 +114,7 @@ inline void console_dispatch(Server & server, std::string line)
         system_clock::time_point banned_until = (system_clock::now()
                                                 + minutes(length));
 
-        server.CONSOLE_ban_ip(ip, banned_until);
+        server.CONSOLE_ban_ip(*prefix, banned_until);
     }
     else if (cmd == "help")
     {
@@ -123,7 +122,10 @@ inline void console_dispatch(Server & server, std::string line)
                 "Available commands: \n"
                 "           ShowIdentity\n"
                 "           BanUser <username> <duration (minutes)> <reason>\n"
-                "           BanIP <ipv4_address> <duration (minutes)>\n"
+                "           BanIP <ip_address[/prefix_length]> <duration (minutes)>\n"
+                "           HashStats\n"
+                "           ReplayStats\n"
+                "           MigrateReplays\n"
                 "           Shutdown",
                 LogLevel::CONSOLE
             );
@@ -136,6 +138,24 @@ inline void console_dispatch(Server & server, std::string line)
             );
         server.shutdown();
     }
+    else if (cmd == "hashstats")
+    {
+        Console::instance().log(
+                server.CONSOLE_hash_stats(),
+                LogLevel::CONSOLE
+            );
+    }
+    else if (cmd == "replaystats")
+    {
+        Console::instance().log(
+                server.CONSOLE_replay_stats(),
+                LogLevel::CONSOLE
+            );
+    }
+    else if (cmd == "migratereplays")
+    {
+        server.CONSOLE_migrate_replays();
+    }
     else if (cmd == "showidentity")
     {
         std::string identity_line = server.get_identity_string();
@@ -18,77 +18,124 @@
 #include "cryptography-constants.h"
 #include "message.h"
 #include "user-manager.h"
-#include "elo-updates.h"
 #include "console.h"
+#include "replay-codec.h"
 
 #include <boost/uuid/uuid_io.hpp>
-#include <pqxx/strconv.hxx>
 
-// One connection to the database per thread in the thread pool.
-static thread_local std::unique_ptr<pqxx::connection> conn_;
+#include <algorithm>
 
-// Utility to turn timepoint into a string for the database.
-std::string timepoint_to_string(std::chrono::system_clock::time_point banned_until)
+// Logs and returns false if a match result can not be stored.
+static bool valid_result(const std::vector<boost::uuids::uuid> & user_ids,
+                         const std::vector<uint8_t> & elimination_order)
 {
-    // prepare time point for DB insertion
-    auto tt = std::chrono::system_clock::to_time_t(banned_until);
-    std::tm tm_utc;
+    size_t N_players = user_ids.size();
 
-    // We need different time conversion (thread safe)
-    // functions for different platforms.
-#if defined(_WIN32) || defined(_WIN64)
-    gmtime_s(&tm_utc, &tt);
-#else
-    gmtime_r(&tt, &tm_utc);
-#endif
+    if (N_players <= 1)
+    {
+        Console::instance().log("Too few players in match log!",
+                                LogLevel::ERROR);
+        return false;
+    }
 
-    std::ostringstream oss;
-    oss << std::put_time(&tm_utc, "%Y-%m-%dT%H:%M:%S");
+    if (elimination_order.size() != N_players)
+    {
+        Console::instance().log(
+            "Size mismatch between elimination "
+            "order and number of players.",
+            LogLevel::ERROR);
 
-    std::string banned_until_str = oss.str();
+        return false;
+    }
 
-    banned_until_str += "Z";
+    // Placement is N_players - elimination, which must be 1 to N_players.
+    for (uint8_t elimination : elimination_order)
+    {
+        if (elimination >= N_players)
+        {
+            Console::instance().log("Elimination order out of range in match log!",
+                                    LogLevel::ERROR);
+            return false;
+        }
+    }
 
-    return banned_until_str;
+    return true;
 }
 
-// Manually convert a vector of UUID strings to data for postgre to use.
-//
-// This could be replaced if using a new version of libpqxx that supports
-// passing in std::vector<std::string> but otherwise this is necessary.
-//
-// This function should not be called for any arbitrary data, only UUIDs.
-std::string uuid_to_pq_array(const std::vector<std::string> & user_id_strs)
+// Rows are newest first and may run past the page, which sets more.
+static MatchHistoryPage make_history_page(GameMode mode,
+                                          std::vector<MatchResultRow> rows,
+                                          size_t page_size)
 {
-    std::string result = "{";
-    for (size_t i = 0; i < user_id_strs.size(); i++)
+    MatchHistoryPage page;
+    page.mode = mode;
+    page.more = rows.size() > page_size;
+
+    if (page.more)
     {
-        result += "\"" + user_id_strs[i] + "\"";
-        if (i + 1 < user_id_strs.size())
-        {
-            result += ",";
-        }
+        rows.resize(page_size);
+    }
+
+    if (!rows.empty())
+    {
+        page.next.finished_at = std::chrono::system_clock::to_time_t(rows.back().finished_at);
+        page.next.match_id = rows.back().match_id;
     }
 
-    result += "}";
-    return result;
+    page.match_results = std::move(rows);
+
+    return page;
 }
 
-// We expect that a file exists at ~/.pgpass
+// The storage backend is chosen by spec, see make_storage.
 Database::Database(asio::io_context & io,
                    AuthCallback auth_callback,
                    BanCallback ban_callback,
                    ShutdownCallback shutdown_callback,
-                   std::shared_ptr<UserManager> user_manager)
+                   std::shared_ptr<UserManager> user_manager,
+                   std::string storage_spec,
+                   std::string write_behind_dir,
+                   std::string archive_dir)
 : strand_(io.get_executor()),
-thread_pool_(MAX_CONCURRENT_AUTHS),
+maintenance_timer_(strand_),
+storage_(make_storage(io, storage_spec, archive_dir)),
+db_pool_(DB_POOL_THREADS),
 auth_callback_(std::move(auth_callback)),
 ban_callback_(std::move(ban_callback)),
 shutdown_callback_(std::move(shutdown_callback)),
 user_manager_(user_manager),
-// Isolate per username work on the same thread pool.
-uuid_strands_(thread_pool_.get_executor())
-{}
+// Isolate per username work on the database pool.
+uuid_strands_(db_pool_.get_executor())
+{
+    if (!write_behind_dir.empty() && !storage_->supports_write_behind())
+    {
+        std::string lmsg = "Write-behind is not supported with "
+                           + storage_->name()
+                           + " storage, matches are written directly.";
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::WARN);
+
+        write_behind_dir.clear();
+    }
+
+    if (!write_behind_dir.empty())
+    {
+        recorder_ = std::make_shared<MatchRecorder>(
+            db_pool_,
+            std::move(write_behind_dir),
+            history_cache_,
+            [this, user_manager](boost::uuids::uuid user_id, int elo, GameMode mode)
+            {
+                leaderboard_.update(user_id, mode, elo);
+                user_manager->notify_elo_update(user_id, elo, mode);
+            });
+
+        recorder_->start();
+    }
+
+    // Make sure there is a partition for the next match before any are played.
+    do_maintenance();
+}
 
 void Database::authenticate(Message msg,
                             std::shared_ptr<Session> session,
@@ -188,33 +235,49 @@ void Database::record_match(MatchResult result)
 {
     asio::post(strand_, [this, result = std::move(result)] mutable
     {
+        // Both the recorder and do_record index the elimination order
+        // by player, so a bad result is dropped before either sees it.
+        if (!valid_result(result.user_ids, result.elimination_order))
+        {
+            return;
+        }
+
         // Add a write to pending, we need to not prevent
         // match results to be returned and exit only once done.
-        pending_writes_.fetch_add(1, std::memory_order_acq_rel);
-
-        std::string moves_json;
-        auto ec = glz::write_json(result.move_history, moves_json);
-
-        // Handle bad write.
-        if (ec)
+        //
+        // The recorder tracks its own writes, see async_shutdown.
+        if (!recorder_)
         {
-            moves_json = "Error parsing moves.";
+            pending_writes_.fetch_add(1, std::memory_order_acq_rel);
         }
 
+        std::string moves = encode_replay(result.move_history);
+
         std::string settings_json;
-        ec = glz::write_json(result, settings_json);
+        auto ec = glz::write_json(result, settings_json);
 
         // Handle bad write.
         if (ec)
         {
-            moves_json = "Error parsing settings.";
+            settings_json = "Error parsing settings.";
+        }
+
+        if (recorder_)
+        {
+            recorder_->enqueue(PendingMatch{boost::uuids::random_generator()(),
+                                            result.user_ids,
+                                            result.elimination_order,
+                                            std::move(settings_json),
+                                            std::move(moves),
+                                            static_cast<GameMode>(result.settings.mode)});
+            return;
         }
 
         // post database work to the database thread pool.
         do_record(result.user_ids,
                   result.elimination_order,
                   settings_json,
-                  moves_json,
+                  moves,
                   static_cast<GameMode>(result.settings.mode));
     });
 }
@@ -413,9 +476,68 @@ void Database::fetch_new_matches(boost::uuids::uuid user,
         return;
     }
 
+    // Served from memory when we have the user's history.
+    if (auto rows = history_cache_.get(user, mode))
+    {
+        Message match_history_message;
+
+        if (rows->empty())
+        {
+            match_history_message.create_serialized(HeaderType::NoNewMatches);
+        }
+        else
+        {
+            if (rows->size() > static_cast<size_t>(LATEST_MATCHES_COUNT))
+            {
+                rows->resize(LATEST_MATCHES_COUNT);
+            }
+
+            MatchResultList results;
+            results.mode = mode;
+            results.match_results = std::move(*rows);
+
+            match_history_message.create_serialized(results);
+        }
+
+        session->deliver(match_history_message);
+        return;
+    }
+
     do_fetch_new_matches(user, mode, session);
 }
 
+void Database::fetch_match_page(boost::uuids::uuid user,
+                                MatchHistoryPageRequest req,
+                                std::shared_ptr<Session> session)
+{
+    if (shutting_down_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    req.page_size = std::clamp<int>(req.page_size, 1, MAX_HISTORY_PAGE_SIZE);
+
+    if (req.after.empty())
+    {
+        if (auto rows = history_cache_.get(user, req.mode))
+        {
+            // Either a row past the page is cached, or the whole history is.
+            if (rows->size() > req.page_size
+                || rows->size() < HISTORY_CACHE_DEPTH)
+            {
+                Message page_message;
+                page_message.create_serialized(make_history_page(req.mode,
+                                                                 std::move(*rows),
+                                                                 req.page_size));
+                session->deliver(page_message);
+                return;
+            }
+        }
+    }
+
+    do_fetch_match_page(user, req, session);
+}
+
 void Database::fetch_replay(ReplayRequest req,
                             std::shared_ptr<Session> session)
 {
@@ -424,41 +546,49 @@ void Database::fetch_replay(ReplayRequest req,
         return;
     }
 
-    do_fetch_replay(req, session);
+    // Only the first of concurrent requests for a match loads it.
+    if (replay_cache_.lookup(req.match_id, std::move(session))
+        == ReplayCache::Lookup::Load)
+    {
+        do_fetch_replay(req);
+    }
 }
 
-std::unordered_map<std::string, std::chrono::system_clock::time_point>
-Database::load_bans()
+void Database::fetch_leaderboard(boost::uuids::uuid user,
+                                 LeaderboardRequest req,
+                                 std::shared_ptr<Session> session)
 {
-    std::unordered_map<std::string, std::chrono::system_clock::time_point>
-    map;
-
-    std::unique_ptr<pqxx::connection> temp_conn_ = std::make_unique<pqxx::connection>(
-            "host=127.0.0.1 "
-            "port=5432 "
-            "dbname=silenttanksdb "
-            "user=silenttanksoperator");
+    if (shutting_down_.load(std::memory_order_acquire))
+    {
+        return;
+    }
 
-    pqxx::work txn{*temp_conn_};
-    // Get the time in terms of the unix epoch
-    auto res = txn.exec(
-        "SELECT ip, (extract(epoch FROM banned_until)*1000)::bigint AS banned_ms "
-        "FROM BannedIPs");
+    Message page_message;
+    page_message.create_serialized(leaderboard_.query(user, req));
+    session->deliver(page_message);
+}
 
-    // For row in rows essentially.
-    for (const auto & row : res)
-    {
-        std::string ip = row["ip"].c_str();
+std::unordered_map<std::string, std::chrono::system_clock::time_point>
+Database::load_bans()
+{
+    return storage_->load_ip_bans();
+}
 
-        auto ms = row["banned_ms"].as<long long>();
+size_t Database::load_leaderboard()
+{
+    size_t ratings = 0;
 
-        auto timepoint = std::chrono::system_clock::time_point{
-                                std::chrono::milliseconds(ms)
-                                };
-        map.emplace(std::move(ip), timepoint);
-    }
+    storage_->load_ratings(
+        [this, &ratings](const boost::uuids::uuid & user_id,
+                         const std::string & username,
+                         GameMode mode,
+                         int elo)
+        {
+            leaderboard_.set(user_id, username, mode, elo);
+            ratings++;
+        });
 
-    return map;
+    return ratings;
 }
 
 void Database::async_shutdown()
@@ -470,15 +600,56 @@ void Database::async_shutdown()
         return;
     }
 
+    // Queries still in flight are failed and their handlers told.
+    storage_->close();
+
+    asio::post(strand_, [this]{
+        maintenance_timer_.cancel();
+    });
+
+    // Let the recorder write what it has buffered first.
+    if (recorder_)
+    {
+        recorder_->shutdown([this]{
+            recorder_drained_.store(true, std::memory_order_release);
+            try_finish_shutdown();
+        });
+    }
+
     // Try to shutdown.
     try_finish_shutdown();
 }
 
+void Database::migrate_replays()
+{
+    if (migrating_replays_.exchange(true))
+    {
+        Console::instance().log("Replay migration is already running.",
+                                LogLevel::CONSOLE);
+        return;
+    }
+
+    Console::instance().log("Migrating legacy replays.",
+                            LogLevel::CONSOLE);
+
+    do_migrate_replays(ReplayMigration{});
+}
+
+HashPoolStats Database::hash_stats() const
+{
+    return hash_pool_.stats();
+}
+
+ReplayCacheStats Database::replay_stats() const
+{
+    return replay_cache_.stats();
+}
+
 void Database::do_auth(LoginRequest request,
                        std::shared_ptr<Session> session,
                        std::string client_ip)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
                [this,
                req=std::move(request),
                s = std::move(session),
@@ -486,72 +657,36 @@ void Database::do_auth(LoginRequest request,
 
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-            auto res = txn.exec(pqxx::prepped{"auth"},
-                                pqxx::params{req.username});
+            std::optional<LoginRecord> record = storage_->find_login(req.username);
 
-            if (!res.empty())
+            if (!record)
             {
-                auto row = res[0];
-
-                auto hash_bytes = row["hash"].as<pqxx::bytes>();
-                auto salt_bytes = row["salt"].as<pqxx::bytes>();
-
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid user_id = gen(row["user_id"].as<std::string>());
-
-                uuid_strands_.post(user_id,
-                    [this,
-                     req = std::move(req),
-                     user_id,
-                     hash_bytes,
-                     salt_bytes,
-                     s,
-                     ip
-                     ]() mutable {
-// START LAMBDA FOR UUID BASED STRAND
-    UserData data;
-    UUIDHashSet friends;
-    UUIDHashSet blocks;
-    try {
-            prepares();
+                // Empty, failed to find user.
+                Message bad_auth;
+                BadAuthNotification a_notif(BadAuthNotification::Reason::InvalidUsername);
+                bad_auth.create_serialized(a_notif);
 
-            pqxx::work txn{*conn_};
-            pqxx::result ban_res = txn.exec
-                                    (
-                                        pqxx::prepped{"check_bans"},
-                                        pqxx::params{boost::uuids::to_string(user_id)}
-                                    );
+                s->deliver(bad_auth);
+                return;
+            }
 
             // If user is banned, reject and send them a banned message.
-            if(!ban_res.empty())
+            //
+            // Banned users are turned away before we spend a hash on them.
+            if (record->banned_until)
             {
-                auto ban_row = ban_res[0];
-
-                // Convert the ban time, same as load_bans
-                auto ms = ban_row["banned_ms"].as<long long>();
-
-                auto timepoint = std::chrono::system_clock::time_point
-                                    {
-                                        std::chrono::milliseconds(ms)
-                                    };
-
                 // Convert to message and deliver to the session.
                 BanMessage ban_msg;
-                ban_msg.time_till_unban = timepoint;
-                ban_msg.reason = ban_row["reason"].as<std::string>();
+                ban_msg.time_till_unban = *record->banned_until;
+                ban_msg.reason = std::move(record->ban_reason);
 
                 Message banned;
                 banned.create_serialized(ban_msg);
                 s->deliver(banned);
 
-                txn.commit();
-
                 if(auth_callback_)
                 {
-                    auth_callback_(data, friends, blocks, s);
+                    auth_callback_(UserData{}, UUIDHashSet{}, UUIDHashSet{}, s);
                 }
                 else
                 {
@@ -565,118 +700,113 @@ void Database::do_auth(LoginRequest request,
                 return;
             }
 
-            // If we get here, the user is not currently banned.
-
-            if (hash_bytes.size() != HASH_LENGTH ||
-                salt_bytes.size() != SALT_LENGTH)
-            {
-                std::string lmsg = "DB call had wrong hashing lengths! "
-                                    + std::to_string(hash_bytes.size())
-                                    + " "
-                                    + std::to_string(salt_bytes.size());
-                Console::instance().log(std::move(lmsg),
-                                        LogLevel::ERROR);
-                return;
-            }
-
-            std::array<uint8_t, HASH_LENGTH> hash;
-            std::array<uint8_t, SALT_LENGTH> salt;
-
-            std::copy
-            (
-                reinterpret_cast<uint8_t *>(hash_bytes.data()),
-                reinterpret_cast<uint8_t *>(hash_bytes.data() + hash_bytes.size()),
-                hash.begin()
-            );
-
-            std::copy
-            (
-                reinterpret_cast<uint8_t *>(salt_bytes.data()),
-                reinterpret_cast<uint8_t *>(salt_bytes.data() + salt_bytes.size()),
-                salt.begin()
-            );
-
-            // First, take our 32 byte H(password) from the user
-            // and compute H(H(password), salt) using libargon2
-            std::array<uint8_t, HASH_LENGTH> computed_hash{};
-            int result = argon2id_hash_raw(
-                ARGON2_TIME,
-                ARGON2_MEMORY,
-                ARGON2_PARALLEL,
-                reinterpret_cast<const uint8_t*>(req.hash.data()),
-                req.hash.size(),
-                salt.data(),
-                salt.size(),
-                computed_hash.data(),
-                computed_hash.size());
-
-            // If function hashed successfully, compare hashes.
-            if (result == ARGON2_OK)
-            {
-                // If correct, password matched and we can authenticate.
-                if (computed_hash == hash)
-                {
-                    data.user_id = user_id;
-                    data.username = req.username;
+            // Hash off the database threads, then finish the login
+            // on the user's strand back in the database pool.
+            bool accepted = hash_pool_.try_post(
+                [this,
+                 req = std::move(req),
+                 user_id = record->user_id,
+                 hash = record->hash,
+                 salt = record->salt,
+                 s,
+                 ip]() mutable {
+
+                // Take our 32 byte H(password) from the user and
+                // compute H(H(password), salt) using libargon2
+                std::array<uint8_t, HASH_LENGTH> computed_hash{};
+                int result = argon2id_hash_raw(
+                    ARGON2_TIME,
+                    ARGON2_MEMORY,
+                    ARGON2_PARALLEL,
+                    reinterpret_cast<const uint8_t*>(req.hash.data()),
+                    req.hash.size(),
+                    salt.data(),
+                    salt.size(),
+                    computed_hash.data(),
+                    computed_hash.size());
 
-                    // Update the user's login history.
-                    txn.exec(pqxx::prepped{"update_user_logins"},
-                             pqxx::params{
-                             ip,
-                             boost::uuids::to_string(user_id)});
+                bool matched = (result == ARGON2_OK && computed_hash == hash);
 
-                    // Grab user relations.
-                    boost::uuids::string_generator gen;
+                uuid_strands_.post(user_id,
+                    [this,
+                     username = std::move(req.username),
+                     user_id,
+                     result,
+                     matched,
+                     s,
+                     ip]() mutable {
+
+                    finish_auth(std::move(username),
+                                user_id,
+                                result,
+                                matched,
+                                std::move(s),
+                                std::move(ip));
+                });
+            });
 
-                    auto f_res = txn.exec(pqxx::prepped{"INTERNAL_fetch_friends"},
-                                          pqxx::params{
-                                          boost::uuids::to_string(user_id)});
+            // Too many logins in flight, turn this one away.
+            if (!accepted)
+            {
+                Message bad_auth;
+                BadAuthNotification a_notif(BadAuthNotification::Reason::ServerError);
+                bad_auth.create_serialized(a_notif);
 
-                    friends.clear();
-                    friends.reserve(f_res.size());
+                s->deliver(bad_auth);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::string lmsg = "Database error during auth: "
+                                + std::string(e.what());
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::ERROR);
 
-                    for (const auto & row : f_res)
-                    {
-                        friends.insert(
-                            gen(row["friend_id"].as<std::string>()));
-                    }
+            Message bad_auth;
+            BadAuthNotification a_notif(BadAuthNotification::Reason::ServerError);
+            bad_auth.create_serialized(a_notif);
 
-                    auto b_res = txn.exec(pqxx::prepped{"INTERNAL_fetch_blocks"},
-                                          pqxx::params{
-                                          boost::uuids::to_string(user_id)});
+            s->deliver(bad_auth);
+        }
+    });
+}
 
-                    blocks.clear();
-                    blocks.reserve(b_res.size());
+void Database::finish_auth(std::string username,
+                           boost::uuids::uuid user_id,
+                           int hash_result,
+                           bool hash_matched,
+                           std::shared_ptr<Session> s,
+                           std::string ip)
+{
+    UserData data;
+    UUIDHashSet friends;
+    UUIDHashSet blocks;
+    try {
+            // If function hashed successfully, check the comparison.
+            if (hash_result == ARGON2_OK)
+            {
+                // If correct, password matched and we can authenticate.
+                if (hash_matched)
+                {
+                    // Update the user's login history and grab their
+                    // relations and elos.
+                    LoginData login = storage_->login(user_id, ip);
 
-                    for (const auto & row : b_res)
-                    {
-                        blocks.insert(
-                            gen(row["blocked"].as<std::string>()));
-                    }
+                    data.user_id = user_id;
+                    data.username = username;
 
-                    // Fetch elo's for this user.
-                    auto mode_elos = txn.exec(pqxx::prepped{"get_mode_elos"},
-                                              pqxx::params{
-                                              boost::uuids::to_string(user_id)});
+                    friends.insert(login.friends.begin(), login.friends.end());
+                    blocks.insert(login.blocks.begin(), login.blocks.end());
 
-                    for (const auto & row : mode_elos)
+                    for (const auto & [mode, elo] : login.elos)
                     {
-                        uint8_t mode = static_cast<uint8_t>
-                                        (
-                                            row["game_mode"].as<int>()
-                                        );
-
                         if (mode < RANKED_MODES_START)
                         {
                             continue;
                         }
 
-                        uint8_t idx = elo_ranked_index(mode);
-
-                        data.matching_elos[idx] =  row["current_elo"]
-                                                    .as<int>();
+                        data.matching_elos[elo_ranked_index(mode)] = elo;
                     }
-
                 }
                 // Inform bad login.
                 else
@@ -693,7 +823,7 @@ void Database::do_auth(LoginRequest request,
             else
             {
                 std::string lmsg = "Argon2 hashing failed "
-                                    + std::string(argon2_error_message(result));
+                                    + std::string(argon2_error_message(hash_result));
                 Console::instance().log(std::move(lmsg),
                                         LogLevel::ERROR);
 
@@ -703,8 +833,6 @@ void Database::do_auth(LoginRequest request,
 
                 s->deliver(bad_auth);
             }
-
-        txn.commit();
     }
     catch(const std::exception & e)
     {
@@ -723,60 +851,16 @@ void Database::do_auth(LoginRequest request,
         Console::instance().log("Auth callback was not set!",
                                 LogLevel::ERROR);
     }
-
-            });
-// END LAMBDA FOR UUID BASED STRAND
-            }
-            else
-            {
-                // Empty, failed to find user.
-                Message bad_auth;
-                BadAuthNotification a_notif(BadAuthNotification::Reason::InvalidUsername);
-                bad_auth.create_serialized(a_notif);
-
-                s->deliver(bad_auth);
-            }
-
-            txn.commit();
-            return;
-        }
-        catch(const pqxx::sql_error& e)
-        {
-            std::string lmsg = "Database error: "
-                                + std::string(e.what());
-            Console::instance().log(std::move(lmsg),
-                                    LogLevel::WARN);
-
-            Message bad_auth;
-            BadAuthNotification a_notif(BadAuthNotification::Reason::ServerError);
-            bad_auth.create_serialized(a_notif);
-
-            s->deliver(bad_auth);
-        }
-        catch(const std::exception& e)
-        {
-            std::string lmsg = "Unexpected exception occured during auth "
-                                + std::string(e.what());
-            Console::instance().log(std::move(lmsg),
-                                    LogLevel::ERROR);
-
-            Message bad_auth;
-            BadAuthNotification a_notif(BadAuthNotification::Reason::ServerError);
-            bad_auth.create_serialized(a_notif);
-
-            s->deliver(bad_auth);
-        }
-    });
 }
 
 void Database::do_register(LoginRequest request,
                            std::shared_ptr<Session> session,
                            std::string client_ip)
 {
-    asio::post(thread_pool_,
+    bool accepted = hash_pool_.try_post(
                [this,
                req=std::move(request),
-               s = std::move(session),
+               s = session,
                ip = std::move(client_ip)]() mutable{
 
         std::array<uint8_t, SALT_LENGTH> salt;
@@ -815,279 +899,135 @@ void Database::do_register(LoginRequest request,
         }
 
         // Now, try to insert into the database
-        try
-        {
-            prepares();
+        asio::post(db_pool_,
+                   [this,
+                   req = std::move(req),
+                   s = std::move(s),
+                   ip = std::move(ip),
+                   salt,
+                   computed_hash]{
+            try
+            {
+                // Create a random UUID for database insert
+                boost::uuids::uuid user_id = boost::uuids::random_generator()();
+
+                if (!storage_->create_user(user_id,
+                                           req.username,
+                                           computed_hash,
+                                           salt,
+                                           ip))
+                {
+                    std::string lmsg = "Registration failed: user not unique";
+                    Console::instance().log(std::move(lmsg),
+                                            LogLevel::INFO);
 
-            pqxx::work txn{*conn_};
+                    // Tell client that their username is not unique
+                    Message bad_reg;
+                    BadRegNotification r_notif(BadRegNotification::Reason::NotUnique);
+                    bad_reg.create_serialized(r_notif);
 
-            // Create a random UUID for database insert
-            boost::uuids::uuid user_id = boost::uuids::random_generator()();
+                    s->deliver(bad_reg);
+                    return;
+                }
 
-            txn.exec(
-                pqxx::prepped{"reg"},
-                pqxx::params{
-                boost::uuids::to_string(user_id),
-                req.username,
-                pqxx::bytes(reinterpret_cast<const std::byte*>(computed_hash.data()), computed_hash.size()),
-                pqxx::bytes(reinterpret_cast<const std::byte*>(salt.data()), salt.size()),
-                ip
-                });
-
-            // Create initial elo entries for the user.
-            for (uint8_t mode = RANKED_MODES_START;
-                 mode < static_cast<uint8_t>(GameMode::NO_MODE);
-                 mode++)
-            {
-                txn.exec(pqxx::prepped{"add_user_elos"},
-                         pqxx::params{
-                         boost::uuids::to_string(user_id),
-                         static_cast<int16_t>(mode),
-                         DEFAULT_ELO});
-            }
-
-            txn.commit();
-
-            // Tell client that registration was successful
-            Message good_reg;
-            good_reg.create_serialized(HeaderType::GoodRegistration);
-            s->deliver(good_reg);
-
-            s->set_registered();
-            return;
-        }
-
-        catch (const pqxx::unique_violation & e)
-        {
-            std::string lmsg = "Exception in registration: user not unique";
-            Console::instance().log(std::move(lmsg),
-                                    LogLevel::INFO);
-
-
-            // Tell client that their username is not unique
-            Message bad_reg;
-            BadRegNotification r_notif(BadRegNotification::Reason::NotUnique);
-            bad_reg.create_serialized(r_notif);
+                leaderboard_.add_user(user_id, req.username);
 
-            s->deliver(bad_reg);
-        }
-
-        catch (const std::exception & e)
-        {
-            std::string lmsg = "Exception in registration: "
-                                + std::string(e.what());
-            Console::instance().log(std::move(lmsg),
-                                    LogLevel::ERROR);
+                // Tell client that registration was successful
+                Message good_reg;
+                good_reg.create_serialized(HeaderType::GoodRegistration);
+                s->deliver(good_reg);
 
-            Message bad_reg;
-            BadRegNotification r_notif(BadRegNotification::Reason::ServerError);
-            bad_reg.create_serialized(r_notif);
+                s->set_registered();
+            }
+            catch (const std::exception & e)
+            {
+                std::string lmsg = "Exception in registration: "
+                                    + std::string(e.what());
+                Console::instance().log(std::move(lmsg),
+                                        LogLevel::ERROR);
 
-            s->deliver(bad_reg);
-        }
+                Message bad_reg;
+                BadRegNotification r_notif(BadRegNotification::Reason::ServerError);
+                bad_reg.create_serialized(r_notif);
 
+                s->deliver(bad_reg);
+            }
+        });
 
     });
 
+    // Too many hashes in flight, turn this registration away.
+    if (!accepted)
+    {
+        Message bad_reg;
+        BadRegNotification r_notif(BadRegNotification::Reason::ServerError);
+        bad_reg.create_serialized(r_notif);
+
+        session->deliver(bad_reg);
+    }
 }
 
 void Database::do_record(std::vector<boost::uuids::uuid> user_ids,
                          std::vector<uint8_t> elimination_order,
                          std::string settings_json,
-                         std::string moves_json,
+                         std::string moves,
                          GameMode mode)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
         [this,
         user_ids = std::move(user_ids),
         elimination_order = std::move(elimination_order),
         settings_json = std::move(settings_json),
-        moves_json = std::move(moves_json),
+        moves = std::move(moves),
         mode]() mutable{
 
         try
         {
-            prepares();
-
+            // Checked by record_match.
             size_t N_players = user_ids.size();
 
-            if (N_players <= 1)
-            {
-                Console::instance().log("Too few players in match log!",
-                                        LogLevel::ERROR);
-                return;
-            }
+            // The elimination order is 0, 1, ... so higher is better.
+            //
+            // The placement becomes N_players - elimination.
+            //
+            // Example: N = 3, elimination_order = {0, 2, 1}, then placement is
+            // now {3, 1, 2} as expected.
+            std::vector<int> placements(N_players);
 
-            if (elimination_order.size() != N_players)
+            for (size_t i = 0; i < N_players; i++)
             {
-                Console::instance().log(
-                    "Size mismatch between elimination "
-                    "order and number of players.",
-                    LogLevel::ERROR);
-
-                return;
+                placements[i] = static_cast<int>(N_players - elimination_order[i]);
             }
 
-            // start main transaction
-            pqxx::work match_txn{*conn_};
+            MatchWrite match{user_ids,
+                             std::move(elimination_order),
+                             placements,
+                             std::move(settings_json),
+                             std::move(moves),
+                             mode};
 
-            // Insert the match
-            auto res_m_id = match_txn.exec(
-                pqxx::prepped{"insert_matches"},
-                pqxx::params{
-                static_cast<int16_t>(mode),
-                settings_json,
-                moves_json}
-            );
+            RecordedMatch recorded = storage_->record_match(match);
 
-            long match_id = res_m_id[0][0].as<long>();
-
-            // Now we insert each player for the game into the
-            // MatchPlayers table. Loop through the players.
-            //
-            // This is a candidate for pipelining.
-            for (size_t i = 0; i < N_players; i++)
+            // Only inform the user manager once the new elos are stored.
+            for (size_t i = 0; i < recorded.new_elos.size(); i++)
             {
-                // The elimination order is 0, 1, ... so higher is better.
-                //
-                // The placement becomes N_players - elimination.
-                //
-                // Example: N = 3, elimination_order = {0, 2, 1}, then placement is
-                // now {3, 1, 2} as expected.
-                match_txn.exec(pqxx::prepped{"insert_player"},
-                               pqxx::params{
-                               match_id,
-                               boost::uuids::to_string(user_ids[i]),
-                               static_cast<int16_t>(i),
-                               static_cast<int16_t>(N_players - elimination_order[i])});
+                leaderboard_.update(user_ids[i], mode, recorded.new_elos[i]);
+                user_manager_->notify_elo_update(user_ids[i],
+                                                 recorded.new_elos[i],
+                                                 mode);
             }
 
-            match_txn.commit();
-
-            // Next, we decide if we need to change the player
-            // elos and if so we fetch the player's current ratings.
-            if (static_cast<uint8_t>(mode) >= RANKED_MODES_START)
+            for (size_t i = 0; i < N_players; i++)
             {
-                std::vector<std::string> user_id_strs;
-                user_id_strs.reserve(N_players);
-
-                // Go through the array (type is boost uuid) and
-                // create a string from the user IDs.
-                for (const auto & uuid : user_ids)
-                {
-                    user_id_strs.push_back(boost::uuids::to_string(uuid));
-                }
-
-                // Create a transaction to read the user elos.
-                pqxx::work elo_txn{*conn_};
-
-                // Manually turn this into an array of values.
-                std::string user_id_array = uuid_to_pq_array(user_id_strs);
-
-                auto read_res = elo_txn.exec(pqxx::prepped{"get_elos"},
-                                             pqxx::params{
-                                             user_id_array,
-                                             static_cast<int16_t>(mode)});
-
-                // Get elo values out of our result.
-                //
-                // We map UUID to index and then make the elo vector.
-                std::unordered_map<boost::uuids::uuid, size_t> player_idx;
-                player_idx.reserve(N_players);
-
-                for (size_t i = 0; i < N_players; i++)
-                {
-                    player_idx.emplace(user_ids[i], i);
-                }
-
-                boost::uuids::string_generator gen;
-                int elo_sum = 0;
-
-                std::vector<int> elos(N_players, 0);
-
-                for (const auto & row : read_res)
-                {
-                    boost::uuids::uuid id = gen
-                                    (
-                                        row["user_id"].as<std::string>()
-                                    );
-
-                    int elo = row["current_elo"].as<int>();
-                    auto idx_it = player_idx.find(id);
-
-                    // If we find the user ID then place in correct index.
-                    //
-                    // This should never fail, because we only found
-                    // rows based on our input UUIDs and so there
-                    // should be no way for an external UUID to get in.
-                    if (idx_it != player_idx.end())
-                    {
-                        elos[idx_it->second] = elo;
-                        elo_sum += elo;
-                    }
-                }
-
-                // If a player was missing (not found in table) then
-                // set their elo to the average of the lobby for fairness.
-                //
-                // We do not expect this to occur under normal operation, but
-                // it is good to guard against bad elo updates.
-                if (static_cast<std::size_t>(read_res.size()) < N_players)
-                {
-                    std::string lmsg = "Found "
-                                        + std::to_string(read_res.size())
-                                        + " of "
-                                        + std::to_string(N_players)
-                                        + " players in recording for match "
-                                        + std::to_string(match_id)
-                                        + ".";
-                    Console::instance().log(std::move(lmsg),
-                                            LogLevel::WARN);
-
-                    int average_elo = std::round(
-                                            static_cast<double>(elo_sum)
-                                            /
-                                            static_cast<double>(N_players));
-
-                    for (size_t i = 0; i < N_players; i++)
-                    {
-                        if (elos[i] == 0)
-                        {
-                            elos[i] = average_elo;
-                        }
-                    }
-                }
-
-                // Compute the output elo's for database updates.
-                std::vector<int> new_elos = elo_updates(elos, elimination_order);
-
-                // Update user elo's.
-                //
-                // This is a candidate for pipelining.
-                for (size_t i = 0; i < N_players; i++)
-                {
-                    elo_txn.exec(pqxx::prepped{"record_elo_history"},
-                                 pqxx::params{
-                                 boost::uuids::to_string(user_ids[i]),
-                                 match_id,
-                                 static_cast<int16_t>(mode),
-                                 elos[i],
-                                 new_elos[i]});
-
-                    elo_txn.exec(pqxx::prepped{"update_elo"},
-                                 pqxx::params{
-                                 boost::uuids::to_string(user_ids[i]),
-                                 static_cast<int16_t>(mode),
-                                 new_elos[i]});
-
-                    // Inform the user manager of elo updates.
-                    user_manager_->notify_elo_update(user_ids[i],
-                                                     new_elos[i],
-                                                     static_cast<GameMode>(static_cast<uint8_t>(mode)));
-                }
-
-                elo_txn.commit();
-
+                MatchResultRow row;
+                row.match_id = recorded.match_id;
+                row.finished_at = recorded.finished_at;
+                row.placement = static_cast<uint16_t>(placements[i]);
+                row.elo_change = recorded.new_elos.empty()
+                                 ? 0
+                                 : recorded.new_elos[i] - recorded.old_elos[i];
+
+                history_cache_.push(user_ids[i], mode, std::move(row));
             }
 
             // Record that we finished writing.
@@ -1111,21 +1051,10 @@ void Database::do_record(std::vector<boost::uuids::uuid> user_ids,
 void Database::do_ban_ip(std::string ip,
                          std::chrono::system_clock::time_point banned_until)
 {
-    asio::post(thread_pool_, [this, ip, banned_until]{
+    asio::post(db_pool_, [this, ip, banned_until]{
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
-            std::string banned_until_str = timepoint_to_string(banned_until);
-
-            txn.exec(pqxx::prepped{"ban_ip"},
-                     pqxx::params{
-                     ip,
-                     banned_until_str});
-
-            txn.commit();
+            storage_->ban_ip(ip, banned_until);
         }
         catch (const std::exception & e)
         {
@@ -1140,18 +1069,10 @@ void Database::do_ban_ip(std::string ip,
 
 void Database::do_unban_ip(std::string ip)
 {
-    asio::post(thread_pool_, [this, ip]{
+    asio::post(db_pool_, [this, ip]{
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
-            txn.exec(pqxx::prepped{"unban_ip"},
-                     pqxx::params{
-                     ip});
-
-            txn.commit();
+            storage_->unban_ip(ip);
         }
         catch (const std::exception & e)
         {
@@ -1168,7 +1089,7 @@ void Database::do_ban_user(std::string username,
                  std::chrono::system_clock::time_point banned_until,
                  std::string reason)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
         [this,
         username = std::move(username),
         banned_until = std::move(banned_until),
@@ -1176,63 +1097,41 @@ void Database::do_ban_user(std::string username,
 
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
             // Find the uuid for this username
+            std::optional<boost::uuids::uuid> user_id = storage_->find_user_id(username);
 
-            auto user_res = txn.exec(pqxx::prepped{"find_uuid"},
-                                     pqxx::params{
-                                     username});
-
-            if(!user_res.empty())
+            // No user found, exit.
+            if (!user_id)
             {
-                auto user_row = user_res[0];
-
-                // Turn this into a boost UUID.
-                std::string uuid_str = user_row["user_id"].as<std::string>();
-
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid user_id = gen(uuid_str);
+                Console::instance().log("No user in do_ban_user.",
+                                        LogLevel::CONSOLE);
+                return;
+            }
 
-                uuid_strands_.post(user_id,
-                    [this,
-                     user_id = std::move(user_id),
-                     banned_until = std::move(banned_until),
-                     reason = std::move(reason)
-                     ]() mutable {
+            uuid_strands_.post(*user_id,
+                [this,
+                 user_id = *user_id,
+                 banned_until = std::move(banned_until),
+                 reason = std::move(reason)
+                 ]() mutable {
 // START LAMBDA FOR UUID BASED STRAND
-                prepares();
-
-                pqxx::work txn{*conn_};
-
-                // Make the time string for the database
-                std::string banned_until_str = timepoint_to_string(banned_until);
-
-                // Now insert the ban based on the UUID.
-                txn.exec(pqxx::prepped{"ban_user"},
-                         pqxx::params{
-                         boost::uuids::to_string(user_id),
-                         banned_until_str,
-                         reason});
-
-                txn.commit();
+            try
+            {
+                storage_->ban_user(user_id, banned_until, reason);
 
                 // Callback with the UUID for the server to remove
                 // this user's data from memory.
                 ban_callback_(user_id, banned_until, reason);
-
-                });
-// END LAMBDA FOR UUID BASED STRAND
             }
-            // No user found, exit.
-            else
+            catch (const std::exception & e)
             {
-                Console::instance().log("No user in do_ban_user.",
-                                        LogLevel::CONSOLE);
+                std::string lmsg = "Exception in do_ban_user: "
+                                    + std::string(e.what());
+                Console::instance().log(std::move(lmsg),
+                                        LogLevel::ERROR);
             }
-            txn.commit();
+                });
+// END LAMBDA FOR UUID BASED STRAND
         }
         catch (const std::exception & e)
         {
@@ -1247,57 +1146,41 @@ void Database::do_ban_user(std::string username,
 
 void Database::do_unban_user(std::string username, uint64_t ban_id)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
         [this,
         username = std::move(username),
         ban_id]{
 
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
             // Find the uuid for this username
+            std::optional<boost::uuids::uuid> user_id = storage_->find_user_id(username);
 
-            auto user_res = txn.exec(pqxx::prepped{"find_uuid"},
-                                     pqxx::params{
-                                     username});
-
-            if(!user_res.empty())
+            // No user found, exit.
+            if (!user_id)
             {
-                auto user_row = user_res[0];
-
-                // Turn this into a boost UUID.
-                std::string uuid_str = user_row["user_id"].as<std::string>();
-
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid user_id = gen(uuid_str);
+                Console::instance().log("No user in do_unban_user",
+                                        LogLevel::CONSOLE);
+                return;
+            }
 
-                uuid_strands_.post(user_id,
-                    [this,
-                     ban_id]() mutable {
+            uuid_strands_.post(*user_id,
+                [this,
+                 ban_id]() mutable {
 // START LAMBDA FOR UUID BASED STRAND
-                prepares();
-
-                pqxx::work txn{*conn_};
-
-                txn.exec(pqxx::prepped{"unban_user"},
-                         pqxx::params{
-                         static_cast<int64_t>(ban_id)});
-
-                txn.commit();
-
-                });
-// END LAMBDA FOR UUID BASED STRAND
+            try
+            {
+                storage_->unban_user(ban_id);
             }
-            // No user found, exit.
-            else
+            catch (const std::exception & e)
             {
-                Console::instance().log("No user in do_unban_user",
-                                        LogLevel::CONSOLE);
+                std::string lmsg = "Exception in do_unban_user: "
+                                    + std::string(e.what());
+                Console::instance().log(std::move(lmsg),
+                                        LogLevel::ERROR);
             }
-            txn.commit();
+                });
+// END LAMBDA FOR UUID BASED STRAND
         }
         catch (const std::exception & e)
         {
@@ -1314,113 +1197,60 @@ void Database::do_send_friend_request(boost::uuids::uuid user,
                                       std::string friend_username,
                                       std::shared_ptr<Session> session)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
         [this,
         user = std::move(user),
         friend_username = std::move(friend_username),
         s = std::move(session)]{
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
             // Find the uuid for this username
+            std::optional<boost::uuids::uuid> friend_id
+                = storage_->find_user_id(friend_username);
 
-            auto user_res = txn.exec(pqxx::prepped{"find_uuid"},
-                                     pqxx::params{
-                                     friend_username});
-
-            if(!user_res.empty())
+            // No user found, exit.
+            if (!friend_id)
             {
-                auto user_row = user_res[0];
-
-                // Turn this into a boost UUID.
-                std::string uuid_str = user_row["user_id"].as<std::string>();
-
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid friend_id = gen(uuid_str);
-
-                // Drop this work if user is trying to friend themselves.
-                if (user == friend_id)
-                {
-                    std::string lmsg = "User "
-                                       + uuid_str
-                                       + " tried to friend themselves.";
-                    Console::instance().log(lmsg, LogLevel::WARN);
+                Console::instance().log("No user in do_send_friend_request",
+                                        LogLevel::INFO);
+                return;
+            }
 
-                    txn.commit();
-                    return;
-                }
+            // Drop this work if user is trying to friend themselves.
+            if (user == *friend_id)
+            {
+                std::string lmsg = "User "
+                                   + boost::uuids::to_string(user)
+                                   + " tried to friend themselves.";
+                Console::instance().log(lmsg, LogLevel::WARN);
+                return;
+            }
 
-                uuid_strands_.post(friend_id,
-                    [this,
-                    user = std::move(user),
-                    friend_id = std::move(friend_id),
-                    s = std::move(s)]() mutable {
+            uuid_strands_.post(*friend_id,
+                [this,
+                user = std::move(user),
+                friend_id = *friend_id,
+                s = std::move(s)]() mutable {
 // START LAMBDA FOR UUID BASED STRAND
-                try
+            try
+            {
+                // Blocked or already friends requests are dropped.
+                if (storage_->send_friend_request(user,
+                                                  friend_id,
+                                                  MAX_FRIEND_REQUESTS))
                 {
-                    prepares();
-
-                    pqxx::work txn{*conn_};
-
-                    // Check if the sender is blocked
-                    // by the receiver.
-                    auto blocked_res = txn.exec(pqxx::prepped{"check_blocked"},
-                                                pqxx::params{
-                                                boost::uuids::to_string(user),
-                                                boost::uuids::to_string(friend_id)});
-
-                    // If blocked, finish transaction and close.
-                    if (!blocked_res.empty())
-                    {
-                        txn.commit();
-                        return;
-                    }
-
-                    // Check if they are already friends.
-                    auto friends_res = txn.exec(pqxx::prepped{"check_friends"},
-                                                pqxx::params{
-                                                boost::uuids::to_string(user),
-                                                boost::uuids::to_string(friend_id)});
-
-                    // If already friends, stop now.
-                    if (!friends_res.empty())
-                    {
-                        txn.commit();
-                        return;
-                    }
-
-                    // If a friend request already exists, this will
-                    // simply do nothing.
-                    txn.exec(pqxx::prepped{"friend_request"},
-                             pqxx::params{
-                             boost::uuids::to_string(user),
-                             boost::uuids::to_string(friend_id),
-                             MAX_FRIEND_REQUESTS});
-
                     user_manager_->on_friend_request(user, friend_id);
-
-                    txn.commit();
-                }
-                catch (const std::exception & e)
-                {
-                    std::string lmsg = "Exception in do_send_friend_request: "
-                                        + std::string(e.what());
-                    Console::instance().log(std::move(lmsg),
-                                            LogLevel::ERROR);
                 }
-                });
-// END LAMBDA FOR UUID BASED STRAND
             }
-            // No user found, exit.
-            else
+            catch (const std::exception & e)
             {
-                Console::instance().log("No user in do_send_friend_request",
-                                        LogLevel::INFO);
+                std::string lmsg = "Exception in do_send_friend_request: "
+                                    + std::string(e.what());
+                Console::instance().log(std::move(lmsg),
+                                        LogLevel::ERROR);
             }
-            txn.commit();
+                });
+// END LAMBDA FOR UUID BASED STRAND
         }
         catch (const std::exception & e)
         {
@@ -1447,47 +1277,18 @@ void Database::do_respond_friend_request(boost::uuids::uuid user,
 // START LAMBDA FOR UUID BASED STRAND
     try
     {
-        prepares();
-
-        pqxx::work txn{*conn_};
-
         if (decision == ACCEPT_FRIEND_REQUEST)
         {
-            // Check if this friend request exists.
-            auto req_res = txn.exec(pqxx::prepped{"find_friend_request"},
-                                    pqxx::params{
-                                    boost::uuids::to_string(user),
-                                    boost::uuids::to_string(sender)});
+            std::optional<std::string> sender_name
+                = storage_->accept_friend_request(user, sender);
 
-            if(!req_res.empty())
+            // Otherwise the request never existed!
+            if (sender_name)
             {
-                txn.exec(pqxx::prepped{"accept_friend"},
-                         pqxx::params{
-                         boost::uuids::to_string(user),
-                         boost::uuids::to_string(sender)});
-
-                txn.exec(pqxx::prepped{"delete_friend_request"},
-                         pqxx::params{
-                         boost::uuids::to_string(sender),
-                         boost::uuids::to_string(user)});
-
-                auto f_res = txn.exec(pqxx::prepped{"find_username"},
-                                      pqxx::params{
-                                      boost::uuids::to_string(sender)});
-
                 // Send notification to caller on friend accepted.
                 NotifyRelationUpdate notification;
                 notification.user.user_id = sender;
-
-                if (!f_res.empty())
-                {
-                    notification.user.username = f_res[0]["username"].
-                                                    as<std::string>();
-                }
-                else
-                {
-                    notification.user.username.clear();
-                }
+                notification.user.username = std::move(*sender_name);
 
                 Message notify_friend;
                 notify_friend.header.type_ = HeaderType::NotifyFriendAdded;
@@ -1502,20 +1303,11 @@ void Database::do_respond_friend_request(boost::uuids::uuid user,
                                               std::move(user_username),
                                               sender);
             }
-            else
-            {
-                // Request never existed!
-            }
         }
         else
         {
-            txn.exec(pqxx::prepped{"delete_friend_request"},
-                     pqxx::params{
-                     boost::uuids::to_string(sender),
-                     boost::uuids::to_string(user)});
+            storage_->decline_friend_request(user, sender);
         }
-
-        txn.commit();
     }
     catch (const std::exception & e)
     {
@@ -1532,7 +1324,7 @@ void Database::do_block_user(boost::uuids::uuid blocker,
                              std::string blocked,
                              std::shared_ptr<Session> session)
 {
-    asio::post(thread_pool_,
+    asio::post(db_pool_,
         [this,
         blocker,
         blocked = std::move(blocked),
@@ -1540,73 +1332,38 @@ void Database::do_block_user(boost::uuids::uuid blocker,
 
         try
         {
-            prepares();
-
-            pqxx::work txn{*conn_};
-
             // Find the uuid for this username
+            std::optional<boost::uuids::uuid> blocked_id
+                = storage_->find_user_id(blocked);
 
-            auto user_res = txn.exec(pqxx::prepped{"find_uuid"},
-                                     pqxx::params{
-                                     blocked});
-
-            if(!user_res.empty())
+            // No user found, exit.
+            if (!blocked_id)
             {
-                auto user_row = user_res[0];
-
-                // Turn this into a boost UUID.
-                std::string uuid_str = user_row["user_id"].as<std::string>();
-
-                boost::uuids::string_generator gen;
-                boost::uuids::uuid blocked_id = gen(uuid_str);
+                Console::instance().log("No user in do_block_user",
+                                        LogLevel::INFO);
+                return;
+            }
 
-                if (blocker == blocked_id)
-                {
-                    std::string lmsg = "User "
-                                       + uuid_str
-                                       + " tried to block themselves.";
-                    Console::instance().log(lmsg, LogLevel::WARN);
-                    return;
-                }
+            if (blocker == *blocked_id)
+            {
+                std::string lmsg = "User "
+                                   + boost::uuids::to_string(blocker)
+                                   + " tried to block themselves.";
+                Console::instance().log(lmsg, LogLevel::WARN);
+                return;
+            }
 
-                uuid_strands_.post(blocked_id,
-                    [this,
-                    blocker = std::move(blocker),
-                    blocked = std::move(blocked),
-                    blocked_id = std::move(blocked_id),
-                    s = std::move(s)]() mutable {
+            uuid_strands_.post(*blocked_id,
+                [this,
+                blocker = std::move(blocker),
+                blocked = std::move(blocked),
+                blocked_id = *blocked_id,
+                s = std::move(s)]() mutable {
 // START LAMBDA FOR UUID BASED STRAND
             try
             {
-                prepares();
-
-                pqxx::work txn{*conn_};
-
-                // Block the user, idempotent.
-                txn.exec(pqxx::prepped{"block_user"},
-                         pqxx::params{
-                         boost::uuids::to_string(blocker),
-                         boost::uuids::to_string(blocked_id)});
-
-                // Remove any friend requests that might exist.
-                txn.exec(pqxx::prepped{"delete_friend_request"},
-                         pqxx::params{
-                         boost::uuids::to_string(blocked_id),
-                         boost::uuids::to_string(blocker)});
-
-                txn.exec(pqxx::prepped{"delete_friend_request"},
-                         pqxx::params{
-                         boost::uuids::to_string(blocker),
-                         boost::uuids::to_string(blocked_id)});
-
-                // Remove any friendships that exist between
-                // the two users.
-                txn.exec(pqxx::prepped{"remove_friend"},
-                         pqxx::params{
-                         boost::uuids::to_string(blocker),
-                         boost::uuids::to_string(blocked_id)});
-
-                txn.commit();
+                // Also removes any friendship or request between them.
+                storage_->block_user(blocker, blocked_id);
 
                 // Send notification to caller that user is blocked.
                 NotifyRelationUpdate notification;
@@ -1631,14 +1388,6 @@ void Database::do_block_user(boost::uuids::uuid blocker,
             }
                 });
 // END LAMBDA FOR UUID BASED STRAND
-            }
-            // No user found, exit.
-            else
-            {
-                Console::instance().log("No user in do_block_user",
-                                        LogLevel::INFO);
-            }
-            txn.commit();
         }
         catch (const std::exception & e)
         {
@@ -1663,16 +1412,7 @@ void Database::do_unblock_user(boost::uuids::uuid blocker,
 // START LAMBDA FOR UUID BASED STRAND
     try
     {
-        prepares();
-
-        pqxx::work txn{*conn_};
-
-        txn.exec(pqxx::prepped{"unblock_user"},
-                 pqxx::params{
-                 boost::uuids::to_string(blocker),
-                 boost::uuids::to_string(blocked_id)});
-
-        txn.commit();
+        storage_->unblock_user(blocker, blocked_id);
 
         // Send notification to caller that user is unblocked.
         NotifyRelationUpdate notification;
@@ -1713,16 +1453,7 @@ void Database::do_remove_friend(boost::uuids::uuid user,
 // START LAMBDA FOR UUID BASED STRAND
     try
     {
-        prepares();
-
-        pqxx::work txn{*conn_};
-
-        txn.exec(pqxx::prepped{"remove_friend"},
-                 pqxx::params{
-                 boost::uuids::to_string(user),
-                 boost::uuids::to_string(friend_id)});
-
-        txn.commit();
+        storage_->remove_friend(user, friend_id);
 
         // Send notification to caller that user is unblocked.
         NotifyRelationUpdate notification;
@@ -1754,41 +1485,28 @@ void Database::do_remove_friend(boost::uuids::uuid user,
 void Database::do_fetch_blocks(boost::uuids::uuid user,
                                std::shared_ptr<Session> session)
 {
+    // Submitted from the user's strand, so it is sent after any earlier
+    // write for this user has committed.
     uuid_strands_.post(user,
         [this,
         user = std::move(user),
         s = std::move(session)]() mutable {
 
-    try
-    {
-        prepares();
-
-        pqxx::work txn{*conn_};
+    storage_->fetch_blocks(user,
+        [s = std::move(s)](std::string error, std::vector<ExternalUser> users) {
 
-        auto blocks_res = txn.exec(pqxx::prepped{"fetch_blocks"},
-                                   pqxx::params{
-                                   boost::uuids::to_string(user)});
-
-        // This transaction is read only. Commit now.
-        txn.commit();
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_blocks: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        return;
+    }
 
+    try
+    {
         UserList blocked_users;
-
-        // Go through the blocked user list if it exists.
-        if(!blocks_res.empty())
-        {
-            boost::uuids::string_generator gen;
-
-            for (const auto & row : blocks_res)
-            {
-                ExternalUser blocked_user;
-
-                blocked_user.user_id = gen(row["user_id"].c_str());
-                blocked_user.username = row["username"].as<std::string>();
-
-                blocked_users.users.push_back(blocked_user);
-            }
-        }
+        blocked_users.users = std::move(users);
 
         // Turn the data into a message and send it to the client.
         Message blocks_msg;
@@ -1805,6 +1523,7 @@ void Database::do_fetch_blocks(boost::uuids::uuid user,
                                 LogLevel::ERROR);
     }
     });
+    });
 }
 
 void Database::do_fetch_friends(boost::uuids::uuid user,
@@ -1815,36 +1534,21 @@ void Database::do_fetch_friends(boost::uuids::uuid user,
         user = std::move(user),
         s = std::move(session)]() mutable {
 
-    try
-    {
-        prepares();
-
-        pqxx::work txn{*conn_};
+    storage_->fetch_friends(user,
+        [s = std::move(s)](std::string error, std::vector<ExternalUser> users) {
 
-        auto friends_res = txn.exec(pqxx::prepped{"fetch_friends"},
-                                    pqxx::params{
-                                    boost::uuids::to_string(user)});
-
-        // This transaction is read only. Commit now.
-        txn.commit();
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_friends: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        return;
+    }
 
+    try
+    {
         UserList friends;
-
-        // Go through the friends list if it exists.
-        if(!friends_res.empty())
-        {
-            boost::uuids::string_generator gen;
-
-            for (const auto & row : friends_res)
-            {
-                ExternalUser curr_friend;
-
-                curr_friend.user_id = gen(row["friend_id"].c_str());
-                curr_friend.username = row["username"].as<std::string>();
-
-                friends.users.push_back(curr_friend);
-            }
-        }
+        friends.users = std::move(users);
 
         // Turn the data into a message and send it to the client.
         Message friends_msg;
@@ -1861,6 +1565,7 @@ void Database::do_fetch_friends(boost::uuids::uuid user,
                                 LogLevel::ERROR);
     }
     });
+    });
 }
 
 void Database::do_fetch_friend_requests(boost::uuids::uuid user,
@@ -1871,36 +1576,21 @@ void Database::do_fetch_friend_requests(boost::uuids::uuid user,
         user = std::move(user),
         s = std::move(session)]() mutable {
 
-    try
-    {
-        prepares();
-
-        pqxx::work txn{*conn_};
+    storage_->fetch_friend_requests(user,
+        [s = std::move(s)](std::string error, std::vector<ExternalUser> users) {
 
-        auto friends_req_res = txn.exec(pqxx::prepped{"fetch_friend_requests"},
-                                        pqxx::params{
-                                        boost::uuids::to_string(user)});
-
-        // This transaction is read only. Commit now.
-        txn.commit();
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_friend_requests: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        return;
+    }
 
+    try
+    {
         UserList friend_requests;
-
-        // Go through the friends list if it exists.
-        if(!friends_req_res.empty())
-        {
-            boost::uuids::string_generator gen;
-
-            for (const auto & row : friends_req_res)
-            {
-                ExternalUser curr_req;
-
-                curr_req.user_id = gen(row["user_id"].c_str());
-                curr_req.username = row["username"].as<std::string>();
-
-                friend_requests.users.push_back(curr_req);
-            }
-        }
+        friend_requests.users = std::move(users);
 
         // Turn the data into a message and send it to the client.
         Message friends_req_msg;
@@ -1917,6 +1607,7 @@ void Database::do_fetch_friend_requests(boost::uuids::uuid user,
                                 LogLevel::ERROR);
     }
     });
+    });
 }
 
 void Database::do_fetch_new_matches(boost::uuids::uuid user,
@@ -1929,47 +1620,48 @@ uuid_strands_.post(user,
         mode,
         s = std::move(session)]() mutable {
 
-    try
-    {
-        prepares();
+    uint64_t cache_version = history_cache_.begin_fill(user, mode);
 
-        pqxx::work txn{*conn_};
-
-        auto matches_res = txn.exec(pqxx::prepped{"fetch_latest_matches"},
-                                        pqxx::params{
-                                        boost::uuids::to_string(user),
-                                        static_cast<int16_t>(mode),
-                                        LATEST_MATCHES_COUNT
-                                        });
+    // Fetch enough to also answer the first history page from the cache.
+    storage_->fetch_latest_matches(user,
+                                   mode,
+                                   MatchHistoryCursor{},
+                                   HISTORY_CACHE_DEPTH,
+        [this,
+         user,
+         mode,
+         cache_version,
+         s = std::move(s)](std::string error, std::vector<MatchResultRow> rows) {
 
-        // This transaction is read only. Commit now.
-        txn.commit();
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_new_matches: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        return;
+    }
 
+    try
+    {
         // Inform client that nothing exists.
-        if (matches_res.empty())
+        if (rows.empty())
         {
             Message match_history_message;
             match_history_message.create_serialized(HeaderType::NoNewMatches);
             s->deliver(match_history_message);
         }
 
-        // Iterate through the rows and extract results.
-        MatchResultList results;
-        results.mode = mode;
+        history_cache_.fill(user, mode, rows, cache_version);
 
-        for (const auto & row : matches_res)
+        if (rows.size() > static_cast<size_t>(LATEST_MATCHES_COUNT))
         {
-            MatchResultRow result;
-            result.match_id = row["match_id"].as<std::int64_t>();
-            result.placement = row["placement"].as<std::uint16_t>();
-            result.elo_change = row["elo_change"].as<std::int32_t>();
-
-            auto finished_at = row["finished_at"].as<std::time_t>();
-            result.finished_at = std::chrono::system_clock::from_time_t(finished_at);
-
-            results.match_results.push_back(std::move(result));
+            rows.resize(LATEST_MATCHES_COUNT);
         }
 
+        MatchResultList results;
+        results.mode = mode;
+        results.match_results = std::move(rows);
+
         Message match_history_message;
         match_history_message.create_serialized(results);
         s->deliver(match_history_message);
@@ -1983,67 +1675,140 @@ uuid_strands_.post(user,
                                 LogLevel::ERROR);
     }
     });
+    });
 }
 
-void Database::do_fetch_replay(ReplayRequest req,
-                               std::shared_ptr<Session> session)
+void Database::do_fetch_match_page(boost::uuids::uuid user,
+                                   MatchHistoryPageRequest req,
+                                   std::shared_ptr<Session> session)
 {
-    asio::post(thread_pool_,
+uuid_strands_.post(user,
         [this,
+        user = std::move(user),
         req,
-        s = std::move(session)](){
+        s = std::move(session)]() mutable {
+
+    // A first page also fills the history cache, so fetch at least as
+    // much as it holds.
+    std::optional<uint64_t> cache_version;
+    int limit = req.page_size + 1;
+
+    if (req.after.empty())
+    {
+        cache_version = history_cache_.begin_fill(user, req.mode);
+        limit = std::max<int>(limit, HISTORY_CACHE_DEPTH);
+    }
+
+    // One extra row tells us if there is another page.
+    storage_->fetch_latest_matches(user,
+                                   req.mode,
+                                   req.after,
+                                   limit,
+        [this,
+         user,
+         req,
+         cache_version,
+         s = std::move(s)](std::string error, std::vector<MatchResultRow> rows) {
+
+    // Failures still answer, with an empty last page, so the client is
+    // not left waiting on its request.
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_match_page: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        rows.clear();
+    }
 
     try
     {
-        prepares();
+        if (error.empty() && cache_version)
+        {
+            history_cache_.fill(user, req.mode, rows, *cache_version);
+        }
 
-        pqxx::work txn{*conn_};
+        Message page_message;
+        page_message.create_serialized(make_history_page(req.mode,
+                                                         std::move(rows),
+                                                         req.page_size));
+        s->deliver(page_message);
+    }
+    catch (const std::exception & e)
+    {
+        std::string lmsg = "Exception in do_fetch_match_page: "
+                            + std::string(e.what());
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+
+        Message page_message;
+        page_message.create_serialized(make_history_page(req.mode,
+                                                         {},
+                                                         req.page_size));
+        s->deliver(page_message);
+    }
+    });
+    });
+}
+
+void Database::do_fetch_replay(ReplayRequest req)
+{
+    // Backends may answer inline, keep that off the caller's thread.
+    asio::post(db_pool_, [this, req]{
 
-        auto replay_res = txn.exec(pqxx::prepped{"fetch_replay"},
-                                    pqxx::params{
-                                    static_cast<int64_t>(req.match_id)
-                                    });
+    storage_->fetch_replay(req.match_id,
+        db_pool_.get_executor(),
+        [this, req](std::string error, std::optional<StoredReplay> replay) {
 
-        auto players_res = txn.exec(pqxx::prepped{"fetch_match_users"},
-                                    pqxx::params{
-                                    static_cast<int64_t>(req.match_id)
-                                    });
+    if (!error.empty())
+    {
+        std::string lmsg = "Error in do_fetch_replay: " + error;
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
 
-        // This transaction is read only. Commit now.
-        txn.commit();
+        // Release anyone waiting on this load.
+        replay_cache_.complete(req.match_id, nullptr, false);
+        return;
+    }
 
+    try
+    {
         // Handle the match ID being bad, shouldn't happen with correct
         // clients.
-        if (replay_res.empty() || players_res.empty())
+        if (!replay)
         {
             Message empty_replay;
             empty_replay.create_serialized(HeaderType::NoReplay);
-            s->deliver(empty_replay);
+
+            // Not kept, a write-behind match may just not be stored yet.
+            replay_cache_.complete(req.match_id,
+                                   std::make_shared<const Message>(std::move(empty_replay)),
+                                   false);
             return;
         }
 
-        // Otherwise, take our json bytes and deserialize into a list of commands.
-        std::string moves_json = replay_res[0]["move_history"].as<std::string>();
+        // Otherwise, decode our stored bytes into a list of commands.
         std::vector<CommandHead> moves{};
 
-        auto ec = glz::read_json(moves, moves_json);
-
-        if (ec) {
-            std::string lmsg = "Failed to parse moves. Input: " + moves_json;
+        if (!decode_replay(replay->moves, moves)) {
+            std::string lmsg = "Failed to decode moves for match "
+                               + std::to_string(req.match_id);
             Console::instance().log(std::move(lmsg),
                                     LogLevel::ERROR);
+
+            replay_cache_.complete(req.match_id, nullptr, false);
             return;
         }
 
-        std::string settings_json = replay_res[0]["settings"].as<std::string>();
         MatchResult result_settings;
 
-        auto settings_ec = glz::read_json(result_settings, settings_json);
+        auto settings_ec = glz::read_json(result_settings, replay->settings_json);
 
         if (settings_ec) {
-            std::string lmsg = "Failed to parse settings. Input: " + settings_json;
+            std::string lmsg = "Failed to parse settings. Input: " + replay->settings_json;
             Console::instance().log(std::move(lmsg),
                                     LogLevel::ERROR);
+
+            replay_cache_.complete(req.match_id, nullptr, false);
             return;
         }
 
@@ -2059,22 +1824,21 @@ void Database::do_fetch_replay(ReplayRequest req,
         if (match_replay.settings.num_players <= 0
             || match_replay.settings.num_players > 8)
         {
-            std::string lmsg = "Settings had bad num_players. Input: " + settings_json;
+            std::string lmsg = "Settings had bad num_players. Input: "
+                               + replay->settings_json;
             Console::instance().log(std::move(lmsg),
                                     LogLevel::ERROR);
+
+            replay_cache_.complete(req.match_id, nullptr, false);
             return;
         }
 
         std::vector<ExternalUser> player_list;
         player_list.resize(match_replay.settings.num_players);
 
-        boost::uuids::string_generator gen;
-
-        for (const auto & row : players_res)
+        for (auto & [p_id, user] : replay->players)
         {
-            uint8_t p_id = static_cast<uint8_t>(row["player_id"].as<int>());
-
-            if (p_id > player_list.size() || p_id < 0)
+            if (p_id >= player_list.size())
             {
                 std::string lmsg = "Players had bad player_id: "
                                    + std::to_string(p_id);
@@ -2083,19 +1847,17 @@ void Database::do_fetch_replay(ReplayRequest req,
                 continue;
             }
 
-            ExternalUser user;
-
-            user.user_id = gen(row["user_id"].as<std::string>());
-            user.username = row["username"].as<std::string>();
-
-            player_list[p_id] = user;
+            player_list[p_id] = std::move(user);
         }
 
         match_replay.players.users = player_list;
 
         Message match_replay_message;
         match_replay_message.create_serialized(match_replay);
-        s->deliver(match_replay_message);
+
+        replay_cache_.complete(req.match_id,
+                               std::make_shared<const Message>(std::move(match_replay_message)),
+                               true);
 
     }
     catch (const std::exception & e)
@@ -2104,232 +1866,97 @@ void Database::do_fetch_replay(ReplayRequest req,
                             + std::string(e.what());
         Console::instance().log(std::move(lmsg),
                                 LogLevel::ERROR);
+
+        // Release anyone waiting on this load.
+        replay_cache_.complete(req.match_id, nullptr, false);
     }
+    });
+    });
+}
+
+void Database::do_migrate_replays(ReplayMigration progress)
+{
+    asio::post(db_pool_, [this, progress]() mutable {
+        try
+        {
+            bool stopped = shutting_down_.load(std::memory_order_acquire);
+
+            if (!stopped
+                && storage_->migrate_replays(progress, REPLAY_MIGRATION_BATCH))
+            {
+                do_migrate_replays(progress);
+                return;
+            }
 
+            std::string lmsg = std::string(stopped ? "Replay migration stopped: "
+                                                   : "Replay migration finished: ")
+                               + std::to_string(progress.converted)
+                               + " converted, "
+                               + std::to_string(progress.failed)
+                               + " left as JSON.";
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::CONSOLE);
+        }
+        catch (const std::exception & e)
+        {
+            std::string lmsg = "Exception in do_migrate_replays: "
+                                + std::string(e.what());
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::ERROR);
+        }
+
+        migrating_replays_.store(false, std::memory_order_release);
     });
 }
 
-void Database::prepares()
+void Database::schedule_maintenance()
 {
-    if (!conn_)
-    {
-        conn_ = std::make_unique<pqxx::connection>(
-            "host=127.0.0.1 "
-            "port=5432 "
-            "dbname=silenttanksdb "
-            "user=silenttanksoperator"
-            );
-        conn_->prepare("auth",
-            "SELECT user_id, hash, salt "
-            "FROM Users "
-            "WHERE LOWER(username) = LOWER($1)"
-            );
-        conn_->prepare("reg",
-            "INSERT INTO Users (user_id, username, hash, salt, last_ip) "
-            "VALUES ($1, $2, $3, $4, $5)"
-            );
-        conn_->prepare("insert_matches",
-            "INSERT INTO Matches(game_mode, settings, move_history) "
-            "VALUES ($1, $2::jsonb, $3::jsonb) "
-            "RETURNING match_id"
-            );
-        conn_->prepare("insert_player",
-            "INSERT INTO MatchPlayers(match_id, user_id, "
-            "player_id, placement) VALUES ($1, $2, $3, $4)"
-            );
-        conn_->prepare("get_elos",
-            "SELECT user_id, current_elo "
-            "FROM UserElos "
-            "WHERE user_id = ANY($1::uuid[]) AND game_mode = $2 "
-            );
-        conn_->prepare("get_mode_elos",
-            "SELECT user_id, current_elo, game_mode "
-            "FROM UserElos "
-            "WHERE user_id = $1"
-            );
-        conn_->prepare("update_elo",
-            "INSERT INTO UserElos (user_id, game_mode, current_elo) "
-            "VALUES ($1, $2, $3) "
-            "ON CONFLICT (user_id, game_mode) "
-            "DO UPDATE SET current_elo = EXCLUDED.current_elo"
-            );
-        conn_->prepare("record_elo_history",
-            "INSERT INTO EloHistory (user_id, match_id, game_mode, "
-                                    "old_elo, new_elo) "
-            "VALUES ($1, $2, $3, $4, $5)"
-            );
-        conn_->prepare("ban_ip",
-            "INSERT INTO BannedIPs (ip, banned_until, original_expiration) "
-            "VALUES ($1, $2, $2) "
-            "ON CONFLICT (ip) DO UPDATE "
-            "  SET banned_until = EXCLUDED.banned_until, "
-            "  original_expiration = EXCLUDED.original_expiration"
-            );
-        conn_->prepare("unban_ip",
-            "UPDATE BannedIPs "
-            "SET banned_until = now() "
-            "WHERE ip = $1"
-            );
-        conn_->prepare("update_user_logins",
-            "UPDATE Users "
-            "SET last_login = now(), "
-            "last_ip = $1 "
-            "WHERE user_id = $2"
-            );
-        conn_->prepare("check_bans",
-            "SELECT banned_at, (extract(epoch FROM banned_until)*1000)::bigint AS banned_ms, reason "
-            "FROM UserBans "
-            "WHERE user_id = $1 "
-            " AND banned_until > now() "
-            "ORDER BY banned_at DESC "
-            "LIMIT 1"
-            );
-        conn_->prepare("add_user_elos",
-            "INSERT INTO UserElos (user_id, game_mode, current_elo) "
-            "VALUES ($1, $2, $3) "
-            "ON CONFLICT DO NOTHING"
-            );
-        conn_->prepare("find_uuid",
-            "SELECT user_id "
-            "FROM Users "
-            "WHERE LOWER(username) = LOWER($1)"
-            );
-        conn_->prepare("find_username",
-            "SELECT username "
-            "FROM Users "
-            "WHERE user_id = $1"
-            );
-        conn_->prepare("ban_user",
-            "INSERT INTO UserBans (user_id, banned_until, original_expiration, reason) "
-            "VALUES ($1, $2, $2, $3)"
-            );
-        conn_->prepare("unban_user",
-            "UPDATE UserBans "
-            "SET banned_until = now() "
-            "WHERE ban_id = $1"
-            );
-        conn_->prepare("friend_request",
-            "WITH pending AS ( "
-            "SELECT COUNT(*) AS cnt "
-            "FROM FriendRequests "
-            "WHERE sender = $1 "
-            ") "
-            "INSERT INTO FriendRequests (sender, receiver) "
-            "SELECT $1, $2 "
-            "FROM pending "
-            "WHERE cnt < $3 "
-            "ON CONFLICT DO NOTHING"
-            );
-        conn_->prepare("delete_friend_request",
-            "DELETE FROM FriendRequests "
-            "WHERE sender = $1 "
-            " AND receiver = $2"
-            );
-        conn_->prepare("accept_friend",
-            "INSERT INTO Friends (user_a, user_b) "
-            "VALUES (LEAST($1::uuid, $2::uuid), GREATEST($1::uuid, $2::uuid)) "
-            "ON CONFLICT DO NOTHING"
-            );
-        conn_->prepare("find_friend_request",
-            "SELECT 1 "
-            "FROM FriendRequests "
-            "WHERE receiver = $1 AND sender = $2 "
-            "LIMIT 1"
-            );
-        conn_->prepare("block_user",
-            "INSERT INTO BlockedUsers (blocker, blocked) "
-            "VALUES ($1, $2) "
-            "ON CONFLICT DO NOTHING"
-            );
-        conn_->prepare("check_blocked",
-            "SELECT 1 "
-            "FROM BlockedUsers "
-            "WHERE blocker = $1::uuid AND blocked = $2::uuid "
-            "LIMIT 1"
-            );
-        conn_->prepare("check_friends",
-            "SELECT 1 "
-            "FROM Friends "
-            "WHERE user_a = LEAST($1::uuid, $2::uuid) "
-            "AND user_b = GREATEST($1::uuid, $2::uuid) "
-            "LIMIT 1"
-            );
-        conn_->prepare("remove_friend",
-            "DELETE FROM Friends "
-            "WHERE (user_a = LEAST($1::uuid, $2::uuid) "
-            "AND user_b = GREATEST($1::uuid, $2::uuid))"
-            );
-        conn_->prepare("unblock_user",
-            "DELETE FROM BlockedUsers "
-            "WHERE blocker = $1::uuid AND blocked = $2::uuid"
-            );
-        conn_->prepare("fetch_blocks",
-            "SELECT b.blocked AS user_id, u.username AS username "
-            "FROM BlockedUsers b JOIN Users u ON u.user_id = b.blocked "
-            "WHERE b.blocker = $1"
-            );
-        conn_->prepare("fetch_friends",
-            "SELECT (CASE "
-            "WHEN f.user_a = $1 THEN f.user_b "
-            "ELSE f.user_a "
-            "END) AS friend_id, u.username AS username "
-            "FROM Friends f "
-            "JOIN Users u "
-            "ON u.user_id = (CASE WHEN f.user_a = $1 THEN f.user_b "
-            "ELSE f.user_a END) "
-            "WHERE user_a = $1 OR user_b = $1"
-            );
-        conn_->prepare("fetch_friend_requests",
-            "SELECT fr.sender AS user_id, u.username AS username "
-            "FROM FriendRequests fr JOIN Users u ON u.user_id = fr.sender "
-            "WHERE receiver = $1"
-            );
-        conn_->prepare("INTERNAL_fetch_friends",
-            "SELECT (CASE "
-            "WHEN f.user_a = $1 THEN f.user_b "
-            "ELSE f.user_a "
-            "END) AS friend_id "
-            "FROM Friends f "
-            "WHERE f.user_a = $1 OR f.user_b = $1"
-            );
-        conn_->prepare("INTERNAL_fetch_blocks",
-            "SELECT b.blocked as blocked "
-            "FROM BlockedUsers b "
-            "WHERE b.blocker = $1"
-            );
-        conn_->prepare("fetch_latest_matches",
-            "SELECT m.match_id, "
-            "FLOOR(EXTRACT(epoch from m.finished_at))::bigint as finished_at, "
-            "mp.placement, "
-            "COALESCE(eh.elo_change, 0) AS elo_change "
-            "FROM matches m JOIN MatchPlayers mp ON mp.match_id = m.match_id "
-            "LEFT JOIN LATERAL ( "
-            "SELECT (new_elo - old_elo) AS elo_change "
-            "FROM EloHistory eh "
-            "WHERE eh.match_id = m.match_id "
-            "AND eh.user_id = mp.user_id "
-            "AND eh.game_mode = m.game_mode "
-            "ORDER BY history_id DESC "
-            "LIMIT 1 "
-            ") eh ON true "
-            "WHERE mp.user_id = $1::uuid "
-            "AND m.game_mode = $2::int "
-            "ORDER BY m.finished_at DESC "
-            "LIMIT $3"
-            );
-        conn_->prepare("fetch_replay",
-            "SELECT move_history, settings "
-            "FROM Matches "
-            "WHERE match_id = $1"
-            );
-        conn_->prepare("fetch_match_users",
-            "SELECT u.user_id, u.username, mp.player_id "
-            "FROM MatchPlayers mp "
-            "JOIN Users u ON u.user_id = mp.user_id "
-            "WHERE mp.match_id = $1 "
-            "ORDER BY mp.player_id"
-            );
-    }
+    asio::post(strand_, [this]{
+        if (shutting_down_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        maintenance_timer_.expires_after(STORAGE_MAINTENANCE_INTERVAL);
+        maintenance_timer_.async_wait([this](const boost::system::error_code & ec){
+            if (ec || shutting_down_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+
+            do_maintenance();
+        });
+    });
+}
+
+void Database::do_maintenance()
+{
+    asio::post(db_pool_, [this]{
+        bool more = false;
+
+        try
+        {
+            more = !shutting_down_.load(std::memory_order_acquire)
+                   && storage_->maintain();
+        }
+        catch (const std::exception & e)
+        {
+            std::string lmsg = "Exception in do_maintenance: "
+                                + std::string(e.what());
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::ERROR);
+        }
+
+        // Go round the pool again so other work gets a turn in between.
+        if (more)
+        {
+            do_maintenance();
+        }
+        else
+        {
+            schedule_maintenance();
+        }
+    });
 }
 
 void Database::try_finish_shutdown()
@@ -2352,6 +1979,11 @@ void Database::try_finish_shutdown()
         return;
     }
 
+    if (recorder_ && !recorder_drained_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
     if (shutdown_callback_)
     {
         auto cb = std::move(shutdown_callback_);
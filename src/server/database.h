@@ -20,11 +20,16 @@
 #include "user.h"
 #include "match-result.h"
 #include "keyed-executor.h"
+#include "hash-pool.h"
+#include "match-recorder.h"
+#include "match-history-cache.h"
+#include "leaderboard.h"
+#include "replay-cache.h"
+#include "storage.h"
 
 #include <array>
 #include <cstdint>
 #include <chrono>
-#include <pqxx/pqxx>
 #include <boost/asio.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/string_generator.hpp>
@@ -37,16 +42,20 @@
 
 class UserManager;
 
-// Limit how much memory we are consuming for logins.
-constexpr size_t MAX_CONCURRENT_AUTHS = 3;
+// Threads for blocking storage calls, keep within what postgres can serve.
+constexpr size_t DB_POOL_THREADS = 4;
 
 // Maximum number of requests to hold at one time, to prevent spam.
 constexpr int MAX_FRIEND_REQUESTS = 50;
 
+// Legacy move lists re-encoded per transaction by migrate_replays.
+constexpr size_t REPLAY_MIGRATION_BATCH = 500;
+
+// How often the storage creates partitions and archives old replays.
+constexpr std::chrono::minutes STORAGE_MAINTENANCE_INTERVAL{10};
+
 namespace asio = boost::asio;
 
-// TODO <optimization>: pipeline everything that can be pipelined.
-// This is especially true for the match write function.
 class Database
 {
 public:
@@ -69,7 +78,10 @@ public:
              AuthCallback auth_callback,
              BanCallback ban_callback,
              ShutdownCallback shutdown_callback,
-             std::shared_ptr<UserManager> user_manager);
+             std::shared_ptr<UserManager> user_manager,
+             std::string storage_spec = "postgres",
+             std::string write_behind_dir = "",
+             std::string archive_dir = "");
 
     void authenticate(Message msg,
                       std::shared_ptr<Session> session,
@@ -125,19 +137,49 @@ public:
                            GameMode mode,
                            std::shared_ptr<Session> session);
 
+    // A first page is answered from the history cache when it holds
+    // enough rows, later pages always come from storage.
+    void fetch_match_page(boost::uuids::uuid user,
+                          MatchHistoryPageRequest req,
+                          std::shared_ptr<Session> session);
+
     void fetch_replay(ReplayRequest req,
                       std::shared_ptr<Session> session);
 
+    // Answered from the in memory leaderboard, without a query.
+    void fetch_leaderboard(boost::uuids::uuid user,
+                           LeaderboardRequest req,
+                           std::shared_ptr<Session> session);
+
     std::unordered_map<std::string, std::chrono::system_clock::time_point>
     load_bans();
 
+    // Blocks until every rating is loaded, returns how many there were.
+    size_t load_leaderboard();
+
     void async_shutdown();
 
+    // Re-encodes legacy JSON move lists in the background, one batch
+    // per pool task so other queries are not held up.
+    void migrate_replays();
+
+    HashPoolStats hash_stats() const;
+
+    ReplayCacheStats replay_stats() const;
+
 private:
     void do_auth(LoginRequest request,
                  std::shared_ptr<Session> session,
                  std::string client_ip);
 
+    // Runs on the user's strand once their password has been hashed.
+    void finish_auth(std::string username,
+                     boost::uuids::uuid user_id,
+                     int hash_result,
+                     bool hash_matched,
+                     std::shared_ptr<Session> s,
+                     std::string ip);
+
     void do_register(LoginRequest request,
                      std::shared_ptr<Session> session,
                      std::string client_ip);
@@ -145,7 +187,7 @@ private:
     void do_record(std::vector<boost::uuids::uuid> user_ids,
                    std::vector<uint8_t> elimination_order,
                    std::string settings_json,
-                   std::string moves_json,
+                   std::string moves,
                    GameMode mode);
 
     void do_ban_ip(std::string ip,
@@ -193,10 +235,21 @@ private:
                               GameMode mode,
                               std::shared_ptr<Session> session);
 
-    void do_fetch_replay(ReplayRequest req,
-                         std::shared_ptr<Session> session);
+    void do_fetch_match_page(boost::uuids::uuid user,
+                             MatchHistoryPageRequest req,
+                             std::shared_ptr<Session> session);
+
+    // Loads for the replay cache, which answers the waiting sessions.
+    void do_fetch_replay(ReplayRequest req);
+
+    void do_migrate_replays(ReplayMigration progress);
 
-    void prepares();
+    // Waits out STORAGE_MAINTENANCE_INTERVAL on the strand, then runs
+    // do_maintenance.
+    void schedule_maintenance();
+
+    // Calls Storage::maintain on the pool until it has nothing left.
+    void do_maintenance();
 
     void try_finish_shutdown();
 
@@ -204,9 +257,28 @@ private:
     // Main strand to serialize requests.
     asio::strand<asio::io_context::executor_type> strand_;
 
-    // Small number of threads for this pool to stop our main
-    // threads from blocking.
-    asio::thread_pool thread_pool_;
+    // Runs on strand_, cancelled on shutdown.
+    asio::steady_timer maintenance_timer_;
+
+    // Written through as matches commit, so it must outlive the pools.
+    MatchHistoryCache history_cache_;
+
+    // Ranks in every ranked mode, updated as elo changes commit.
+    Leaderboard leaderboard_;
+
+    // Serialized replays, shared by everyone who asks for the same match.
+    ReplayCache replay_cache_;
+
+    // Users, relations, matches and elos. Pool work uses it, so it is
+    // destroyed after the pool has joined.
+    std::unique_ptr<Storage> storage_;
+
+    // Small number of threads for blocking queries, each with
+    // its own connection, to stop our main threads from blocking.
+    asio::thread_pool db_pool_;
+
+    // Password hashing, kept off of the database threads.
+    HashPool hash_pool_;
 
     // Callbacks
     AuthCallback auth_callback_;
@@ -215,11 +287,16 @@ private:
 
     std::shared_ptr<UserManager> user_manager_;
 
+    // Batches match writes when the server runs with write-behind.
+    std::shared_ptr<MatchRecorder> recorder_;
+    std::atomic<bool> recorder_drained_{false};
+
     // Thread safe map of mutex's for user keys.
     KeyedExecutor<boost::uuids::uuid,
                   boost::hash<boost::uuids::uuid>>
                   uuid_strands_;
 
     std::atomic<bool> shutting_down_{false};
+    std::atomic<bool> migrating_replays_{false};
     std::atomic<size_t> pending_writes_{0};
 };
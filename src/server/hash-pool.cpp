@@ -0,0 +1,65 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "hash-pool.h"
+
+#include <algorithm>
+#include <thread>
+
+static size_t hash_thread_count()
+{
+    // hardware_concurrency may return 0 if it is unknown.
+    size_t cores = std::thread::hardware_concurrency();
+
+    return std::clamp<size_t>(cores, 1, MAX_HASH_THREADS);
+}
+
+std::string HashPoolStats::to_string() const
+{
+    return "Hash pool: "
+           + std::to_string(threads) + " threads, "
+           + std::to_string(pending) + " pending (peak "
+           + std::to_string(peak_pending) + "), "
+           + std::to_string(completed) + " completed, "
+           + std::to_string(rejected) + " rejected, "
+           + std::to_string(average_wait.count()) + "us average wait";
+}
+
+HashPool::HashPool()
+:threads_(hash_thread_count()),
+pool_(threads_)
+{
+}
+
+HashPoolStats HashPool::stats() const
+{
+    HashPoolStats stats;
+
+    stats.threads = threads_;
+    stats.pending = pending_.load(std::memory_order_relaxed);
+    stats.peak_pending = peak_pending_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+
+    uint64_t total_wait = total_wait_us_.load(std::memory_order_relaxed);
+
+    stats.average_wait = std::chrono::microseconds
+                         (
+                             stats.completed ? total_wait / stats.completed : 0
+                         );
+
+    return stats;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include <boost/asio.hpp>
+
+#include "console.h"
+
+namespace asio = boost::asio;
+
+// Each hash holds ARGON2_MEMORY KiB, so this also bounds hashing memory.
+constexpr size_t MAX_HASH_THREADS = 8;
+
+// Hashes allowed to wait for a thread before new ones are turned away.
+constexpr size_t MAX_PENDING_HASHES = 64;
+
+struct HashPoolStats
+{
+    size_t threads;
+    size_t pending;
+    size_t peak_pending;
+    uint64_t completed;
+    uint64_t rejected;
+
+    // Average time between submission and a thread picking the hash up.
+    std::chrono::microseconds average_wait;
+
+    std::string to_string() const;
+};
+
+// Thread pool for CPU bound password hashing.
+//
+// Kept apart from the database pool, so that a burst of logins queues up
+// here instead of in front of match recording and other queries, and a
+// slow query never holds up hashing. Submissions past MAX_PENDING_HASHES
+// are refused so the caller can fail fast instead of queueing forever.
+class HashPool
+{
+    using steady_clock = std::chrono::steady_clock;
+
+public:
+    // Sized to the number of cores, up to MAX_HASH_THREADS.
+    HashPool();
+
+    // Returns false, without running f, if the pool is saturated.
+    template <typename Func>
+    bool try_post(Func && f);
+
+    HashPoolStats stats() const;
+
+private:
+    const size_t threads_;
+    asio::thread_pool pool_;
+
+    // Queued and running hashes.
+    std::atomic<size_t> pending_{0};
+
+    std::atomic<size_t> peak_pending_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> total_wait_us_{0};
+};
+
+template <typename Func>
+bool HashPool::try_post(Func && f)
+{
+    size_t pending = pending_.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    if (pending > threads_ + MAX_PENDING_HASHES)
+    {
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t peak = peak_pending_.load(std::memory_order_relaxed);
+    while (pending > peak
+           && !peak_pending_.compare_exchange_weak(peak,
+                                                   pending,
+                                                   std::memory_order_relaxed))
+    {
+    }
+
+    asio::post(pool_,
+        [this,
+         submitted = steady_clock::now(),
+         func = std::forward<Func>(f)]() mutable {
+
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>
+                        (
+                            steady_clock::now() - submitted
+                        );
+
+        total_wait_us_.fetch_add(waited.count(), std::memory_order_relaxed);
+
+        // A throwing hash must still give back its slot, or the pool
+        // fills up and refuses every later login.
+        try
+        {
+            func();
+        }
+        catch (const std::exception & e)
+        {
+            std::string lmsg = "Exception in hash pool task: "
+                               + std::string(e.what());
+            Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+        }
+        catch (...)
+        {
+            std::string lmsg = "Hash pool task threw nonstandard exception";
+            Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+        }
+
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+    });
+
+    return true;
+}
@@ -0,0 +1,237 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "leaderboard.h"
+#include "elo-updates.h"
+
+#include <algorithm>
+#include <mutex>
+
+static bool ranked(GameMode mode)
+{
+    return static_cast<uint8_t>(mode) >= RANKED_MODES_START
+           && mode < GameMode::NO_MODE;
+}
+
+void Leaderboard::set(const boost::uuids::uuid & user_id,
+                      const std::string & username,
+                      GameMode mode,
+                      int elo)
+{
+    if (!ranked(mode))
+    {
+        return;
+    }
+
+    std::unique_lock lock(mutex_);
+
+    place(intern(user_id, username), mode, elo);
+}
+
+void Leaderboard::add_user(const boost::uuids::uuid & user_id,
+                           const std::string & username)
+{
+    std::unique_lock lock(mutex_);
+
+    uint32_t player = intern(user_id, username);
+
+    for (uint8_t m = RANKED_MODES_START; m < NUMBER_OF_MODES; m++)
+    {
+        place(player, static_cast<GameMode>(m), DEFAULT_ELO);
+    }
+}
+
+void Leaderboard::update(const boost::uuids::uuid & user_id, GameMode mode, int elo)
+{
+    if (!ranked(mode))
+    {
+        return;
+    }
+
+    std::unique_lock lock(mutex_);
+
+    // Users are loaded or added before they can play, so this only
+    // misses if they registered while the table was loading.
+    auto itr = index_.find(user_id);
+
+    uint32_t player = (itr != index_.end()) ? itr->second : intern(user_id, "");
+
+    place(player, mode, elo);
+}
+
+size_t Leaderboard::players(GameMode mode) const
+{
+    if (!ranked(mode))
+    {
+        return 0;
+    }
+
+    std::shared_lock lock(mutex_);
+
+    return trees_[elo_ranked_index(mode)].size();
+}
+
+std::optional<uint32_t> Leaderboard::rank(const boost::uuids::uuid & user_id,
+                                          GameMode mode) const
+{
+    if (!ranked(mode))
+    {
+        return std::nullopt;
+    }
+
+    std::shared_lock lock(mutex_);
+
+    auto itr = index_.find(user_id);
+
+    if (itr == index_.end())
+    {
+        return std::nullopt;
+    }
+
+    uint8_t idx = elo_ranked_index(mode);
+    const std::optional<int> & elo = players_[itr->second].elos[idx];
+
+    if (!elo)
+    {
+        return std::nullopt;
+    }
+
+    // Everyone strictly above, the lowest index sorts first among equals.
+    return trees_[idx].order_of_key(RankKey{*elo, 0}) + 1;
+}
+
+LeaderboardPage Leaderboard::query(const boost::uuids::uuid & user_id,
+                                   const LeaderboardRequest & req) const
+{
+    LeaderboardPage page{};
+    page.mode = req.mode;
+
+    if (!ranked(req.mode))
+    {
+        return page;
+    }
+
+    size_t count = std::min<size_t>(req.count, MAX_LEADERBOARD_ENTRIES);
+    uint8_t idx = elo_ranked_index(req.mode);
+
+    std::shared_lock lock(mutex_);
+
+    const RankTree & tree = trees_[idx];
+    page.players = static_cast<uint32_t>(tree.size());
+
+    std::optional<size_t> position;
+
+    if (auto itr = index_.find(user_id); itr != index_.end())
+    {
+        if (const std::optional<int> & elo = players_[itr->second].elos[idx])
+        {
+            position = tree.order_of_key(RankKey{*elo, itr->second});
+            page.my_rank = static_cast<uint32_t>(
+                               tree.order_of_key(RankKey{*elo, 0}) + 1);
+        }
+    }
+
+    if (req.kind == LeaderboardRequest::Kind::Top)
+    {
+        page.entries = entries(tree, 0, count);
+    }
+    else if (position && count > 0)
+    {
+        // Centre on the user, shifted inwards at either end of the table.
+        size_t first = *position - std::min(*position, (count - 1) / 2);
+        first = std::min(first, tree.size() - std::min(tree.size(), count));
+
+        page.entries = entries(tree, first, count);
+    }
+
+    return page;
+}
+
+uint32_t Leaderboard::intern(const boost::uuids::uuid & user_id,
+                             const std::string & username)
+{
+    auto [itr, inserted] = index_.try_emplace(user_id,
+                                              static_cast<uint32_t>(players_.size()));
+
+    if (inserted)
+    {
+        players_.push_back(Player{user_id, username, {}});
+    }
+    else if (!username.empty())
+    {
+        players_[itr->second].username = username;
+    }
+
+    return itr->second;
+}
+
+void Leaderboard::place(uint32_t player, GameMode mode, int elo)
+{
+    uint8_t idx = elo_ranked_index(mode);
+    std::optional<int> & current = players_[player].elos[idx];
+
+    if (current)
+    {
+        if (*current == elo)
+        {
+            return;
+        }
+
+        trees_[idx].erase(RankKey{*current, player});
+    }
+
+    trees_[idx].insert(RankKey{elo, player});
+    current = elo;
+}
+
+std::vector<LeaderboardEntry> Leaderboard::entries(const RankTree & tree,
+                                                   size_t first,
+                                                   size_t count) const
+{
+    std::vector<LeaderboardEntry> result;
+
+    if (first >= tree.size())
+    {
+        return result;
+    }
+
+    result.reserve(std::min(count, tree.size() - first));
+
+    size_t position = first;
+    uint32_t rank = 0;
+
+    for (auto itr = tree.find_by_order(first);
+         itr != tree.end() && result.size() < count;
+         ++itr, ++position)
+    {
+        // Only the first entry needs a lookup, after that a rank is
+        // either shared with the entry above or is the position.
+        if (result.empty())
+        {
+            rank = static_cast<uint32_t>(tree.order_of_key(RankKey{itr->elo, 0}) + 1);
+        }
+        else if (itr->elo != result.back().elo)
+        {
+            rank = static_cast<uint32_t>(position + 1);
+        }
+
+        result.push_back(LeaderboardEntry{rank,
+                                          itr->elo,
+                                          players_[itr->player].username});
+    }
+
+    return result;
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/functional/hash.hpp>
+
+#include "gamemodes.h"
+#include "leaderboard-structs.h"
+
+// Every rated player in every ranked mode, kept in rank order.
+//
+// Each mode is an order statistic tree, a red black tree where every
+// node also knows the size of its subtree. That gives a player's rank,
+// and the player at any rank, in O(log n), so the top of the table, a
+// player's own rank and the players around them never touch storage.
+//
+// Loaded once on startup and then kept current by whatever applies elo
+// changes, after they commit. Thread safe, queries share a lock.
+class Leaderboard
+{
+public:
+    // Sets a rating while loading, the username is kept for display.
+    void set(const boost::uuids::uuid & user_id,
+             const std::string & username,
+             GameMode mode,
+             int elo);
+
+    // A new account, rated DEFAULT_ELO in every ranked mode.
+    void add_user(const boost::uuids::uuid & user_id,
+                  const std::string & username);
+
+    // A rating changed by a match.
+    void update(const boost::uuids::uuid & user_id, GameMode mode, int elo);
+
+    // Rated players in the mode.
+    size_t players(GameMode mode) const;
+
+    // Ranks start at one, players with the same elo share a rank.
+    // Nullopt if the user has no rating in the mode.
+    std::optional<uint32_t> rank(const boost::uuids::uuid & user_id,
+                                 GameMode mode) const;
+
+    // Answers a request from user_id, at most MAX_LEADERBOARD_ENTRIES.
+    // Around me is empty if user_id has no rating in the mode.
+    LeaderboardPage query(const boost::uuids::uuid & user_id,
+                          const LeaderboardRequest & req) const;
+
+private:
+    struct RankKey
+    {
+        int elo;
+
+        // Index into players_, so that equal elos are distinct keys.
+        uint32_t player;
+    };
+
+    // Highest elo first, then in the order players were first seen.
+    struct RankOrder
+    {
+        bool operator()(const RankKey & a, const RankKey & b) const
+        {
+            return (a.elo != b.elo) ? a.elo > b.elo : a.player < b.player;
+        }
+    };
+
+    using RankTree = __gnu_pbds::tree<RankKey,
+                                      __gnu_pbds::null_type,
+                                      RankOrder,
+                                      __gnu_pbds::rb_tree_tag,
+                                      __gnu_pbds::tree_order_statistics_node_update>;
+
+    struct Player
+    {
+        boost::uuids::uuid user_id;
+        std::string username;
+
+        // Indexed by elo_ranked_index, empty if unrated in the mode.
+        std::array<std::optional<int>, RANKED_MODES_COUNT> elos;
+    };
+
+    // Requires a unique lock, returns the player's index.
+    uint32_t intern(const boost::uuids::uuid & user_id,
+                    const std::string & username);
+
+    // Requires a unique lock, moves or inserts the player's key.
+    void place(uint32_t player, GameMode mode, int elo);
+
+    // Requires a lock, count entries from position first onwards.
+    std::vector<LeaderboardEntry> entries(const RankTree & tree,
+                                          size_t first,
+                                          size_t count) const;
+
+private:
+    mutable std::shared_mutex mutex_;
+
+    // Players are never removed, an index stays valid for the tree keys.
+    std::vector<Player> players_;
+
+    std::unordered_map<boost::uuids::uuid,
+                       uint32_t,
+                       boost::hash<boost::uuids::uuid>> index_;
+
+    std::array<RankTree, RANKED_MODES_COUNT> trees_;
+};
@@ -0,0 +1,235 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "generic-constants.h"
+#include "console.h"
+#include "elo-updates.h"
+#include "storage.h"
+#include "rating-models.h"
+#include "rating-rebuild.h"
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+using steady_clock = std::chrono::steady_clock;
+
+static std::string elapsed(steady_clock::time_point since)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>
+                (
+                    steady_clock::now() - since
+                );
+
+    return std::to_string(ms.count()) + "ms";
+}
+
+// Compares the rebuilt elos with the stored ones, without writing.
+static void report_differences(Storage & storage, const RatingRebuild & rebuild)
+{
+    size_t compared = 0;
+    size_t changed = 0;
+    int64_t total_difference = 0;
+    int largest_difference = 0;
+
+    storage.load_ratings(
+        [&](const boost::uuids::uuid & user_id,
+            const std::string & username,
+            GameMode mode,
+            int elo)
+        {
+            int rebuilt = rebuild.elo(user_id, mode).value_or(DEFAULT_ELO);
+            int difference = std::abs(rebuilt - elo);
+
+            compared++;
+            changed += (difference != 0);
+            total_difference += difference;
+            largest_difference = std::max(largest_difference, difference);
+        });
+
+    std::string lmsg = std::to_string(changed)
+                       + " of "
+                       + std::to_string(compared)
+                       + " stored elos would change, by "
+                       + std::to_string(compared ? total_difference / static_cast<int64_t>(compared) : 0)
+                       + " on average and at most "
+                       + std::to_string(largest_difference)
+                       + ". Run with --write to store them.";
+    Console::instance().log(std::move(lmsg),
+                            LogLevel::INFO);
+}
+
+// Rebuilds every ranked elo and all elo history from the stored matches.
+// The server must be stopped while this runs.
+int main(int argc, char** argv)
+{
+    namespace asio = boost::asio;
+
+    std::string storage_spec;
+    std::string model_name;
+    size_t threads = 0;
+    bool write = false;
+
+    po::options_description desc("Allowed options");
+
+    desc.add_options()
+        ("help,h", "show help message")
+        ("storage",
+         po::value<std::string>(&storage_spec)->default_value("postgres"),
+         "Storage backend: postgres or sqlite:<path>")
+        ("model",
+         po::value<std::string>(&model_name)->default_value("elo"),
+         "Rating model: elo or glicko2, only elo can be written")
+        ("threads",
+         po::value<size_t>(&threads)->default_value(std::thread::hardware_concurrency()),
+         "Threads to rate independent groups of players on")
+        ("write",
+         po::bool_switch(&write),
+         "Replace stored elos and elo history, otherwise only report the changes");
+
+    po::variables_map vars;
+    try
+    {
+        po::store(po::parse_command_line(argc, argv, desc), vars);
+        po::notify(vars);
+    }
+
+    catch (const po::error & e)
+    {
+        std::cerr << TERM_RED
+                  << "Command line error: "
+                  << e.what()
+                  << "\n"
+                  << desc
+                  << "\n"
+                  << TERM_RESET;
+
+        return 1;
+    }
+
+    if (vars.count("help"))
+    {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    // Storage only holds an elo, and the server keeps rating with elo
+    // updates, so other models would drop state and be overwritten.
+    if (write && model_name != "elo")
+    {
+        std::cerr << TERM_RED
+                  << "Only elo ratings can be written, run "
+                  << model_name
+                  << " without --write to compare it.\n"
+                  << TERM_RESET;
+
+        return 1;
+    }
+
+    asio::io_context io_context;
+    auto work_guard = asio::make_work_guard(io_context);
+
+    // Logs are written from the io context, as in the server.
+    Console::init(io_context, LogLevel::INFO);
+    std::thread log_thread([&io_context]{ io_context.run(); });
+
+    int status = 0;
+
+    try
+    {
+        std::unique_ptr<RatingModel> model = make_rating_model(model_name);
+        std::unique_ptr<Storage> storage = make_storage(io_context, storage_spec, "");
+
+        RatingRebuild rebuild;
+
+        auto start = steady_clock::now();
+        rebuild.load(*storage);
+
+        RatingRebuildStats stats = rebuild.stats();
+
+        std::string lmsg = "Loaded "
+                           + std::to_string(stats.matches)
+                           + " ranked matches of "
+                           + std::to_string(stats.users)
+                           + " players in "
+                           + elapsed(start)
+                           + ", skipped "
+                           + std::to_string(stats.skipped)
+                           + ".";
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::INFO);
+
+        start = steady_clock::now();
+        rebuild.run(*model, threads);
+
+        stats = rebuild.stats();
+
+        lmsg = "Rated with "
+               + model->name()
+               + " in "
+               + elapsed(start)
+               + ", "
+               + std::to_string(stats.components)
+               + " independent groups, the largest has "
+               + std::to_string(stats.largest_component)
+               + " matches.";
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::INFO);
+
+        if (write)
+        {
+            start = steady_clock::now();
+
+            storage->rewrite_ratings(RatingRewrite{
+                [&rebuild](const EloVisitor & visit){ rebuild.for_each_elo(visit); },
+                [&rebuild](const EloChangeVisitor & visit){ rebuild.for_each_change(visit); }
+            });
+
+            lmsg = "Wrote elos and "
+                   + std::to_string(stats.results)
+                   + " elo history rows in "
+                   + elapsed(start)
+                   + ".";
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::INFO);
+        }
+        else
+        {
+            report_differences(*storage, rebuild);
+        }
+
+        storage->close();
+    }
+    catch (const std::exception & e)
+    {
+        std::string lmsg = "Rating rebuild failed: " + std::string(e.what());
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::ERROR);
+        status = 1;
+    }
+
+    // Let the remaining logs drain.
+    work_guard.reset();
+    log_thread.join();
+
+    return status;
+}
@@ -21,6 +21,7 @@
 #include "generic-constants.h"
 #include "server-identity.h"
 #include "server.h"
+#include "tls-ticket-keys.h"
 #include "console.h"
 #include "console-dispatch.h"
 
@@ -58,6 +59,10 @@ int main(int argc, char** argv)
     // Try to parse the command line.
     std::string address;
     int port = 0;
+    bool use_ktls = false;
+    std::string write_behind_dir;
+    std::string storage_spec;
+    std::string archive_dir;
 
     po::options_description desc("Allowed options");
 
@@ -69,7 +74,19 @@ int main(int argc, char** argv)
         ("address",
          po::value<std::string>(&address)
          ->default_value(std::string(DEFAULT_SERVER_ADDRESS)),
-         "IP Address to listen on (example: 127.0.0.1)");
+         "IP Address to listen on (example: 127.0.0.1)")
+        ("ktls",
+         po::bool_switch(&use_ktls),
+         "Offload TLS records to the kernel when supported (Linux)")
+        ("storage",
+         po::value<std::string>(&storage_spec)->default_value("postgres"),
+         "Storage backend: postgres or sqlite:<path>")
+        ("write-behind",
+         po::value<std::string>(&write_behind_dir),
+         "Record finished matches in batches, spilling to this directory")
+        ("archive-dir",
+         po::value<std::string>(&archive_dir),
+         "Move replays of old matches out of the database into this directory");
 
     po::variables_map vars;
     try
@@ -153,6 +170,10 @@ try
 
     asio::ip::tcp::endpoint endpoint(asio::ip::make_address(address), port);
 
+    // Attached to the SSL context below. Declared first so the context,
+    // whose ticket callback points at it, is destroyed before it.
+    TicketKeyRing ticket_keys;
+
     // Setup ssl context for the server.
     asio::ssl::context ssl_cntx(asio::ssl::context::tls_server);
 
@@ -183,6 +204,24 @@ try
         | asio::ssl::context::no_tlsv1_1
     );
 
+    // Allow reconnecting clients to resume their TLS session instead of
+    // paying for a full handshake, which matters after restarts when
+    // every client reconnects at once.
+    ticket_keys.attach(ssl_cntx);
+
+    // Sessions check the context for this option and switch to driving
+    // OpenSSL on the socket directly, see TlsStream.
+    if (use_ktls)
+    {
+#if defined(SSL_OP_ENABLE_KTLS)
+        SSL_CTX_set_options(ssl_cntx.native_handle(), SSL_OP_ENABLE_KTLS);
+#else
+        std::cerr << TERM_RED
+                  << "OpenSSL was built without kTLS support, ignoring --ktls.\n"
+                  << TERM_RESET;
+#endif
+    }
+
     // Try to fill the server identity with the current server public key.
     bool valid_fingerprint = fill_server_fingerprint(ssl_cntx,
                                                      server_identity.display_hash);
@@ -201,7 +240,10 @@ try
     Server server(server_io_context,
                   endpoint,
                   ssl_cntx,
-                  server_identity);
+                  server_identity,
+                  storage_spec,
+                  write_behind_dir,
+                  archive_dir);
 
     std::string lmsg = "Server started. "
                        + std::string("Server identity string:\n")
@@ -255,6 +297,16 @@ try
                   << TERM_RESET;
     }
 
+    // Such as a bad --storage option or an unreachable database.
+    catch(const std::exception& e)
+    {
+        std::cerr << TERM_RED
+                  << "Server error: "
+                  << e.what()
+                  << "\n"
+                  << TERM_RESET;
+    }
+
     std::cerr << "\nServer stopped. Press anything to return.\n";
 
     if (console_started)
@@ -0,0 +1,149 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "match-history-cache.h"
+
+#include "message.h"
+
+#include <algorithm>
+
+// The legacy request is answered from the same rows.
+static_assert(HISTORY_CACHE_DEPTH >= static_cast<size_t>(LATEST_MATCHES_COUNT));
+
+std::optional<std::vector<MatchResultRow>>
+MatchHistoryCache::get(const boost::uuids::uuid & user_id, GameMode mode)
+{
+    std::lock_guard lock(mutex_);
+
+    auto itr = entries_.find(Key{user_id, mode});
+
+    if (itr == entries_.end() || !itr->second.populated)
+    {
+        return std::nullopt;
+    }
+
+    lru_.splice(lru_.begin(), lru_, itr->second.lru);
+
+    return std::vector<MatchResultRow>(itr->second.rows.begin(),
+                                       itr->second.rows.end());
+}
+
+uint64_t MatchHistoryCache::begin_fill(const boost::uuids::uuid & user_id,
+                                       GameMode mode)
+{
+    std::lock_guard lock(mutex_);
+
+    // Creating the entry now means an eviction also cancels the fill.
+    return touch(Key{user_id, mode}).version;
+}
+
+void MatchHistoryCache::fill(const boost::uuids::uuid & user_id,
+                             GameMode mode,
+                             std::vector<MatchResultRow> rows,
+                             uint64_t version)
+{
+    std::lock_guard lock(mutex_);
+
+    auto itr = entries_.find(Key{user_id, mode});
+
+    if (itr == entries_.end() || itr->second.version != version)
+    {
+        return;
+    }
+
+    if (rows.size() > HISTORY_CACHE_DEPTH)
+    {
+        rows.resize(HISTORY_CACHE_DEPTH);
+    }
+
+    itr->second.rows.assign(rows.begin(), rows.end());
+    itr->second.populated = true;
+}
+
+void MatchHistoryCache::push(const boost::uuids::uuid & user_id,
+                             GameMode mode,
+                             MatchResultRow row)
+{
+    std::lock_guard lock(mutex_);
+
+    // Users nobody asked about are left for a fill, which a write
+    // through should neither create nor evict.
+    auto itr = entries_.find(Key{user_id, mode});
+
+    if (itr == entries_.end())
+    {
+        return;
+    }
+
+    Entry & entry = itr->second;
+    entry.version = ++next_version_;
+
+    if (!entry.populated)
+    {
+        return;
+    }
+
+    // Matches commit on several pool threads, so they can arrive out of
+    // match_id order. Keep the rows newest first.
+    auto pos = std::find_if(entry.rows.begin(),
+                            entry.rows.end(),
+                            [&row](const MatchResultRow & kept){
+                                return kept.match_id <= row.match_id;
+                            });
+
+    if (pos != entry.rows.end() && pos->match_id == row.match_id)
+    {
+        return;
+    }
+
+    // Older than every row of a full history, so not among the latest.
+    if (pos == entry.rows.end() && entry.rows.size() >= HISTORY_CACHE_DEPTH)
+    {
+        return;
+    }
+
+    entry.rows.insert(pos, std::move(row));
+
+    if (entry.rows.size() > HISTORY_CACHE_DEPTH)
+    {
+        entry.rows.pop_back();
+    }
+}
+
+MatchHistoryCache::Entry & MatchHistoryCache::touch(const Key & key)
+{
+    auto itr = entries_.find(key);
+
+    if (itr != entries_.end())
+    {
+        lru_.splice(lru_.begin(), lru_, itr->second.lru);
+        return itr->second;
+    }
+
+    if (entries_.size() >= HISTORY_CACHE_CAPACITY)
+    {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+
+    lru_.push_front(key);
+
+    Entry & entry = entries_[key];
+    entry.version = ++next_version_;
+    entry.lru = lru_.begin();
+
+    return entry;
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/functional/hash.hpp>
+
+#include "gamemodes.h"
+#include "match-result-structs.h"
+
+// Number of (user, mode) histories kept, least recently used go first.
+constexpr size_t HISTORY_CACHE_CAPACITY = 65536;
+
+// Rows kept per history. One more than the client's history page, so a
+// first page can be answered along with whether there is another.
+constexpr size_t HISTORY_CACHE_DEPTH = 21;
+
+// Latest HISTORY_CACHE_DEPTH results of each user and mode. A populated
+// entry with fewer rows than that holds the user's whole history.
+//
+// Filled from the database on a miss and written through by whatever
+// records matches, once their transaction commits, so online users are
+// served their history without a query.
+//
+// Every entry has a version which moves on each write through. A
+// fill is only stored if the version did not move while its query ran,
+// so a match committed during the query is never lost. Thread safe.
+class MatchHistoryCache
+{
+public:
+    // Newest first, or nullopt on a miss.
+    std::optional<std::vector<MatchResultRow>>
+    get(const boost::uuids::uuid & user_id, GameMode mode);
+
+    // Call before querying the database, and pass the result to fill.
+    uint64_t begin_fill(const boost::uuids::uuid & user_id, GameMode mode);
+
+    // Rows are newest first, as fetched.
+    void fill(const boost::uuids::uuid & user_id,
+              GameMode mode,
+              std::vector<MatchResultRow> rows,
+              uint64_t version);
+
+    // A new match for the user, called once it has committed. Only
+    // updates an entry that is already cached.
+    void push(const boost::uuids::uuid & user_id,
+              GameMode mode,
+              MatchResultRow row);
+
+private:
+    struct Key
+    {
+        boost::uuids::uuid user_id;
+        GameMode mode;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key & key) const
+        {
+            size_t seed = boost::hash<boost::uuids::uuid>()(key.user_id);
+            boost::hash_combine(seed, static_cast<uint8_t>(key.mode));
+            return seed;
+        }
+    };
+
+    struct Entry
+    {
+        std::deque<MatchResultRow> rows;
+
+        // False until filled, rows are only a partial history until then.
+        bool populated{false};
+        uint64_t version{0};
+
+        std::list<Key>::iterator lru;
+    };
+
+    // Requires mutex_, creates the entry if needed and marks it used.
+    Entry & touch(const Key & key);
+
+private:
+    std::mutex mutex_;
+
+    // Most recently used at the front.
+    std::list<Key> lru_;
+    std::unordered_map<Key, Entry, KeyHash> entries_;
+
+    uint64_t next_version_{0};
+};
@@ -31,6 +31,7 @@ username(user_string)
 
 // Only valid constructor, refuse any other construction attempts.
 MatchInstance::MatchInstance(asio::io_context & cntx,
+                             TurnClock & turn_clock,
                              MatchSettings settings,
                              std::vector<PlayerInfo> player_list,
                              SendCallback send_callback,
@@ -42,7 +43,7 @@ MatchInstance::MatchInstance(asio::io_context & cntx,
     remaining_players(n_players_),
     current_fuel(TURN_PLAYER_FUEL),
     strand_(cntx.get_executor()),
-    timer_(cntx),
+    turn_clock_(turn_clock),
     results_(settings.map.map_settings,
              settings.initial_time_ms,
              settings.increment_ms),
@@ -53,8 +54,10 @@ MatchInstance::MatchInstance(asio::io_context & cntx,
     increment_(std::chrono::milliseconds(settings.increment_ms)),
     current_state(GameState::Setup),
     command_queues_(n_players_),
+    last_sequence_(n_players_, 0),
     time_left_(n_players_,
                std::chrono::milliseconds(settings.initial_time_ms)),
+    spectators_(std::make_shared<SpectatorHub>(cntx, n_players_ + 1)),
     send_callback_(send_callback),
     results_callback_(nullptr),
     game_message_(game_message)
@@ -67,6 +70,70 @@ MatchInstance::MatchInstance(asio::io_context & cntx,
     }
 }
 
+void MatchInstance::reset(MatchSettings settings,
+                          std::vector<PlayerInfo> player_list,
+                          SendCallback send_callback,
+                          GameMessageCallback game_message)
+{
+    n_players_ = settings.map.map_settings.num_players;
+    elim_counter_ = 0;
+    current_player = 0;
+    remaining_players = n_players_;
+    current_fuel = TURN_PLAYER_FUEL;
+
+    results_ = MatchResult(settings.map.map_settings,
+                           settings.initial_time_ms,
+                           settings.increment_ms);
+
+    players_ = std::move(player_list);
+    tanks_placed = 0;
+    game_instance_.reset(std::move(settings.map));
+
+    turn_ID_ = 0;
+    turn_claimed_ = false;
+    increment_ = std::chrono::milliseconds(settings.increment_ms);
+    current_state = GameState::Setup;
+
+    // Keep the queue storage from the last match.
+    command_queues_.resize(n_players_);
+    for (auto & queue : command_queues_)
+    {
+        while (!queue.empty())
+        {
+            queue.pop();
+        }
+    }
+
+    last_sequence_.assign(n_players_, 0);
+
+    time_left_.assign(n_players_,
+                      std::chrono::milliseconds(settings.initial_time_ms));
+
+    // Views are resized as needed when they are next computed.
+    player_views_.resize(n_players_);
+
+    // Spectators of the last match may still be receiving delayed
+    // frames, so they keep the old hub until it closes.
+    spectators_ = std::make_shared<SpectatorHub>(
+                      strand_.get_inner_executor().context(),
+                      n_players_ + 1);
+
+    send_callback_ = std::move(send_callback);
+    results_callback_ = nullptr;
+    game_message_ = std::move(game_message);
+
+    shutdown = false;
+}
+
+void MatchInstance::recycle()
+{
+    send_callback_ = nullptr;
+    results_callback_ = nullptr;
+    game_message_ = nullptr;
+
+    players_.clear();
+}
+
 void MatchInstance::set_results_callback(ResultsCallback cb)
 {
     results_callback_ = std::move(cb);
@@ -147,6 +214,44 @@ void MatchInstance::receive_command(boost::uuids::uuid user_id, Command cmd)
         });
 }
 
+// Function to apply a whole turn of commands (routed by the server)
+void MatchInstance::receive_batch(boost::uuids::uuid user_id, TurnBatch batch)
+{
+    asio::post(strand_,
+        [self = shared_from_this(),
+         batch = std::move(batch),
+         t_id = turn_ID_,
+         user_id = user_id]() mutable {
+
+            uint8_t correct_id = UINT8_MAX;
+            for (uint8_t p_id = 0; p_id < self->n_players_; p_id++)
+            {
+                if (self->players_[p_id].user_id == user_id)
+                {
+                    correct_id = p_id;
+                    break;
+                }
+            }
+
+            if (correct_id == UINT8_MAX)
+            {
+                return;
+            }
+
+            if (self->current_state == GameState::Concluded)
+            {
+                Message match_over;
+                match_over.create_serialized(HeaderType::GameEnded);
+
+                self->send_callback_(self->players_[correct_id].session_id,
+                                     std::move(match_over));
+                return;
+            }
+
+            self->on_batch_arrived(t_id, correct_id, batch);
+        });
+}
+
 void MatchInstance::forfeit(boost::uuids::uuid user_id)
 {
     asio::post(strand_,
@@ -298,10 +403,69 @@ void MatchInstance::async_shutdown()
 
     self->shutdown = true;
 
-    self->timer_.cancel();
     self->send_callback_ = nullptr;
     self->results_callback_ = nullptr;
 
+    self->spectators_->shutdown();
+
+    });
+}
+
+void MatchInstance::add_spectator(Session::ptr session,
+                                  std::optional<boost::uuids::uuid> perspective,
+                                  bool fogged)
+{
+    asio::post(strand_,
+        [self = shared_from_this(),
+         session = std::move(session),
+         perspective,
+         fogged]{
+
+        boost::uuids::uuid user_id = session->get_user_data().user_id;
+
+        bool is_player = false;
+        uint8_t stream = GLOBAL_SPECTATOR_STREAM;
+
+        for (uint8_t p_id = 0; p_id < self->n_players_; p_id++)
+        {
+            if (self->players_[p_id].user_id == user_id)
+            {
+                is_player = true;
+            }
+
+            if (perspective && self->players_[p_id].user_id == *perspective)
+            {
+                stream = 1 + p_id;
+            }
+        }
+
+        // Without a perspective, fogged spectators follow the first player.
+        if (fogged && stream == GLOBAL_SPECTATOR_STREAM)
+        {
+            stream = 1;
+        }
+        else if (!fogged)
+        {
+            stream = GLOBAL_SPECTATOR_STREAM;
+        }
+
+        if (is_player
+            || self->shutdown
+            || self->current_state == GameState::Concluded)
+        {
+            Message failed;
+            failed.create_serialized(HeaderType::SpectateFailed);
+            session->deliver(std::move(failed));
+            return;
+        }
+
+        self->spectators_->add(session, stream);
+
+        // Queue a frame now, otherwise the new spectator would wait
+        // for the next move before their delay even starts.
+        std::vector<SpectatorHub::Frame> frames(self->n_players_ + 1);
+        frames[stream] = self->serialize_spectator_frame(stream);
+        self->spectators_->publish(std::move(frames));
     });
 }
 
@@ -318,6 +482,10 @@ void MatchInstance::start()
         send_callback_(players_[id].session_id, static_data_msg);
     }
 
+    auto spectator_data = std::make_shared<Message>();
+    spectator_data->create_serialized(match_data);
+    spectators_->set_static_data(std::move(spectator_data));
+
     // Send an initial view of the environment to each player
     // and then start the game asynchronously
     compute_all_views();
@@ -394,21 +562,28 @@ void MatchInstance::start_turn()
 
     // schedule move timeout and wait for turn
     //
-    // if we cancel the timer, we will get an operation cancelled error_code
-    // and if we have advanced the turn, the timer is likewise useless.
-    //
-    // thus, only perform timeout if we fail to cancel the timer and have not
-    // moved to another player.
+    // deadlines are never cancelled, if we move on to another turn
+    // the turn ID no longer matches and on_turn_deadline ignores it.
     expiry_time_ = steady_clock::now() + time_left_[current_player];
 
-    timer_.expires_at(expiry_time_);
-    timer_.async_wait(asio::bind_executor(strand_,
-        [self = shared_from_this(),
-         id=current_player,
-         t_id = turn_ID_](boost::system::error_code ec)
+    turn_clock_.schedule(shared_from_this(), turn_ID_, expiry_time_);
+
+    // if we already have a move in the queue, use this now
+    if (!command_queues_[current_player].empty())
+    {
+        on_player_move_arrived(turn_ID_);
+    }
+
+}
+
+void MatchInstance::on_turn_deadline(uint32_t t_id)
+{
+    asio::post(strand_,
+        [self = shared_from_this(), t_id]
         {
-            // check for stale timer calls
-            if (t_id != self->turn_ID_)
+            // check for stale deadlines and finished matches
+            if (t_id != self->turn_ID_ || self->shutdown
+                || self->current_state == GameState::Concluded)
             {
                 return;
             }
@@ -419,22 +594,18 @@ void MatchInstance::start_turn()
                 return;
             }
 
-            // otherwise, timeout the player if expired
-            if (!ec)
+            // the clock may round up to its tick, but never fires early.
+            // guard against it anyways so we never time out a player with
+            // time left on their clock.
+            if (steady_clock::now() < self->expiry_time_)
             {
-                self->turn_claimed_ = true;
-                self->handle_timeout();
+                self->turn_clock_.schedule(self, t_id, self->expiry_time_);
+                return;
             }
-        })
-
-    );
-
-    // if we already have a move in the queue, use this now
-    if (!command_queues_[current_player].empty())
-    {
-        on_player_move_arrived(turn_ID_);
-    }
 
+            self->turn_claimed_ = true;
+            self->handle_timeout();
+        });
 }
 
 // Post work for the next turn to the strand.
@@ -486,9 +657,6 @@ void MatchInstance::on_player_move_arrived(uint32_t t_id)
         return;
     }
 
-    // cancel the timer so we don't get timed out
-    timer_.cancel();
-
     // compute the time difference
     steady_clock::duration remaining = std::chrono::milliseconds(0);
     if (expiry_time_ > now)
@@ -522,6 +690,7 @@ void MatchInstance::on_player_move_arrived(uint32_t t_id)
     }
 
     time_left_[current_player] += increment_;
+    last_sequence_[current_player] = next_move.sequence_number;
 
     // Add this command to the move history of the match
     results_.move_history.push_back(std::move(CommandHead(next_move)));
@@ -569,6 +738,132 @@ void MatchInstance::on_player_move_arrived(uint32_t t_id)
 
 }
 
+void MatchInstance::on_batch_arrived(uint32_t t_id,
+                                     uint8_t p_id,
+                                     TurnBatch & batch)
+{
+    steady_clock::time_point now = steady_clock::now();
+
+    TurnBatchResult result;
+    result.status.assign(batch.commands.size(), BatchStatus::Skipped);
+
+    // Unlike single commands, batches are not queued for a later turn,
+    // the client resends once it is their turn.
+    if (t_id != turn_ID_ || turn_claimed_ || p_id != current_player)
+    {
+        Message result_msg;
+        result_msg.create_serialized(result);
+        send_callback_(players_[p_id].session_id, std::move(result_msg));
+        return;
+    }
+
+    // Claim the turn, the deadline may not time us out anymore.
+    turn_claimed_ = true;
+
+    steady_clock::duration remaining = std::chrono::milliseconds(0);
+    if (expiry_time_ > now)
+    {
+        remaining = expiry_time_ - now;
+    }
+
+    time_left_[current_player] = std::chrono::duration_cast<std::chrono::milliseconds>(remaining);
+
+    // Apply in order, same as if each command had arrived on its own,
+    // but only compute and broadcast views once at the end.
+    //
+    // Anything start_turn has to settle first, such as the end of the
+    // turn, of setup or of the game, stops the batch and the commands
+    // left are Skipped.
+    bool applied_any = false;
+
+    for (size_t i = 0; i < batch.commands.size(); i++)
+    {
+        Command & cmd = batch.commands[i];
+        cmd.sender = p_id;
+
+        ApplyResult res = apply_command(cmd);
+
+        if (res.valid_move == false)
+        {
+            result.status[i] = BatchStatus::Failed;
+            continue;
+        }
+
+        result.status[i] = BatchStatus::Applied;
+        applied_any = true;
+
+        time_left_[current_player] += increment_;
+        last_sequence_[current_player] = cmd.sequence_number;
+        results_.move_history.push_back(CommandHead(cmd));
+
+        // Setup moves do not consume fuel, placing a tank ends the turn
+        // and the last placement ends setup.
+        if (current_state == GameState::Setup)
+        {
+            current_player = ((current_player + 1) % n_players_);
+            break;
+        }
+
+        current_fuel = current_fuel - 1;
+
+        if (current_fuel == 0)
+        {
+            current_player = ((current_player + 1) % n_players_);
+            current_fuel = TURN_PLAYER_FUEL;
+            break;
+        }
+
+        // A hit may have eliminated a player, and so ended the game,
+        // which compute_all_views and start_turn pick up.
+        if (cmd.type == CommandType::Fire && tanks_lost())
+        {
+            break;
+        }
+    }
+
+    Message result_msg;
+    result_msg.create_serialized(result);
+    send_callback_(players_[p_id].session_id, std::move(result_msg));
+
+    if (applied_any)
+    {
+        compute_all_views();
+    }
+
+    start_turn_strand();
+}
+
+bool MatchInstance::tanks_lost()
+{
+    for (uint8_t p_id = 0; p_id < n_players_; p_id++)
+    {
+        if (players_[p_id].alive == false)
+        {
+            continue;
+        }
+
+        bool any_alive = false;
+
+        for (uint8_t t = 0; t < game_instance_.num_tanks_; t++)
+        {
+            uint8_t tank_id = p_id * game_instance_.num_tanks_ + t;
+
+            if (game_instance_.get_tank(tank_id).health_ > 0)
+            {
+                any_alive = true;
+                break;
+            }
+        }
+
+        if (!any_alive)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void MatchInstance::handle_timeout()
 {
     handle_elimination(current_player, HeaderType::TimedOut);
@@ -623,8 +918,6 @@ void MatchInstance::handle_elimination(uint8_t p_id, HeaderType reason)
     {
         current_player = ((current_player + 1) % n_players_);
         current_fuel = TURN_PLAYER_FUEL;
-        // Cancel timers.
-        timer_.cancel();
     }
 
     // Go back to main game loop by posting a new turn.
@@ -829,7 +1122,7 @@ void MatchInstance::compute_all_views()
 
         uint8_t live_tanks = 0;
 
-        player_views_[i] = game_instance_.compute_view(i, live_tanks);
+        game_instance_.compute_view(i, live_tanks, player_views_[i]);
 
         if (live_tanks == 0 && current_state != GameState::Setup)
         {
@@ -856,6 +1149,8 @@ void MatchInstance::compute_all_views()
         // Append time for each player.
         player_views_[i].timers = time_left_;
 
+        player_views_[i].last_sequence = last_sequence_[i];
+
         // Send view to the player
         Message view_message;
         view_message.create_serialized(player_views_[i]);
@@ -865,6 +1160,58 @@ void MatchInstance::compute_all_views()
 
     }
 
+    // Most matches have no spectators, skip the extra serialization.
+    if (spectators_->active())
+    {
+        publish_spectator_frames();
+    }
+
+}
+
+SpectatorHub::Frame MatchInstance::serialize_spectator_frame(uint8_t stream)
+{
+    const PlayerView * view = nullptr;
+
+    if (stream == GLOBAL_SPECTATOR_STREAM)
+    {
+        game_instance_.dump_global_view(spectator_view_);
+
+        spectator_view_.current_player = current_player;
+        spectator_view_.current_fuel = current_fuel;
+        spectator_view_.current_state = current_state;
+        spectator_view_.timers = time_left_;
+
+        view = &spectator_view_;
+    }
+    else
+    {
+        view = &player_views_[stream - 1];
+    }
+
+    auto frame = std::make_shared<Message>();
+    frame->create_serialized(*view);
+
+    // Same payload as a player view, but clients must not treat
+    // it as their own game.
+    frame->header.type_ = HeaderType::SpectatorView;
+
+    return frame;
+}
+
+void MatchInstance::publish_spectator_frames()
+{
+    std::vector<SpectatorHub::Frame> frames(n_players_ + 1);
+
+    // Each stream is serialized once, no matter how many are watching it.
+    for (uint8_t stream = 0; stream < frames.size(); stream++)
+    {
+        if (spectators_->watching(stream))
+        {
+            frames[stream] = serialize_spectator_frame(stream);
+        }
+    }
+
+    spectators_->publish(std::move(frames));
 }
 
 void MatchInstance::conclude_game()
@@ -899,13 +1246,16 @@ void MatchInstance::conclude_game()
         send_callback_(players_[winner].session_id, inform_winner);
     }
 
+    // Spectators see the end of the match once their delay catches up.
+    auto spectate_ended = std::make_shared<Message>();
+    spectate_ended->create_serialized(HeaderType::SpectateEnded);
+    spectators_->close(std::move(spectate_ended));
+
     // Call back to the server to write results to the database
     // and handle any updates
-    results_callback_(results_);
+    results_callback_(std::move(results_));
 
     // Break down the game instance. We do not need it anymore.
-    timer_.cancel();
-
     send_callback_ = nullptr;
     results_callback_ = nullptr;
 
@@ -19,6 +19,7 @@
 #include <vector>
 #include <queue>
 #include <chrono>
+#include <optional>
 #include <utility>
 
 #include <boost/asio.hpp>
@@ -32,6 +33,8 @@
 #include "message.h"
 #include "match-result.h"
 #include "game-state.h"
+#include "turn-clock.h"
+#include "spectator-hub.h"
 
 namespace asio = boost::asio;
 
@@ -74,17 +77,31 @@ public:
 
     // Only valid constructor, refuse any other construction attempts.
     MatchInstance(asio::io_context & cntx,
+                  TurnClock & turn_clock,
                   MatchSettings settings,
                   std::vector<PlayerInfo> player_list,
                   SendCallback send_callback,
                   GameMessageCallback game_message);
 
+    // Reinitialize a recycled instance for a new match. The instance must
+    // not have any pending work, see MatchPool.
+    void reset(MatchSettings settings,
+               std::vector<PlayerInfo> player_list,
+               SendCallback send_callback,
+               GameMessageCallback game_message);
+
+    // Drop references held by callbacks before being pooled.
+    void recycle();
+
     // To be called before the instance starts async operations.
     void set_results_callback(ResultsCallback cb);
 
     // Called by the networking layer to enqueue commands.
     void receive_command(boost::uuids::uuid user_id, Command cmd);
 
+    // Called by the networking layer for a whole turn of commands.
+    void receive_batch(boost::uuids::uuid user_id, TurnBatch batch);
+
     void forfeit(boost::uuids::uuid user_id);
 
     // To be used when a reconnecting client needs to sync state.
@@ -94,9 +111,18 @@ public:
 
     void async_shutdown();
 
+    // Watch the match from the global view, or from the fogged view of
+    // the player with the given user ID.
+    void add_spectator(Session::ptr session,
+                       std::optional<boost::uuids::uuid> perspective,
+                       bool fogged);
+
     // Initialization function to start a match.
     void start();
 
+    // Called by the turn clock once the deadline of turn t_id has passed.
+    void on_turn_deadline(uint32_t t_id);
+
 private:
     StaticMatchData compute_static_data();
 
@@ -111,6 +137,13 @@ private:
     // Handles the arrival of a move in the context of a turn.
     void on_player_move_arrived(uint32_t t_id);
 
+    // Applies a batch of commands from player p_id as one turn.
+    void on_batch_arrived(uint32_t t_id, uint8_t p_id, TurnBatch & batch);
+
+    // True if a player still in the match has no live tanks, which is
+    // only acted on by compute_all_views.
+    bool tanks_lost();
+
     // Handles timing out the player and preparing for the next game state.
     void handle_timeout();
 
@@ -122,6 +155,12 @@ private:
     // Compute the view of the game for every player.
     void compute_all_views();
 
+    // Serialize the streams spectators are watching and pass them
+    // to the spectator hub.
+    void publish_spectator_frames();
+
+    SpectatorHub::Frame serialize_spectator_frame(uint8_t stream);
+
     // Determines the winner and sends this information back to the server
     //
     // First, we should clean our instance up on its strand (cancel timers, etc)
@@ -149,7 +188,8 @@ public:
 private:
     asio::strand<asio::io_context::executor_type> strand_;
 
-    asio::steady_timer timer_;
+    // Shared with every other live match, see TurnClock.
+    TurnClock & turn_clock_;
     steady_clock::time_point expiry_time_;
 
     // Move history for recording the game history.
@@ -188,12 +228,20 @@ private:
     // ensure the correct turn order is processed.
     std::vector<std::priority_queue<Command, std::vector<Command>, seq_comp>> command_queues_;
 
+    // Sequence number of the last applied command for each player,
+    // echoed in their views for client side prediction.
+    std::vector<uint16_t> last_sequence_;
+
     // Per player counts of remaining time.
     std::vector<std::chrono::milliseconds> time_left_;
 
     // Per player views of the game.
     std::vector<PlayerView> player_views_;
 
+    // Delayed broadcast of the match, see SpectatorHub.
+    std::shared_ptr<SpectatorHub> spectators_;
+    PlayerView spectator_view_;
+
     // Callback function to send message to a player's session.
     SendCallback send_callback_;
 
@@ -25,6 +25,8 @@ MatchMaker::MatchMaker(asio::io_context & cntx,
                        std::shared_ptr<UserManager> user_manager)
 :global_strand_(cntx.get_executor()),
  all_maps_(std::make_unique<MapRepository>()),
+ turn_clock_(cntx),
+ match_pool_(std::make_shared<MatchPool>()),
  io_cntx_(cntx),
  send_callback_(std::move(send_callback)),
  recorder_callback_(std::move(recorder_callback)),
@@ -48,6 +50,8 @@ MatchMaker::MatchMaker(asio::io_context & cntx,
     matching_queues_[static_cast<size_t>(GameMode::ClassicFivePlayer)] = std::make_unique<CasualFivePlayerStrategy>(cntx, match_call_back, all_maps_);
 
     matching_queues_[static_cast<size_t>(GameMode::RankedTwoPlayer)] = std::make_unique<RankedTwoPlayerStrategy>(cntx, match_call_back, all_maps_);
+    matching_queues_[static_cast<size_t>(GameMode::RankedThreePlayer)] = std::make_unique<RankedGroupStrategy>(cntx, match_call_back, all_maps_, GameMode::RankedThreePlayer);
+    matching_queues_[static_cast<size_t>(GameMode::RankedFivePlayer)] = std::make_unique<RankedGroupStrategy>(cntx, match_call_back, all_maps_, GameMode::RankedFivePlayer);
 
     // Start tick timer.
     start_tick_loop();
@@ -148,12 +152,47 @@ void MatchMaker::tick_all()
 // Public facing function to keep strand logic and routing logic separate
 void MatchMaker::route_to_match(const Session::ptr & p, Message msg)
 {
+    // Fast path, go straight to the match strand. Commands are the bulk
+    // of match traffic and should not wait behind match making.
+    if (auto match = p->current_match())
+    {
+        auto user_id = (p->get_user_data()).user_id;
+        deliver_command(p, *match, user_id, msg);
+        return;
+    }
+
+    // Not bound yet (or no match), fall back to the lookup.
     asio::post(global_strand_, [this, p, m = std::move(msg)]
     {
         route_impl(p, m);
     });
 }
 
+void MatchMaker::deliver_command(const Session::ptr & p,
+                                 MatchInstance & match,
+                                 boost::uuids::uuid user_id,
+                                 Message & msg)
+{
+    if (msg.header.type_ != HeaderType::SendTurnBatch)
+    {
+        match.receive_command(user_id, msg.to_command());
+        return;
+    }
+
+    bool status = false;
+    TurnBatch batch = msg.to_turn_batch(status);
+
+    if (!status)
+    {
+        Message bad_message;
+        bad_message.create_serialized(HeaderType::BadMessage);
+        p->deliver(std::move(bad_message));
+        return;
+    }
+
+    match.receive_batch(user_id, std::move(batch));
+}
+
 void MatchMaker::forfeit(const Session::ptr & p)
 {
     asio::post(global_strand_, [this, p]
@@ -166,6 +205,12 @@ void MatchMaker::send_match_message(const Session::ptr & p,
                                     boost::uuids::uuid user_id,
                                     InternalMatchMessage msg)
 {
+    if (auto match = p->current_match())
+    {
+        match->match_message(user_id, std::move(msg));
+        return;
+    }
+
     asio::post(global_strand_,
             [this,
             session = p,
@@ -192,6 +237,27 @@ void MatchMaker::send_match_message(const Session::ptr & p,
     });
 }
 
+void MatchMaker::spectate(const Session::ptr & p,
+                          uint64_t match_id,
+                          bool fogged)
+{
+    asio::post(global_strand_, [this, p, match_id, fogged]{
+
+        auto match = live_matches_.find(match_id);
+
+        if (match == live_matches_.end())
+        {
+            Message failed;
+            failed.create_serialized(HeaderType::SpectateFailed);
+
+            p->deliver(std::move(failed));
+            return;
+        }
+
+        match->second->add_spectator(p, std::nullopt, fogged);
+    });
+}
+
 void MatchMaker::async_shutdown(std::function<void()> on_done)
 {
     asio::post(global_strand_,
@@ -214,6 +280,7 @@ void MatchMaker::async_shutdown(std::function<void()> on_done)
             }
 
             tick_timer_.cancel();
+            turn_clock_.shutdown();
 
             on_done();
     });
@@ -343,11 +410,12 @@ void MatchMaker::make_match_on_strand(std::vector<Session::ptr> players,
     // out of memory and need to stop making matches.
     try
     {
-        new_inst = std::make_shared<MatchInstance>(io_cntx_,
-                                                   std::move(settings),
-                                                   player_list,
-                                                   send_callback_,
-                                                   game_message_cb);
+        new_inst = match_pool_->acquire(io_cntx_,
+                                        turn_clock_,
+                                        std::move(settings),
+                                        player_list,
+                                        send_callback_,
+                                        game_message_cb);
     }
     catch (...)
     {
@@ -423,11 +491,8 @@ void MatchMaker::route_impl(const Session::ptr & p, Message msg)
 
     if (match != uuid_to_match_.end())
     {
-        // Convert message to command
-        Command cmd_to_send = msg.to_command();
-
         // Route to found match instance
-        match->second->receive_command(user_id, std::move(cmd_to_send));
+        deliver_command(p, *match->second, user_id, msg);
     }
     else
     {
@@ -18,6 +18,7 @@
 
 #include "match-strategy.h"
 #include "match-instance.h"
+#include "match-pool.h"
 #include "map-repository.h"
 
 #include <boost/functional/hash.hpp>
@@ -53,6 +54,9 @@ public:
                             boost::uuids::uuid user_id,
                             InternalMatchMessage msg);
 
+    // Watch a live match by its internal match ID.
+    void spectate(const Session::ptr & p, uint64_t match_id, bool fogged);
+
     void async_shutdown(std::function<void()> on_done);
 
 private:
@@ -63,6 +67,12 @@ private:
 
     void route_impl(const Session::ptr & p, Message msg);
 
+    // Decode a SendCommand or SendTurnBatch message into the match.
+    void deliver_command(const Session::ptr & p,
+                         MatchInstance & match,
+                         boost::uuids::uuid user_id,
+                         Message & msg);
+
     void forfeit_impl(const Session::ptr & p);
 
 private:
@@ -93,6 +103,13 @@ private:
     // Map repository.
     std::shared_ptr<MapRepository> all_maps_;
 
+    // Turn deadlines of every live match.
+    TurnClock turn_clock_;
+
+    // Recycled match instances, shared so that instances still in play
+    // can find their way back.
+    std::shared_ptr<MatchPool> match_pool_;
+
     // Necessary to create match instances with a different strand
     // to prevent having to use global_strand_ for all calls.
     asio::io_context & io_cntx_;
@@ -0,0 +1,95 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "match-pool.h"
+
+std::shared_ptr<MatchInstance>
+MatchPool::acquire(asio::io_context & cntx,
+                   TurnClock & turn_clock,
+                   MatchSettings settings,
+                   std::vector<PlayerInfo> player_list,
+                   SendCallback send_callback,
+                   GameMessageCallback game_message)
+{
+    uint32_t key = shape_key(settings.map.map_settings);
+
+    std::unique_ptr<MatchInstance> inst;
+
+    {
+        std::lock_guard lock(pool_mutex_);
+
+        auto itr = idle_.find(key);
+        if (itr != idle_.end() && !itr->second.empty())
+        {
+            inst = std::move(itr->second.back());
+            itr->second.pop_back();
+        }
+    }
+
+    if (inst)
+    {
+        inst->reset(std::move(settings),
+                    std::move(player_list),
+                    std::move(send_callback),
+                    std::move(game_message));
+    }
+    else
+    {
+        inst = std::make_unique<MatchInstance>(cntx,
+                                               turn_clock,
+                                               std::move(settings),
+                                               std::move(player_list),
+                                               std::move(send_callback),
+                                               std::move(game_message));
+    }
+
+    // Return to the pool when the last reference is dropped, or just
+    // delete if the pool is already gone.
+    return std::shared_ptr<MatchInstance>(inst.release(),
+        [weak_pool = weak_from_this(), key](MatchInstance * released)
+        {
+            if (auto pool = weak_pool.lock())
+            {
+                pool->release(key, released);
+                return;
+            }
+
+            delete released;
+        });
+}
+
+uint32_t MatchPool::shape_key(const MapSettings & settings)
+{
+    return (static_cast<uint32_t>(settings.num_players) << 16)
+           | (static_cast<uint32_t>(settings.width) << 8)
+           | static_cast<uint32_t>(settings.height);
+}
+
+void MatchPool::release(uint32_t key, MatchInstance * inst)
+{
+    std::unique_ptr<MatchInstance> owned(inst);
+
+    owned->recycle();
+
+    std::lock_guard lock(pool_mutex_);
+
+    auto & idle = idle_[key];
+
+    if (idle.size() < MAX_POOLED_MATCHES_PER_SHAPE)
+    {
+        idle.push_back(std::move(owned));
+    }
+}
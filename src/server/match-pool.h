@@ -0,0 +1,63 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "match-instance.h"
+
+// Upper bound on idle instances kept for each map shape.
+static constexpr size_t MAX_POOLED_MATCHES_PER_SHAPE = 32;
+
+// Recycles MatchInstance objects between matches.
+//
+// Instances are handed out as shared pointers whose deleter returns them
+// to the pool instead of freeing them. Since every pending handler of a
+// match holds a shared pointer, an instance only comes back once all of
+// its async work is done, and is then reset in place for the next match.
+//
+// Idle instances are kept per map shape (players, width, height) so the
+// board, view and queue buffers they hold are already the right size.
+//
+// All instances from a pool must share the same turn clock.
+class MatchPool : public std::enable_shared_from_this<MatchPool>
+{
+    using SendCallback = std::function<void(uint64_t s_id, Message msg)>;
+    using GameMessageCallback = std::function<void(boost::uuids::uuid sender,
+                                                   InternalMatchMessage msg)>;
+
+public:
+    std::shared_ptr<MatchInstance> acquire(asio::io_context & cntx,
+                                           TurnClock & turn_clock,
+                                           MatchSettings settings,
+                                           std::vector<PlayerInfo> player_list,
+                                           SendCallback send_callback,
+                                           GameMessageCallback game_message);
+
+private:
+    static uint32_t shape_key(const MapSettings & settings);
+
+    void release(uint32_t key, MatchInstance * inst);
+
+private:
+    std::mutex pool_mutex_;
+    std::unordered_map<uint32_t,
+                       std::vector<std::unique_ptr<MatchInstance>>> idle_;
+};
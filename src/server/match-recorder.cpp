@@ -0,0 +1,884 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "match-recorder.h"
+#include "console.h"
+#include "postgres-storage.h"
+#include "replay-codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <optional>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static constexpr std::string_view SEGMENT_PREFIX = "matches-";
+static constexpr std::string_view SEGMENT_EXTENSION = ".spill";
+
+// Records are only read back on the machine that wrote them,
+// so integers are stored in host byte order.
+template <typename T>
+static void put(std::string & out, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+static bool take(std::string_view & in, T & value)
+{
+    if (in.size() < sizeof(T))
+    {
+        return false;
+    }
+
+    std::memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+static bool take_uuid(std::string_view & in, boost::uuids::uuid & id)
+{
+    if (in.size() < id.size())
+    {
+        return false;
+    }
+
+    std::memcpy(id.data, in.data(), id.size());
+    in.remove_prefix(id.size());
+    return true;
+}
+
+static bool take_string(std::string_view & in, std::string & value)
+{
+    uint32_t length = 0;
+
+    if (!take(in, length) || in.size() < length)
+    {
+        return false;
+    }
+
+    value.assign(in.data(), length);
+    in.remove_prefix(length);
+    return true;
+}
+
+MatchRecorder::MatchRecorder(asio::thread_pool & pool,
+                             std::filesystem::path spill_dir,
+                             MatchHistoryCache & history_cache,
+                             EloCallback elo_callback)
+:strand_(pool.get_executor()),
+timer_(strand_),
+spill_dir_(std::move(spill_dir)),
+history_cache_(history_cache),
+elo_callback_(std::move(elo_callback))
+{
+}
+
+MatchRecorder::~MatchRecorder()
+{
+    if (spill_file_)
+    {
+        std::fclose(spill_file_);
+    }
+}
+
+void MatchRecorder::start()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(spill_dir_, ec);
+
+    if (ec)
+    {
+        std::string lmsg = "Could not create match spill directory "
+                           + spill_dir_.string()
+                           + ": "
+                           + ec.message();
+        Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+    }
+
+    // Collect segments left by an earlier run, oldest first.
+    std::vector<Segment> leftover;
+
+    for (const auto & entry : std::filesystem::directory_iterator(spill_dir_, ec))
+    {
+        std::string name = entry.path().filename().string();
+
+        if (!name.starts_with(SEGMENT_PREFIX) || !name.ends_with(SEGMENT_EXTENSION))
+        {
+            continue;
+        }
+
+        std::string digits = name.substr(SEGMENT_PREFIX.size(),
+                                         name.size()
+                                         - SEGMENT_PREFIX.size()
+                                         - SEGMENT_EXTENSION.size());
+
+        try
+        {
+            leftover.push_back(Segment{std::stoull(digits), entry.path()});
+        }
+        catch (const std::exception &)
+        {
+            continue;
+        }
+    }
+
+    std::sort(leftover.begin(), leftover.end(),
+              [](const Segment & a, const Segment & b)
+              {
+                  return a.number < b.number;
+              });
+
+    std::vector<PendingMatch> recovered;
+
+    for (const Segment & segment : leftover)
+    {
+        auto matches = read_segment(segment.path);
+        std::move(matches.begin(), matches.end(), std::back_inserter(recovered));
+    }
+
+    {
+        std::lock_guard lock(spill_mutex_);
+
+        segment_number_ = leftover.empty() ? 0 : leftover.back().number + 1;
+        open_segment();
+    }
+
+    if (!leftover.empty())
+    {
+        std::string lmsg = "Replaying "
+                           + std::to_string(recovered.size())
+                           + " unrecorded matches from "
+                           + std::to_string(leftover.size())
+                           + " spill segments.";
+        Console::instance().log(std::move(lmsg), LogLevel::WARN);
+    }
+
+    asio::post(strand_,
+        [self = shared_from_this(),
+         recovered = std::move(recovered),
+         leftover = std::move(leftover)]() mutable {
+
+        // An earlier run may have died between commit and delete.
+        self->uncertain_ = true;
+        self->retry_ = std::move(recovered);
+        self->retry_segments_ = std::move(leftover);
+        self->flush();
+    });
+}
+
+void MatchRecorder::enqueue(PendingMatch match)
+{
+    std::string record = serialize(match);
+
+    std::lock_guard lock(spill_mutex_);
+
+    if (spill_file_)
+    {
+        bool written = std::fwrite(record.data(), 1, record.size(), spill_file_) == record.size()
+                       && std::fflush(spill_file_) == 0;
+
+        if (!written)
+        {
+            Console::instance().log("Failed to write a match to the spill file.",
+                                    LogLevel::ERROR);
+        }
+    }
+
+    buffer_.push_back(std::move(match));
+
+    if (buffer_.size() >= RECORDER_BATCH_SIZE)
+    {
+        asio::post(strand_, [self = shared_from_this()]{
+            self->flush();
+        });
+    }
+    else if (buffer_.size() == 1)
+    {
+        asio::post(strand_, [self = shared_from_this()]{
+            self->arm_timer(RECORDER_FLUSH_INTERVAL);
+        });
+    }
+}
+
+void MatchRecorder::shutdown(DrainedCallback callback)
+{
+    asio::post(strand_,
+        [self = shared_from_this(), callback = std::move(callback)]() mutable {
+
+        self->shutting_down_ = true;
+        self->drained_callback_ = std::move(callback);
+        self->timer_.cancel();
+        self->flush();
+    });
+}
+
+void MatchRecorder::arm_timer(steady_clock::duration delay)
+{
+    if (timer_armed_ || shutting_down_)
+    {
+        return;
+    }
+
+    timer_armed_ = true;
+
+    timer_.expires_after(delay);
+    timer_.async_wait(asio::bind_executor(strand_,
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+            self->timer_armed_ = false;
+
+            if (!ec)
+            {
+                self->flush();
+            }
+        }));
+}
+
+void MatchRecorder::flush()
+{
+    {
+        std::lock_guard lock(spill_mutex_);
+
+        if (!buffer_.empty())
+        {
+            seal_segment();
+            open_segment();
+
+            // Anything that failed before goes first, to keep elos in order.
+            std::move(buffer_.begin(), buffer_.end(), std::back_inserter(retry_));
+            buffer_.clear();
+        }
+
+        std::move(sealed_.begin(), sealed_.end(), std::back_inserter(retry_segments_));
+        sealed_.clear();
+    }
+
+    // Dead lettered matches count as stored, they are in their own file.
+    bool stored = retry_.empty() || store(retry_);
+
+    if (stored)
+    {
+        for (const Segment & segment : retry_segments_)
+        {
+            std::error_code ec;
+            std::filesystem::remove(segment.path, ec);
+        }
+
+        retry_segments_.clear();
+        uncertain_ = false;
+    }
+    else
+    {
+        uncertain_ = true;
+        arm_timer(RECORDER_RETRY_INTERVAL);
+    }
+
+    // The spill file keeps anything we could not store.
+    if (shutting_down_ && drained_callback_)
+    {
+        auto callback = std::move(drained_callback_);
+        drained_callback_ = nullptr;
+
+        callback();
+    }
+}
+
+bool MatchRecorder::store(std::vector<PendingMatch> & matches)
+{
+    // Parts still to write, in match order, so elos are applied in order.
+    std::deque<std::vector<PendingMatch>> parts;
+    parts.push_back(std::move(matches));
+    matches.clear();
+
+    while (!parts.empty())
+    {
+        std::vector<PendingMatch> & part = parts.front();
+        std::vector<std::tuple<boost::uuids::uuid, int, GameMode>> elos;
+
+        switch (write_batch(part, elos))
+        {
+            case WriteResult::Stored:
+            {
+                for (const auto & [user_id, elo, mode] : elos)
+                {
+                    elo_callback_(user_id, elo, mode);
+                }
+
+                parts.pop_front();
+                break;
+            }
+            case WriteResult::Rejected:
+            {
+                if (part.size() == 1)
+                {
+                    dead_letter(part.front());
+                    parts.pop_front();
+                    break;
+                }
+
+                // Retry each half, the good one commits.
+                auto middle = part.begin() + part.size() / 2;
+
+                std::vector<PendingMatch> second(std::make_move_iterator(middle),
+                                                 std::make_move_iterator(part.end()));
+                part.erase(middle, part.end());
+
+                parts.insert(parts.begin() + 1, std::move(second));
+                break;
+            }
+            case WriteResult::Unreachable:
+            {
+                for (auto & rest : parts)
+                {
+                    std::move(rest.begin(), rest.end(), std::back_inserter(matches));
+                }
+
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void MatchRecorder::dead_letter(const PendingMatch & match)
+{
+    std::string record = serialize(match);
+    std::filesystem::path path = spill_dir_ / RECORDER_DEAD_LETTER_FILE;
+
+    std::FILE * file = std::fopen(path.string().c_str(), "ab");
+
+    bool written = file
+                   && std::fwrite(record.data(), 1, record.size(), file) == record.size()
+                   && std::fflush(file) == 0;
+
+#if !defined(_WIN32)
+    if (written)
+    {
+        ::fsync(::fileno(file));
+    }
+#endif
+
+    if (file)
+    {
+        std::fclose(file);
+    }
+
+    std::string lmsg = "Match "
+                       + boost::uuids::to_string(match.record_id)
+                       + " was rejected by the database, "
+                       + (written ? "moved it to " : "and could not move it to ")
+                       + path.string()
+                       + ".";
+    Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+}
+
+MatchRecorder::WriteResult
+MatchRecorder::write_batch(std::vector<PendingMatch> & batch,
+                           std::vector<std::tuple<boost::uuids::uuid, int, GameMode>> & elos)
+{
+    auto unreachable = [this, &batch](const std::exception & e)
+    {
+        std::string lmsg = "Failed to write "
+                           + std::to_string(batch.size())
+                           + " matches, will retry: "
+                           + std::string(e.what());
+        Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+
+        // Reconnect next time, in case the connection was lost.
+        conn_.reset();
+        return WriteResult::Unreachable;
+    };
+
+    try
+    {
+        connect();
+
+        pqxx::work txn{*conn_};
+
+        if (uncertain_)
+        {
+            skip_stored(txn, batch);
+
+            if (batch.empty())
+            {
+                txn.commit();
+                return WriteResult::Stored;
+            }
+        }
+
+        auto id_res = txn.exec(pqxx::prepped{"reserve_match_ids"},
+                               pqxx::params{static_cast<int>(batch.size())});
+
+        std::vector<int64_t> match_ids;
+        match_ids.reserve(batch.size());
+
+        for (const auto & row : id_res)
+        {
+            match_ids.push_back(row["match_id"].as<int64_t>());
+        }
+
+        // Every row of this transaction gets the same finished_at.
+        auto finished_at = std::chrono::system_clock::from_time_t
+                            (
+                                id_res[0]["finished_at"].as<std::time_t>()
+                            );
+
+        // Results to write through once committed, by match then player.
+        std::vector<std::vector<MatchResultRow>> results(batch.size());
+
+        auto matches = pqxx::stream_to::table(txn,
+                                              {"matches"},
+                                              {"match_id",
+                                               "record_id",
+                                               "game_mode",
+                                               "settings",
+                                               "replay"});
+
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            matches.write_values(match_ids[i],
+                                 boost::uuids::to_string(batch[i].record_id),
+                                 static_cast<int16_t>(batch[i].mode),
+                                 batch[i].settings_json,
+                                 to_pq_bytes(batch[i].moves));
+        }
+
+        matches.complete();
+
+        auto players = pqxx::stream_to::table(txn,
+                                              {"matchplayers"},
+                                              {"match_id",
+                                               "user_id",
+                                               "player_id",
+                                               "placement"});
+
+        // Placement is N_players - elimination, see Database::do_record.
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            size_t n_players = batch[i].user_ids.size();
+
+            for (size_t p = 0; p < n_players; p++)
+            {
+                auto placement = static_cast<int16_t>(n_players
+                                                      - batch[i].elimination_order[p]);
+
+                players.write_values(match_ids[i],
+                                     boost::uuids::to_string(batch[i].user_ids[p]),
+                                     static_cast<int16_t>(p),
+                                     placement);
+
+                MatchResultRow row;
+                row.match_id = match_ids[i];
+                row.finished_at = finished_at;
+                row.placement = static_cast<uint16_t>(placement);
+                row.elo_change = 0;
+
+                results[i].push_back(row);
+            }
+        }
+
+        players.complete();
+
+        // Lock every ranked player's elo in the batch with one read.
+        using EloKey = std::pair<boost::uuids::uuid, GameMode>;
+
+        // Nullopt until read, and for players without a rating.
+        std::map<EloKey, std::optional<int>> current;
+
+        for (const PendingMatch & match : batch)
+        {
+            if (static_cast<uint8_t>(match.mode) < RANKED_MODES_START)
+            {
+                continue;
+            }
+
+            for (const auto & user_id : match.user_ids)
+            {
+                current.emplace(EloKey{user_id, match.mode}, std::nullopt);
+            }
+        }
+
+        auto write_through = [&]
+        {
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                for (size_t p = 0; p < results[i].size(); p++)
+                {
+                    history_cache_.push(batch[i].user_ids[p],
+                                        batch[i].mode,
+                                        results[i][p]);
+                }
+            }
+        };
+
+        if (current.empty())
+        {
+            txn.commit();
+            write_through();
+            return WriteResult::Stored;
+        }
+
+        std::vector<std::string> key_ids;
+        std::vector<int> key_modes;
+
+        for (const auto & [key, elo] : current)
+        {
+            key_ids.push_back(boost::uuids::to_string(key.first));
+            key_modes.push_back(static_cast<int>(key.second));
+        }
+
+        auto read_res = txn.exec(pqxx::prepped{"lock_batch_elos"},
+                                 pqxx::params{
+                                 uuid_to_pq_array(key_ids),
+                                 int_to_pq_array(key_modes)});
+
+        boost::uuids::string_generator gen;
+
+        for (const auto & row : read_res)
+        {
+            EloKey key{gen(row["user_id"].as<std::string>()),
+                       static_cast<GameMode>(row["game_mode"].as<int>())};
+
+            current[key] = row["current_elo"].as<int>();
+        }
+
+        auto history = pqxx::stream_to::table(txn,
+                                              {"elohistory"},
+                                              {"user_id",
+                                               "match_id",
+                                               "game_mode",
+                                               "old_elo",
+                                               "new_elo"});
+
+        // Apply matches in order, a player may be in more than one.
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const PendingMatch & match = batch[i];
+
+            if (static_cast<uint8_t>(match.mode) < RANKED_MODES_START)
+            {
+                continue;
+            }
+
+            size_t n_players = match.user_ids.size();
+            std::vector<std::optional<int>> current_elos(n_players);
+
+            for (size_t p = 0; p < n_players; p++)
+            {
+                current_elos[p] = current[EloKey{match.user_ids[p], match.mode}];
+            }
+
+            RecordedMatch rated{};
+            rated.match_id = match_ids[i];
+            rate_match(current_elos, match.elimination_order, rated);
+
+            const std::vector<int> & old_elos = rated.old_elos;
+            const std::vector<int> & new_elos = rated.new_elos;
+
+            for (size_t p = 0; p < n_players; p++)
+            {
+                history.write_values(boost::uuids::to_string(match.user_ids[p]),
+                                     match_ids[i],
+                                     static_cast<int>(match.mode),
+                                     old_elos[p],
+                                     new_elos[p]);
+
+                current[EloKey{match.user_ids[p], match.mode}] = new_elos[p];
+                results[i][p].elo_change = new_elos[p] - old_elos[p];
+            }
+        }
+
+        history.complete();
+
+        // Every key belongs to a ranked match, so all were rated above.
+        std::vector<int> final_elos;
+
+        for (const auto & [key, elo] : current)
+        {
+            final_elos.push_back(*elo);
+        }
+
+        txn.exec(pqxx::prepped{"upsert_batch_elos"},
+                 pqxx::params{
+                 uuid_to_pq_array(key_ids),
+                 int_to_pq_array(key_modes),
+                 int_to_pq_array(final_elos)});
+
+        txn.commit();
+        write_through();
+
+        for (const auto & [key, elo] : current)
+        {
+            elos.emplace_back(key.first, *elo, key.second);
+        }
+
+        return WriteResult::Stored;
+    }
+    // Worth retrying as is, the batch itself may be fine.
+    catch (const pqxx::broken_connection & e)
+    {
+        return unreachable(e);
+    }
+    catch (const pqxx::in_doubt_error & e)
+    {
+        return unreachable(e);
+    }
+    catch (const pqxx::transaction_rollback & e)
+    {
+        return unreachable(e);
+    }
+    catch (const std::exception & e)
+    {
+        std::string lmsg = "Database rejected "
+                           + std::to_string(batch.size())
+                           + " matches: "
+                           + std::string(e.what());
+        Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+
+        return WriteResult::Rejected;
+    }
+}
+
+void MatchRecorder::skip_stored(pqxx::work & txn, std::vector<PendingMatch> & batch)
+{
+    std::vector<std::string> record_ids;
+    record_ids.reserve(batch.size());
+
+    for (const PendingMatch & match : batch)
+    {
+        record_ids.push_back(boost::uuids::to_string(match.record_id));
+    }
+
+    auto res = txn.exec(pqxx::prepped{"find_record_ids"},
+                        pqxx::params{uuid_to_pq_array(record_ids)});
+
+    if (res.empty())
+    {
+        return;
+    }
+
+    boost::uuids::string_generator gen;
+    std::vector<boost::uuids::uuid> stored;
+
+    for (const auto & row : res)
+    {
+        stored.push_back(gen(row["record_id"].as<std::string>()));
+    }
+
+    std::erase_if(batch, [&](const PendingMatch & match)
+    {
+        return std::find(stored.begin(), stored.end(), match.record_id) != stored.end();
+    });
+}
+
+void MatchRecorder::connect()
+{
+    if (conn_ && conn_->is_open())
+    {
+        return;
+    }
+
+    conn_ = std::make_unique<pqxx::connection>(POSTGRES_CONNINFO);
+    conn_->prepare("reserve_match_ids",
+        "SELECT nextval(pg_get_serial_sequence('matches', 'match_id')) AS match_id, "
+        "FLOOR(EXTRACT(epoch from now()))::bigint AS finished_at "
+        "FROM generate_series(1, $1)"
+        );
+    conn_->prepare("find_record_ids",
+        "SELECT record_id "
+        "FROM Matches "
+        "WHERE record_id = ANY($1::uuid[])"
+        );
+    // Locked in key order, like get_elos_for_update.
+    conn_->prepare("lock_batch_elos",
+        "SELECT e.user_id, e.game_mode, e.current_elo "
+        "FROM UserElos e "
+        "JOIN unnest($1::uuid[], $2::smallint[]) AS k(user_id, game_mode) "
+        "  ON e.user_id = k.user_id AND e.game_mode = k.game_mode "
+        "ORDER BY e.user_id, e.game_mode "
+        "FOR UPDATE OF e"
+        );
+    conn_->prepare("upsert_batch_elos",
+        "INSERT INTO UserElos (user_id, game_mode, current_elo) "
+        "SELECT * FROM unnest($1::uuid[], $2::smallint[], $3::int[]) "
+        "ON CONFLICT (user_id, game_mode) "
+        "DO UPDATE SET current_elo = EXCLUDED.current_elo"
+        );
+}
+
+std::filesystem::path MatchRecorder::segment_path(uint64_t number) const
+{
+    return spill_dir_ / (std::string(SEGMENT_PREFIX)
+                         + std::to_string(number)
+                         + std::string(SEGMENT_EXTENSION));
+}
+
+void MatchRecorder::open_segment()
+{
+    std::filesystem::path path = segment_path(segment_number_);
+
+    spill_file_ = std::fopen(path.string().c_str(), "ab");
+
+    if (!spill_file_)
+    {
+        std::string lmsg = "Could not open match spill file "
+                           + path.string()
+                           + ", matches are only kept in memory.";
+        Console::instance().log(std::move(lmsg), LogLevel::ERROR);
+    }
+}
+
+void MatchRecorder::seal_segment()
+{
+    if (!spill_file_)
+    {
+        return;
+    }
+
+    std::fflush(spill_file_);
+
+#if !defined(_WIN32)
+    ::fsync(::fileno(spill_file_));
+#endif
+
+    std::fclose(spill_file_);
+    spill_file_ = nullptr;
+
+    sealed_.push_back(Segment{segment_number_, segment_path(segment_number_)});
+    segment_number_++;
+}
+
+std::string MatchRecorder::serialize(const PendingMatch & match)
+{
+    std::string payload;
+
+    payload.append(reinterpret_cast<const char *>(match.record_id.data),
+                   match.record_id.size());
+    put(payload, static_cast<uint8_t>(match.mode));
+    put(payload, static_cast<uint8_t>(match.user_ids.size()));
+
+    for (const auto & user_id : match.user_ids)
+    {
+        payload.append(reinterpret_cast<const char *>(user_id.data), user_id.size());
+    }
+
+    payload.append(reinterpret_cast<const char *>(match.elimination_order.data()),
+                   match.elimination_order.size());
+
+    put(payload, static_cast<uint32_t>(match.settings_json.size()));
+    payload.append(match.settings_json);
+    put(payload, static_cast<uint32_t>(match.moves.size()));
+    payload.append(match.moves);
+
+    // Length prefix, so a record cut short by a crash can be detected.
+    std::string record;
+    record.reserve(sizeof(uint32_t) + payload.size());
+
+    put(record, static_cast<uint32_t>(payload.size()));
+    record.append(payload);
+
+    return record;
+}
+
+std::vector<PendingMatch> MatchRecorder::read_segment(const std::filesystem::path & path)
+{
+    std::vector<PendingMatch> matches;
+
+    std::ifstream file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+
+    std::string_view in(contents);
+
+    while (!in.empty())
+    {
+        uint32_t length = 0;
+
+        if (!take(in, length) || in.size() < length)
+        {
+            Console::instance().log("Dropped a partially written match from "
+                                    + path.string(),
+                                    LogLevel::WARN);
+            break;
+        }
+
+        std::string_view payload = in.substr(0, length);
+        in.remove_prefix(length);
+
+        PendingMatch match;
+        uint8_t mode = 0;
+        uint8_t n_players = 0;
+
+        bool valid = take_uuid(payload, match.record_id)
+                     && take(payload, mode)
+                     && take(payload, n_players);
+
+        match.mode = static_cast<GameMode>(mode);
+        match.user_ids.resize(n_players);
+
+        for (size_t i = 0; valid && i < n_players; i++)
+        {
+            valid = take_uuid(payload, match.user_ids[i]);
+        }
+
+        if (valid && payload.size() >= n_players)
+        {
+            match.elimination_order.assign(payload.begin(), payload.begin() + n_players);
+            payload.remove_prefix(n_players);
+        }
+        else
+        {
+            valid = false;
+        }
+
+        valid = valid
+                && take_string(payload, match.settings_json)
+                && take_string(payload, match.moves);
+
+        // Segments spilled before replays were encoded hold JSON.
+        if (valid && match.moves.starts_with('['))
+        {
+            std::optional<std::string> moves = replay_from_json(match.moves);
+
+            valid = moves.has_value();
+            match.moves = std::move(moves).value_or(std::string{});
+        }
+
+        if (!valid)
+        {
+            Console::instance().log("Skipped a corrupt match in "
+                                    + path.string(),
+                                    LogLevel::ERROR);
+            continue;
+        }
+
+        matches.push_back(std::move(match));
+    }
+
+    return matches;
+}
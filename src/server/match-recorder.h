@@ -0,0 +1,186 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <pqxx/pqxx>
+
+#include "gamemodes.h"
+#include "match-history-cache.h"
+
+namespace asio = boost::asio;
+
+// A batch is written once this many matches are waiting...
+constexpr size_t RECORDER_BATCH_SIZE = 128;
+
+// ...or once the oldest has waited this long.
+constexpr std::chrono::milliseconds RECORDER_FLUSH_INTERVAL{20};
+
+// Wait between attempts while the database is unreachable.
+constexpr std::chrono::seconds RECORDER_RETRY_INTERVAL{5};
+
+// Matches the database refused, in the spill file format.
+constexpr std::string_view RECORDER_DEAD_LETTER_FILE = "dead-letters.spill";
+
+// A finished match, ready to be written.
+struct PendingMatch
+{
+    // Lets a replayed spill file skip matches that were already stored.
+    boost::uuids::uuid record_id;
+
+    std::vector<boost::uuids::uuid> user_ids;
+    std::vector<uint8_t> elimination_order;
+    std::string settings_json;
+
+    // Move list from encode_replay.
+    std::string moves;
+    GameMode mode;
+};
+
+// Write-behind recorder for finished matches.
+//
+// Matches are appended to a spill file as they arrive and written in
+// batches: match ids are reserved in one query, Matches, MatchPlayers
+// and EloHistory are bulk loaded with COPY, and all ranked elos are read
+// and updated with one statement each, in a single transaction. Stored
+// results are then written through to the history cache.
+//
+// The spill file is split into segments. The current segment is sealed
+// when a batch is taken, and deleted once that batch commits. Segments
+// left over from a crash are replayed on startup. A match is in the
+// file before enqueue returns, so a crash of the server loses nothing,
+// and a segment is synced to disk when sealed, so a crash of the machine
+// loses at most the matches of one flush interval.
+//
+// A batch the database rejects is split in halves until the matches at
+// fault are found. Those are appended to RECORDER_DEAD_LETTER_FILE in
+// the spill directory, so the rest can commit. Renaming that file to a
+// segment name after fixing the cause replays it on the next start.
+class MatchRecorder : public std::enable_shared_from_this<MatchRecorder>
+{
+    using steady_clock = std::chrono::steady_clock;
+
+public:
+    using EloCallback = std::function<void(boost::uuids::uuid, int, GameMode)>;
+    using DrainedCallback = std::function<void()>;
+
+    // Runs its writes on a strand of the given pool, with its own connection.
+    MatchRecorder(asio::thread_pool & pool,
+                  std::filesystem::path spill_dir,
+                  MatchHistoryCache & history_cache,
+                  EloCallback elo_callback);
+
+    ~MatchRecorder();
+
+    // Replays leftover segments, call once before enqueueing.
+    void start();
+
+    // Thread safe, the match is in the spill file when this returns.
+    void enqueue(PendingMatch match);
+
+    // Writes everything still waiting then calls back. Whatever could not
+    // be written stays in the spill file for the next start.
+    void shutdown(DrainedCallback callback);
+
+private:
+    struct Segment
+    {
+        uint64_t number;
+        std::filesystem::path path;
+    };
+
+    void arm_timer(steady_clock::duration delay);
+
+    void flush();
+
+    enum class WriteResult
+    {
+        Stored,
+        // The database refused the batch, some match in it is bad.
+        Rejected,
+        // Lost the connection, or could not tell if the commit happened.
+        Unreachable
+    };
+
+    // Writes the batch in one transaction, nothing is stored unless it
+    // returns Stored.
+    WriteResult write_batch(std::vector<PendingMatch> & batch,
+                            std::vector<std::tuple<boost::uuids::uuid, int, GameMode>> & elos);
+
+    // Writes the matches in order, splitting rejected batches and dead
+    // lettering the matches at fault. Returns false if the database was
+    // unreachable, with the matches not yet stored left in matches.
+    bool store(std::vector<PendingMatch> & matches);
+
+    void dead_letter(const PendingMatch & match);
+
+    // Drops matches whose record id is already in the database.
+    void skip_stored(pqxx::work & txn, std::vector<PendingMatch> & batch);
+
+    void connect();
+
+    std::filesystem::path segment_path(uint64_t number) const;
+
+    // Both require spill_mutex_.
+    void open_segment();
+    void seal_segment();
+
+    static std::string serialize(const PendingMatch & match);
+
+    static std::vector<PendingMatch> read_segment(const std::filesystem::path & path);
+
+private:
+    asio::strand<asio::thread_pool::executor_type> strand_;
+    asio::steady_timer timer_;
+
+    std::filesystem::path spill_dir_;
+    MatchHistoryCache & history_cache_;
+    EloCallback elo_callback_;
+
+    // Guards everything the callers of enqueue touch.
+    std::mutex spill_mutex_;
+    std::FILE * spill_file_{nullptr};
+    uint64_t segment_number_{0};
+    std::vector<PendingMatch> buffer_;
+    std::vector<Segment> sealed_;
+
+    // Strand only.
+    std::unique_ptr<pqxx::connection> conn_;
+    // Matches taken from the buffer but not yet stored, and their files.
+    std::vector<PendingMatch> retry_;
+    std::vector<Segment> retry_segments_;
+
+    // Set when an earlier attempt may have committed without us knowing.
+    bool uncertain_{false};
+    bool timer_armed_{false};
+    bool shutting_down_{false};
+    DrainedCallback drained_callback_;
+};
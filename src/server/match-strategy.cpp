@@ -290,15 +290,14 @@ void CasualFivePlayerStrategy::try_form_match()
     }
 }
 
-// Ranked 1 vs 1 strategy. Uses a bucket based matching system.
+// Ranked 1 vs 1 strategy. Matches players by elo window, see RankedQueue.
 RankedTwoPlayerStrategy::RankedTwoPlayerStrategy(
                         boost::asio::io_context & cntx,
                         MakeMatchCallback on_match_ready,
                         const std::shared_ptr<MapRepository> & map_repo)
 :strand_(cntx.get_executor()),
 on_match_ready_(std::move(on_match_ready)),
-map_repo_(map_repo),
-elo_buckets_(NUM_BUCKETS + 1)
+map_repo_(map_repo)
 {
 }
 
@@ -308,25 +307,12 @@ void RankedTwoPlayerStrategy::enqueue(Session::ptr p)
         [this, p] {
 
         auto data = p->get_user_data();
+        auto now = std::chrono::steady_clock::now();
 
-        boost::uuids::uuid user_id = data.user_id;
-
-        // if the lookup does not find this session enqueued already
-        if (lookup_.find(user_id) == lookup_.end())
+        // if the queue does not have this session enqueued already
+        if (queue_.insert(p, data.get_elo(curr_gamemode), now))
         {
-            auto now = std::chrono::steady_clock::now();
-            size_t bucket_index = elo_to_bucket_index
-                                    (
-                                        data.get_elo(curr_gamemode)
-                                    );
-
-            // Insert the queue entry into the proper bucket and get
-            // the iterator back.
-            elo_buckets_[bucket_index].push_back({p, now});
-            auto iter = std::prev(elo_buckets_[bucket_index].end());
-
-            // Insert the lookup data.
-            lookup_[user_id] = {bucket_index, iter};
+            try_form_match(data.user_id, now);
         }
 
     });
@@ -336,143 +322,50 @@ void RankedTwoPlayerStrategy::cancel(Session::ptr p)
 {
     asio::post(strand_, [this, p]{
 
-        boost::uuids::uuid user_id = p->get_user_data().user_id;
-
-        auto lookup_itr = lookup_.find(user_id);
-
-        // If entry exists, remove it.
-        if (lookup_itr != lookup_.end())
-        {
-            // Grab the list iterator and bucket from the lookup for erasing.
-            LookupData data = lookup_itr->second;
-            elo_buckets_[data.bucket_index].erase(data.iter);
-
-            // Also remove the lookup entry after we're done.
-            lookup_.erase(lookup_itr);
-        }
+        queue_.erase(p->get_user_data().user_id);
 
     });
 }
 
-// Simply call our try_form_match on each tick by the match maker.
+// Windows only change on ticks, so only recheck players whose window grew.
 void RankedTwoPlayerStrategy::tick()
 {
     asio::post(strand_, [this]{
 
-        try_form_match();
-
-    });
-}
+        auto now = std::chrono::steady_clock::now();
 
-// Compute the current time, pass through each bucket, and match players
-// to their closest valid opponent.
-//
-// Must be called within a stranded function such as tick().
-void RankedTwoPlayerStrategy::try_form_match()
-{
-    auto now = std::chrono::steady_clock::now();
-    // Progress from the highest elo bucket to the lowest, attempting
-    // to match players versus one another.
-    //
-    // We would prefer to give higher elo players the first chance at
-    // matching.
-    for (int i = elo_buckets_.size() - 1; i >= 0; i--)
-    {
-        auto & bucket = elo_buckets_[i];
-
-        // If this bucket cannot instantly be matched, see if we
-        // can look for neighbors.
-        if (bucket.size() < 2)
+        for (const auto & user_id : queue_.widened(now))
         {
-            // If the bucket is empty, just continue.
-            if (bucket.empty())
+            // May have been matched earlier in this loop.
+            if (queue_.contains(user_id))
             {
-                continue;
-            }
-
-            // Pop the first entry, they have been waiting the
-            // longest time in this bucket.
-            auto & entry = bucket.front();
-            auto wait_time = now - entry.enqueued_at;
-            auto increments = wait_time / BUCKET_INCREMENT_TIME;
-
-            // Get size_t from our computation. This should always
-            // be rounded down since the difference will be positive.
-            //
-            // NOTE: This means the window delta is based on the oldest
-            // player in the queue, so a new person who queues may be matched
-            // with someone with a larger elo than expected. We could
-            // consider checking that the windows overlap instead
-            // if this turns out to be problematic.
-            size_t delta = static_cast<size_t>(increments);
-
-            // Enforce delta bounds
-            if (delta > MAX_BUCKETS_DIFF)
-            {
-                delta = MAX_BUCKETS_DIFF;
+                try_form_match(user_id, now);
             }
+        }
 
-            // If player has not been queued for enough time, skip.
-            if (delta == 0)
-            {
-                continue;
-            }
+    });
+}
 
-            // Now search +/- radius buckets for a match.
-            for (size_t radius = 1; radius <= delta; radius++)
-            {
-                // First, lower bucket candidate.
-                if (i >= static_cast<int>(radius)
-                    && !elo_buckets_[i - radius].empty())
-                {
-                    match_and_remove(bucket.begin()->session,
-                                     elo_buckets_[i - radius].begin()->session);
-                    break;
-                }
-
-                // Now, upper bucket candidate.
-                if (i + static_cast<int>(radius) <= NUM_BUCKETS
-                    && !elo_buckets_[i + radius].empty())
-                {
-                    match_and_remove(bucket.begin()->session,
-                                     elo_buckets_[i + radius].begin()->session);
-                    break;
-                }
-            }
+// Must be called within a stranded function such as tick().
+void RankedTwoPlayerStrategy::try_form_match(const boost::uuids::uuid & user_id,
+                                             std::chrono::steady_clock::time_point now)
+{
+    auto opponent = queue_.best_opponent(user_id, now);
 
-            // If no match was found, just continue to the next bucket.
-            // We will need to have this player wait.
-            continue;
-        }
-        // Base case, there is at least 2 players in the bucket.
-        else
-        {
-            // Match players from the bucket until there are no more pairs.
-            while (bucket.size() >= 2)
-            {
-                match_and_remove(bucket.begin()->session,
-                                 std::next(bucket.begin())->session);
-            }
-        }
+    if (opponent)
+    {
+        match_and_remove(user_id, *opponent);
     }
 }
 
-void RankedTwoPlayerStrategy::match_and_remove(Session::ptr p1,
-                                               Session::ptr p2)
+void RankedTwoPlayerStrategy::match_and_remove(const boost::uuids::uuid & p1,
+                                               const boost::uuids::uuid & p2)
 {
-    auto p1_uuid = p1->get_user_data().user_id;
-    auto p2_uuid = p2->get_user_data().user_id;
-
-    // Remove from buckets and lookup.
-    auto p1_look = lookup_.find(p1_uuid);
-    auto p2_look = lookup_.find(p2_uuid);
-
-    // Erase p2 first because of iterator order. p2 is std::next of p1.
-    elo_buckets_[p2_look->second.bucket_index].erase(p2_look->second.iter);
-    elo_buckets_[p1_look->second.bucket_index].erase(p1_look->second.iter);
+    Session::ptr s1 = queue_.find(p1)->session;
+    Session::ptr s2 = queue_.find(p2)->session;
 
-    lookup_.erase(p1_look);
-    lookup_.erase(p2_look);
+    queue_.erase(p1);
+    queue_.erase(p2);
 
     // Get a random map and setup match settings.
     GameMap map = map_repo_->get_random_map
@@ -485,24 +378,99 @@ void RankedTwoPlayerStrategy::match_and_remove(Session::ptr p1,
                            increment_ms,
                            GameMode::RankedTwoPlayer);
 
-    on_match_ready_(std::vector<Session::ptr>{p1, p2}, settings);
+    on_match_ready_(std::vector<Session::ptr>{s1, s2}, settings);
 
 }
 
-size_t RankedTwoPlayerStrategy::elo_to_bucket_index(int elo)
+// Ranked free for all strategy. Matches groups by elo window, see RankedQueue.
+RankedGroupStrategy::RankedGroupStrategy(
+                        boost::asio::io_context & cntx,
+                        MakeMatchCallback on_match_ready,
+                        const std::shared_ptr<MapRepository> & map_repo,
+                        GameMode mode)
+:strand_(cntx.get_executor()),
+on_match_ready_(std::move(on_match_ready)),
+map_repo_(map_repo),
+mode_(mode),
+group_size_(players_for_gamemode[static_cast<uint8_t>(mode)])
 {
-    // If greater than our max bucket, put into overflow bucket.
-    if (elo >= MAX_ELO_BUCKET)
-    {
-        return NUM_BUCKETS;
-    }
-    else if (elo < ELO_FLOOR)
+}
+
+void RankedGroupStrategy::enqueue(Session::ptr p)
+{
+    asio::post(strand_,
+        [this, p] {
+
+        auto data = p->get_user_data();
+        auto now = std::chrono::steady_clock::now();
+
+        // if the queue does not have this session enqueued already
+        if (queue_.insert(p, data.get_elo(mode_), now))
+        {
+            try_form_match(data.user_id, now);
+        }
+
+    });
+}
+
+void RankedGroupStrategy::cancel(Session::ptr p)
+{
+    asio::post(strand_, [this, p]{
+
+        queue_.erase(p->get_user_data().user_id);
+
+    });
+}
+
+// Windows only change on ticks, so only recheck players whose window grew.
+void RankedGroupStrategy::tick()
+{
+    asio::post(strand_, [this]{
+
+        auto now = std::chrono::steady_clock::now();
+
+        for (const auto & user_id : queue_.widened(now))
+        {
+            // May have been matched earlier in this loop.
+            if (queue_.contains(user_id))
+            {
+                try_form_match(user_id, now);
+            }
+        }
+
+    });
+}
+
+// Must be called within a stranded function such as tick().
+void RankedGroupStrategy::try_form_match(const boost::uuids::uuid & user_id,
+                                         std::chrono::steady_clock::time_point now)
+{
+    auto group = queue_.best_group(user_id, group_size_, now);
+
+    if (!group.empty())
     {
-        return 0;
+        match_and_remove(group);
     }
-    else
+}
+
+void RankedGroupStrategy::match_and_remove(const std::vector<boost::uuids::uuid> & group)
+{
+    std::vector<Session::ptr> players;
+    players.reserve(group.size());
+
+    for (const auto & user_id : group)
     {
-        // This implicitly takes the floor.
-        return (elo - ELO_FLOOR) / BUCKET_SIZE;
+        players.push_back(queue_.find(user_id)->session);
+        queue_.erase(user_id);
     }
+
+    // Get a random map and setup match settings.
+    GameMap map = map_repo_->get_random_map(static_cast<uint8_t>(mode_));
+
+    MatchSettings settings(map,
+                           initial_time_ms,
+                           increment_ms,
+                           mode_);
+
+    on_match_ready_(std::move(players), settings);
 }
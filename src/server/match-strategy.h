@@ -29,6 +29,7 @@
 #include "map-repository.h"
 #include "match-settings.h"
 #include "elo-updates.h"
+#include "ranked-queue.h"
 
 class IMatchStrategy
 {
@@ -191,59 +192,69 @@ private:
 
 // Ranked 1 vs 1 queue.
 //
-// We use bucket based match making for ranked queues. The elo range
-// [ELO_FLOOR, MAX_ELO_BUCKET) is sliced up into buckets, with an extra bucket
-// for everyone with elo at or equal to MAX_ELO_BUCKET.
+// Players are kept in a RankedQueue ordered by elo. Each player accepts
+// opponents within an elo window that widens the longer they wait, and a
+// match needs both players to be inside each other's window.
 //
-// Players are matched up within their bucket whenever possible. Otherwise,
-// if a bucket B_i has only one player, we scan the buckets B_(i-delta) through
-// B_(i+delta) where delta depends on the time a player spends in the queue.
-//
-// So with min = 500, bucket size 25, the bucket B_0 has range [500, 525),
-// bucket B_1 has range [525, 550), etc.
-//
-// To compute the index given elo, we use (elo - MIN_ELO) / (BUCKET_SIZE)
-// and take the floor.
+// Players are matched to their closest acceptable opponent as soon as
+// they enqueue. The match maker tick only rechecks the players whose
+// window has grown since the last tick.
 class RankedTwoPlayerStrategy : public IMatchStrategy
 {
 public:
-    struct QueueEntry
-    {
-        Session::ptr session;
-        std::chrono::steady_clock::time_point enqueued_at;
-    };
+    inline static constexpr GameMode curr_gamemode = GameMode::RankedTwoPlayer;
 
-    struct LookupData
-    {
-        size_t bucket_index;
-        std::list<QueueEntry>::iterator iter;
-    };
+public:
+    RankedTwoPlayerStrategy(boost::asio::io_context & cntx,
+                            MakeMatchCallback on_match_ready,
+                            const std::shared_ptr<MapRepository> & map_repo);
 
-    // Set the cutoff for when elo  gets put into the last bucket.
-    inline static constexpr int MAX_ELO_BUCKET = 3000;
+    void enqueue(Session::ptr p) override;
 
-    // Compute ranges, get bucket size.
-    inline static constexpr int ELO_RANGE = MAX_ELO_BUCKET - ELO_FLOOR;
-    inline static constexpr int NUM_BUCKETS = 100;
-    inline static constexpr int BUCKET_SIZE = ELO_RANGE / NUM_BUCKETS;
+    void cancel(Session::ptr p) override;
 
-    // Enforce bounds on bucket searching.
-    inline static constexpr int MAX_ELO_DIFF = 400;
-    inline static constexpr int MAX_BUCKETS_DIFF = MAX_ELO_DIFF / BUCKET_SIZE;
+    // Handle logic on each matching tick.
+    void tick() override;
 
-    // Update bounds every 30 seconds.
-    inline static constexpr std::chrono::seconds BUCKET_INCREMENT_TIME{15};
+private:
+    // Match the player with their best opponent, if there is one.
+    void try_form_match(const boost::uuids::uuid & user_id,
+                        std::chrono::steady_clock::time_point now);
 
-    inline static constexpr GameMode curr_gamemode = GameMode::RankedTwoPlayer;
+    void match_and_remove(const boost::uuids::uuid & p1,
+                          const boost::uuids::uuid & p2);
 
-    // Ensure divisibility.
-    static_assert(ELO_RANGE % NUM_BUCKETS == 0);
-    static_assert(MAX_ELO_DIFF % BUCKET_SIZE == 0);
+public:
+    // 20 minute clock
+    inline static constexpr uint64_t initial_time_ms = 1200000;
+    // 1 second increment
+    inline static constexpr uint64_t increment_ms = 1000;
 
+private:
+    // Strand for this game mode to manage async queue/cancel attempts
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+
+    // Callback to MatchMaker's make_match_on_strand function.
+    MakeMatchCallback on_match_ready_;
+
+    const std::shared_ptr<MapRepository> & map_repo_;
+
+    RankedQueue queue_;
+};
+
+// Ranked free for all queue, for any mode with more than two players.
+//
+// Uses the same RankedQueue as the 1 vs 1 queue, but forms the tightest
+// group where every player is inside every other player's window, see
+// RankedQueue::best_group. Groups are formed on enqueue, and on ticks
+// for players whose window has grown.
+class RankedGroupStrategy : public IMatchStrategy
+{
 public:
-    RankedTwoPlayerStrategy(boost::asio::io_context & cntx,
-                            MakeMatchCallback on_match_ready,
-                            const std::shared_ptr<MapRepository> & map_repo);
+    RankedGroupStrategy(boost::asio::io_context & cntx,
+                        MakeMatchCallback on_match_ready,
+                        const std::shared_ptr<MapRepository> & map_repo,
+                        GameMode mode);
 
     void enqueue(Session::ptr p) override;
 
@@ -253,11 +264,11 @@ public:
     void tick() override;
 
 private:
-    void try_form_match();
+    // Form a group around the player, if there is one.
+    void try_form_match(const boost::uuids::uuid & user_id,
+                        std::chrono::steady_clock::time_point now);
 
-    void match_and_remove(Session::ptr p1, Session::ptr p2);
-
-    size_t elo_to_bucket_index(int elo);
+    void match_and_remove(const std::vector<boost::uuids::uuid> & group);
 
 public:
     // 20 minute clock
@@ -274,11 +285,8 @@ private:
 
     const std::shared_ptr<MapRepository> & map_repo_;
 
-    // Members for matching players.
-    std::vector<std::list<QueueEntry>> elo_buckets_;
+    const GameMode mode_;
+    const size_t group_size_;
 
-    // Map from UUID to the respective bucket index and list iterator.
-    std::unordered_map<boost::uuids::uuid,
-                       LookupData,
-                       boost::hash<boost::uuids::uuid>> lookup_;
+    RankedQueue queue_;
 };
@@ -0,0 +1,1388 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#include "postgres-storage.h"
+#include "elo-updates.h"
+#include "replay-codec.h"
+#include "console.h"
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <pqxx/strconv.hxx>
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+// One connection to the database per thread in the database pool.
+static thread_local std::unique_ptr<pqxx::connection> conn_;
+
+// Utility to turn timepoint into a string for the database.
+static std::string timepoint_to_string(std::chrono::system_clock::time_point banned_until)
+{
+    // prepare time point for DB insertion
+    auto tt = std::chrono::system_clock::to_time_t(banned_until);
+    std::tm tm_utc;
+
+    // We need different time conversion (thread safe)
+    // functions for different platforms.
+#if defined(_WIN32) || defined(_WIN64)
+    gmtime_s(&tm_utc, &tt);
+#else
+    gmtime_r(&tt, &tm_utc);
+#endif
+
+    std::ostringstream oss;
+    oss << std::put_time(&tm_utc, "%Y-%m-%dT%H:%M:%S");
+
+    std::string banned_until_str = oss.str();
+
+    banned_until_str += "Z";
+
+    return banned_until_str;
+}
+
+// Manually convert a vector of UUID strings to data for postgre to use.
+//
+// This could be replaced if using a new version of libpqxx that supports
+// passing in std::vector<std::string> but otherwise this is necessary.
+//
+// This function should not be called for any arbitrary data, only UUIDs.
+std::string uuid_to_pq_array(const std::vector<std::string> & user_id_strs)
+{
+    std::string result = "{";
+    for (size_t i = 0; i < user_id_strs.size(); i++)
+    {
+        result += "\"" + user_id_strs[i] + "\"";
+        if (i + 1 < user_id_strs.size())
+        {
+            result += ",";
+        }
+    }
+
+    result += "}";
+    return result;
+}
+
+// Convert a vector of integers to an array literal for postgre to use.
+std::string int_to_pq_array(const std::vector<int> & values)
+{
+    std::string result = "{";
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        result += std::to_string(values[i]);
+        if (i + 1 < values.size())
+        {
+            result += ",";
+        }
+    }
+
+    result += "}";
+    return result;
+}
+
+// Match ids for an ANY($1::bigint[]) parameter.
+static std::string bigint_to_pq_array(const std::vector<int64_t> & values)
+{
+    std::string result = "{";
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        result += std::to_string(values[i]);
+        if (i + 1 < values.size())
+        {
+            result += ",";
+        }
+    }
+
+    result += "}";
+    return result;
+}
+
+pqxx::bytes to_pq_bytes(std::string_view data)
+{
+    return pqxx::bytes(reinterpret_cast<const std::byte*>(data.data()), data.size());
+}
+
+// Read only queries served by the non-blocking connections.
+static PgStatements async_statements()
+{
+    return {
+        {"fetch_blocks",
+         "SELECT b.blocked AS user_id, u.username AS username "
+         "FROM BlockedUsers b JOIN Users u ON u.user_id = b.blocked "
+         "WHERE b.blocker = $1"},
+        {"fetch_friends",
+         "SELECT (CASE "
+         "WHEN f.user_a = $1 THEN f.user_b "
+         "ELSE f.user_a "
+         "END) AS friend_id, u.username AS username "
+         "FROM Friends f "
+         "JOIN Users u "
+         "ON u.user_id = (CASE WHEN f.user_a = $1 THEN f.user_b "
+         "ELSE f.user_a END) "
+         "WHERE user_a = $1 OR user_b = $1"},
+        {"fetch_friend_requests",
+         "SELECT fr.sender AS user_id, u.username AS username "
+         "FROM FriendRequests fr JOIN Users u ON u.user_id = fr.sender "
+         "WHERE receiver = $1"},
+        {"fetch_latest_matches",
+         "SELECT m.match_id, "
+         "FLOOR(EXTRACT(epoch from m.finished_at))::bigint as finished_at, "
+         "mp.placement, "
+         "COALESCE(eh.elo_change, 0) AS elo_change "
+         "FROM MatchPlayers mp JOIN Matches m ON m.match_id = mp.match_id "
+         "LEFT JOIN LATERAL ( "
+         "SELECT (new_elo - old_elo) AS elo_change "
+         "FROM EloHistory eh "
+         "WHERE eh.match_id = m.match_id "
+         "AND eh.user_id = mp.user_id "
+         "AND eh.game_mode = m.game_mode "
+         "ORDER BY history_id DESC "
+         "LIMIT 1 "
+         ") eh ON true "
+         "WHERE mp.user_id = $1::uuid "
+         "AND mp.match_id < $3::bigint "
+         "AND m.game_mode = $2::int "
+         "ORDER BY mp.match_id DESC "
+         "LIMIT $4"},
+        {"fetch_replay",
+         "SELECT replay, move_history, archive_segment, settings "
+         "FROM Matches "
+         "WHERE match_id = $1"},
+        {"fetch_match_users",
+         "SELECT u.user_id, u.username, mp.player_id "
+         "FROM MatchPlayers mp "
+         "JOIN Users u ON u.user_id = mp.user_id "
+         "WHERE mp.match_id = $1 "
+         "ORDER BY mp.player_id"}
+    };
+}
+
+PostgresStorage::PostgresStorage(asio::io_context & io, std::string archive_dir)
+:async_db_(io, POSTGRES_CONNINFO, async_statements())
+{
+    if (!archive_dir.empty())
+    {
+        archive_ = std::make_unique<ReplayArchive>(std::move(archive_dir));
+    }
+}
+
+std::string PostgresStorage::name() const
+{
+    return "postgres";
+}
+
+bool PostgresStorage::supports_write_behind() const
+{
+    return true;
+}
+
+std::unordered_map<std::string, std::chrono::system_clock::time_point>
+PostgresStorage::load_ip_bans()
+{
+    std::unordered_map<std::string, std::chrono::system_clock::time_point>
+    map;
+
+    // Not a pool thread, so do not leave a connection behind.
+    pqxx::connection temp_conn{POSTGRES_CONNINFO};
+
+    pqxx::work txn{temp_conn};
+    // Get the time in terms of the unix epoch
+    auto res = txn.exec(
+        "SELECT ip, (extract(epoch FROM banned_until)*1000)::bigint AS banned_ms "
+        "FROM BannedIPs");
+
+    // For row in rows essentially.
+    for (const auto & row : res)
+    {
+        std::string ip = row["ip"].c_str();
+
+        auto ms = row["banned_ms"].as<long long>();
+
+        auto timepoint = std::chrono::system_clock::time_point{
+                                std::chrono::milliseconds(ms)
+                                };
+        map.emplace(std::move(ip), timepoint);
+    }
+
+    return map;
+}
+
+void PostgresStorage::load_ratings(const RatingVisitor & visit)
+{
+    // Not a pool thread, so do not leave a connection behind.
+    pqxx::connection temp_conn{POSTGRES_CONNINFO};
+
+    pqxx::nontransaction txn{temp_conn};
+    boost::uuids::string_generator gen;
+
+    // Streamed with COPY, there is a row per user and ranked mode.
+    for (auto [user_id, username, mode, elo]
+         : txn.stream<std::string_view, std::string_view, int, int>(
+               "SELECT ue.user_id, u.username, ue.game_mode, ue.current_elo "
+               "FROM UserElos ue "
+               "JOIN Users u ON u.user_id = ue.user_id"))
+    {
+        visit(gen(user_id.begin(), user_id.end()),
+              std::string(username),
+              static_cast<GameMode>(mode),
+              elo);
+    }
+}
+
+std::optional<LoginRecord> PostgresStorage::find_login(const std::string & username)
+{
+    // One statement, no need for BEGIN and COMMIT round trips.
+    pqxx::nontransaction txn{connection()};
+    auto res = txn.exec(pqxx::prepped{"auth"},
+                        pqxx::params{username});
+
+    if (res.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto row = res[0];
+
+    LoginRecord record{};
+
+    boost::uuids::string_generator gen;
+    record.user_id = gen(row["user_id"].as<std::string>());
+
+    // Banned users are turned away before their hash is needed.
+    if (!row["banned_ms"].is_null())
+    {
+        auto ms = row["banned_ms"].as<long long>();
+
+        record.banned_until = std::chrono::system_clock::time_point
+                                {
+                                    std::chrono::milliseconds(ms)
+                                };
+        record.ban_reason = row["reason"].as<std::string>();
+
+        return record;
+    }
+
+    auto hash_bytes = row["hash"].as<pqxx::bytes>();
+    auto salt_bytes = row["salt"].as<pqxx::bytes>();
+
+    if (hash_bytes.size() != HASH_LENGTH ||
+        salt_bytes.size() != SALT_LENGTH)
+    {
+        throw StorageError("DB call had wrong hashing lengths! "
+                           + std::to_string(hash_bytes.size())
+                           + " "
+                           + std::to_string(salt_bytes.size()));
+    }
+
+    std::copy
+    (
+        reinterpret_cast<uint8_t *>(hash_bytes.data()),
+        reinterpret_cast<uint8_t *>(hash_bytes.data() + hash_bytes.size()),
+        record.hash.begin()
+    );
+
+    std::copy
+    (
+        reinterpret_cast<uint8_t *>(salt_bytes.data()),
+        reinterpret_cast<uint8_t *>(salt_bytes.data() + salt_bytes.size()),
+        record.salt.begin()
+    );
+
+    return record;
+}
+
+LoginData PostgresStorage::login(const boost::uuids::uuid & user_id,
+                                 const std::string & ip)
+{
+    // Update the user's login history and grab their
+    // relations and elos, all in one statement.
+    pqxx::nontransaction txn{connection()};
+
+    auto login_res = txn.exec(pqxx::prepped{"login_user"},
+                              pqxx::params{
+                              ip,
+                              boost::uuids::to_string(user_id)});
+
+    LoginData data;
+    boost::uuids::string_generator gen;
+
+    for (const auto & row : login_res)
+    {
+        std::string kind = row["kind"].as<std::string>();
+
+        if (kind == "friend")
+        {
+            data.friends.push_back(gen(row["other_id"].as<std::string>()));
+        }
+        else if (kind == "block")
+        {
+            data.blocks.push_back(gen(row["other_id"].as<std::string>()));
+        }
+        else
+        {
+            data.elos.emplace_back(static_cast<uint8_t>(row["game_mode"].as<int>()),
+                                   row["current_elo"].as<int>());
+        }
+    }
+
+    return data;
+}
+
+bool PostgresStorage::create_user(const boost::uuids::uuid & user_id,
+                                  const std::string & username,
+                                  const std::array<uint8_t, HASH_LENGTH> & hash,
+                                  const std::array<uint8_t, SALT_LENGTH> & salt,
+                                  const std::string & ip)
+{
+    try
+    {
+        pqxx::work txn{connection()};
+
+        txn.exec(
+            pqxx::prepped{"reg"},
+            pqxx::params{
+            boost::uuids::to_string(user_id),
+            username,
+            pqxx::bytes(reinterpret_cast<const std::byte*>(hash.data()), hash.size()),
+            pqxx::bytes(reinterpret_cast<const std::byte*>(salt.data()), salt.size()),
+            ip
+            });
+
+        // Create initial elo entries for the user.
+        for (uint8_t mode = RANKED_MODES_START;
+             mode < static_cast<uint8_t>(GameMode::NO_MODE);
+             mode++)
+        {
+            txn.exec(pqxx::prepped{"add_user_elos"},
+                     pqxx::params{
+                     boost::uuids::to_string(user_id),
+                     static_cast<int16_t>(mode),
+                     DEFAULT_ELO});
+        }
+
+        txn.commit();
+    }
+    catch (const pqxx::unique_violation &)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+RecordedMatch PostgresStorage::record_match(const MatchWrite & match)
+{
+    size_t N_players = match.user_ids.size();
+
+    std::vector<std::string> user_id_strs;
+    user_id_strs.reserve(N_players);
+
+    // Go through the array (type is boost uuid) and
+    // create a string from the user IDs.
+    for (const auto & uuid : match.user_ids)
+    {
+        user_id_strs.push_back(boost::uuids::to_string(uuid));
+    }
+
+    std::vector<int> player_ids(N_players);
+
+    for (size_t i = 0; i < N_players; i++)
+    {
+        player_ids[i] = static_cast<int>(i);
+    }
+
+    // Manually turn these into arrays of values.
+    std::string user_id_array = uuid_to_pq_array(user_id_strs);
+
+    // The whole recording is one transaction of at most three
+    // statements, no matter how many players were in the match.
+    pqxx::work txn{connection()};
+
+    // Insert the match and all of its players at once.
+    auto res_m_id = txn.exec(
+        pqxx::prepped{"insert_match_players"},
+        pqxx::params{
+        static_cast<int16_t>(match.mode),
+        match.settings_json,
+        to_pq_bytes(match.moves),
+        user_id_array,
+        int_to_pq_array(player_ids),
+        int_to_pq_array(match.placements)}
+    );
+
+    RecordedMatch recorded;
+
+    recorded.match_id = res_m_id[0]["match_id"].as<int64_t>();
+
+    recorded.finished_at = std::chrono::system_clock::from_time_t
+                            (
+                                res_m_id[0]["finished_at"].as<std::time_t>()
+                            );
+
+    // Next, we decide if we need to change the player
+    // elos and if so we fetch the player's current ratings.
+    if (static_cast<uint8_t>(match.mode) >= RANKED_MODES_START)
+    {
+        // Lock the rows we read, so that nothing can change
+        // them between this read and our update below.
+        auto read_res = txn.exec(pqxx::prepped{"get_elos_for_update"},
+                                 pqxx::params{
+                                 user_id_array,
+                                 static_cast<int16_t>(match.mode)});
+
+        // We map UUID to index and then fill in the elos we found.
+        std::unordered_map<boost::uuids::uuid,
+                           size_t,
+                           boost::hash<boost::uuids::uuid>> player_idx;
+        player_idx.reserve(N_players);
+
+        for (size_t i = 0; i < N_players; i++)
+        {
+            player_idx.emplace(match.user_ids[i], i);
+        }
+
+        boost::uuids::string_generator gen;
+        std::vector<std::optional<int>> current(N_players);
+
+        for (const auto & row : read_res)
+        {
+            auto idx_it = player_idx.find(gen(row["user_id"].as<std::string>()));
+
+            // This should never fail, because we only found
+            // rows based on our input UUIDs.
+            if (idx_it != player_idx.end())
+            {
+                current[idx_it->second] = row["current_elo"].as<int>();
+            }
+        }
+
+        rate_match(current, match.elimination_order, recorded);
+
+        // Record the history and update every player's elo at once.
+        txn.exec(pqxx::prepped{"record_elos"},
+                 pqxx::params{
+                 user_id_array,
+                 recorded.match_id,
+                 static_cast<int16_t>(match.mode),
+                 int_to_pq_array(recorded.old_elos),
+                 int_to_pq_array(recorded.new_elos)});
+    }
+
+    txn.commit();
+
+    return recorded;
+}
+
+void PostgresStorage::ban_ip(const std::string & ip,
+                             std::chrono::system_clock::time_point banned_until)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"ban_ip"},
+             pqxx::params{
+             ip,
+             timepoint_to_string(banned_until)});
+
+    txn.commit();
+}
+
+void PostgresStorage::unban_ip(const std::string & ip)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"unban_ip"},
+             pqxx::params{
+             ip});
+
+    txn.commit();
+}
+
+std::optional<boost::uuids::uuid>
+PostgresStorage::find_user_id(const std::string & username)
+{
+    pqxx::nontransaction txn{connection()};
+
+    auto user_res = txn.exec(pqxx::prepped{"find_uuid"},
+                             pqxx::params{
+                             username});
+
+    if (user_res.empty())
+    {
+        return std::nullopt;
+    }
+
+    boost::uuids::string_generator gen;
+
+    return gen(user_res[0]["user_id"].as<std::string>());
+}
+
+void PostgresStorage::ban_user(const boost::uuids::uuid & user_id,
+                               std::chrono::system_clock::time_point banned_until,
+                               const std::string & reason)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"ban_user"},
+             pqxx::params{
+             boost::uuids::to_string(user_id),
+             timepoint_to_string(banned_until),
+             reason});
+
+    txn.commit();
+}
+
+void PostgresStorage::unban_user(uint64_t ban_id)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"unban_user"},
+             pqxx::params{
+             static_cast<int64_t>(ban_id)});
+
+    txn.commit();
+}
+
+bool PostgresStorage::send_friend_request(const boost::uuids::uuid & sender,
+                                          const boost::uuids::uuid & receiver,
+                                          int max_pending)
+{
+    pqxx::work txn{connection()};
+
+    std::string sender_str = boost::uuids::to_string(sender);
+    std::string receiver_str = boost::uuids::to_string(receiver);
+
+    // Check if the sender is blocked by the receiver.
+    auto blocked_res = txn.exec(pqxx::prepped{"check_blocked"},
+                                pqxx::params{
+                                sender_str,
+                                receiver_str});
+
+    if (!blocked_res.empty())
+    {
+        txn.commit();
+        return false;
+    }
+
+    // Check if they are already friends.
+    auto friends_res = txn.exec(pqxx::prepped{"check_friends"},
+                                pqxx::params{
+                                sender_str,
+                                receiver_str});
+
+    if (!friends_res.empty())
+    {
+        txn.commit();
+        return false;
+    }
+
+    // If a friend request already exists, this will
+    // simply do nothing.
+    txn.exec(pqxx::prepped{"friend_request"},
+             pqxx::params{
+             sender_str,
+             receiver_str,
+             max_pending});
+
+    txn.commit();
+
+    return true;
+}
+
+std::optional<std::string>
+PostgresStorage::accept_friend_request(const boost::uuids::uuid & receiver,
+                                       const boost::uuids::uuid & sender)
+{
+    pqxx::work txn{connection()};
+
+    std::string sender_str = boost::uuids::to_string(sender);
+    std::string receiver_str = boost::uuids::to_string(receiver);
+
+    // Check if this friend request exists.
+    auto req_res = txn.exec(pqxx::prepped{"find_friend_request"},
+                            pqxx::params{
+                            receiver_str,
+                            sender_str});
+
+    if (req_res.empty())
+    {
+        txn.commit();
+        return std::nullopt;
+    }
+
+    txn.exec(pqxx::prepped{"accept_friend"},
+             pqxx::params{
+             receiver_str,
+             sender_str});
+
+    txn.exec(pqxx::prepped{"delete_friend_request"},
+             pqxx::params{
+             sender_str,
+             receiver_str});
+
+    auto f_res = txn.exec(pqxx::prepped{"find_username"},
+                          pqxx::params{
+                          sender_str});
+
+    txn.commit();
+
+    return f_res.empty() ? std::string{} : f_res[0]["username"].as<std::string>();
+}
+
+void PostgresStorage::decline_friend_request(const boost::uuids::uuid & receiver,
+                                             const boost::uuids::uuid & sender)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"delete_friend_request"},
+             pqxx::params{
+             boost::uuids::to_string(sender),
+             boost::uuids::to_string(receiver)});
+
+    txn.commit();
+}
+
+void PostgresStorage::block_user(const boost::uuids::uuid & blocker,
+                                 const boost::uuids::uuid & blocked)
+{
+    pqxx::work txn{connection()};
+
+    std::string blocker_str = boost::uuids::to_string(blocker);
+    std::string blocked_str = boost::uuids::to_string(blocked);
+
+    // Block the user, idempotent.
+    txn.exec(pqxx::prepped{"block_user"},
+             pqxx::params{
+             blocker_str,
+             blocked_str});
+
+    // Remove any friend requests that might exist.
+    txn.exec(pqxx::prepped{"delete_friend_request"},
+             pqxx::params{
+             blocked_str,
+             blocker_str});
+
+    txn.exec(pqxx::prepped{"delete_friend_request"},
+             pqxx::params{
+             blocker_str,
+             blocked_str});
+
+    // Remove any friendships that exist between
+    // the two users.
+    txn.exec(pqxx::prepped{"remove_friend"},
+             pqxx::params{
+             blocker_str,
+             blocked_str});
+
+    txn.commit();
+}
+
+void PostgresStorage::unblock_user(const boost::uuids::uuid & blocker,
+                                   const boost::uuids::uuid & blocked)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"unblock_user"},
+             pqxx::params{
+             boost::uuids::to_string(blocker),
+             boost::uuids::to_string(blocked)});
+
+    txn.commit();
+}
+
+void PostgresStorage::remove_friend(const boost::uuids::uuid & user,
+                                    const boost::uuids::uuid & friend_id)
+{
+    pqxx::work txn{connection()};
+
+    txn.exec(pqxx::prepped{"remove_friend"},
+             pqxx::params{
+             boost::uuids::to_string(user),
+             boost::uuids::to_string(friend_id)});
+
+    txn.commit();
+}
+
+void PostgresStorage::fetch_blocks(const boost::uuids::uuid & user,
+                                   StorageHandler<std::vector<ExternalUser>> handler)
+{
+    fetch_users("fetch_blocks", "user_id", user, std::move(handler));
+}
+
+void PostgresStorage::fetch_friends(const boost::uuids::uuid & user,
+                                    StorageHandler<std::vector<ExternalUser>> handler)
+{
+    fetch_users("fetch_friends", "friend_id", user, std::move(handler));
+}
+
+void PostgresStorage::fetch_friend_requests(const boost::uuids::uuid & user,
+                                            StorageHandler<std::vector<ExternalUser>> handler)
+{
+    fetch_users("fetch_friend_requests", "user_id", user, std::move(handler));
+}
+
+void PostgresStorage::fetch_latest_matches(const boost::uuids::uuid & user,
+                                           GameMode mode,
+                                           const MatchHistoryCursor & after,
+                                           int limit,
+                                           StorageHandler<std::vector<MatchResultRow>> handler)
+{
+    int64_t before_id = after.empty() ? std::numeric_limits<int64_t>::max()
+                                      : after.match_id;
+
+    async_db_.exec("fetch_latest_matches",
+                   {boost::uuids::to_string(user),
+                    std::to_string(static_cast<int16_t>(mode)),
+                    std::to_string(before_id),
+                    std::to_string(limit)},
+                   [handler = std::move(handler)](std::string error,
+                                                  PgResult matches_res) {
+
+        std::vector<MatchResultRow> rows;
+
+        for (size_t i = 0; error.empty() && i < matches_res.size(); i++)
+        {
+            MatchResultRow result;
+            result.match_id = matches_res.as<std::int64_t>(i, "match_id");
+            result.placement = matches_res.as<std::uint16_t>(i, "placement");
+            result.elo_change = matches_res.as<std::int32_t>(i, "elo_change");
+
+            auto finished_at = matches_res.as<std::time_t>(i, "finished_at");
+            result.finished_at = std::chrono::system_clock::from_time_t(finished_at);
+
+            rows.push_back(std::move(result));
+        }
+
+        handler(std::move(error), std::move(rows));
+    });
+}
+
+void PostgresStorage::fetch_replay(uint64_t match_id,
+                                   asio::any_io_executor blocking,
+                                   StorageHandler<std::optional<StoredReplay>> handler)
+{
+    std::string match_id_str = std::to_string(static_cast<int64_t>(match_id));
+
+    async_db_.exec("fetch_replay",
+                   {match_id_str},
+                   [this,
+                    match_id_str,
+                    blocking = std::move(blocking),
+                    handler = std::move(handler)](std::string error,
+                                                  PgResult replay_res) mutable {
+
+        if (!error.empty())
+        {
+            handler(std::move(error), std::nullopt);
+            return;
+        }
+
+        async_db_.exec("fetch_match_users",
+                       {match_id_str},
+                       [this,
+                        match_id_str,
+                        blocking = std::move(blocking),
+                        replay_res = std::move(replay_res),
+                        handler = std::move(handler)](std::string error,
+                                                      PgResult players_res) mutable {
+
+            if (!error.empty() || replay_res.empty() || players_res.empty())
+            {
+                handler(std::move(error), std::nullopt);
+                return;
+            }
+
+            StoredReplay replay;
+            replay.settings_json = replay_res.as<std::string>(0, "settings");
+
+            try
+            {
+                boost::uuids::string_generator gen;
+
+                for (size_t i = 0; i < players_res.size(); i++)
+                {
+                    ExternalUser user;
+                    user.user_id = gen(players_res.as<std::string>(i, "user_id"));
+                    user.username = players_res.as<std::string>(i, "username");
+
+                    replay.players.emplace_back(
+                        static_cast<uint8_t>(players_res.as<int>(i, "player_id")),
+                        std::move(user));
+                }
+            }
+            catch (const std::exception & e)
+            {
+                handler(e.what(), std::nullopt);
+                return;
+            }
+
+            if (!replay_res.is_null(0, "replay"))
+            {
+                replay.moves = replay_res.bytes(0, "replay");
+            }
+            // Moved out by archive_replays. Reading opens the segment and
+            // inflates a block, which must not hold the io_context.
+            else if (!replay_res.is_null(0, "archive_segment")
+                     && replay_res.as<int64_t>(0, "archive_segment") != UNARCHIVABLE_SEGMENT)
+            {
+                if (!archive_)
+                {
+                    handler("Replay is archived but no archive directory is set.",
+                            std::nullopt);
+                    return;
+                }
+
+                asio::post(blocking,
+                    [this,
+                     segment = replay_res.as<int64_t>(0, "archive_segment"),
+                     match_id = std::stoll(match_id_str),
+                     replay = std::move(replay),
+                     handler = std::move(handler)]() mutable
+                    {
+                        auto moves = archive_->read(segment, match_id);
+
+                        if (!moves)
+                        {
+                            handler("Failed to read archived replay.", std::nullopt);
+                            return;
+                        }
+
+                        replay.moves = std::move(*moves);
+                        handler(std::string{}, std::move(replay));
+                    });
+
+                return;
+            }
+            // Not yet migrated, see migrate_replays.
+            else if (auto moves = replay_from_json(replay_res.view(0, "move_history")))
+            {
+                replay.moves = std::move(*moves);
+            }
+            else
+            {
+                handler("Failed to parse legacy moves.", std::nullopt);
+                return;
+            }
+
+            handler(std::string{}, std::move(replay));
+        });
+    });
+}
+
+void PostgresStorage::load_ranked_results(const RankedResultVisitor & visit)
+{
+    pqxx::nontransaction txn{connection()};
+    boost::uuids::string_generator gen;
+
+    // Streamed with COPY, both tables are partitioned on match_id so the
+    // ordering follows their primary keys.
+    for (auto [match_id, mode, user_id, player_id, placement]
+         : txn.stream<int64_t, int, std::string_view, int, int>(
+               "SELECT mp.match_id, m.game_mode, mp.user_id, mp.player_id, mp.placement "
+               "FROM MatchPlayers mp "
+               "JOIN Matches m ON m.match_id = mp.match_id "
+               "WHERE m.game_mode >= " + std::to_string(RANKED_MODES_START) + " "
+               "ORDER BY mp.match_id, mp.player_id"))
+    {
+        visit(RankedResult{match_id,
+                           static_cast<GameMode>(mode),
+                           gen(user_id.begin(), user_id.end()),
+                           static_cast<uint8_t>(player_id),
+                           static_cast<uint16_t>(placement)});
+    }
+}
+
+void PostgresStorage::rewrite_ratings(const RatingRewrite & rewrite)
+{
+    pqxx::work txn{connection()};
+
+    // Stage the elos so they are applied with one join, not a statement each.
+    txn.exec("CREATE TEMP TABLE RewrittenElos("
+             "  user_id UUID NOT NULL,"
+             "  game_mode SMALLINT NOT NULL,"
+             "  current_elo INT NOT NULL"
+             ") ON COMMIT DROP");
+
+    auto elos = pqxx::stream_to::table(txn,
+                                       {"rewrittenelos"},
+                                       {"user_id",
+                                        "game_mode",
+                                        "current_elo"});
+
+    rewrite.for_each_elo(
+        [&elos](const boost::uuids::uuid & user_id, GameMode mode, int elo)
+        {
+            elos.write_values(boost::uuids::to_string(user_id),
+                              static_cast<int16_t>(mode),
+                              elo);
+        });
+
+    elos.complete();
+
+    txn.exec("ANALYZE RewrittenElos");
+
+    const std::string default_elo = std::to_string(DEFAULT_ELO);
+
+    txn.exec("UPDATE UserElos SET current_elo = " + default_elo + " "
+             "WHERE game_mode >= " + std::to_string(RANKED_MODES_START) + " "
+             "AND current_elo <> " + default_elo);
+
+    txn.exec("INSERT INTO UserElos (user_id, game_mode, current_elo) "
+             "SELECT user_id, game_mode, current_elo FROM RewrittenElos "
+             "ON CONFLICT (user_id, game_mode) "
+             "DO UPDATE SET current_elo = excluded.current_elo");
+
+    // Only ranked matches have history, so all of it is replaced. This is
+    // much cheaper than deleting every row of every partition.
+    txn.exec("TRUNCATE EloHistory");
+
+    auto history = pqxx::stream_to::table(txn,
+                                          {"elohistory"},
+                                          {"user_id",
+                                           "match_id",
+                                           "game_mode",
+                                           "old_elo",
+                                           "new_elo"});
+
+    rewrite.for_each_change(
+        [&history](const EloChange & change)
+        {
+            history.write_values(boost::uuids::to_string(change.user_id),
+                                 change.match_id,
+                                 static_cast<int>(change.mode),
+                                 change.old_elo,
+                                 change.new_elo);
+        });
+
+    history.complete();
+
+    txn.commit();
+}
+
+bool PostgresStorage::migrate_replays(ReplayMigration & progress, size_t limit)
+{
+    pqxx::work txn{connection()};
+
+    auto res = txn.exec(pqxx::prepped{"find_legacy_replays"},
+                        pqxx::params{
+                        progress.last_match_id,
+                        static_cast<int64_t>(limit)});
+
+    if (res.empty())
+    {
+        txn.commit();
+        return false;
+    }
+
+    for (const auto & row : res)
+    {
+        progress.last_match_id = row["match_id"].as<int64_t>();
+
+        std::optional<std::string> moves = replay_from_json(row["move_history"].view());
+
+        if (!moves)
+        {
+            progress.failed++;
+            continue;
+        }
+
+        txn.exec(pqxx::prepped{"store_replay"},
+                 pqxx::params{
+                 progress.last_match_id,
+                 to_pq_bytes(*moves)});
+
+        progress.converted++;
+    }
+
+    txn.commit();
+
+    return true;
+}
+
+bool PostgresStorage::maintain()
+{
+    {
+        pqxx::nontransaction txn{connection()};
+
+        auto res = txn.exec(pqxx::prepped{"ensure_match_partitions"},
+                            pqxx::params{
+                            MATCH_PARTITION_SIZE,
+                            MATCH_PARTITIONS_AHEAD});
+
+        int created = res[0][0].as<int>();
+
+        if (created > 0)
+        {
+            std::string lmsg = "Created "
+                               + std::to_string(created)
+                               + " match table partitions.";
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::INFO);
+        }
+    }
+
+    return archive_ && archive_replays();
+}
+
+bool PostgresStorage::archive_replays()
+{
+    pqxx::work txn{connection()};
+
+    // Locked rows are skipped, so two servers never archive a match twice.
+    auto res = txn.exec(pqxx::prepped{"find_archivable_replays"},
+                        pqxx::params{
+                        static_cast<int>(ARCHIVE_AFTER.count()),
+                        static_cast<int64_t>(ARCHIVE_SEGMENT_MATCHES)});
+
+    if (res.empty())
+    {
+        txn.commit();
+        return false;
+    }
+
+    std::vector<ArchivedReplay> replays;
+    replays.reserve(res.size());
+
+    std::vector<int64_t> match_ids;
+    match_ids.reserve(res.size());
+
+    std::vector<int64_t> failed_ids;
+
+    for (const auto & row : res)
+    {
+        int64_t match_id = row["match_id"].as<int64_t>();
+        std::optional<std::string> moves;
+
+        if (!row["replay"].is_null())
+        {
+            auto bytes = row["replay"].as<pqxx::bytes>();
+            moves.emplace(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        }
+        else
+        {
+            moves = replay_from_json(row["move_history"].view());
+        }
+
+        // Left in place and marked, so it is not selected again.
+        if (!moves)
+        {
+            std::string lmsg = "Could not archive replay of match "
+                               + std::to_string(match_id)
+                               + ", its moves failed to parse.";
+            Console::instance().log(std::move(lmsg),
+                                    LogLevel::WARN);
+            failed_ids.push_back(match_id);
+            continue;
+        }
+
+        replays.push_back(ArchivedReplay{match_id, std::move(*moves)});
+        match_ids.push_back(match_id);
+    }
+
+    if (!replays.empty())
+    {
+        // The segment is synced before the rows point at it. If the
+        // commit fails, the next run rewrites the same segment.
+        int64_t segment = archive_->write_segment(replays);
+
+        txn.exec(pqxx::prepped{"archive_replays"},
+                 pqxx::params{
+                 segment,
+                 bigint_to_pq_array(match_ids)});
+    }
+
+    if (!failed_ids.empty())
+    {
+        txn.exec(pqxx::prepped{"mark_unarchivable_replays"},
+                 pqxx::params{
+                 UNARCHIVABLE_SEGMENT,
+                 bigint_to_pq_array(failed_ids)});
+    }
+
+    txn.commit();
+
+    if (!replays.empty())
+    {
+        std::string lmsg = "Archived "
+                           + std::to_string(replays.size())
+                           + " replays.";
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::INFO);
+    }
+
+    return res.size() == ARCHIVE_SEGMENT_MATCHES;
+}
+
+void PostgresStorage::close()
+{
+    // Queries still in flight are failed and their handlers told.
+    async_db_.close();
+}
+
+void PostgresStorage::fetch_users(std::string statement,
+                                  const char * id_column,
+                                  const boost::uuids::uuid & user,
+                                  StorageHandler<std::vector<ExternalUser>> handler)
+{
+    async_db_.exec(std::move(statement),
+                   {boost::uuids::to_string(user)},
+                   [id_column,
+                    handler = std::move(handler)](std::string error,
+                                                  PgResult res) {
+
+        std::vector<ExternalUser> users;
+
+        try
+        {
+            boost::uuids::string_generator gen;
+
+            for (size_t i = 0; error.empty() && i < res.size(); i++)
+            {
+                ExternalUser user;
+
+                user.user_id = gen(res.as<std::string>(i, id_column));
+                user.username = res.as<std::string>(i, "username");
+
+                users.push_back(std::move(user));
+            }
+        }
+        catch (const std::exception & e)
+        {
+            error = e.what();
+            users.clear();
+        }
+
+        handler(std::move(error), std::move(users));
+    });
+}
+
+pqxx::connection & PostgresStorage::connection()
+{
+    if (!conn_)
+    {
+        conn_ = std::make_unique<pqxx::connection>(POSTGRES_CONNINFO);
+        conn_->prepare("auth",
+            "SELECT u.user_id, u.hash, u.salt, b.banned_ms, b.reason "
+            "FROM Users u "
+            "LEFT JOIN LATERAL ( "
+            "  SELECT (extract(epoch FROM banned_until)*1000)::bigint AS banned_ms, reason "
+            "  FROM UserBans "
+            "  WHERE user_id = u.user_id "
+            "  AND banned_until > now() "
+            "  ORDER BY banned_at DESC "
+            "  LIMIT 1 "
+            ") b ON true "
+            "WHERE LOWER(u.username) = LOWER($1)"
+            );
+        conn_->prepare("reg",
+            "INSERT INTO Users (user_id, username, hash, salt, last_ip) "
+            "VALUES ($1, $2, $3, $4, $5)"
+            );
+        conn_->prepare("insert_match_players",
+            "WITH m AS ("
+            "  INSERT INTO Matches(game_mode, settings, replay) "
+            "  VALUES ($1, $2::jsonb, $3::bytea) "
+            "  RETURNING match_id, finished_at"
+            "), p AS ("
+            "  INSERT INTO MatchPlayers(match_id, user_id, player_id, placement) "
+            "  SELECT m.match_id, u.user_id, u.player_id, u.placement "
+            "  FROM m, unnest($4::uuid[], $5::smallint[], $6::smallint[]) "
+            "       AS u(user_id, player_id, placement)"
+            ") "
+            "SELECT match_id, "
+            "FLOOR(EXTRACT(epoch from finished_at))::bigint AS finished_at "
+            "FROM m"
+            );
+        // Rows are locked in a fixed order so concurrent
+        // recordings cannot deadlock on each other.
+        conn_->prepare("get_elos_for_update",
+            "SELECT user_id, current_elo "
+            "FROM UserElos "
+            "WHERE user_id = ANY($1::uuid[]) AND game_mode = $2 "
+            "ORDER BY user_id "
+            "FOR UPDATE"
+            );
+        conn_->prepare("record_elos",
+            "WITH u AS ("
+            "  SELECT * FROM unnest($1::uuid[], $4::int[], $5::int[]) "
+            "         AS u(user_id, old_elo, new_elo)"
+            "), h AS ("
+            "  INSERT INTO EloHistory (user_id, match_id, game_mode, "
+                                      "old_elo, new_elo) "
+            "  SELECT user_id, $2::bigint, $3::smallint, old_elo, new_elo FROM u"
+            ") "
+            "INSERT INTO UserElos (user_id, game_mode, current_elo) "
+            "SELECT user_id, $3::smallint, new_elo FROM u "
+            "ON CONFLICT (user_id, game_mode) "
+            "DO UPDATE SET current_elo = EXCLUDED.current_elo"
+            );
+        conn_->prepare("ban_ip",
+            "INSERT INTO BannedIPs (ip, banned_until, original_expiration) "
+            "VALUES ($1, $2, $2) "
+            "ON CONFLICT (ip) DO UPDATE "
+            "  SET banned_until = EXCLUDED.banned_until, "
+            "  original_expiration = EXCLUDED.original_expiration"
+            );
+        conn_->prepare("unban_ip",
+            "UPDATE BannedIPs "
+            "SET banned_until = now() "
+            "WHERE ip = $1"
+            );
+        // Rows are tagged by kind: one per friend, block and elo.
+        //
+        // The update runs even though nothing reads its output.
+        conn_->prepare("login_user",
+            "WITH login AS ( "
+            "  UPDATE Users "
+            "  SET last_login = now(), "
+            "  last_ip = $1 "
+            "  WHERE user_id = $2::uuid "
+            ") "
+            "SELECT 'friend' AS kind, "
+            "(CASE WHEN f.user_a = $2::uuid THEN f.user_b ELSE f.user_a END) AS other_id, "
+            "NULL::smallint AS game_mode, NULL::int AS current_elo "
+            "FROM Friends f "
+            "WHERE f.user_a = $2::uuid OR f.user_b = $2::uuid "
+            "UNION ALL "
+            "SELECT 'block', b.blocked, NULL, NULL "
+            "FROM BlockedUsers b "
+            "WHERE b.blocker = $2::uuid "
+            "UNION ALL "
+            "SELECT 'elo', NULL, e.game_mode, e.current_elo "
+            "FROM UserElos e "
+            "WHERE e.user_id = $2::uuid"
+            );
+        conn_->prepare("add_user_elos",
+            "INSERT INTO UserElos (user_id, game_mode, current_elo) "
+            "VALUES ($1, $2, $3) "
+            "ON CONFLICT DO NOTHING"
+            );
+        conn_->prepare("find_uuid",
+            "SELECT user_id "
+            "FROM Users "
+            "WHERE LOWER(username) = LOWER($1)"
+            );
+        conn_->prepare("find_username",
+            "SELECT username "
+            "FROM Users "
+            "WHERE user_id = $1"
+            );
+        conn_->prepare("ban_user",
+            "INSERT INTO UserBans (user_id, banned_until, original_expiration, reason) "
+            "VALUES ($1, $2, $2, $3)"
+            );
+        conn_->prepare("unban_user",
+            "UPDATE UserBans "
+            "SET banned_until = now() "
+            "WHERE ban_id = $1"
+            );
+        conn_->prepare("friend_request",
+            "WITH pending AS ( "
+            "SELECT COUNT(*) AS cnt "
+            "FROM FriendRequests "
+            "WHERE sender = $1 "
+            ") "
+            "INSERT INTO FriendRequests (sender, receiver) "
+            "SELECT $1, $2 "
+            "FROM pending "
+            "WHERE cnt < $3 "
+            "ON CONFLICT DO NOTHING"
+            );
+        conn_->prepare("delete_friend_request",
+            "DELETE FROM FriendRequests "
+            "WHERE sender = $1 "
+            " AND receiver = $2"
+            );
+        conn_->prepare("accept_friend",
+            "INSERT INTO Friends (user_a, user_b) "
+            "VALUES (LEAST($1::uuid, $2::uuid), GREATEST($1::uuid, $2::uuid)) "
+            "ON CONFLICT DO NOTHING"
+            );
+        conn_->prepare("find_friend_request",
+            "SELECT 1 "
+            "FROM FriendRequests "
+            "WHERE receiver = $1 AND sender = $2 "
+            "LIMIT 1"
+            );
+        conn_->prepare("block_user",
+            "INSERT INTO BlockedUsers (blocker, blocked) "
+            "VALUES ($1, $2) "
+            "ON CONFLICT DO NOTHING"
+            );
+        conn_->prepare("check_blocked",
+            "SELECT 1 "
+            "FROM BlockedUsers "
+            "WHERE blocker = $1::uuid AND blocked = $2::uuid "
+            "LIMIT 1"
+            );
+        conn_->prepare("check_friends",
+            "SELECT 1 "
+            "FROM Friends "
+            "WHERE user_a = LEAST($1::uuid, $2::uuid) "
+            "AND user_b = GREATEST($1::uuid, $2::uuid) "
+            "LIMIT 1"
+            );
+        conn_->prepare("remove_friend",
+            "DELETE FROM Friends "
+            "WHERE (user_a = LEAST($1::uuid, $2::uuid) "
+            "AND user_b = GREATEST($1::uuid, $2::uuid))"
+            );
+        conn_->prepare("unblock_user",
+            "DELETE FROM BlockedUsers "
+            "WHERE blocker = $1::uuid AND blocked = $2::uuid"
+            );
+        conn_->prepare("find_legacy_replays",
+            "SELECT match_id, move_history::text AS move_history "
+            "FROM Matches "
+            "WHERE replay IS NULL AND move_history IS NOT NULL "
+            "AND match_id > $1 "
+            "ORDER BY match_id "
+            "LIMIT $2 "
+            "FOR UPDATE"
+            );
+        conn_->prepare("store_replay",
+            "UPDATE Matches "
+            "SET replay = $2, move_history = NULL "
+            "WHERE match_id = $1"
+            );
+        conn_->prepare("ensure_match_partitions",
+            "SELECT ensure_match_partitions($1, $2)"
+            );
+        conn_->prepare("find_archivable_replays",
+            "SELECT match_id, replay, move_history::text AS move_history "
+            "FROM Matches "
+            "WHERE archive_segment IS NULL "
+            "AND finished_at < now() - make_interval(days => $1) "
+            "ORDER BY match_id "
+            "LIMIT $2 "
+            "FOR UPDATE SKIP LOCKED"
+            );
+        conn_->prepare("archive_replays",
+            "UPDATE Matches "
+            "SET replay = NULL, move_history = NULL, archive_segment = $1 "
+            "WHERE match_id = ANY($2::bigint[])"
+            );
+        conn_->prepare("mark_unarchivable_replays",
+            "UPDATE Matches "
+            "SET archive_segment = $1 "
+            "WHERE match_id = ANY($2::bigint[])"
+            );
+    }
+
+    return *conn_;
+}
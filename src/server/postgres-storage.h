@@ -0,0 +1,170 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#pragma once
+
+#include "storage.h"
+#include "async-pg.h"
+#include "replay-archive.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pqxx/pqxx>
+
+// Array literals for passing lists of values as one parameter.
+std::string uuid_to_pq_array(const std::vector<std::string> & user_id_strs);
+std::string int_to_pq_array(const std::vector<int> & values);
+
+// Binary parameter for a bytea column.
+pqxx::bytes to_pq_bytes(std::string_view data);
+
+// The local cluster, shared by every connection the server makes.
+// We expect that a file exists at ~/.pgpass
+constexpr const char * POSTGRES_CONNINFO = "host=127.0.0.1 "
+                                           "port=5432 "
+                                           "dbname=silenttanksdb "
+                                           "user=silenttanksoperator";
+
+// Match ids per partition of the match tables. Must match the size the
+// partitions were created with, see setup/create-tables.sql.
+constexpr int64_t MATCH_PARTITION_SIZE = 1000000;
+
+// Partitions kept ready past the one holding the newest match.
+constexpr int MATCH_PARTITIONS_AHEAD = 2;
+
+// The local postgres cluster, see setup/create-tables.sql.
+//
+// Blocking calls use one pqxx connection per pool thread. The fetches
+// are pipelined over non-blocking connections on the io_context.
+//
+// With an archive directory, replays older than ARCHIVE_AFTER are moved
+// out of the Matches table into segment files there during upkeep.
+class PostgresStorage : public Storage
+{
+public:
+    // An empty archive_dir keeps every replay in the database.
+    explicit PostgresStorage(asio::io_context & io, std::string archive_dir = "");
+
+    std::string name() const override;
+
+    bool supports_write_behind() const override;
+
+    std::unordered_map<std::string, std::chrono::system_clock::time_point>
+    load_ip_bans() override;
+
+    void load_ratings(const RatingVisitor & visit) override;
+
+    std::optional<LoginRecord> find_login(const std::string & username) override;
+
+    LoginData login(const boost::uuids::uuid & user_id,
+                    const std::string & ip) override;
+
+    bool create_user(const boost::uuids::uuid & user_id,
+                     const std::string & username,
+                     const std::array<uint8_t, HASH_LENGTH> & hash,
+                     const std::array<uint8_t, SALT_LENGTH> & salt,
+                     const std::string & ip) override;
+
+    RecordedMatch record_match(const MatchWrite & match) override;
+
+    void ban_ip(const std::string & ip,
+                std::chrono::system_clock::time_point banned_until) override;
+
+    void unban_ip(const std::string & ip) override;
+
+    std::optional<boost::uuids::uuid> find_user_id(const std::string & username) override;
+
+    void ban_user(const boost::uuids::uuid & user_id,
+                  std::chrono::system_clock::time_point banned_until,
+                  const std::string & reason) override;
+
+    void unban_user(uint64_t ban_id) override;
+
+    bool send_friend_request(const boost::uuids::uuid & sender,
+                             const boost::uuids::uuid & receiver,
+                             int max_pending) override;
+
+    std::optional<std::string>
+    accept_friend_request(const boost::uuids::uuid & receiver,
+                          const boost::uuids::uuid & sender) override;
+
+    void decline_friend_request(const boost::uuids::uuid & receiver,
+                                const boost::uuids::uuid & sender) override;
+
+    void block_user(const boost::uuids::uuid & blocker,
+                    const boost::uuids::uuid & blocked) override;
+
+    void unblock_user(const boost::uuids::uuid & blocker,
+                      const boost::uuids::uuid & blocked) override;
+
+    void remove_friend(const boost::uuids::uuid & user,
+                       const boost::uuids::uuid & friend_id) override;
+
+    void fetch_blocks(const boost::uuids::uuid & user,
+                      StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_friends(const boost::uuids::uuid & user,
+                       StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_friend_requests(const boost::uuids::uuid & user,
+                               StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_latest_matches(const boost::uuids::uuid & user,
+                              GameMode mode,
+                              const MatchHistoryCursor & after,
+                              int limit,
+                              StorageHandler<std::vector<MatchResultRow>> handler) override;
+
+    void load_ranked_results(const RankedResultVisitor & visit) override;
+
+    void rewrite_ratings(const RatingRewrite & rewrite) override;
+
+    bool migrate_replays(ReplayMigration & progress, size_t limit) override;
+
+    void fetch_replay(uint64_t match_id,
+                      asio::any_io_executor blocking,
+                      StorageHandler<std::optional<StoredReplay>> handler) override;
+
+    // Creates upcoming match partitions, then archives one segment.
+    bool maintain() override;
+
+    void close() override;
+
+private:
+    // The calling thread's connection, made and prepared on first use.
+    pqxx::connection & connection();
+
+    void fetch_users(std::string statement,
+                     const char * id_column,
+                     const boost::uuids::uuid & user,
+                     StorageHandler<std::vector<ExternalUser>> handler);
+
+    // Moves up to ARCHIVE_SEGMENT_MATCHES old replays into a segment.
+    // Returns false if there were fewer, so nothing is left for now.
+    bool archive_replays();
+
+private:
+    // Read only queries, pipelined over non-blocking connections that
+    // run on the io_context, so they never hold a pool thread.
+    PgPool async_db_;
+
+    // Null without an archive directory.
+    std::unique_ptr<ReplayArchive> archive_;
+};
@@ -0,0 +1,302 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "ranked-queue.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+bool RankedQueue::insert(Session::ptr session,
+                         int elo,
+                         steady_clock::time_point now)
+{
+    boost::uuids::uuid user_id = session->get_user_data().user_id;
+
+    if (nodes_.contains(user_id))
+    {
+        return false;
+    }
+
+    uint64_t order = next_order_++;
+
+    Node node{Entry{std::move(session), user_id, elo, now},
+              order,
+              RANKED_BASE_WINDOW};
+
+    nodes_.emplace(user_id, std::move(node));
+    by_elo_.emplace(EloKey{elo, order}, user_id);
+    by_time_.emplace(order, user_id);
+
+    return true;
+}
+
+bool RankedQueue::erase(const boost::uuids::uuid & user_id)
+{
+    auto itr = nodes_.find(user_id);
+
+    if (itr == nodes_.end())
+    {
+        return false;
+    }
+
+    by_elo_.erase(EloKey{itr->second.entry.elo, itr->second.order});
+    by_time_.erase(itr->second.order);
+    nodes_.erase(itr);
+
+    return true;
+}
+
+bool RankedQueue::contains(const boost::uuids::uuid & user_id) const
+{
+    return nodes_.contains(user_id);
+}
+
+const RankedQueue::Entry * RankedQueue::find(const boost::uuids::uuid & user_id) const
+{
+    auto itr = nodes_.find(user_id);
+
+    return (itr != nodes_.end()) ? &itr->second.entry : nullptr;
+}
+
+size_t RankedQueue::size() const
+{
+    return nodes_.size();
+}
+
+int RankedQueue::window(const Entry & entry, steady_clock::time_point now)
+{
+    auto steps = (now - entry.enqueued_at) / RANKED_WIDEN_INTERVAL;
+
+    if (steps <= 0)
+    {
+        return RANKED_BASE_WINDOW;
+    }
+
+    // Clamp before multiplying, a long wait could overflow.
+    steps = std::min<decltype(steps)>(steps, RANKED_MAX_WINDOW / RANKED_WINDOW_STEP);
+
+    return std::min(RANKED_BASE_WINDOW + static_cast<int>(steps) * RANKED_WINDOW_STEP,
+                    RANKED_MAX_WINDOW);
+}
+
+std::optional<boost::uuids::uuid>
+RankedQueue::best_opponent(const boost::uuids::uuid & user_id,
+                           steady_clock::time_point now) const
+{
+    auto node_itr = nodes_.find(user_id);
+
+    if (node_itr == nodes_.end())
+    {
+        return std::nullopt;
+    }
+
+    const Node & self = node_itr->second;
+    const int elo = self.entry.elo;
+    const int limit = window(self.entry, now);
+
+    auto self_itr = by_elo_.find(EloKey{elo, self.order});
+
+    // Walk outwards from our own position, always taking the closer side.
+    auto lower = std::make_reverse_iterator(self_itr);
+    auto upper = std::next(self_itr);
+
+    while (true)
+    {
+        bool lower_ok = lower != by_elo_.rend()
+                        && elo - lower->first.elo <= limit;
+        bool upper_ok = upper != by_elo_.end()
+                        && upper->first.elo - elo <= limit;
+
+        if (!lower_ok && !upper_ok)
+        {
+            return std::nullopt;
+        }
+
+        bool take_lower = lower_ok;
+
+        if (lower_ok && upper_ok)
+        {
+            int lower_diff = elo - lower->first.elo;
+            int upper_diff = upper->first.elo - elo;
+
+            // On a tie prefer the lower order, who has waited longer.
+            take_lower = (lower_diff != upper_diff)
+                         ? lower_diff < upper_diff
+                         : lower->first.order < upper->first.order;
+        }
+
+        const auto & candidate = take_lower ? *lower : *upper;
+        const Node & other = nodes_.at(candidate.second);
+
+        if (std::abs(other.entry.elo - elo) <= window(other.entry, now))
+        {
+            return candidate.second;
+        }
+
+        if (take_lower)
+        {
+            ++lower;
+        }
+        else
+        {
+            ++upper;
+        }
+    }
+}
+
+std::vector<boost::uuids::uuid>
+RankedQueue::best_group(const boost::uuids::uuid & user_id,
+                        size_t group_size,
+                        steady_clock::time_point now) const
+{
+    auto node_itr = nodes_.find(user_id);
+
+    if (node_itr == nodes_.end() || group_size < 2)
+    {
+        return {};
+    }
+
+    struct Candidate
+    {
+        const Node * node;
+        int window;
+    };
+
+    const Node & self = node_itr->second;
+    const int elo = self.entry.elo;
+    const int limit = window(self.entry, now);
+
+    // Gather everyone who accepts us and who we accept, in elo order.
+    // Anyone else could never be in a group with us.
+    std::vector<Candidate> candidates;
+    auto self_itr = by_elo_.find(EloKey{elo, self.order});
+
+    for (auto itr = std::make_reverse_iterator(self_itr);
+         itr != by_elo_.rend() && elo - itr->first.elo <= limit;
+         ++itr)
+    {
+        const Node & other = nodes_.at(itr->second);
+        int other_window = window(other.entry, now);
+
+        if (elo - other.entry.elo <= other_window)
+        {
+            candidates.push_back(Candidate{&other, other_window});
+        }
+    }
+
+    std::reverse(candidates.begin(), candidates.end());
+
+    size_t self_index = candidates.size();
+    candidates.push_back(Candidate{&self, limit});
+
+    for (auto itr = std::next(self_itr);
+         itr != by_elo_.end() && itr->first.elo - elo <= limit;
+         ++itr)
+    {
+        const Node & other = nodes_.at(itr->second);
+        int other_window = window(other.entry, now);
+
+        if (other.entry.elo - elo <= other_window)
+        {
+            candidates.push_back(Candidate{&other, other_window});
+        }
+    }
+
+    if (candidates.size() < group_size)
+    {
+        return {};
+    }
+
+    // Slide a window of group_size over the candidates, keeping us inside.
+    // A group is valid when its spread fits in every member's window.
+    size_t first = (self_index >= group_size - 1) ? self_index - group_size + 1 : 0;
+    size_t last = std::min(self_index, candidates.size() - group_size);
+
+    std::optional<size_t> best;
+    int best_spread = 0;
+    uint64_t best_age = 0;
+
+    for (size_t start = first; start <= last; start++)
+    {
+        int spread = candidates[start + group_size - 1].node->entry.elo
+                     - candidates[start].node->entry.elo;
+
+        bool valid = true;
+        uint64_t age = 0;
+
+        for (size_t i = start; i < start + group_size; i++)
+        {
+            if (spread > candidates[i].window)
+            {
+                valid = false;
+                break;
+            }
+
+            age += candidates[i].node->order;
+        }
+
+        // Lower orders have been waiting longer.
+        if (valid && (!best
+                      || spread < best_spread
+                      || (spread == best_spread && age < best_age)))
+        {
+            best = start;
+            best_spread = spread;
+            best_age = age;
+        }
+    }
+
+    if (!best)
+    {
+        return {};
+    }
+
+    std::vector<boost::uuids::uuid> group;
+    group.reserve(group_size);
+
+    for (size_t i = *best; i < *best + group_size; i++)
+    {
+        group.push_back(candidates[i].node->entry.user_id);
+    }
+
+    return group;
+}
+
+std::vector<boost::uuids::uuid> RankedQueue::widened(steady_clock::time_point now)
+{
+    std::vector<boost::uuids::uuid> result;
+
+    for (const auto & [order, user_id] : by_time_)
+    {
+        Node & node = nodes_.at(user_id);
+
+        // Everyone after this point still has the base window.
+        if (now - node.entry.enqueued_at < RANKED_WIDEN_INTERVAL)
+        {
+            break;
+        }
+
+        int current = window(node.entry, now);
+
+        if (current != node.last_window)
+        {
+            node.last_window = current;
+            result.push_back(user_id);
+        }
+    }
+
+    return result;
+}
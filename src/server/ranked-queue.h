@@ -0,0 +1,130 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <chrono>
+#include <compare>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/functional/hash.hpp>
+
+#include "session.h"
+
+// Elo difference every queued player accepts right away.
+inline constexpr int RANKED_BASE_WINDOW = 25;
+
+// The window grows by this much every RANKED_WIDEN_INTERVAL in the queue.
+inline constexpr int RANKED_WINDOW_STEP = 25;
+inline constexpr std::chrono::seconds RANKED_WIDEN_INTERVAL{15};
+
+inline constexpr int RANKED_MAX_WINDOW = 400;
+
+// Queue of ranked players indexed by elo and by time enqueued.
+//
+// Both indices are balanced trees, so finding a player's closest
+// acceptable opponents is a walk outwards from their own position, and
+// players only match if each is inside every other's window.
+//
+// Players are matched as they enqueue, so for a group size of k the
+// queue never holds k players within RANKED_BASE_WINDOW of each other.
+// That bounds the walk to about k * RANKED_MAX_WINDOW / RANKED_BASE_WINDOW
+// entries each way.
+//
+// Not thread safe, owned by a strategy's strand.
+class RankedQueue
+{
+    using steady_clock = std::chrono::steady_clock;
+
+public:
+    struct Entry
+    {
+        Session::ptr session;
+        boost::uuids::uuid user_id;
+        int elo;
+        steady_clock::time_point enqueued_at;
+    };
+
+    // Returns false if the user is already queued.
+    bool insert(Session::ptr session, int elo, steady_clock::time_point now);
+
+    bool erase(const boost::uuids::uuid & user_id);
+
+    bool contains(const boost::uuids::uuid & user_id) const;
+
+    const Entry * find(const boost::uuids::uuid & user_id) const;
+
+    size_t size() const;
+
+    // Largest elo difference the entry accepts at the given time.
+    static int window(const Entry & entry, steady_clock::time_point now);
+
+    // Closest queued player in elo that user_id accepts and that accepts
+    // user_id. Ties go to whoever has waited longer.
+    std::optional<boost::uuids::uuid>
+    best_opponent(const boost::uuids::uuid & user_id,
+                  steady_clock::time_point now) const;
+
+    // Tightest group of group_size players containing user_id in which
+    // every player accepts every other, or empty if there is none.
+    //
+    // Candidates inside user_id's window are gathered in elo order, and
+    // a window of group_size consecutive candidates is slid across them.
+    // The group with the smallest elo spread wins, ties go to the group
+    // that has waited longer in total.
+    std::vector<boost::uuids::uuid>
+    best_group(const boost::uuids::uuid & user_id,
+               size_t group_size,
+               steady_clock::time_point now) const;
+
+    // Players whose window has grown since the last call, longest
+    // waiting first. Only these can have gained an opponent on a tick.
+    std::vector<boost::uuids::uuid> widened(steady_clock::time_point now);
+
+private:
+    struct EloKey
+    {
+        int elo;
+        uint64_t order;
+
+        auto operator<=>(const EloKey &) const = default;
+    };
+
+    struct Node
+    {
+        Entry entry;
+        uint64_t order;
+
+        // Window the player had when they were last considered.
+        int last_window;
+    };
+
+private:
+    // Insertion counter, so keys are unique and earlier means older.
+    uint64_t next_order_{0};
+
+    std::unordered_map<boost::uuids::uuid,
+                       Node,
+                       boost::hash<boost::uuids::uuid>> nodes_;
+
+    std::map<EloKey, boost::uuids::uuid> by_elo_;
+
+    std::map<uint64_t, boost::uuids::uuid> by_time_;
+};
@@ -0,0 +1,207 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "rating-models.h"
+#include "elo-updates.h"
+
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <vector>
+
+// Convergence of the volatility iteration, as suggested by Glickman.
+constexpr double GLICKO_EPSILON = 0.000001;
+
+std::string EloModel::name() const
+{
+    return "elo";
+}
+
+Rating EloModel::initial() const
+{
+    return Rating{static_cast<double>(DEFAULT_ELO), 0.0, 0.0};
+}
+
+void EloModel::rate(std::span<Rating> ratings,
+                    std::span<const uint8_t> elimination_order) const
+{
+    std::vector<int> elos(ratings.size());
+
+    for (size_t i = 0; i < ratings.size(); i++)
+    {
+        elos[i] = static_cast<int>(std::lround(ratings[i].rating));
+    }
+
+    std::vector<int> updated = elo_updates(elos,
+                                           std::vector<uint8_t>(elimination_order.begin(),
+                                                                elimination_order.end()));
+
+    for (size_t i = 0; i < ratings.size(); i++)
+    {
+        ratings[i].rating = static_cast<double>(updated[i]);
+    }
+}
+
+std::string Glicko2Model::name() const
+{
+    return "glicko2";
+}
+
+Rating Glicko2Model::initial() const
+{
+    return Rating{static_cast<double>(DEFAULT_ELO),
+                  GLICKO_INITIAL_DEVIATION,
+                  GLICKO_INITIAL_VOLATILITY};
+}
+
+// Step 5 of Glickman's paper, the new volatility by the Illinois method.
+static double glicko_volatility(double phi, double volatility, double v, double delta)
+{
+    const double a = std::log(volatility * volatility);
+    const double tau_sq = GLICKO_TAU * GLICKO_TAU;
+
+    auto f = [&](double x)
+    {
+        double ex = std::exp(x);
+        double denom = phi * phi + v + ex;
+
+        return ex * (delta * delta - phi * phi - v - ex) / (2.0 * denom * denom)
+               - (x - a) / tau_sq;
+    };
+
+    double A = a;
+    double B;
+
+    if (delta * delta > phi * phi + v)
+    {
+        B = std::log(delta * delta - phi * phi - v);
+    }
+    else
+    {
+        int k = 1;
+
+        while (f(a - k * GLICKO_TAU) < 0.0)
+        {
+            k++;
+        }
+
+        B = a - k * GLICKO_TAU;
+    }
+
+    double fA = f(A);
+    double fB = f(B);
+
+    while (std::abs(B - A) > GLICKO_EPSILON)
+    {
+        double C = A + (A - B) * fA / (fB - fA);
+        double fC = f(C);
+
+        if (fC * fB <= 0.0)
+        {
+            A = B;
+            fA = fB;
+        }
+        else
+        {
+            fA = fA / 2.0;
+        }
+
+        B = C;
+        fB = fC;
+    }
+
+    return std::exp(A / 2.0);
+}
+
+void Glicko2Model::rate(std::span<Rating> ratings,
+                        std::span<const uint8_t> elimination_order) const
+{
+    const size_t n = ratings.size();
+
+    if (n <= 1)
+    {
+        return;
+    }
+
+    // Everyone is rated against what the others had before this match.
+    std::vector<Rating> before(ratings.begin(), ratings.end());
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double mu = (before[i].rating - DEFAULT_ELO) / GLICKO_SCALE;
+        double phi = before[i].deviation / GLICKO_SCALE;
+
+        double v_inverse = 0.0;
+        double score_sum = 0.0;
+
+        for (size_t j = 0; j < n; j++)
+        {
+            if (i == j)
+            {
+                continue;
+            }
+
+            double mu_j = (before[j].rating - DEFAULT_ELO) / GLICKO_SCALE;
+            double phi_j = before[j].deviation / GLICKO_SCALE;
+
+            double g = 1.0 / std::sqrt(1.0 + 3.0 * phi_j * phi_j
+                                             / (std::numbers::pi * std::numbers::pi));
+            double expected = 1.0 / (1.0 + std::exp(-g * (mu - mu_j)));
+
+            double score = (elimination_order[i] > elimination_order[j]) ? 1.0
+                           : (elimination_order[i] < elimination_order[j]) ? 0.0
+                           : 0.5;
+
+            v_inverse += g * g * expected * (1.0 - expected);
+            score_sum += g * (score - expected);
+        }
+
+        // Guard against opponents so far apart the result tells us nothing.
+        if (v_inverse <= 0.0)
+        {
+            continue;
+        }
+
+        double v = 1.0 / v_inverse;
+        double delta = v * score_sum;
+
+        double volatility = glicko_volatility(phi, before[i].volatility, v, delta);
+
+        double phi_star = std::sqrt(phi * phi + volatility * volatility);
+        double phi_new = 1.0 / std::sqrt(1.0 / (phi_star * phi_star) + v_inverse);
+        double mu_new = mu + phi_new * phi_new * score_sum;
+
+        ratings[i].rating = mu_new * GLICKO_SCALE + DEFAULT_ELO;
+        ratings[i].deviation = phi_new * GLICKO_SCALE;
+        ratings[i].volatility = volatility;
+    }
+}
+
+std::unique_ptr<RatingModel> make_rating_model(const std::string & name)
+{
+    if (name == "elo")
+    {
+        return std::make_unique<EloModel>();
+    }
+
+    if (name == "glicko2")
+    {
+        return std::make_unique<Glicko2Model>();
+    }
+
+    throw std::invalid_argument("Unknown rating model \"" + name + "\", expected "
+                                "elo or glicko2");
+}
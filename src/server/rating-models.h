@@ -0,0 +1,91 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+// Glicko-2 starting deviation and volatility, and tau which limits how
+// fast volatility can move.
+constexpr double GLICKO_INITIAL_DEVIATION = 350.0;
+constexpr double GLICKO_INITIAL_VOLATILITY = 0.06;
+constexpr double GLICKO_TAU = 0.5;
+
+// Converts between Glicko and Glicko-2 scales.
+constexpr double GLICKO_SCALE = 173.7178;
+
+struct Rating
+{
+    double rating;
+
+    // Only used by Glicko-2.
+    double deviation;
+    double volatility;
+};
+
+// A rating system for rerating matches offline.
+class RatingModel
+{
+public:
+    virtual ~RatingModel() = default;
+
+    virtual std::string name() const = 0;
+
+    // Rating of a player before their first match.
+    virtual Rating initial() const = 0;
+
+    // Rates one match in place, both indexed by player id. Elimination
+    // order runs from 0 (last place) to N-1 (first place), as for
+    // elo_updates. Called from several threads at once.
+    virtual void rate(std::span<Rating> ratings,
+                      std::span<const uint8_t> elimination_order) const = 0;
+};
+
+// The server's own multiplayer Elo, through elo_updates on whole elos,
+// so rerating with unchanged constants reproduces the stored history.
+class EloModel : public RatingModel
+{
+public:
+    std::string name() const override;
+
+    Rating initial() const override;
+
+    void rate(std::span<Rating> ratings,
+              std::span<const uint8_t> elimination_order) const override;
+};
+
+// Glicko-2, with every match as its own rating period. A match of N
+// players counts as N-1 games for each, won against everyone eliminated
+// before them and lost against the rest. Everyone is rated against the
+// ratings the others came in with.
+class Glicko2Model : public RatingModel
+{
+public:
+    std::string name() const override;
+
+    Rating initial() const override;
+
+    void rate(std::span<Rating> ratings,
+              std::span<const uint8_t> elimination_order) const override;
+};
+
+// Parses a --model option, elo or glicko2.
+//
+// Throws std::invalid_argument for anything else.
+std::unique_ptr<RatingModel> make_rating_model(const std::string & name);
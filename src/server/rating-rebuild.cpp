@@ -0,0 +1,327 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "rating-rebuild.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <boost/asio.hpp>
+
+namespace asio = boost::asio;
+
+static int whole_elo(const Rating & rating)
+{
+    return static_cast<int>(std::lround(rating.rating));
+}
+
+void RatingRebuild::load(Storage & storage)
+{
+    // Rows arrive grouped by match, so buffer one match at a time.
+    std::vector<RankedResult> rows;
+
+    storage.load_ranked_results([this, &rows](const RankedResult & result)
+    {
+        if (!rows.empty() && rows.front().match_id != result.match_id)
+        {
+            add_match(rows.front().match_id, rows.front().mode, rows);
+            rows.clear();
+        }
+
+        rows.push_back(result);
+    });
+
+    if (!rows.empty())
+    {
+        add_match(rows.front().match_id, rows.front().mode, rows);
+    }
+
+    stats_.users = users_.size();
+}
+
+void RatingRebuild::run(const RatingModel & model, size_t threads)
+{
+    std::vector<Component> work = components();
+
+    for (uint8_t m = 0; m < RANKED_MODES_COUNT; m++)
+    {
+        ratings_[m].assign(users_.size(), model.initial());
+        played_[m].assign(users_.size(), 0);
+    }
+
+    old_elos_.assign(results_.size(), 0);
+    new_elos_.assign(results_.size(), 0);
+
+    // Components share no players, so workers never touch the same
+    // rating, and each takes the next largest component as it finishes.
+    std::atomic<size_t> next{0};
+    asio::thread_pool pool(std::max<size_t>(threads, 1));
+
+    for (size_t t = 0; t < std::max<size_t>(threads, 1); t++)
+    {
+        asio::post(pool, [this, &model, &work, &next]()
+        {
+            size_t i;
+
+            while ((i = next.fetch_add(1, std::memory_order_relaxed)) < work.size())
+            {
+                rate_component(model, work[i]);
+            }
+        });
+    }
+
+    pool.join();
+}
+
+std::optional<int> RatingRebuild::elo(const boost::uuids::uuid & user_id, GameMode mode) const
+{
+    auto itr = index_.find(user_id);
+
+    if (itr == index_.end()
+        || static_cast<uint8_t>(mode) < RANKED_MODES_START
+        || mode >= GameMode::NO_MODE)
+    {
+        return std::nullopt;
+    }
+
+    uint8_t m = elo_ranked_index(mode);
+
+    if (!played_[m][itr->second])
+    {
+        return std::nullopt;
+    }
+
+    return whole_elo(ratings_[m][itr->second]);
+}
+
+void RatingRebuild::for_each_elo(const EloVisitor & visit) const
+{
+    for (uint8_t m = 0; m < RANKED_MODES_COUNT; m++)
+    {
+        GameMode mode = static_cast<GameMode>(m + RANKED_MODES_START);
+
+        for (uint32_t user = 0; user < played_[m].size(); user++)
+        {
+            if (played_[m][user])
+            {
+                visit(users_[user], mode, whole_elo(ratings_[m][user]));
+            }
+        }
+    }
+}
+
+void RatingRebuild::for_each_change(const EloChangeVisitor & visit) const
+{
+    for (uint8_t m = 0; m < RANKED_MODES_COUNT; m++)
+    {
+        GameMode mode = static_cast<GameMode>(m + RANKED_MODES_START);
+
+        for (const Match & match : matches_[m])
+        {
+            for (uint32_t r = match.first; r < match.first + match.players; r++)
+            {
+                visit(EloChange{match.match_id,
+                                users_[results_[r].user],
+                                mode,
+                                old_elos_[r],
+                                new_elos_[r]});
+            }
+        }
+    }
+}
+
+RatingRebuildStats RatingRebuild::stats() const
+{
+    return stats_;
+}
+
+void RatingRebuild::add_match(int64_t match_id,
+                              GameMode mode,
+                              const std::vector<RankedResult> & rows)
+{
+    size_t n_players = rows.size();
+
+    bool valid = static_cast<uint8_t>(mode) >= RANKED_MODES_START
+                 && mode < GameMode::NO_MODE
+                 && n_players <= std::numeric_limits<uint8_t>::max();
+
+    // Placements are 1 to N, see Database::do_record.
+    for (const RankedResult & row : rows)
+    {
+        valid = valid && row.placement >= 1 && row.placement <= n_players;
+    }
+
+    if (!valid)
+    {
+        stats_.skipped++;
+        return;
+    }
+
+    matches_[elo_ranked_index(mode)].push_back(Match{match_id,
+                                                     static_cast<uint32_t>(results_.size()),
+                                                     static_cast<uint8_t>(n_players)});
+
+    for (const RankedResult & row : rows)
+    {
+        auto [itr, inserted] = index_.try_emplace(row.user_id,
+                                                  static_cast<uint32_t>(users_.size()));
+
+        if (inserted)
+        {
+            users_.push_back(row.user_id);
+        }
+
+        results_.push_back(Result{itr->second,
+                                  static_cast<uint8_t>(n_players - row.placement)});
+    }
+
+    stats_.matches++;
+    stats_.results += n_players;
+}
+
+std::vector<RatingRebuild::Component> RatingRebuild::components()
+{
+    std::vector<Component> result;
+
+    for (uint8_t m = 0; m < RANKED_MODES_COUNT; m++)
+    {
+        const std::vector<Match> & matches = matches_[m];
+
+        std::vector<uint32_t> parent(users_.size());
+        std::vector<uint32_t> size(users_.size(), 1);
+        std::iota(parent.begin(), parent.end(), 0);
+
+        auto find = [&parent](uint32_t user)
+        {
+            // Path halving keeps the trees flat without recursion.
+            while (parent[user] != user)
+            {
+                parent[user] = parent[parent[user]];
+                user = parent[user];
+            }
+
+            return user;
+        };
+
+        for (const Match & match : matches)
+        {
+            uint32_t root = find(results_[match.first].user);
+
+            for (uint32_t r = match.first + 1; r < match.first + match.players; r++)
+            {
+                uint32_t other = find(results_[r].user);
+
+                if (other == root)
+                {
+                    continue;
+                }
+
+                if (size[other] > size[root])
+                {
+                    std::swap(other, root);
+                }
+
+                parent[other] = root;
+                size[root] += size[other];
+            }
+        }
+
+        // Group the matches by component with a stable counting sort, so
+        // each component keeps its matches in the order they finished.
+        std::vector<uint32_t> root_of(matches.size());
+        std::vector<uint32_t> count(users_.size(), 0);
+
+        for (uint32_t i = 0; i < matches.size(); i++)
+        {
+            root_of[i] = find(results_[matches[i].first].user);
+            count[root_of[i]]++;
+        }
+
+        std::vector<uint32_t> start(users_.size(), 0);
+        uint32_t offset = 0;
+
+        for (uint32_t root = 0; root < users_.size(); root++)
+        {
+            if (count[root] == 0)
+            {
+                continue;
+            }
+
+            start[root] = offset;
+            result.push_back(Component{m, offset, offset + count[root]});
+            offset += count[root];
+        }
+
+        order_[m].assign(matches.size(), 0);
+
+        for (uint32_t i = 0; i < matches.size(); i++)
+        {
+            order_[m][start[root_of[i]]++] = i;
+        }
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const Component & a, const Component & b)
+              {
+                  return a.end - a.begin > b.end - b.begin;
+              });
+
+    stats_.components = result.size();
+    stats_.largest_component = result.empty() ? 0 : result.front().end - result.front().begin;
+
+    return result;
+}
+
+void RatingRebuild::rate_component(const RatingModel & model, const Component & component)
+{
+    std::vector<Rating> & ratings = ratings_[component.mode];
+    std::vector<uint8_t> & played = played_[component.mode];
+    const std::vector<Match> & matches = matches_[component.mode];
+
+    std::vector<Rating> lobby;
+    std::vector<uint8_t> elimination;
+
+    for (uint32_t k = component.begin; k < component.end; k++)
+    {
+        const Match & match = matches[order_[component.mode][k]];
+
+        lobby.clear();
+        elimination.clear();
+
+        for (uint32_t r = match.first; r < match.first + match.players; r++)
+        {
+            const Rating & rating = ratings[results_[r].user];
+
+            lobby.push_back(rating);
+            elimination.push_back(results_[r].elimination);
+            old_elos_[r] = whole_elo(rating);
+        }
+
+        model.rate(lobby, elimination);
+
+        for (uint32_t p = 0; p < match.players; p++)
+        {
+            uint32_t user = results_[match.first + p].user;
+
+            ratings[user] = lobby[p];
+            played[user] = 1;
+            new_elos_[match.first + p] = whole_elo(lobby[p]);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/functional/hash.hpp>
+
+#include "gamemodes.h"
+#include "rating-models.h"
+#include "storage.h"
+
+struct RatingRebuildStats
+{
+    size_t users{0};
+    size_t matches{0};
+    size_t results{0};
+
+    // Matches left out for impossible placements.
+    size_t skipped{0};
+
+    size_t components{0};
+
+    // Matches in the largest component, which bounds the parallel speedup.
+    size_t largest_component{0};
+};
+
+// Rerates every stored ranked match from scratch with a rating model.
+//
+// Results are streamed out of storage once into flat arrays, users are
+// interned to indices and each mode keeps its matches in the order they
+// finished.
+//
+// Modes never share ratings, and within a mode two players can only
+// affect each other if some chain of matches joins them. Each mode is
+// split into these connected components with a union find, and the
+// components are rated in parallel, each in match order, so the result
+// is the same as rating everything in order on one thread. The largest
+// components are handed out first so that one is not left for last.
+class RatingRebuild
+{
+public:
+    void load(Storage & storage);
+
+    void run(const RatingModel & model, size_t threads);
+
+    // After run, a user's rating rounded to a whole elo.
+    std::optional<int> elo(const boost::uuids::uuid & user_id, GameMode mode) const;
+
+    // After run, the final elo of everyone who played a mode.
+    void for_each_elo(const EloVisitor & visit) const;
+
+    // After run, the elo change of every player in every match.
+    void for_each_change(const EloChangeVisitor & visit) const;
+
+    RatingRebuildStats stats() const;
+
+private:
+    struct Result
+    {
+        uint32_t user;
+        uint8_t elimination;
+    };
+
+    struct Match
+    {
+        int64_t match_id;
+
+        // Players are results_[first, first + players).
+        uint32_t first;
+        uint8_t players;
+    };
+
+    // A component of one mode, its matches are order_[mode][begin, end).
+    struct Component
+    {
+        uint8_t mode;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Requires the rows of one whole match, in player order.
+    void add_match(int64_t match_id, GameMode mode, const std::vector<RankedResult> & rows);
+
+    // Splits every mode into components, largest first.
+    std::vector<Component> components();
+
+    void rate_component(const RatingModel & model, const Component & component);
+
+private:
+    std::vector<boost::uuids::uuid> users_;
+
+    std::unordered_map<boost::uuids::uuid,
+                       uint32_t,
+                       boost::hash<boost::uuids::uuid>> index_;
+
+    // Every player of every match, in match order.
+    std::vector<Result> results_;
+
+    // Indexed by elo_ranked_index, in the order they finished.
+    std::array<std::vector<Match>, RANKED_MODES_COUNT> matches_;
+
+    // Indices into matches_, grouped by component, match order within.
+    std::array<std::vector<uint32_t>, RANKED_MODES_COUNT> order_;
+
+    // Indexed by user, written by run.
+    std::array<std::vector<Rating>, RANKED_MODES_COUNT> ratings_;
+    std::array<std::vector<uint8_t>, RANKED_MODES_COUNT> played_;
+
+    // Indexed like results_, written by run.
+    std::vector<int> old_elos_;
+    std::vector<int> new_elos_;
+
+    RatingRebuildStats stats_;
+};
@@ -0,0 +1,286 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#include "replay-archive.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+#include <zlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static constexpr std::string_view SEGMENT_PREFIX = "replays-";
+static constexpr std::string_view SEGMENT_EXTENSION = ".archive";
+
+static constexpr char SEGMENT_MAGIC[4] = {'S', 'T', 'R', 'A'};
+static constexpr uint32_t SEGMENT_VERSION = 1;
+
+// Layout:
+//
+//   header    magic, version, block count, replay count
+//   blocks    file offset, compressed size and raw size of every block
+//   index     match id, block, offset in the block and length of every
+//             replay, sorted by match id
+//   data      the compressed blocks
+struct SegmentHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t n_blocks;
+    uint32_t n_replays;
+};
+
+struct BlockEntry
+{
+    uint64_t offset;
+    uint32_t compressed_size;
+    uint32_t raw_size;
+};
+
+struct IndexEntry
+{
+    int64_t match_id;
+    uint32_t block;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t padding;
+};
+
+template <typename T>
+static void put(std::string & out, const T & value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+ReplayArchive::ReplayArchive(std::filesystem::path dir)
+:dir_(std::move(dir))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+
+    if (ec)
+    {
+        throw std::runtime_error("Could not create archive directory "
+                                 + dir_.string() + ": " + ec.message());
+    }
+}
+
+int64_t ReplayArchive::write_segment(const std::vector<ArchivedReplay> & replays) const
+{
+    if (replays.empty())
+    {
+        throw std::runtime_error("Archive segment with no replays.");
+    }
+
+    std::vector<IndexEntry> index;
+    index.reserve(replays.size());
+
+    std::vector<std::string> raw_blocks(1);
+
+    for (const ArchivedReplay & replay : replays)
+    {
+        if (raw_blocks.back().size() >= ARCHIVE_BLOCK_BYTES)
+        {
+            raw_blocks.emplace_back();
+        }
+
+        std::string & block = raw_blocks.back();
+
+        index.push_back(IndexEntry{replay.match_id,
+                                   static_cast<uint32_t>(raw_blocks.size() - 1),
+                                   static_cast<uint32_t>(block.size()),
+                                   static_cast<uint32_t>(replay.replay.size()),
+                                   0});
+
+        block.append(replay.replay);
+    }
+
+    uint64_t offset = sizeof(SegmentHeader)
+                      + raw_blocks.size() * sizeof(BlockEntry)
+                      + index.size() * sizeof(IndexEntry);
+
+    std::vector<BlockEntry> blocks;
+    std::string data;
+
+    for (const std::string & raw : raw_blocks)
+    {
+        uLongf compressed_size = compressBound(raw.size());
+        std::string compressed(compressed_size, '\0');
+
+        int rc = compress2(reinterpret_cast<Bytef *>(compressed.data()),
+                           &compressed_size,
+                           reinterpret_cast<const Bytef *>(raw.data()),
+                           raw.size(),
+                           Z_DEFAULT_COMPRESSION);
+
+        if (rc != Z_OK)
+        {
+            throw std::runtime_error("Failed to compress an archive block.");
+        }
+
+        blocks.push_back(BlockEntry{offset + data.size(),
+                                    static_cast<uint32_t>(compressed_size),
+                                    static_cast<uint32_t>(raw.size())});
+
+        data.append(compressed.data(), compressed_size);
+    }
+
+    SegmentHeader header;
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.version = SEGMENT_VERSION;
+    header.n_blocks = static_cast<uint32_t>(blocks.size());
+    header.n_replays = static_cast<uint32_t>(index.size());
+
+    std::string file;
+    file.reserve(offset + data.size());
+
+    put(file, header);
+
+    for (const BlockEntry & block : blocks)
+    {
+        put(file, block);
+    }
+
+    for (const IndexEntry & entry : index)
+    {
+        put(file, entry);
+    }
+
+    file.append(data);
+
+    int64_t segment = replays.front().match_id;
+
+    // Written aside and renamed, so a reader never sees half a segment.
+    std::filesystem::path path = segment_path(segment);
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp";
+
+    std::FILE * out = std::fopen(temp_path.string().c_str(), "wb");
+
+    if (!out)
+    {
+        throw std::runtime_error("Could not open " + temp_path.string());
+    }
+
+    bool written = std::fwrite(file.data(), 1, file.size(), out) == file.size()
+                   && std::fflush(out) == 0;
+
+#if !defined(_WIN32)
+    written = written && ::fsync(::fileno(out)) == 0;
+#endif
+
+    std::fclose(out);
+
+    std::error_code ec;
+
+    if (written)
+    {
+        std::filesystem::rename(temp_path, path, ec);
+    }
+
+    if (!written || ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        throw std::runtime_error("Could not write " + path.string());
+    }
+
+    return segment;
+}
+
+std::optional<std::string> ReplayArchive::read(int64_t segment, int64_t match_id) const
+{
+    std::ifstream file(segment_path(segment), std::ios::binary);
+
+    SegmentHeader header;
+
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0
+        || header.version != SEGMENT_VERSION
+        || header.n_replays > ARCHIVE_SEGMENT_MATCHES * 16
+        || header.n_blocks > header.n_replays)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<BlockEntry> blocks(header.n_blocks);
+    std::vector<IndexEntry> index(header.n_replays);
+
+    if (!file.read(reinterpret_cast<char *>(blocks.data()),
+                   blocks.size() * sizeof(BlockEntry))
+        || !file.read(reinterpret_cast<char *>(index.data()),
+                      index.size() * sizeof(IndexEntry)))
+    {
+        return std::nullopt;
+    }
+
+    auto entry = std::lower_bound(index.begin(), index.end(), match_id,
+                                  [](const IndexEntry & e, int64_t id){
+                                      return e.match_id < id;
+                                  });
+
+    if (entry == index.end() || entry->match_id != match_id
+        || entry->block >= blocks.size())
+    {
+        return std::nullopt;
+    }
+
+    const BlockEntry & block = blocks[entry->block];
+
+    if (static_cast<uint64_t>(entry->offset) + entry->length > block.raw_size)
+    {
+        return std::nullopt;
+    }
+
+    std::string compressed(block.compressed_size, '\0');
+
+    if (!file.seekg(static_cast<std::streamoff>(block.offset))
+        || !file.read(compressed.data(), compressed.size()))
+    {
+        return std::nullopt;
+    }
+
+    std::string raw(block.raw_size, '\0');
+    uLongf raw_size = block.raw_size;
+
+    int rc = uncompress(reinterpret_cast<Bytef *>(raw.data()),
+                        &raw_size,
+                        reinterpret_cast<const Bytef *>(compressed.data()),
+                        compressed.size());
+
+    if (rc != Z_OK || raw_size != block.raw_size)
+    {
+        return std::nullopt;
+    }
+
+    return raw.substr(entry->offset, entry->length);
+}
+
+std::filesystem::path ReplayArchive::segment_path(int64_t segment) const
+{
+    return dir_ / (std::string(SEGMENT_PREFIX)
+                   + std::to_string(segment)
+                   + std::string(SEGMENT_EXTENSION));
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Replays of matches older than this are moved out of the database.
+constexpr std::chrono::days ARCHIVE_AFTER{30};
+
+// Replays per segment file, and so per archiving transaction.
+constexpr size_t ARCHIVE_SEGMENT_MATCHES = 4096;
+
+// Segment recorded for a row whose moves could not be archived, so the
+// archiver does not pick it again. Its moves stay in the row.
+constexpr int64_t UNARCHIVABLE_SEGMENT = -1;
+
+// Replays are compressed together in blocks of about this many bytes,
+// so reading one back only inflates its own block.
+constexpr size_t ARCHIVE_BLOCK_BYTES = 8 * 1024;
+
+struct ArchivedReplay
+{
+    int64_t match_id;
+
+    // Move list from encode_replay.
+    std::string replay;
+};
+
+// Compressed, write-once segment files of old replays on local disk.
+//
+// A segment is named after its first match id, which the database keeps
+// next to every match moved into it. Each file starts with an index of
+// its blocks and of the match ids in it, sorted, followed by the zlib
+// compressed blocks. Integers are in host byte order, like spill files.
+//
+// Segments are never modified once written, so reads need no locking.
+class ReplayArchive
+{
+public:
+    // Creates the directory if it does not exist.
+    explicit ReplayArchive(std::filesystem::path dir);
+
+    // Writes and syncs a segment, returning its id. Replays must be sorted
+    // by match id. A segment with the same id is replaced, it can only be
+    // left over from a batch that was never committed.
+    //
+    // Throws std::runtime_error on failure.
+    int64_t write_segment(const std::vector<ArchivedReplay> & replays) const;
+
+    // Nullopt if the segment is missing, corrupt or lacks the match.
+    std::optional<std::string> read(int64_t segment, int64_t match_id) const;
+
+private:
+    std::filesystem::path segment_path(int64_t segment) const;
+
+private:
+    std::filesystem::path dir_;
+};
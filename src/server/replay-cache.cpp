@@ -0,0 +1,130 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "replay-cache.h"
+
+std::string ReplayCacheStats::to_string() const
+{
+    uint64_t requests = hits + misses + coalesced;
+    uint64_t hit_percent = requests ? (100 * (hits + coalesced)) / requests : 0;
+
+    return "Replay cache: "
+           + std::to_string(entries) + " replays, "
+           + std::to_string(bytes / 1024) + " KiB, "
+           + std::to_string(hits) + " hits, "
+           + std::to_string(coalesced) + " coalesced, "
+           + std::to_string(misses) + " misses ("
+           + std::to_string(hit_percent) + "% served without a load), "
+           + std::to_string(evictions) + " evictions";
+}
+
+ReplayCache::Lookup ReplayCache::lookup(uint64_t match_id,
+                                        std::shared_ptr<Session> session)
+{
+    Replay replay;
+
+    {
+        std::lock_guard lock(mutex_);
+
+        auto itr = entries_.find(match_id);
+
+        if (itr == entries_.end())
+        {
+            auto [waiters, first] = loading_.try_emplace(match_id);
+            waiters->second.push_back(std::move(session));
+
+            if (first)
+            {
+                misses_++;
+                return Lookup::Load;
+            }
+
+            coalesced_++;
+            return Lookup::Joined;
+        }
+
+        hits_++;
+        lru_.splice(lru_.begin(), lru_, itr->second.lru);
+        replay = itr->second.replay;
+    }
+
+    session->deliver(std::move(replay));
+    return Lookup::Hit;
+}
+
+void ReplayCache::complete(uint64_t match_id, Replay replay, bool cacheable)
+{
+    std::vector<std::shared_ptr<Session>> waiters;
+
+    {
+        std::lock_guard lock(mutex_);
+
+        auto itr = loading_.find(match_id);
+
+        if (itr != loading_.end())
+        {
+            waiters = std::move(itr->second);
+            loading_.erase(itr);
+        }
+
+        size_t bytes = replay ? replay_bytes(*replay) : 0;
+
+        if (replay && cacheable && bytes <= REPLAY_CACHE_BYTES
+            && !entries_.contains(match_id))
+        {
+            while (bytes_ + bytes > REPLAY_CACHE_BYTES)
+            {
+                auto oldest = entries_.find(lru_.back());
+
+                bytes_ -= oldest->second.bytes;
+                entries_.erase(oldest);
+                lru_.pop_back();
+                evictions_++;
+            }
+
+            lru_.push_front(match_id);
+            entries_.emplace(match_id, Entry{replay, bytes, lru_.begin()});
+            bytes_ += bytes;
+        }
+    }
+
+    if (!replay)
+    {
+        return;
+    }
+
+    for (const auto & session : waiters)
+    {
+        session->deliver(replay);
+    }
+}
+
+ReplayCacheStats ReplayCache::stats() const
+{
+    std::lock_guard lock(mutex_);
+
+    return ReplayCacheStats{entries_.size(),
+                            bytes_,
+                            hits_,
+                            misses_,
+                            coalesced_,
+                            evictions_};
+}
+
+size_t ReplayCache::replay_bytes(const Message & replay)
+{
+    return sizeof(Message) + replay.payload.capacity();
+}
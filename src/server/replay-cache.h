@@ -0,0 +1,101 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "message.h"
+#include "session.h"
+
+// Bytes of serialized replays kept in memory.
+constexpr size_t REPLAY_CACHE_BYTES = 64 * 1024 * 1024;
+
+struct ReplayCacheStats
+{
+    size_t entries;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+
+    // Requests that waited on a load already in flight.
+    uint64_t coalesced;
+    uint64_t evictions;
+
+    std::string to_string() const;
+};
+
+// Byte bounded LRU of serialized MatchReplay messages by match id.
+//
+// Replays never change once recorded, so entries are never invalidated,
+// only evicted. Concurrent misses for the same match are collapsed into
+// one load: the first requester loads it, and everyone who asks in the
+// meantime is answered when it completes. Thread safe.
+class ReplayCache
+{
+public:
+    using Replay = std::shared_ptr<const Message>;
+
+    enum class Lookup
+    {
+        // Delivered from the cache.
+        Hit,
+        // Another load is running, the session will be answered by it.
+        Joined,
+        // The caller must load the replay and call complete.
+        Load
+    };
+
+    Lookup lookup(uint64_t match_id, std::shared_ptr<Session> session);
+
+    // Delivers to everyone waiting on match_id. Only cacheable replays are
+    // kept, a null replay answers nobody, as when the match was corrupt.
+    void complete(uint64_t match_id, Replay replay, bool cacheable);
+
+    ReplayCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        Replay replay;
+        size_t bytes;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    static size_t replay_bytes(const Message & replay);
+
+private:
+    mutable std::mutex mutex_;
+
+    // Most recently used at the front.
+    std::list<uint64_t> lru_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    size_t bytes_{0};
+
+    // Sessions waiting on each load in flight, the loader included.
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<Session>>> loading_;
+
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t coalesced_{0};
+    uint64_t evictions_{0};
+};
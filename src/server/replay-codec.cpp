@@ -0,0 +1,277 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#include "replay-codec.h"
+
+#include <glaze/glaze.hpp>
+
+// Layout, all integers unsigned:
+//
+//   version     1 byte, REPLAY_FORMAT_VERSION
+//   flags       1 byte, none are defined and a decoder rejects any set
+//   count       LEB128 varint, number of commands
+//   commands    count times, each a head byte and one to five more
+//
+// The head byte holds the type in bits 0-2, the sender in bits 3-5 and
+// the form of the rest of the command in bits 6-7:
+//
+//   SHORT   one byte: tank id in bits 0-4, payload_first in bits 5-7.
+//           Moves, rotations, fire and load, whose payload is a direction.
+//   FULL    tank id, payload_first and payload_second as bytes. Placements.
+//   RAW     type and sender bits are zero, followed by sender, type, tank
+//           id, payload_first and payload_second. Anything out of range.
+enum class Form : uint8_t
+{
+    Short = 0,
+    Full = 1,
+    Raw = 2
+};
+
+static constexpr uint8_t FIELD_MASK = 0b111;
+static constexpr uint8_t SHORT_TANK_MASK = 0b11111;
+
+static void put_varint(std::string & out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<char>(value));
+}
+
+static bool take_varint(std::string_view & in, uint64_t & value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint8_t take_byte(std::string_view & in)
+{
+    uint8_t byte = static_cast<uint8_t>(in.front());
+    in.remove_prefix(1);
+    return byte;
+}
+
+std::string encode_replay(const std::vector<CommandHead> & moves)
+{
+    std::string out;
+
+    // Most commands are two bytes, placements four.
+    out.reserve(12 + moves.size() * 2);
+
+    out.push_back(static_cast<char>(REPLAY_FORMAT_VERSION));
+    out.push_back(0);
+    put_varint(out, moves.size());
+
+    for (const CommandHead & cmd : moves)
+    {
+        uint8_t type = static_cast<uint8_t>(cmd.type);
+
+        if (type > FIELD_MASK || cmd.sender > FIELD_MASK)
+        {
+            out.push_back(static_cast<char>(static_cast<uint8_t>(Form::Raw) << 6));
+            out.push_back(static_cast<char>(cmd.sender));
+            out.push_back(static_cast<char>(type));
+            out.push_back(static_cast<char>(cmd.tank_id));
+            out.push_back(static_cast<char>(cmd.payload_first));
+            out.push_back(static_cast<char>(cmd.payload_second));
+            continue;
+        }
+
+        uint8_t head = type | (cmd.sender << 3);
+
+        if (cmd.tank_id <= SHORT_TANK_MASK
+            && cmd.payload_first <= FIELD_MASK
+            && cmd.payload_second == 0)
+        {
+            out.push_back(static_cast<char>(head | (static_cast<uint8_t>(Form::Short) << 6)));
+            out.push_back(static_cast<char>(cmd.tank_id | (cmd.payload_first << 5)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(head | (static_cast<uint8_t>(Form::Full) << 6)));
+            out.push_back(static_cast<char>(cmd.tank_id));
+            out.push_back(static_cast<char>(cmd.payload_first));
+            out.push_back(static_cast<char>(cmd.payload_second));
+        }
+    }
+
+    return out;
+}
+
+std::optional<std::string> replay_from_json(std::string_view json)
+{
+    std::vector<CommandHead> moves;
+
+    // Glaze reads from an owned, null terminated buffer.
+    std::string buffer(json);
+
+    if (glz::read_json(moves, buffer))
+    {
+        return std::nullopt;
+    }
+
+    return encode_replay(moves);
+}
+
+ReplayDecoder::ReplayDecoder(std::string_view encoded)
+:in_(encoded)
+{
+    if (in_.size() < 2
+        || static_cast<uint8_t>(in_[0]) != REPLAY_FORMAT_VERSION
+        || in_[1] != 0)
+    {
+        return;
+    }
+
+    in_.remove_prefix(2);
+
+    uint64_t count = 0;
+
+    // Every command takes at least two bytes, anything more is corrupt.
+    if (!take_varint(in_, count) || count > in_.size() / 2)
+    {
+        return;
+    }
+
+    remaining_ = static_cast<size_t>(count);
+    valid_ = true;
+}
+
+bool ReplayDecoder::valid() const
+{
+    return valid_;
+}
+
+size_t ReplayDecoder::remaining() const
+{
+    return remaining_;
+}
+
+bool ReplayDecoder::next(CommandHead & cmd)
+{
+    if (!valid_ || remaining_ == 0)
+    {
+        return false;
+    }
+
+    if (in_.empty())
+    {
+        valid_ = false;
+        return false;
+    }
+
+    uint8_t head = take_byte(in_);
+    Form form = static_cast<Form>(head >> 6);
+
+    switch (form)
+    {
+        case Form::Short:
+        {
+            if (in_.empty())
+            {
+                valid_ = false;
+                return false;
+            }
+
+            uint8_t packed = take_byte(in_);
+
+            cmd.sender = (head >> 3) & FIELD_MASK;
+            cmd.type = static_cast<CommandType>(head & FIELD_MASK);
+            cmd.tank_id = packed & SHORT_TANK_MASK;
+            cmd.payload_first = packed >> 5;
+            cmd.payload_second = 0;
+            break;
+        }
+        case Form::Full:
+        {
+            if (in_.size() < 3)
+            {
+                valid_ = false;
+                return false;
+            }
+
+            cmd.sender = (head >> 3) & FIELD_MASK;
+            cmd.type = static_cast<CommandType>(head & FIELD_MASK);
+            cmd.tank_id = take_byte(in_);
+            cmd.payload_first = take_byte(in_);
+            cmd.payload_second = take_byte(in_);
+            break;
+        }
+        case Form::Raw:
+        {
+            if (in_.size() < 5)
+            {
+                valid_ = false;
+                return false;
+            }
+
+            cmd.sender = take_byte(in_);
+            cmd.type = static_cast<CommandType>(take_byte(in_));
+            cmd.tank_id = take_byte(in_);
+            cmd.payload_first = take_byte(in_);
+            cmd.payload_second = take_byte(in_);
+            break;
+        }
+        default:
+        {
+            valid_ = false;
+            return false;
+        }
+    }
+
+    remaining_--;
+    return true;
+}
+
+bool decode_replay(std::string_view encoded, std::vector<CommandHead> & moves)
+{
+    ReplayDecoder decoder(encoded);
+
+    if (!decoder.valid())
+    {
+        return false;
+    }
+
+    moves.clear();
+    moves.reserve(decoder.remaining());
+
+    CommandHead cmd;
+
+    while (decoder.next(cmd))
+    {
+        moves.push_back(cmd);
+    }
+
+    return decoder.valid();
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "command.h"
+
+// First byte of every encoded replay. A legacy JSON move list starts
+// with '[' instead, so the two can never be confused.
+constexpr uint8_t REPLAY_FORMAT_VERSION = 1;
+
+// Encodes a move list for storage, see replay-codec.cpp for the layout.
+//
+// Typical commands take two bytes, against about seventy as JSON.
+std::string encode_replay(const std::vector<CommandHead> & moves);
+
+// Re-encodes a legacy JSON move list, nullopt if it does not parse.
+std::optional<std::string> replay_from_json(std::string_view json);
+
+// Reads an encoded replay one command at a time, without copying it.
+//
+// The view must outlive the decoder.
+class ReplayDecoder
+{
+public:
+    explicit ReplayDecoder(std::string_view encoded);
+
+    // False if the header is unreadable, or once a command was corrupt.
+    bool valid() const;
+
+    // Commands not yet read, as declared by the header.
+    size_t remaining() const;
+
+    // False once every command was read or the input is corrupt,
+    // check valid() to tell the two apart.
+    bool next(CommandHead & cmd);
+
+private:
+    std::string_view in_;
+    size_t remaining_{0};
+    bool valid_{false};
+};
+
+// Decodes a whole replay, false if it is corrupt.
+bool decode_replay(std::string_view encoded, std::vector<CommandHead> & moves);
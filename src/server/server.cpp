@@ -16,11 +16,15 @@
 
 #include "server.h"
 #include "console.h"
+#include "spectator-hub.h"
 
 Server::Server(asio::io_context & cntx,
                tcp::endpoint endpoint,
                asio::ssl::context & ssl_cntx,
-               ServerIdentity server_identity)
+               ServerIdentity server_identity,
+               std::string storage_spec,
+               std::string write_behind_dir,
+               std::string archive_dir)
 :calling_context_(cntx),
 server_strand_(cntx.get_executor()),
 ssl_cntx_(ssl_cntx),
@@ -32,10 +36,10 @@ matcher_(cntx,
          // Callback function to send messages to sessions
          [this](uint64_t s_id, Message msg)
             {
-            auto target_session = sessions_.find(s_id);
-            if (target_session != sessions_.end())
+            // Called from match strands, the registry is safe to read here.
+            if (auto target_session = sessions_.find(s_id))
             {
-                target_session->second->deliver(std::move(msg));
+                target_session->deliver(std::move(msg));
             }
             // Otherwise, session no longer exists!
             },
@@ -71,13 +75,23 @@ db_(cntx,
         this->notify_subsystem_shutdown();
     },
     // Pass a reference to the user manager.
-    user_manager_
+    user_manager_,
+    std::move(storage_spec),
+    std::move(write_behind_dir),
+    std::move(archive_dir)
 )
 {
     // Load bans into the server's map on startup.
     //
     // This will block the server thread until they are loaded.
-    bans_ = db_.load_bans();
+    bans_.load(db_.load_bans());
+
+    // Ranks are served from memory, so every rating is loaded up front.
+    size_t ratings = db_.load_leaderboard();
+
+    std::string lmsg = "Loaded " + std::to_string(ratings) + " ratings into the leaderboard.";
+    Console::instance().log(std::move(lmsg),
+                            LogLevel::INFO);
 
     // Accept connections in a loop.
     do_accept();
@@ -96,14 +110,30 @@ void Server::CONSOLE_ban_user(std::string username,
                  std::move(reason));
 }
 
-void Server::CONSOLE_ban_ip(std::string ip,
+void Server::CONSOLE_ban_ip(IPPrefix prefix,
                             std::chrono::system_clock::time_point banned_until)
 {
-    db_.ban_ip(std::move(ip),
+    bans_.add(prefix, banned_until);
+
+    db_.ban_ip(prefix.to_string(),
                std::move(banned_until));
 
-    // TODO <feature>: evict users who are under this IP and insert into
-    //                 the list of server IP bans.
+    // TODO <feature>: evict users who are under this IP or range.
+}
+
+std::string Server::CONSOLE_hash_stats() const
+{
+    return db_.hash_stats().to_string();
+}
+
+std::string Server::CONSOLE_replay_stats() const
+{
+    return db_.replay_stats().to_string();
+}
+
+void Server::CONSOLE_migrate_replays()
+{
+    db_.migrate_replays();
 }
 
 // Shutdown smoothly.
@@ -136,9 +166,9 @@ void Server::shutdown()
     db_.async_shutdown();
 
     // Close all sessions.
-    for (auto & key : sessions_)
+    for (auto & session : sessions_.snapshot())
     {
-        key.second->close_session();
+        session->close_session();
     }
 
     // Now, we wait until notify_subsystem_shutdown turns off the io context
@@ -172,27 +202,16 @@ void Server::handle_accept(const boost::system::error_code & ec,
             return;
         }
 
-        // Handle IP bans.
+        // Handle IP bans before spending anything on a TLS handshake.
         boost::system::error_code endpoint_ec;
-        auto client_ip = socket.remote_endpoint(endpoint_ec).address().to_string();
-        auto ip_itr = bans_.find(client_ip);
-        auto now = std::chrono::system_clock::now();
+        auto client_address = socket.remote_endpoint(endpoint_ec).address();
 
         // Drop connections of banned players.
-        if(ip_itr != bans_.end() && now < ip_itr->second)
+        if (auto ban_expiration = check_ip_ban(client_address))
         {
-            // Send ban message.
-            auto ban_expiration = ip_itr->second;
-            send_banned(ban_expiration, std::move(socket));
+            send_banned(*ban_expiration, std::move(socket));
             return;
         }
-        // If a ban exists but expired, clean it up
-        else if (ip_itr != bans_.end())
-        {
-            bans_.erase(ip_itr);
-            // Tell the database to drop this ban entry.
-            db_.unban_ip(client_ip);
-        }
 
         // Increment and store the next session ID.
         uint64_t s_id = next_session_id_++;
@@ -218,7 +237,7 @@ void Server::handle_accept(const boost::system::error_code & ec,
         );
 
         // Add to map of sessions and start the session.
-        sessions_.emplace(s_id, session);
+        sessions_.insert(s_id, session);
         session->start();
     }
 }
@@ -237,6 +256,12 @@ void Server::remove_session(const ptr & session)
             matcher_.cancel(session, static_cast<GameMode>(mode), false);
         }
 
+        // Stop sending spectator frames to the closed session.
+        if (auto hub = session->spectating())
+        {
+            hub->remove(session->id());
+        }
+
         // Call for the user manager to handle removal.
         //
         // If there is no game for the user, we drop the user struct from memory.
@@ -292,13 +317,15 @@ try {
             }
 
             std::string client_ip;
+            asio::ip::address client_address;
 
             // Grab the current client IP.
             try
             {
                 boost::system::error_code endpoint_ec;
-                client_ip = session->
-                            socket().remote_endpoint(endpoint_ec).address().to_string();
+                client_address = session->
+                                 socket().remote_endpoint(endpoint_ec).address();
+                client_ip = client_address.to_string();
             }
             catch (const std::exception & e)
             {
@@ -311,20 +338,11 @@ try {
             // Necessary if this person's user was banned
             // before they authenticated and thus their IP
             // was not filtered by the accept loop.
-
-            // First, grab the server's ban map mutex.
-            std::lock_guard<std::mutex> lock(bans_mutex_);
-
-            auto ip_itr = bans_.find(client_ip);
-            auto now = std::chrono::system_clock::now();
-
-            if(ip_itr != bans_.end() && now < ip_itr->second)
+            if (auto ban_expiration = check_ip_ban(client_address))
             {
                 // Send a banned message and close the session.
-                auto ban_expiration = ip_itr->second;
-
                 BanMessage banned;
-                banned.time_till_unban = ban_expiration;
+                banned.time_till_unban = *ban_expiration;
 
                 Message banned_msg;
                 banned_msg.create_serialized(banned);
@@ -354,13 +372,15 @@ try {
             }
 
             std::string client_ip;
+            asio::ip::address client_address;
 
             // Grab the current client IP.
             try
             {
                 boost::system::error_code endpoint_ec;
-                client_ip = session->
-                            socket().remote_endpoint(endpoint_ec).address().to_string();
+                client_address = session->
+                                 socket().remote_endpoint(endpoint_ec).address();
+                client_ip = client_address.to_string();
             }
             catch (const std::exception & e)
             {
@@ -373,20 +393,11 @@ try {
             // Necessary if this person's user was banned
             // before they authenticated and thus their IP
             // was not filtered by the accept loop.
-
-            // First, grab the server's ban map mutex.
-            std::lock_guard<std::mutex> lock(bans_mutex_);
-
-            auto ip_itr = bans_.find(client_ip);
-            auto now = std::chrono::system_clock::now();
-
-            if(ip_itr != bans_.end() && now < ip_itr->second)
+            if (auto ban_expiration = check_ip_ban(client_address))
             {
                 // Send a banned message and close the session.
-                auto ban_expiration = ip_itr->second;
-
                 BanMessage banned;
-                banned.time_till_unban = ban_expiration;
+                banned.time_till_unban = *ban_expiration;
 
                 Message banned_msg;
                 banned_msg.create_serialized(banned);
@@ -615,6 +626,7 @@ try {
             break;
         }
         case HeaderType::SendCommand:
+        case HeaderType::SendTurnBatch:
         {
             // Prevent actions before login.
             if (!session->is_authenticated())
@@ -681,6 +693,64 @@ try {
             db_.fetch_new_matches(user_id, mode, session);
             break;
         }
+        case HeaderType::FetchMatchHistoryPage:
+        {
+            // Prevent actions before login.
+            if (!session->is_authenticated())
+            {
+                Message not_authorized;
+                not_authorized.create_serialized(HeaderType::Unauthorized);
+                session->deliver(not_authorized);
+                break;
+            }
+
+            bool op_status = false;
+            MatchHistoryPageRequest req = msg.to_history_page_request(op_status);
+
+            if (!op_status)
+            {
+                Message b_req;
+                b_req.create_serialized(HeaderType::BadMessage);
+                session->deliver(b_req);
+
+                session->close_session();
+                return;
+            }
+
+            boost::uuids::uuid user_id = (session->get_user_data()).user_id;
+
+            db_.fetch_match_page(user_id, req, session);
+            break;
+        }
+        case HeaderType::FetchLeaderboard:
+        {
+            // Prevent actions before login.
+            if (!session->is_authenticated())
+            {
+                Message not_authorized;
+                not_authorized.create_serialized(HeaderType::Unauthorized);
+                session->deliver(not_authorized);
+                break;
+            }
+
+            bool op_status = false;
+            LeaderboardRequest req = msg.to_leaderboard_request(op_status);
+
+            if (!op_status)
+            {
+                Message b_req;
+                b_req.create_serialized(HeaderType::BadMessage);
+                session->deliver(b_req);
+
+                session->close_session();
+                return;
+            }
+
+            boost::uuids::uuid user_id = (session->get_user_data()).user_id;
+
+            db_.fetch_leaderboard(user_id, req, session);
+            break;
+        }
         case HeaderType::MatchReplayRequest:
         {
             // Prevent actions before login.
@@ -696,6 +766,48 @@ try {
             db_.fetch_replay(req, session);
             break;
         }
+        case HeaderType::SpectateMatch:
+        {
+            // Prevent actions before login.
+            if (!session->is_authenticated())
+            {
+                Message not_authorized;
+                not_authorized.create_serialized(HeaderType::Unauthorized);
+                session->deliver(not_authorized);
+                break;
+            }
+
+            bool op_status = false;
+            SpectateRequest req = msg.to_spectate_request(op_status);
+
+            // Players can not spectate while in a match.
+            if (!op_status || session->current_match())
+            {
+                Message failed;
+                failed.create_serialized(HeaderType::SpectateFailed);
+                session->deliver(failed);
+                break;
+            }
+
+            if (req.by_user)
+            {
+                user_manager_->spectate_friend(session, req.user_id, req.fogged);
+            }
+            else
+            {
+                matcher_.spectate(session, req.match_id, req.fogged);
+            }
+            break;
+        }
+        case HeaderType::StopSpectating:
+        {
+            if (auto hub = session->spectating())
+            {
+                session->bind_spectating({});
+                hub->remove(session->id());
+            }
+            break;
+        }
         default:
             // do nothing, should never happen
             break;
@@ -765,6 +877,34 @@ void Server::on_ban_user(boost::uuids::uuid user_id,
     });
 }
 
+std::optional<std::chrono::system_clock::time_point>
+Server::check_ip_ban(const asio::ip::address & address)
+{
+    auto now = std::chrono::system_clock::now();
+
+    BanLookup lookup = bans_.check(address, now);
+
+    if (lookup.saw_expired
+        && !ban_prune_queued_.exchange(true, std::memory_order_acq_rel))
+    {
+        asio::post(calling_context_, [this]{ prune_ip_bans(); });
+    }
+
+    return lookup.banned_until;
+}
+
+void Server::prune_ip_bans()
+{
+    // Cleared first, so a ban expiring during the prune queues another.
+    ban_prune_queued_.store(false, std::memory_order_release);
+
+    // Clean up bans that have run out, and tell the database to drop them.
+    for (const auto & prefix : bans_.prune_expired(std::chrono::system_clock::now()))
+    {
+        db_.unban_ip(prefix.to_string());
+    }
+}
+
 void Server::send_banned(std::chrono::system_clock::time_point banned_until,
                          tcp::socket socket)
 {
@@ -24,6 +24,8 @@
 #include "database.h"
 #include "asset-resolver.h"
 #include "server-identity.h"
+#include "ban-index.h"
+#include "session-registry.h"
 
 static constexpr int SHUTDOWN_COMPONENTS_COUNT = 3;
 
@@ -42,15 +44,24 @@ public:
     Server(asio::io_context & cntx,
            tcp::endpoint endpoint,
            asio::ssl::context & ssl_cntx,
-           ServerIdentity server_identity);
+           ServerIdentity server_identity,
+           std::string storage_spec = "postgres",
+           std::string write_behind_dir = "",
+           std::string archive_dir = "");
 
     void CONSOLE_ban_user(std::string username,
                           std::chrono::system_clock::time_point banned_until,
                           std::string reason);
 
-    void CONSOLE_ban_ip(std::string username,
+    void CONSOLE_ban_ip(IPPrefix prefix,
                         std::chrono::system_clock::time_point banned_until);
 
+    std::string CONSOLE_hash_stats() const;
+
+    std::string CONSOLE_replay_stats() const;
+
+    void CONSOLE_migrate_replays();
+
     void shutdown();
 
     void do_accept();
@@ -74,6 +85,15 @@ private:
                      std::chrono::system_clock::time_point banned_until,
                      std::string reason);
 
+    // Returns the unban time if the address is banned. Expired bans
+    // seen along the way are pruned later by prune_ip_bans.
+    std::optional<std::chrono::system_clock::time_point>
+    check_ip_ban(const asio::ip::address & address);
+
+    // Drops expired bans from the index and database. Runs off the
+    // accept strand since it rebuilds the index.
+    void prune_ip_bans();
+
     void send_banned(std::chrono::system_clock::time_point banned_until,
                      tcp::socket socket);
 
@@ -103,13 +123,14 @@ private:
     // we can experience memory fragmentation if many sessions are opened
     // and closed between server reboots.
     //
-    // By using an unordered map we end up preventing this, though, we
+    // By using a (sharded) hash map we end up preventing this, though, we
     // get worse cache locality of course.
     //
     // This trade off is perfectly reasonable for a server however.
     //
-    // We map each session ID to a session with this structure.
-    std::unordered_map<uint64_t, ptr> sessions_;
+    // We map each session ID to a session with this structure. It is
+    // written on the server strand but read from every match strand.
+    SessionRegistry sessions_;
 
     // We would prefer to hand off login requests to a login manager
     // just like we do with match making requests.
@@ -121,11 +142,13 @@ private:
     // Class to post calls to the postgreSQL database.
     Database db_;
 
-    // Hash map of banned IPs and their unban times.
-    std::unordered_map<std::string,
-                        std::chrono::system_clock::time_point> bans_;
+    // Banned IPs and CIDR ranges with their unban times. Lookups do not
+    // take a lock, so this is safe to check from any handler.
+    BanIndex bans_;
 
-    std::mutex bans_mutex_;
+    // Set while a prune_ip_bans task is queued, so a burst of lookups
+    // hitting expired bans only queues one.
+    std::atomic<bool> ban_prune_queued_{false};
 
     // Increasing counter for the next session ID.
     uint64_t next_session_id_{1};
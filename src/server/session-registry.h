@@ -0,0 +1,138 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "session.h"
+
+// Number of shards, must be a power of two.
+static constexpr size_t SESSION_REGISTRY_SHARDS = 64;
+
+static_assert((SESSION_REGISTRY_SHARDS & (SESSION_REGISTRY_SHARDS - 1)) == 0);
+
+// Map of session IDs to sessions which can be used from any strand.
+//
+// Sessions are split across shards by ID, each with its own reader/writer
+// lock. Session IDs are handed out sequentially, so the low bits spread
+// them evenly. Lookups from match strands only contend when they hit the
+// same shard as an insert or removal.
+//
+// Lookups hand out a shared pointer, so a session removed while a message
+// is being delivered to it stays alive until the delivery is done.
+class SessionRegistry
+{
+public:
+    using ptr = std::shared_ptr<Session>;
+
+    void insert(uint64_t session_id, ptr session)
+    {
+        Shard & shard = shard_for(session_id);
+
+        std::unique_lock lock(shard.mutex);
+        if (shard.sessions.emplace(session_id, std::move(session)).second)
+        {
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void erase(uint64_t session_id)
+    {
+        ptr removed;
+        Shard & shard = shard_for(session_id);
+
+        {
+            std::unique_lock lock(shard.mutex);
+            auto itr = shard.sessions.find(session_id);
+
+            if (itr == shard.sessions.end())
+            {
+                return;
+            }
+
+            // Destroy the session outside of the lock.
+            removed = std::move(itr->second);
+            shard.sessions.erase(itr);
+        }
+
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Returns null if the session no longer exists.
+    ptr find(uint64_t session_id) const
+    {
+        const Shard & shard = shard_for(session_id);
+
+        std::shared_lock lock(shard.mutex);
+        auto itr = shard.sessions.find(session_id);
+
+        return (itr != shard.sessions.end()) ? itr->second : nullptr;
+    }
+
+    size_t size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    // Copy of every session, for infrequent bulk operations like shutdown.
+    std::vector<ptr> snapshot() const
+    {
+        std::vector<ptr> sessions;
+        sessions.reserve(size());
+
+        for (const Shard & shard : shards_)
+        {
+            std::shared_lock lock(shard.mutex);
+
+            for (const auto & [id, session] : shard.sessions)
+            {
+                sessions.push_back(session);
+            }
+        }
+
+        return sessions;
+    }
+
+private:
+    // Padded so that shards do not share cache lines.
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, ptr> sessions;
+    };
+
+    Shard & shard_for(uint64_t session_id)
+    {
+        return shards_[session_id & (SESSION_REGISTRY_SHARDS - 1)];
+    }
+
+    const Shard & shard_for(uint64_t session_id) const
+    {
+        return shards_[session_id & (SESSION_REGISTRY_SHARDS - 1)];
+    }
+
+private:
+    std::array<Shard, SESSION_REGISTRY_SHARDS> shards_;
+
+    std::atomic<size_t> size_{0};
+};
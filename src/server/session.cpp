@@ -56,6 +56,20 @@ void Session::start()
                     return;
                 }
 
+                if (ssl_socket_.ktls_mode()
+                    && !(ssl_socket_.ktls_send() && ssl_socket_.ktls_recv()))
+                {
+                    std::string lmsg = "kTLS unavailable for session "
+                                       + std::to_string(session_id_)
+                                       + " (send: "
+                                       + std::to_string(ssl_socket_.ktls_send())
+                                       + ", recv: "
+                                       + std::to_string(ssl_socket_.ktls_recv())
+                                       + "), using userspace TLS.";
+
+                    Console::instance().log(std::move(lmsg), LogLevel::INFO);
+                }
+
                 this->do_read_header();
                 this->start_ping();
         }));
@@ -67,7 +81,7 @@ void Session::deliver(Message msg)
         // if the write queue is currently not empty
         bool write_in_progress = !self->write_queue_.empty();
 
-        self->write_queue_.push_back(std::move(m));
+        self->write_queue_.push_back(OutgoingMessage{std::move(m), nullptr});
 
         // Prevent malicious clients from intentionally building up a large
         // queue of messages that they refuse to read any faster than the
@@ -88,6 +102,48 @@ void Session::deliver(Message msg)
     });
 }
 
+void Session::deliver(std::shared_ptr<const Message> msg)
+{
+    asio::post(strand_, [self = shared_from_this(), m = std::move(msg)]() mutable {
+        bool write_in_progress = !self->write_queue_.empty();
+
+        self->write_queue_.push_back(OutgoingMessage{Message{}, std::move(m)});
+
+        // Same limit as our own messages, see deliver.
+        if (self->write_queue_.size() > MAX_MESSAGE_BACKLOG)
+        {
+            boost::system::error_code ignored;
+            self->ssl_socket_.lowest_layer().cancel(ignored);
+            return;
+        }
+
+        if (!write_in_progress)
+        {
+            self->do_write();
+        }
+    });
+}
+
+void Session::deliver_shared(std::shared_ptr<const Message> msg)
+{
+    asio::post(strand_, [self = shared_from_this(), m = std::move(msg)]() mutable {
+        // Frames are full snapshots, a newer one will follow.
+        if (self->write_queue_.size() >= MAX_SHARED_BACKLOG)
+        {
+            return;
+        }
+
+        bool write_in_progress = !self->write_queue_.empty();
+
+        self->write_queue_.push_back(OutgoingMessage{Message{}, std::move(m)});
+
+        if (!write_in_progress)
+        {
+            self->do_write();
+        }
+    });
+}
+
 void Session::close_session()
 {
     // if already being closed, ignore call and don't
@@ -306,7 +362,7 @@ void Session::do_write()
 {
     auto self = shared_from_this();
 
-    const Message& msg = write_queue_.front();
+    const Message& msg = write_queue_.front().get();
 
     // msg buffer
     std::array<asio::const_buffer, 2> bufs
@@ -28,6 +28,10 @@
 #include "message.h"
 #include "header.h"
 #include "user-data.h"
+#include "tls-stream.h"
+
+class MatchInstance;
+class SpectatorHub;
 
 // Seconds to wait before closing session when data is not sent.
 static constexpr uint64_t READ_TIMEOUT = 10;
@@ -46,6 +50,9 @@ static constexpr uint64_t MAX_TOKENS = 10 * TOKENS_REFILL_RATE;
 // Upper bound on messages waiting to be written.
 static constexpr size_t MAX_MESSAGE_BACKLOG = 50;
 
+// Shared frames are dropped once this many messages are waiting.
+static constexpr size_t MAX_SHARED_BACKLOG = 4;
+
 // Command to get the cost in tokens of a command.
 constexpr uint64_t weight_of_cmd(Header h)
 {
@@ -65,8 +72,12 @@ constexpr uint64_t weight_of_cmd(Header h)
 
         // Match result requests (involves heavy database calls).
         case HeaderType::FetchMatchHistory: return 20;
+        case HeaderType::FetchMatchHistoryPage: return 20;
         case HeaderType::MatchReplayRequest: return 20;
 
+        // Answered from memory.
+        case HeaderType::FetchLeaderboard: return 5;
+
         // Message passing variable string for text.
         case HeaderType::DirectTextMessage: return 2 + (h.payload_len / 100);
         case HeaderType::MatchTextMessage: return 2 + (h.payload_len / 100);
@@ -75,7 +86,10 @@ constexpr uint64_t weight_of_cmd(Header h)
         case HeaderType::QueueMatch: return 2;
         case HeaderType::CancelMatch: return 1;
         case HeaderType::SendCommand: return 4;
+        case HeaderType::SendTurnBatch: return 4;
         case HeaderType::ForfeitMatch: return 1;
+        case HeaderType::SpectateMatch: return 5;
+        case HeaderType::StopSpectating: return 1;
 
         default: return 0;
     }
@@ -115,6 +129,15 @@ public:
     // use deliver(std::move(msg)) to avoid copies.
     void deliver(Message msg);
 
+    // Send a message shared with other sessions which must arrive, such
+    // as a replay. Queued like deliver, without copying the message.
+    void deliver(std::shared_ptr<const Message> msg);
+
+    // Send a message shared with other sessions, such as a spectator
+    // frame. The frame is dropped instead of queued if the client is
+    // falling behind, so slow spectators can not build up memory.
+    void deliver_shared(std::shared_ptr<const Message> msg);
+
     void close_session();
 
     void set_session_data(UserData user_data);
@@ -141,6 +164,17 @@ public:
 
     inline void set_has_matches(bool value, GameMode mode);
 
+    // The match this session is playing in, if any. Lets commands
+    // go straight to the match instead of through the match maker.
+    inline void bind_match(std::weak_ptr<MatchInstance> match);
+
+    inline std::shared_ptr<MatchInstance> current_match() const;
+
+    // The match this session is watching, if any.
+    inline void bind_spectating(std::weak_ptr<SpectatorHub> hub);
+
+    inline std::shared_ptr<SpectatorHub> spectating() const;
+
 private:
     void start_ping();
 
@@ -161,7 +195,7 @@ private:
 public:
 
 private:
-    asio::ssl::stream<tcp::socket> ssl_socket_;
+    TlsStream ssl_socket_;
     asio::strand<asio::io_context::executor_type> strand_;
 
     // We need to ensure clients are not connecting and
@@ -218,10 +252,28 @@ private:
     mutable std::mutex user_data_mutex_;
     UserData user_data_;
 
+    // Set and cleared by the user manager as matches start and end.
+    mutable std::mutex match_mutex_;
+    std::weak_ptr<MatchInstance> current_match_;
+    std::weak_ptr<SpectatorHub> spectating_;
+
     // Data related members.
     Header incoming_header_;
     std::vector<uint8_t> incoming_body_;
-    std::deque<Message> write_queue_;
+
+    // Either our own message or one shared with other sessions.
+    struct OutgoingMessage
+    {
+        Message owned;
+        std::shared_ptr<const Message> shared;
+
+        const Message & get() const
+        {
+            return shared ? *shared : owned;
+        }
+    };
+
+    std::deque<OutgoingMessage> write_queue_;
 
     // Callbacks.
     MessageHandler on_message_relay_;
@@ -284,3 +336,29 @@ inline void Session::set_has_matches(bool value, GameMode mode)
     has_new_matches_[static_cast<uint8_t>(mode)] = value;
     return;
 }
+
+inline void Session::bind_match(std::weak_ptr<MatchInstance> match)
+{
+    std::lock_guard<std::mutex> lock(match_mutex_);
+    current_match_ = std::move(match);
+    return;
+}
+
+inline std::shared_ptr<MatchInstance> Session::current_match() const
+{
+    std::lock_guard<std::mutex> lock(match_mutex_);
+    return current_match_.lock();
+}
+
+inline void Session::bind_spectating(std::weak_ptr<SpectatorHub> hub)
+{
+    std::lock_guard<std::mutex> lock(match_mutex_);
+    spectating_ = std::move(hub);
+    return;
+}
+
+inline std::shared_ptr<SpectatorHub> Session::spectating() const
+{
+    std::lock_guard<std::mutex> lock(match_mutex_);
+    return spectating_.lock();
+}
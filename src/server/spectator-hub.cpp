@@ -0,0 +1,373 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "spectator-hub.h"
+
+#include <algorithm>
+
+SpectatorHub::SpectatorHub(asio::io_context & cntx, uint8_t n_streams)
+:cntx_(cntx),
+strand_(cntx.get_executor()),
+timer_(cntx),
+n_streams_(n_streams),
+stream_counts_(std::make_unique<std::atomic<uint32_t>[]>(n_streams)),
+groups_(n_streams),
+latest_(n_streams)
+{
+}
+
+bool SpectatorHub::active() const
+{
+    return total_.load(std::memory_order_relaxed) > 0;
+}
+
+bool SpectatorHub::watching(uint8_t stream) const
+{
+    return stream < n_streams_
+           && stream_counts_[stream].load(std::memory_order_relaxed) > 0;
+}
+
+void SpectatorHub::set_static_data(Frame static_data)
+{
+    asio::post(strand_,
+        [self = shared_from_this(), static_data = std::move(static_data)]{
+            self->static_data_ = std::move(static_data);
+        });
+}
+
+void SpectatorHub::add(Session::ptr session, uint8_t stream)
+{
+    asio::post(strand_,
+        [self = shared_from_this(), session = std::move(session), stream]{
+
+        if (self->closed_
+            || stream >= self->n_streams_
+            || self->spectators_.size() >= MAX_SPECTATORS_PER_MATCH)
+        {
+            Message failed;
+            failed.create_serialized(HeaderType::SpectateFailed);
+            session->deliver(std::move(failed));
+            return;
+        }
+
+        // Switching streams is a remove and add.
+        auto itr = std::find_if(self->spectators_.begin(),
+                                self->spectators_.end(),
+                                [id = session->id()](const Spectator & s)
+                                {
+                                    return s.session_id == id;
+                                });
+
+        if (itr != self->spectators_.end())
+        {
+            uint8_t old_stream = itr->stream;
+            self->spectators_.erase(itr);
+            self->stream_counts_[old_stream].fetch_sub(1, std::memory_order_relaxed);
+            self->total_.fetch_sub(1, std::memory_order_relaxed);
+            self->rebuild_groups(old_stream);
+        }
+
+        self->spectators_.push_back(Spectator{session, session->id(), stream});
+        self->stream_counts_[stream].fetch_add(1, std::memory_order_relaxed);
+        self->total_.fetch_add(1, std::memory_order_relaxed);
+        self->rebuild_groups(stream);
+
+        session->bind_spectating(self->weak_from_this());
+
+        // Catch the spectator up with the match so far.
+        if (self->static_data_)
+        {
+            session->deliver_shared(self->static_data_);
+        }
+
+        if (self->latest_[stream])
+        {
+            session->deliver_shared(self->latest_[stream]);
+        }
+    });
+}
+
+void SpectatorHub::remove(uint64_t session_id)
+{
+    asio::post(strand_, [self = shared_from_this(), session_id]{
+
+        auto itr = std::find_if(self->spectators_.begin(),
+                                self->spectators_.end(),
+                                [session_id](const Spectator & s)
+                                {
+                                    return s.session_id == session_id;
+                                });
+
+        if (itr == self->spectators_.end())
+        {
+            return;
+        }
+
+        uint8_t stream = itr->stream;
+        self->spectators_.erase(itr);
+        self->stream_counts_[stream].fetch_sub(1, std::memory_order_relaxed);
+        self->total_.fetch_sub(1, std::memory_order_relaxed);
+        self->rebuild_groups(stream);
+    });
+}
+
+void SpectatorHub::publish(std::vector<Frame> frames)
+{
+    asio::post(strand_,
+        [self = shared_from_this(),
+         due = steady_clock::now() + SPECTATOR_DELAY,
+         frames = std::move(frames)]() mutable {
+
+        if (self->closed_)
+        {
+            return;
+        }
+
+        // Frames are full snapshots, losing old ones only skips ahead.
+        if (self->delayed_.size() >= MAX_DELAYED_FRAMES)
+        {
+            self->delayed_.pop_front();
+        }
+
+        self->delayed_.push_back(DelayedFrames{due, std::move(frames), nullptr});
+        self->arm_timer();
+    });
+}
+
+void SpectatorHub::close(Frame final_message)
+{
+    asio::post(strand_,
+        [self = shared_from_this(),
+         due = steady_clock::now() + SPECTATOR_DELAY,
+         final_message = std::move(final_message)]() mutable {
+
+        if (self->closed_)
+        {
+            return;
+        }
+
+        self->closed_ = true;
+
+        // Still delayed, so the result is not spoiled early.
+        self->delayed_.push_back(DelayedFrames{due, {}, std::move(final_message)});
+        self->arm_timer();
+    });
+}
+
+void SpectatorHub::shutdown()
+{
+    asio::post(strand_, [self = shared_from_this()]{
+        self->closed_ = true;
+        self->timer_.cancel();
+        self->delayed_.clear();
+        self->clear();
+    });
+}
+
+void SpectatorHub::arm_timer()
+{
+    if (timer_armed_ || delayed_.empty())
+    {
+        return;
+    }
+
+    timer_armed_ = true;
+
+    timer_.expires_at(delayed_.front().due);
+    timer_.async_wait(asio::bind_executor(strand_,
+        [self = shared_from_this()](boost::system::error_code ec)
+        {
+            self->on_timer(ec);
+        }));
+}
+
+void SpectatorHub::on_timer(boost::system::error_code ec)
+{
+    timer_armed_ = false;
+
+    if (ec)
+    {
+        return;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+
+    // Only the newest due frame of each stream needs to go out.
+    std::vector<Frame> due(n_streams_);
+    Frame final_message;
+
+    while (!delayed_.empty() && delayed_.front().due <= now)
+    {
+        DelayedFrames & entry = delayed_.front();
+
+        for (size_t i = 0; i < entry.frames.size() && i < n_streams_; i++)
+        {
+            if (entry.frames[i])
+            {
+                due[i] = std::move(entry.frames[i]);
+            }
+        }
+
+        if (entry.final_message)
+        {
+            final_message = std::move(entry.final_message);
+        }
+
+        delayed_.pop_front();
+    }
+
+    for (uint8_t stream = 0; stream < n_streams_; stream++)
+    {
+        if (due[stream])
+        {
+            latest_[stream] = due[stream];
+            fan_out(stream, due[stream]);
+        }
+    }
+
+    if (final_message)
+    {
+        fan_out_all(final_message);
+        clear();
+        return;
+    }
+
+    arm_timer();
+}
+
+void SpectatorHub::fan_out(uint8_t stream, const Frame & frame, bool terminal)
+{
+    for (const auto & group : groups_[stream])
+    {
+        asio::post(cntx_,
+            [self = shared_from_this(), group, frame, terminal]{
+
+            bool saw_expired = false;
+
+            for (const auto & weak_session : *group)
+            {
+                if (auto session = weak_session.lock())
+                {
+                    if (terminal)
+                    {
+                        session->deliver(frame);
+                    }
+                    else
+                    {
+                        session->deliver_shared(frame);
+                    }
+                }
+                else
+                {
+                    saw_expired = true;
+                }
+            }
+
+            // Disconnected spectators are cleaned up lazily.
+            if (saw_expired)
+            {
+                asio::post(self->strand_, [self]{
+                    self->prune_expired();
+                });
+            }
+        });
+    }
+}
+
+void SpectatorHub::fan_out_all(const Frame & frame)
+{
+    for (uint8_t stream = 0; stream < n_streams_; stream++)
+    {
+        fan_out(stream, frame, true);
+    }
+}
+
+void SpectatorHub::rebuild_groups(uint8_t stream)
+{
+    std::vector<std::shared_ptr<const Group>> groups;
+    Group current;
+
+    for (const Spectator & spectator : spectators_)
+    {
+        if (spectator.stream != stream)
+        {
+            continue;
+        }
+
+        current.push_back(spectator.session);
+
+        if (current.size() == SPECTATORS_PER_GROUP)
+        {
+            groups.push_back(std::make_shared<const Group>(std::move(current)));
+            current = Group{};
+        }
+    }
+
+    if (!current.empty())
+    {
+        groups.push_back(std::make_shared<const Group>(std::move(current)));
+    }
+
+    groups_[stream] = std::move(groups);
+}
+
+void SpectatorHub::prune_expired()
+{
+    std::vector<bool> changed(n_streams_, false);
+
+    std::erase_if(spectators_, [&](const Spectator & s)
+    {
+        if (!s.session.expired())
+        {
+            return false;
+        }
+
+        changed[s.stream] = true;
+        stream_counts_[s.stream].fetch_sub(1, std::memory_order_relaxed);
+        total_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    });
+
+    for (uint8_t stream = 0; stream < n_streams_; stream++)
+    {
+        if (changed[stream])
+        {
+            rebuild_groups(stream);
+        }
+    }
+}
+
+void SpectatorHub::clear()
+{
+    for (const Spectator & spectator : spectators_)
+    {
+        if (auto session = spectator.session.lock())
+        {
+            session->bind_spectating({});
+        }
+    }
+
+    spectators_.clear();
+
+    for (uint8_t stream = 0; stream < n_streams_; stream++)
+    {
+        groups_[stream].clear();
+        latest_[stream].reset();
+        stream_counts_[stream].store(0, std::memory_order_relaxed);
+    }
+
+    total_.store(0, std::memory_order_relaxed);
+}
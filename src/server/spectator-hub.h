@@ -0,0 +1,151 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "session.h"
+
+namespace asio = boost::asio;
+
+// Spectators see the match this far behind the players, so they can not
+// relay hidden positions to someone who is playing (ghosting).
+static constexpr std::chrono::seconds SPECTATOR_DELAY{10};
+
+static constexpr size_t MAX_SPECTATORS_PER_MATCH = 4096;
+
+// Spectators delivered to by a single fan-out task.
+static constexpr size_t SPECTATORS_PER_GROUP = 64;
+
+// Frames older than this are dropped if the delay queue backs up.
+static constexpr size_t MAX_DELAYED_FRAMES = 256;
+
+// Stream 0 is the global view, stream 1 + p is the fogged view of player p.
+static constexpr uint8_t GLOBAL_SPECTATOR_STREAM = 0;
+
+// Delivers delayed match frames to any number of spectator sessions.
+//
+// The match serializes each view stream once per update and hands the
+// frames over with publish(). Everything else runs on the hub's own
+// strand, so spectators never hold up the match strand or the players'
+// sessions. Once a frame is due, the hub posts one task per group of
+// SPECTATORS_PER_GROUP sessions, and each task hands the same shared
+// buffer to its sessions. Sessions drop frames they can not keep up with.
+//
+// Groups are immutable snapshots, rebuilt when spectators join or leave,
+// so fan-out tasks can run concurrently without locking.
+class SpectatorHub : public std::enable_shared_from_this<SpectatorHub>
+{
+    using steady_clock = std::chrono::steady_clock;
+
+public:
+    using Frame = std::shared_ptr<const Message>;
+
+    SpectatorHub(asio::io_context & cntx, uint8_t n_streams);
+
+    // Thread safe checks used by the match to skip serializing
+    // streams nobody is watching.
+    bool active() const;
+
+    bool watching(uint8_t stream) const;
+
+    // Sent to each spectator when they join, before any frames.
+    void set_static_data(Frame static_data);
+
+    void add(Session::ptr session, uint8_t stream);
+
+    void remove(uint64_t session_id);
+
+    // Frames for one update, indexed by stream. Null for streams
+    // that were not serialized.
+    void publish(std::vector<Frame> frames);
+
+    // Deliver the final message once the last frames are out,
+    // then drop every spectator.
+    void close(Frame final_message);
+
+    // Drop everything immediately, for server shutdown.
+    void shutdown();
+
+private:
+    struct Spectator
+    {
+        std::weak_ptr<Session> session;
+        uint64_t session_id;
+        uint8_t stream;
+    };
+
+    using Group = std::vector<std::weak_ptr<Session>>;
+
+    struct DelayedFrames
+    {
+        steady_clock::time_point due;
+        std::vector<Frame> frames;
+
+        // Set for the final message from close().
+        Frame final_message;
+    };
+
+    void arm_timer();
+
+    void on_timer(boost::system::error_code ec);
+
+    // Post one delivery task per group of the stream. A terminal frame
+    // is queued even for spectators who are behind, since nothing
+    // follows it.
+    void fan_out(uint8_t stream, const Frame & frame, bool terminal = false);
+
+    // Sends the terminal frame to every stream.
+    void fan_out_all(const Frame & frame);
+
+    void rebuild_groups(uint8_t stream);
+
+    void prune_expired();
+
+    void clear();
+
+private:
+    asio::io_context & cntx_;
+    asio::strand<asio::io_context::executor_type> strand_;
+    asio::steady_timer timer_;
+    bool timer_armed_{false};
+    bool closed_{false};
+
+    const uint8_t n_streams_;
+
+    // Readable from any thread.
+    std::atomic<uint32_t> total_{0};
+    std::unique_ptr<std::atomic<uint32_t>[]> stream_counts_;
+
+    // Everything below is only touched on strand_.
+    std::vector<Spectator> spectators_;
+    std::vector<std::vector<std::shared_ptr<const Group>>> groups_;
+
+    std::deque<DelayedFrames> delayed_;
+
+    // Last frame delivered on each stream, sent to new spectators.
+    std::vector<Frame> latest_;
+
+    Frame static_data_;
+};
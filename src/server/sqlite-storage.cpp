@@ -0,0 +1,1322 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#include "sqlite-storage.h"
+#include "elo-updates.h"
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+#include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <sqlite3.h>
+
+// Mirrors setup/create-tables.sql, without the partitions. Uuids are
+// stored as text, times as unix milliseconds, except finished_at which
+// is in seconds.
+//
+// Files created before EloHistory.match_id became NOT NULL keep the
+// nullable column, which is harmless since every row sets it and
+// matches are never deleted.
+static constexpr const char * SCHEMA =
+    "CREATE TABLE IF NOT EXISTS Users("
+    "  user_id TEXT PRIMARY KEY NOT NULL,"
+    "  username TEXT NOT NULL UNIQUE COLLATE NOCASE,"
+    "  hash BLOB NOT NULL CHECK (length(hash) = 32),"
+    "  salt BLOB NOT NULL CHECK (length(salt) = 16),"
+    "  created_at INTEGER NOT NULL,"
+    "  last_login INTEGER NOT NULL,"
+    "  last_ip TEXT NOT NULL"
+    ");"
+    "CREATE TABLE IF NOT EXISTS Friends("
+    "  user_a TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  user_b TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  created_at INTEGER NOT NULL,"
+    "  PRIMARY KEY (user_a, user_b),"
+    "  CHECK (user_a < user_b)"
+    ") WITHOUT ROWID;"
+    "CREATE INDEX IF NOT EXISTS idx_friends_user_b ON Friends(user_b);"
+    "CREATE TABLE IF NOT EXISTS FriendRequests("
+    "  sender TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  receiver TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  PRIMARY KEY (sender, receiver),"
+    "  CHECK (sender <> receiver)"
+    ") WITHOUT ROWID;"
+    "CREATE INDEX IF NOT EXISTS idx_friend_requests_receiver ON FriendRequests(receiver);"
+    "CREATE TABLE IF NOT EXISTS BlockedUsers("
+    "  blocker TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  blocked TEXT NOT NULL REFERENCES Users(user_id) ON DELETE CASCADE,"
+    "  created_at INTEGER NOT NULL,"
+    "  PRIMARY KEY (blocker, blocked),"
+    "  CHECK (blocker <> blocked)"
+    ") WITHOUT ROWID;"
+    "CREATE TABLE IF NOT EXISTS UserBans("
+    "  ban_id INTEGER PRIMARY KEY,"
+    "  user_id TEXT NOT NULL REFERENCES Users(user_id) ON DELETE RESTRICT,"
+    "  banned_at INTEGER NOT NULL,"
+    "  banned_until INTEGER NOT NULL,"
+    "  original_expiration INTEGER NOT NULL,"
+    "  reason TEXT NOT NULL DEFAULT ''"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_user_bans_user ON UserBans(user_id, banned_until);"
+    "CREATE TABLE IF NOT EXISTS BannedIPs("
+    "  ip TEXT PRIMARY KEY,"
+    "  banned_at INTEGER NOT NULL,"
+    "  banned_until INTEGER NOT NULL,"
+    "  original_expiration INTEGER NOT NULL"
+    ");"
+    "CREATE TABLE IF NOT EXISTS Matches("
+    "  match_id INTEGER PRIMARY KEY,"
+    "  game_mode INTEGER NOT NULL,"
+    "  finished_at INTEGER NOT NULL,"
+    "  settings TEXT NOT NULL,"
+    "  replay BLOB NOT NULL"
+    ");"
+    "CREATE TABLE IF NOT EXISTS MatchPlayers("
+    "  match_id INTEGER NOT NULL REFERENCES Matches(match_id) ON DELETE CASCADE,"
+    "  user_id TEXT NOT NULL REFERENCES Users(user_id) ON DELETE RESTRICT,"
+    "  player_id INTEGER NOT NULL,"
+    "  placement INTEGER NOT NULL,"
+    "  PRIMARY KEY (match_id, user_id),"
+    "  UNIQUE (match_id, player_id)"
+    ") WITHOUT ROWID;"
+    "CREATE INDEX IF NOT EXISTS idx_match_players_user ON MatchPlayers(user_id, match_id, placement);"
+    "CREATE TABLE IF NOT EXISTS EloHistory("
+    "  history_id INTEGER PRIMARY KEY,"
+    "  user_id TEXT NOT NULL REFERENCES Users(user_id) ON DELETE RESTRICT,"
+    "  match_id INTEGER NOT NULL REFERENCES Matches(match_id) ON DELETE CASCADE,"
+    "  game_mode INTEGER NOT NULL,"
+    "  old_elo INTEGER NOT NULL,"
+    "  new_elo INTEGER NOT NULL"
+    ");"
+    "CREATE INDEX IF NOT EXISTS idx_elo_history_match_user "
+    "  ON EloHistory(match_id, user_id, game_mode, old_elo, new_elo);"
+    "CREATE TABLE IF NOT EXISTS UserElos("
+    "  user_id TEXT NOT NULL REFERENCES Users(user_id),"
+    "  game_mode INTEGER NOT NULL,"
+    "  current_elo INTEGER NOT NULL DEFAULT 1500,"
+    "  PRIMARY KEY (user_id, game_mode)"
+    ") WITHOUT ROWID;";
+
+// Statements, prepared once per connection on first use.
+static constexpr const char * SQL_LOAD_IP_BANS =
+    "SELECT ip, banned_until FROM BannedIPs";
+
+static constexpr const char * SQL_LOAD_RATINGS =
+    "SELECT ue.user_id, u.username, ue.game_mode, ue.current_elo "
+    "FROM UserElos ue "
+    "JOIN Users u ON u.user_id = ue.user_id";
+
+static constexpr const char * SQL_FIND_LOGIN =
+    "SELECT u.user_id, u.hash, u.salt, b.banned_until, b.reason "
+    "FROM Users u "
+    "LEFT JOIN UserBans b ON b.ban_id = ( "
+    "  SELECT ban_id FROM UserBans "
+    "  WHERE user_id = u.user_id AND banned_until > ?2 "
+    "  ORDER BY banned_at DESC "
+    "  LIMIT 1 "
+    ") "
+    "WHERE u.username = ?1";
+
+static constexpr const char * SQL_UPDATE_LOGIN =
+    "UPDATE Users SET last_login = ?1, last_ip = ?2 WHERE user_id = ?3";
+
+static constexpr const char * SQL_LOGIN_FRIENDS =
+    "SELECT (CASE WHEN user_a = ?1 THEN user_b ELSE user_a END) "
+    "FROM Friends WHERE user_a = ?1 OR user_b = ?1";
+
+static constexpr const char * SQL_LOGIN_BLOCKS =
+    "SELECT blocked FROM BlockedUsers WHERE blocker = ?1";
+
+static constexpr const char * SQL_LOGIN_ELOS =
+    "SELECT game_mode, current_elo FROM UserElos WHERE user_id = ?1";
+
+static constexpr const char * SQL_CREATE_USER =
+    "INSERT INTO Users (user_id, username, hash, salt, created_at, last_login, last_ip) "
+    "VALUES (?1, ?2, ?3, ?4, ?5, ?5, ?6)";
+
+static constexpr const char * SQL_ADD_USER_ELO =
+    "INSERT INTO UserElos (user_id, game_mode, current_elo) "
+    "VALUES (?1, ?2, ?3) "
+    "ON CONFLICT DO NOTHING";
+
+static constexpr const char * SQL_INSERT_MATCH =
+    "INSERT INTO Matches (game_mode, finished_at, settings, replay) "
+    "VALUES (?1, ?2, ?3, ?4)";
+
+static constexpr const char * SQL_INSERT_MATCH_PLAYER =
+    "INSERT INTO MatchPlayers (match_id, user_id, player_id, placement) "
+    "VALUES (?1, ?2, ?3, ?4)";
+
+static constexpr const char * SQL_GET_ELO =
+    "SELECT current_elo FROM UserElos WHERE user_id = ?1 AND game_mode = ?2";
+
+static constexpr const char * SQL_INSERT_ELO_HISTORY =
+    "INSERT INTO EloHistory (user_id, match_id, game_mode, old_elo, new_elo) "
+    "VALUES (?1, ?2, ?3, ?4, ?5)";
+
+static constexpr const char * SQL_SET_ELO =
+    "INSERT INTO UserElos (user_id, game_mode, current_elo) "
+    "VALUES (?1, ?2, ?3) "
+    "ON CONFLICT (user_id, game_mode) DO UPDATE SET current_elo = excluded.current_elo";
+
+static constexpr const char * SQL_LOAD_RANKED_RESULTS =
+    "SELECT mp.match_id, m.game_mode, mp.user_id, mp.player_id, mp.placement "
+    "FROM MatchPlayers mp "
+    "JOIN Matches m ON m.match_id = mp.match_id "
+    "WHERE m.game_mode >= ?1 "
+    "ORDER BY mp.match_id, mp.player_id";
+
+static constexpr const char * SQL_RESET_ELOS =
+    "UPDATE UserElos SET current_elo = ?1 "
+    "WHERE game_mode >= ?2 AND current_elo <> ?1";
+
+static constexpr const char * SQL_CLEAR_ELO_HISTORY =
+    "DELETE FROM EloHistory";
+
+static constexpr const char * SQL_BAN_IP =
+    "INSERT INTO BannedIPs (ip, banned_at, banned_until, original_expiration) "
+    "VALUES (?1, ?2, ?3, ?3) "
+    "ON CONFLICT (ip) DO UPDATE "
+    "  SET banned_until = excluded.banned_until, "
+    "  original_expiration = excluded.original_expiration";
+
+static constexpr const char * SQL_UNBAN_IP =
+    "UPDATE BannedIPs SET banned_until = ?2 WHERE ip = ?1";
+
+static constexpr const char * SQL_FIND_USER_ID =
+    "SELECT user_id FROM Users WHERE username = ?1";
+
+static constexpr const char * SQL_FIND_USERNAME =
+    "SELECT username FROM Users WHERE user_id = ?1";
+
+static constexpr const char * SQL_BAN_USER =
+    "INSERT INTO UserBans (user_id, banned_at, banned_until, original_expiration, reason) "
+    "VALUES (?1, ?2, ?3, ?3, ?4)";
+
+static constexpr const char * SQL_UNBAN_USER =
+    "UPDATE UserBans SET banned_until = ?2 WHERE ban_id = ?1";
+
+static constexpr const char * SQL_CHECK_BLOCKED =
+    "SELECT 1 FROM BlockedUsers WHERE blocker = ?1 AND blocked = ?2";
+
+static constexpr const char * SQL_CHECK_FRIENDS =
+    "SELECT 1 FROM Friends WHERE user_a = ?1 AND user_b = ?2";
+
+// The WHERE is needed for sqlite to parse the ON CONFLICT.
+static constexpr const char * SQL_FRIEND_REQUEST =
+    "INSERT INTO FriendRequests (sender, receiver) "
+    "SELECT ?1, ?2 "
+    "WHERE (SELECT COUNT(*) FROM FriendRequests WHERE sender = ?1) < ?3 "
+    "ON CONFLICT DO NOTHING";
+
+static constexpr const char * SQL_FIND_FRIEND_REQUEST =
+    "SELECT 1 FROM FriendRequests WHERE receiver = ?1 AND sender = ?2";
+
+static constexpr const char * SQL_DELETE_FRIEND_REQUEST =
+    "DELETE FROM FriendRequests WHERE sender = ?1 AND receiver = ?2";
+
+static constexpr const char * SQL_ADD_FRIEND =
+    "INSERT INTO Friends (user_a, user_b, created_at) "
+    "VALUES (?1, ?2, ?3) "
+    "ON CONFLICT DO NOTHING";
+
+static constexpr const char * SQL_REMOVE_FRIEND =
+    "DELETE FROM Friends WHERE user_a = ?1 AND user_b = ?2";
+
+static constexpr const char * SQL_BLOCK_USER =
+    "INSERT INTO BlockedUsers (blocker, blocked, created_at) "
+    "VALUES (?1, ?2, ?3) "
+    "ON CONFLICT DO NOTHING";
+
+static constexpr const char * SQL_UNBLOCK_USER =
+    "DELETE FROM BlockedUsers WHERE blocker = ?1 AND blocked = ?2";
+
+static constexpr const char * SQL_FETCH_BLOCKS =
+    "SELECT b.blocked, u.username "
+    "FROM BlockedUsers b JOIN Users u ON u.user_id = b.blocked "
+    "WHERE b.blocker = ?1";
+
+static constexpr const char * SQL_FETCH_FRIENDS =
+    "SELECT u.user_id, u.username "
+    "FROM Friends f "
+    "JOIN Users u ON u.user_id = (CASE WHEN f.user_a = ?1 THEN f.user_b ELSE f.user_a END) "
+    "WHERE f.user_a = ?1 OR f.user_b = ?1";
+
+static constexpr const char * SQL_FETCH_FRIEND_REQUESTS =
+    "SELECT fr.sender, u.username "
+    "FROM FriendRequests fr JOIN Users u ON u.user_id = fr.sender "
+    "WHERE fr.receiver = ?1";
+
+// Match ids are handed out in the order matches finish, so walking the
+// player index backwards gives the newest first without a sort.
+static constexpr const char * SQL_FETCH_LATEST_MATCHES =
+    "SELECT m.match_id, m.finished_at, mp.placement, "
+    "COALESCE(( "
+    "  SELECT new_elo - old_elo FROM EloHistory eh "
+    "  WHERE eh.match_id = m.match_id "
+    "  AND eh.user_id = mp.user_id "
+    "  AND eh.game_mode = m.game_mode "
+    "  ORDER BY history_id DESC "
+    "  LIMIT 1 "
+    "), 0) "
+    "FROM MatchPlayers mp JOIN Matches m ON m.match_id = mp.match_id "
+    "WHERE mp.user_id = ?1 AND m.game_mode = ?2 AND mp.match_id < ?3 "
+    "ORDER BY mp.match_id DESC "
+    "LIMIT ?4";
+
+static constexpr const char * SQL_FETCH_REPLAY =
+    "SELECT replay, settings FROM Matches WHERE match_id = ?1";
+
+static constexpr const char * SQL_FETCH_MATCH_USERS =
+    "SELECT u.user_id, u.username, mp.player_id "
+    "FROM MatchPlayers mp "
+    "JOIN Users u ON u.user_id = mp.user_id "
+    "WHERE mp.match_id = ?1 "
+    "ORDER BY mp.player_id";
+
+struct SqliteConnection
+{
+    sqlite3 * db{nullptr};
+
+    // Keyed by the statement constants above.
+    std::unordered_map<std::string_view, sqlite3_stmt *> statements;
+
+    ~SqliteConnection()
+    {
+        for (auto & [sql, stmt] : statements)
+        {
+            sqlite3_finalize(stmt);
+        }
+
+        sqlite3_close_v2(db);
+    }
+};
+
+[[noreturn]] static void throw_error(sqlite3 * db, const char * what)
+{
+    throw StorageError(std::string(what) + ": " + sqlite3_errmsg(db));
+}
+
+static void exec_script(sqlite3 * db, const char * sql)
+{
+    char * error = nullptr;
+
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &error) != SQLITE_OK)
+    {
+        std::string message = error ? error : "unknown error";
+        sqlite3_free(error);
+
+        throw StorageError("sqlite: " + message);
+    }
+}
+
+static int64_t to_ms(std::chrono::system_clock::time_point tp)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>
+            (
+                tp.time_since_epoch()
+            ).count();
+}
+
+static int64_t now_ms()
+{
+    return to_ms(std::chrono::system_clock::now());
+}
+
+// Friends are stored once, smallest id first, as in postgres.
+static std::pair<std::string, std::string> friend_key(const boost::uuids::uuid & a,
+                                                      const boost::uuids::uuid & b)
+{
+    std::string a_str = boost::uuids::to_string(a);
+    std::string b_str = boost::uuids::to_string(b);
+
+    if (b_str < a_str)
+    {
+        std::swap(a_str, b_str);
+    }
+
+    return {std::move(a_str), std::move(b_str)};
+}
+
+namespace
+{
+
+// A cached statement, bound for one use and reset when done.
+class Statement
+{
+public:
+    Statement(SqliteConnection & conn, const char * sql)
+    :db_(conn.db)
+    {
+        auto & stmt = conn.statements[sql];
+
+        if (!stmt
+            && sqlite3_prepare_v3(db_, sql, -1, SQLITE_PREPARE_PERSISTENT,
+                                  &stmt, nullptr) != SQLITE_OK)
+        {
+            conn.statements.erase(sql);
+            throw_error(db_, "sqlite prepare");
+        }
+
+        stmt_ = stmt;
+    }
+
+    ~Statement()
+    {
+        sqlite3_reset(stmt_);
+        sqlite3_clear_bindings(stmt_);
+    }
+
+    Statement(const Statement &) = delete;
+    Statement & operator=(const Statement &) = delete;
+
+    Statement & bind(int index, const std::string & value)
+    {
+        check(sqlite3_bind_text(stmt_, index, value.data(),
+                                static_cast<int>(value.size()),
+                                SQLITE_TRANSIENT));
+        return *this;
+    }
+
+    Statement & bind(int index, int64_t value)
+    {
+        check(sqlite3_bind_int64(stmt_, index, value));
+        return *this;
+    }
+
+    Statement & bind(int index, const uint8_t * data, size_t size)
+    {
+        check(sqlite3_bind_blob(stmt_, index, data,
+                                static_cast<int>(size),
+                                SQLITE_TRANSIENT));
+        return *this;
+    }
+
+    // True while there is a row to read.
+    bool step()
+    {
+        int rc = sqlite3_step(stmt_);
+
+        if (rc == SQLITE_ROW)
+        {
+            return true;
+        }
+
+        if (rc != SQLITE_DONE)
+        {
+            throw_error(db_, "sqlite step");
+        }
+
+        return false;
+    }
+
+    // Runs a statement that returns no rows.
+    void run()
+    {
+        while (step())
+        {
+        }
+    }
+
+    // Lets a statement reused in a loop be bound and run again.
+    void reset()
+    {
+        sqlite3_reset(stmt_);
+    }
+
+    bool is_null(int col) const
+    {
+        return sqlite3_column_type(stmt_, col) == SQLITE_NULL;
+    }
+
+    int64_t int_at(int col) const
+    {
+        return sqlite3_column_int64(stmt_, col);
+    }
+
+    std::string text_at(int col) const
+    {
+        auto text = reinterpret_cast<const char *>(sqlite3_column_text(stmt_, col));
+        return std::string(text ? text : "",
+                           static_cast<size_t>(sqlite3_column_bytes(stmt_, col)));
+    }
+
+    std::string_view blob_at(int col) const
+    {
+        auto blob = static_cast<const char *>(sqlite3_column_blob(stmt_, col));
+        return std::string_view(blob ? blob : "",
+                                static_cast<size_t>(sqlite3_column_bytes(stmt_, col)));
+    }
+
+private:
+    void check(int rc)
+    {
+        if (rc != SQLITE_OK)
+        {
+            throw_error(db_, "sqlite bind");
+        }
+    }
+
+private:
+    sqlite3 * db_;
+    sqlite3_stmt * stmt_;
+};
+
+// Takes the write lock up front, so a read never has to be upgraded
+// and two writers cannot deadlock. Rolls back unless committed.
+class Transaction
+{
+public:
+    explicit Transaction(SqliteConnection & conn)
+    :db_(conn.db)
+    {
+        exec_script(db_, "BEGIN IMMEDIATE");
+    }
+
+    ~Transaction()
+    {
+        if (!done_)
+        {
+            sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        }
+    }
+
+    Transaction(const Transaction &) = delete;
+    Transaction & operator=(const Transaction &) = delete;
+
+    void commit()
+    {
+        exec_script(db_, "COMMIT");
+        done_ = true;
+    }
+
+private:
+    sqlite3 * db_;
+    bool done_{false};
+};
+
+}
+
+static std::unique_ptr<SqliteConnection> open_connection(const std::string & path)
+{
+    auto conn = std::make_unique<SqliteConnection>();
+
+    int rc = sqlite3_open_v2(path.c_str(),
+                             &conn->db,
+                             SQLITE_OPEN_READWRITE
+                             | SQLITE_OPEN_CREATE
+                             | SQLITE_OPEN_NOMUTEX,
+                             nullptr);
+
+    if (rc != SQLITE_OK)
+    {
+        throw_error(conn->db, ("sqlite open " + path).c_str());
+    }
+
+    sqlite3_busy_timeout(conn->db, SQLITE_BUSY_TIMEOUT_MS);
+
+    // WAL persists in the file, the rest is per connection. A commit
+    // survives a crash of the server, but may be lost on power loss.
+    exec_script(conn->db,
+                "PRAGMA journal_mode = WAL;"
+                "PRAGMA synchronous = NORMAL;"
+                "PRAGMA foreign_keys = ON;");
+
+    return conn;
+}
+
+SqliteStorage::Lease::Lease(SqliteStorage & storage,
+                            std::unique_ptr<SqliteConnection> conn)
+:storage_(storage),
+conn_(std::move(conn))
+{
+}
+
+SqliteStorage::Lease::~Lease()
+{
+    std::lock_guard lock(storage_.mutex_);
+    storage_.idle_.push_back(std::move(conn_));
+}
+
+SqliteConnection & SqliteStorage::Lease::operator*()
+{
+    return *conn_;
+}
+
+SqliteStorage::SqliteStorage(std::string path)
+:path_(std::move(path))
+{
+    auto conn = open_connection(path_);
+
+    exec_script(conn->db, SCHEMA);
+
+    idle_.push_back(std::move(conn));
+}
+
+SqliteStorage::~SqliteStorage() = default;
+
+std::string SqliteStorage::name() const
+{
+    return "sqlite " + path_;
+}
+
+bool SqliteStorage::supports_write_behind() const
+{
+    // Recording is already in process, there is no round trip to batch.
+    return false;
+}
+
+SqliteStorage::Lease SqliteStorage::acquire()
+{
+    {
+        std::lock_guard lock(mutex_);
+
+        if (!idle_.empty())
+        {
+            auto conn = std::move(idle_.back());
+            idle_.pop_back();
+
+            return Lease(*this, std::move(conn));
+        }
+    }
+
+    return Lease(*this, open_connection(path_));
+}
+
+std::unordered_map<std::string, std::chrono::system_clock::time_point>
+SqliteStorage::load_ip_bans()
+{
+    std::unordered_map<std::string, std::chrono::system_clock::time_point>
+    map;
+
+    auto conn = acquire();
+    Statement bans(*conn, SQL_LOAD_IP_BANS);
+
+    while (bans.step())
+    {
+        map.emplace(bans.text_at(0),
+                    std::chrono::system_clock::time_point
+                    {
+                        std::chrono::milliseconds(bans.int_at(1))
+                    });
+    }
+
+    return map;
+}
+
+void SqliteStorage::load_ratings(const RatingVisitor & visit)
+{
+    auto conn = acquire();
+    Statement ratings(*conn, SQL_LOAD_RATINGS);
+
+    boost::uuids::string_generator gen;
+
+    while (ratings.step())
+    {
+        visit(gen(ratings.text_at(0)),
+              ratings.text_at(1),
+              static_cast<GameMode>(ratings.int_at(2)),
+              static_cast<int>(ratings.int_at(3)));
+    }
+}
+
+std::optional<LoginRecord> SqliteStorage::find_login(const std::string & username)
+{
+    auto conn = acquire();
+    Statement login(*conn, SQL_FIND_LOGIN);
+
+    login.bind(1, username).bind(2, now_ms());
+
+    if (!login.step())
+    {
+        return std::nullopt;
+    }
+
+    LoginRecord record{};
+
+    boost::uuids::string_generator gen;
+    record.user_id = gen(login.text_at(0));
+
+    // Banned users are turned away before their hash is needed.
+    if (!login.is_null(3))
+    {
+        record.banned_until = std::chrono::system_clock::time_point
+                                {
+                                    std::chrono::milliseconds(login.int_at(3))
+                                };
+        record.ban_reason = login.text_at(4);
+
+        return record;
+    }
+
+    std::string_view hash = login.blob_at(1);
+    std::string_view salt = login.blob_at(2);
+
+    if (hash.size() != HASH_LENGTH || salt.size() != SALT_LENGTH)
+    {
+        throw StorageError("DB call had wrong hashing lengths! "
+                           + std::to_string(hash.size())
+                           + " "
+                           + std::to_string(salt.size()));
+    }
+
+    std::copy(hash.begin(), hash.end(), record.hash.begin());
+    std::copy(salt.begin(), salt.end(), record.salt.begin());
+
+    return record;
+}
+
+LoginData SqliteStorage::login(const boost::uuids::uuid & user_id,
+                               const std::string & ip)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    std::string id = boost::uuids::to_string(user_id);
+
+    Statement(*conn, SQL_UPDATE_LOGIN).bind(1, now_ms())
+                                      .bind(2, ip)
+                                      .bind(3, id)
+                                      .run();
+
+    LoginData data;
+    boost::uuids::string_generator gen;
+
+    {
+        Statement friends(*conn, SQL_LOGIN_FRIENDS);
+        friends.bind(1, id);
+
+        while (friends.step())
+        {
+            data.friends.push_back(gen(friends.text_at(0)));
+        }
+    }
+
+    {
+        Statement blocks(*conn, SQL_LOGIN_BLOCKS);
+        blocks.bind(1, id);
+
+        while (blocks.step())
+        {
+            data.blocks.push_back(gen(blocks.text_at(0)));
+        }
+    }
+
+    {
+        Statement elos(*conn, SQL_LOGIN_ELOS);
+        elos.bind(1, id);
+
+        while (elos.step())
+        {
+            data.elos.emplace_back(static_cast<uint8_t>(elos.int_at(0)),
+                                   static_cast<int>(elos.int_at(1)));
+        }
+    }
+
+    txn.commit();
+
+    return data;
+}
+
+bool SqliteStorage::create_user(const boost::uuids::uuid & user_id,
+                                const std::string & username,
+                                const std::array<uint8_t, HASH_LENGTH> & hash,
+                                const std::array<uint8_t, SALT_LENGTH> & salt,
+                                const std::string & ip)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    std::string id = boost::uuids::to_string(user_id);
+
+    try
+    {
+        Statement(*conn, SQL_CREATE_USER).bind(1, id)
+                                         .bind(2, username)
+                                         .bind(3, hash.data(), hash.size())
+                                         .bind(4, salt.data(), salt.size())
+                                         .bind(5, now_ms())
+                                         .bind(6, ip)
+                                         .run();
+    }
+    catch (const StorageError &)
+    {
+        if (sqlite3_extended_errcode((*conn).db) == SQLITE_CONSTRAINT_UNIQUE
+            || sqlite3_extended_errcode((*conn).db) == SQLITE_CONSTRAINT_PRIMARYKEY)
+        {
+            return false;
+        }
+
+        throw;
+    }
+
+    // Create initial elo entries for the user.
+    for (uint8_t mode = RANKED_MODES_START;
+         mode < static_cast<uint8_t>(GameMode::NO_MODE);
+         mode++)
+    {
+        Statement(*conn, SQL_ADD_USER_ELO).bind(1, id)
+                                          .bind(2, mode)
+                                          .bind(3, DEFAULT_ELO)
+                                          .run();
+    }
+
+    txn.commit();
+
+    return true;
+}
+
+RecordedMatch SqliteStorage::record_match(const MatchWrite & match)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    size_t n_players = match.user_ids.size();
+
+    RecordedMatch recorded;
+    recorded.finished_at = std::chrono::time_point_cast<std::chrono::seconds>
+                            (
+                                std::chrono::system_clock::now()
+                            );
+
+    Statement(*conn, SQL_INSERT_MATCH).bind(1, static_cast<int64_t>(match.mode))
+                                      .bind(2, std::chrono::system_clock::to_time_t(recorded.finished_at))
+                                      .bind(3, match.settings_json)
+                                      .bind(4,
+                                            reinterpret_cast<const uint8_t *>(match.moves.data()),
+                                            match.moves.size())
+                                      .run();
+
+    recorded.match_id = sqlite3_last_insert_rowid((*conn).db);
+
+    std::vector<std::string> user_id_strs;
+    user_id_strs.reserve(n_players);
+
+    for (size_t i = 0; i < n_players; i++)
+    {
+        user_id_strs.push_back(boost::uuids::to_string(match.user_ids[i]));
+
+        Statement(*conn, SQL_INSERT_MATCH_PLAYER).bind(1, recorded.match_id)
+                                                 .bind(2, user_id_strs[i])
+                                                 .bind(3, static_cast<int64_t>(i))
+                                                 .bind(4, match.placements[i])
+                                                 .run();
+    }
+
+    if (static_cast<uint8_t>(match.mode) >= RANKED_MODES_START)
+    {
+        // The transaction holds the write lock, so nothing can change
+        // these between our read and our update.
+        std::vector<std::optional<int>> current(n_players);
+
+        for (size_t i = 0; i < n_players; i++)
+        {
+            Statement elo(*conn, SQL_GET_ELO);
+            elo.bind(1, user_id_strs[i]).bind(2, static_cast<int64_t>(match.mode));
+
+            if (elo.step())
+            {
+                current[i] = static_cast<int>(elo.int_at(0));
+            }
+        }
+
+        rate_match(current, match.elimination_order, recorded);
+
+        for (size_t i = 0; i < n_players; i++)
+        {
+            Statement(*conn, SQL_INSERT_ELO_HISTORY).bind(1, user_id_strs[i])
+                                                    .bind(2, recorded.match_id)
+                                                    .bind(3, static_cast<int64_t>(match.mode))
+                                                    .bind(4, recorded.old_elos[i])
+                                                    .bind(5, recorded.new_elos[i])
+                                                    .run();
+
+            Statement(*conn, SQL_SET_ELO).bind(1, user_id_strs[i])
+                                         .bind(2, static_cast<int64_t>(match.mode))
+                                         .bind(3, recorded.new_elos[i])
+                                         .run();
+        }
+    }
+
+    txn.commit();
+
+    return recorded;
+}
+
+void SqliteStorage::ban_ip(const std::string & ip,
+                           std::chrono::system_clock::time_point banned_until)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_BAN_IP).bind(1, ip)
+                                .bind(2, now_ms())
+                                .bind(3, to_ms(banned_until))
+                                .run();
+}
+
+void SqliteStorage::unban_ip(const std::string & ip)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_UNBAN_IP).bind(1, ip)
+                                  .bind(2, now_ms())
+                                  .run();
+}
+
+std::optional<boost::uuids::uuid>
+SqliteStorage::find_user_id(const std::string & username)
+{
+    auto conn = acquire();
+    Statement user(*conn, SQL_FIND_USER_ID);
+
+    user.bind(1, username);
+
+    if (!user.step())
+    {
+        return std::nullopt;
+    }
+
+    boost::uuids::string_generator gen;
+
+    return gen(user.text_at(0));
+}
+
+void SqliteStorage::ban_user(const boost::uuids::uuid & user_id,
+                             std::chrono::system_clock::time_point banned_until,
+                             const std::string & reason)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_BAN_USER).bind(1, boost::uuids::to_string(user_id))
+                                  .bind(2, now_ms())
+                                  .bind(3, to_ms(banned_until))
+                                  .bind(4, reason)
+                                  .run();
+}
+
+void SqliteStorage::unban_user(uint64_t ban_id)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_UNBAN_USER).bind(1, static_cast<int64_t>(ban_id))
+                                    .bind(2, now_ms())
+                                    .run();
+}
+
+bool SqliteStorage::send_friend_request(const boost::uuids::uuid & sender,
+                                        const boost::uuids::uuid & receiver,
+                                        int max_pending)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    std::string sender_str = boost::uuids::to_string(sender);
+    std::string receiver_str = boost::uuids::to_string(receiver);
+
+    {
+        Statement blocked(*conn, SQL_CHECK_BLOCKED);
+        blocked.bind(1, sender_str).bind(2, receiver_str);
+
+        if (blocked.step())
+        {
+            return false;
+        }
+    }
+
+    {
+        auto [user_a, user_b] = friend_key(sender, receiver);
+
+        Statement friends(*conn, SQL_CHECK_FRIENDS);
+        friends.bind(1, user_a).bind(2, user_b);
+
+        if (friends.step())
+        {
+            return false;
+        }
+    }
+
+    // If a friend request already exists, this will
+    // simply do nothing.
+    Statement(*conn, SQL_FRIEND_REQUEST).bind(1, sender_str)
+                                        .bind(2, receiver_str)
+                                        .bind(3, max_pending)
+                                        .run();
+
+    txn.commit();
+
+    return true;
+}
+
+std::optional<std::string>
+SqliteStorage::accept_friend_request(const boost::uuids::uuid & receiver,
+                                     const boost::uuids::uuid & sender)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    std::string sender_str = boost::uuids::to_string(sender);
+    std::string receiver_str = boost::uuids::to_string(receiver);
+
+    {
+        Statement request(*conn, SQL_FIND_FRIEND_REQUEST);
+        request.bind(1, receiver_str).bind(2, sender_str);
+
+        if (!request.step())
+        {
+            return std::nullopt;
+        }
+    }
+
+    auto [user_a, user_b] = friend_key(receiver, sender);
+
+    Statement(*conn, SQL_ADD_FRIEND).bind(1, user_a)
+                                    .bind(2, user_b)
+                                    .bind(3, now_ms())
+                                    .run();
+
+    Statement(*conn, SQL_DELETE_FRIEND_REQUEST).bind(1, sender_str)
+                                               .bind(2, receiver_str)
+                                               .run();
+
+    std::string username;
+
+    {
+        Statement name(*conn, SQL_FIND_USERNAME);
+        name.bind(1, sender_str);
+
+        if (name.step())
+        {
+            username = name.text_at(0);
+        }
+    }
+
+    txn.commit();
+
+    return username;
+}
+
+void SqliteStorage::decline_friend_request(const boost::uuids::uuid & receiver,
+                                           const boost::uuids::uuid & sender)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_DELETE_FRIEND_REQUEST).bind(1, boost::uuids::to_string(sender))
+                                               .bind(2, boost::uuids::to_string(receiver))
+                                               .run();
+}
+
+void SqliteStorage::block_user(const boost::uuids::uuid & blocker,
+                               const boost::uuids::uuid & blocked)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    std::string blocker_str = boost::uuids::to_string(blocker);
+    std::string blocked_str = boost::uuids::to_string(blocked);
+
+    Statement(*conn, SQL_BLOCK_USER).bind(1, blocker_str)
+                                    .bind(2, blocked_str)
+                                    .bind(3, now_ms())
+                                    .run();
+
+    // Remove any friend requests that might exist.
+    Statement(*conn, SQL_DELETE_FRIEND_REQUEST).bind(1, blocked_str)
+                                               .bind(2, blocker_str)
+                                               .run();
+
+    Statement(*conn, SQL_DELETE_FRIEND_REQUEST).bind(1, blocker_str)
+                                               .bind(2, blocked_str)
+                                               .run();
+
+    auto [user_a, user_b] = friend_key(blocker, blocked);
+
+    Statement(*conn, SQL_REMOVE_FRIEND).bind(1, user_a)
+                                       .bind(2, user_b)
+                                       .run();
+
+    txn.commit();
+}
+
+void SqliteStorage::unblock_user(const boost::uuids::uuid & blocker,
+                                 const boost::uuids::uuid & blocked)
+{
+    auto conn = acquire();
+
+    Statement(*conn, SQL_UNBLOCK_USER).bind(1, boost::uuids::to_string(blocker))
+                                      .bind(2, boost::uuids::to_string(blocked))
+                                      .run();
+}
+
+void SqliteStorage::remove_friend(const boost::uuids::uuid & user,
+                                  const boost::uuids::uuid & friend_id)
+{
+    auto conn = acquire();
+    auto [user_a, user_b] = friend_key(user, friend_id);
+
+    Statement(*conn, SQL_REMOVE_FRIEND).bind(1, user_a)
+                                       .bind(2, user_b)
+                                       .run();
+}
+
+void SqliteStorage::fetch_blocks(const boost::uuids::uuid & user,
+                                 StorageHandler<std::vector<ExternalUser>> handler)
+{
+    std::vector<ExternalUser> users;
+
+    try
+    {
+        users = fetch_users(SQL_FETCH_BLOCKS, user);
+    }
+    catch (const std::exception & e)
+    {
+        handler(e.what(), {});
+        return;
+    }
+
+    handler(std::string{}, std::move(users));
+}
+
+void SqliteStorage::fetch_friends(const boost::uuids::uuid & user,
+                                  StorageHandler<std::vector<ExternalUser>> handler)
+{
+    std::vector<ExternalUser> users;
+
+    try
+    {
+        users = fetch_users(SQL_FETCH_FRIENDS, user);
+    }
+    catch (const std::exception & e)
+    {
+        handler(e.what(), {});
+        return;
+    }
+
+    handler(std::string{}, std::move(users));
+}
+
+void SqliteStorage::fetch_friend_requests(const boost::uuids::uuid & user,
+                                          StorageHandler<std::vector<ExternalUser>> handler)
+{
+    std::vector<ExternalUser> users;
+
+    try
+    {
+        users = fetch_users(SQL_FETCH_FRIEND_REQUESTS, user);
+    }
+    catch (const std::exception & e)
+    {
+        handler(e.what(), {});
+        return;
+    }
+
+    handler(std::string{}, std::move(users));
+}
+
+void SqliteStorage::fetch_latest_matches(const boost::uuids::uuid & user,
+                                         GameMode mode,
+                                         const MatchHistoryCursor & after,
+                                         int limit,
+                                         StorageHandler<std::vector<MatchResultRow>> handler)
+{
+    std::vector<MatchResultRow> rows;
+
+    try
+    {
+        auto conn = acquire();
+        Statement matches(*conn, SQL_FETCH_LATEST_MATCHES);
+
+        int64_t before_id = after.empty() ? std::numeric_limits<int64_t>::max()
+                                          : after.match_id;
+
+        matches.bind(1, boost::uuids::to_string(user))
+               .bind(2, static_cast<int64_t>(mode))
+               .bind(3, before_id)
+               .bind(4, limit);
+
+        while (matches.step())
+        {
+            MatchResultRow row;
+            row.match_id = matches.int_at(0);
+            row.finished_at = std::chrono::system_clock::from_time_t(matches.int_at(1));
+            row.placement = static_cast<uint16_t>(matches.int_at(2));
+            row.elo_change = static_cast<int32_t>(matches.int_at(3));
+
+            rows.push_back(std::move(row));
+        }
+    }
+    catch (const std::exception & e)
+    {
+        handler(e.what(), {});
+        return;
+    }
+
+    handler(std::string{}, std::move(rows));
+}
+
+void SqliteStorage::fetch_replay(uint64_t match_id,
+                                 asio::any_io_executor,
+                                 StorageHandler<std::optional<StoredReplay>> handler)
+{
+    std::optional<StoredReplay> replay;
+
+    try
+    {
+        auto conn = acquire();
+        Statement match(*conn, SQL_FETCH_REPLAY);
+
+        match.bind(1, static_cast<int64_t>(match_id));
+
+        if (match.step())
+        {
+            replay.emplace();
+            replay->moves = std::string(match.blob_at(0));
+            replay->settings_json = match.text_at(1);
+
+            Statement players(*conn, SQL_FETCH_MATCH_USERS);
+            players.bind(1, static_cast<int64_t>(match_id));
+
+            boost::uuids::string_generator gen;
+
+            while (players.step())
+            {
+                ExternalUser user;
+                user.user_id = gen(players.text_at(0));
+                user.username = players.text_at(1);
+
+                replay->players.emplace_back(static_cast<uint8_t>(players.int_at(2)),
+                                             std::move(user));
+            }
+
+            if (replay->players.empty())
+            {
+                replay.reset();
+            }
+        }
+    }
+    catch (const std::exception & e)
+    {
+        handler(e.what(), std::nullopt);
+        return;
+    }
+
+    handler(std::string{}, std::move(replay));
+}
+
+void SqliteStorage::load_ranked_results(const RankedResultVisitor & visit)
+{
+    auto conn = acquire();
+    Statement results(*conn, SQL_LOAD_RANKED_RESULTS);
+
+    results.bind(1, static_cast<int64_t>(RANKED_MODES_START));
+
+    boost::uuids::string_generator gen;
+
+    while (results.step())
+    {
+        visit(RankedResult{results.int_at(0),
+                           static_cast<GameMode>(results.int_at(1)),
+                           gen(results.text_at(2)),
+                           static_cast<uint8_t>(results.int_at(3)),
+                           static_cast<uint16_t>(results.int_at(4))});
+    }
+}
+
+void SqliteStorage::rewrite_ratings(const RatingRewrite & rewrite)
+{
+    auto conn = acquire();
+    Transaction txn(*conn);
+
+    Statement(*conn, SQL_RESET_ELOS).bind(1, static_cast<int64_t>(DEFAULT_ELO))
+                                    .bind(2, static_cast<int64_t>(RANKED_MODES_START))
+                                    .run();
+
+    // One statement each, rebound for every row.
+    Statement set_elo(*conn, SQL_SET_ELO);
+
+    rewrite.for_each_elo(
+        [&set_elo](const boost::uuids::uuid & user_id, GameMode mode, int elo)
+        {
+            set_elo.bind(1, boost::uuids::to_string(user_id))
+                   .bind(2, static_cast<int64_t>(mode))
+                   .bind(3, elo)
+                   .run();
+            set_elo.reset();
+        });
+
+    // Only ranked matches have history, so all of it is replaced.
+    Statement(*conn, SQL_CLEAR_ELO_HISTORY).run();
+
+    Statement insert_history(*conn, SQL_INSERT_ELO_HISTORY);
+
+    rewrite.for_each_change(
+        [&insert_history](const EloChange & change)
+        {
+            insert_history.bind(1, boost::uuids::to_string(change.user_id))
+                          .bind(2, change.match_id)
+                          .bind(3, static_cast<int64_t>(change.mode))
+                          .bind(4, change.old_elo)
+                          .bind(5, change.new_elo)
+                          .run();
+            insert_history.reset();
+        });
+
+    txn.commit();
+}
+
+bool SqliteStorage::migrate_replays(ReplayMigration & progress, size_t limit)
+{
+    // Replays have always been stored encoded here.
+    return false;
+}
+
+bool SqliteStorage::maintain()
+{
+    // Tables are not partitioned and replays are not archived.
+    return false;
+}
+
+void SqliteStorage::close()
+{
+    // Nothing is ever left in flight.
+}
+
+std::vector<ExternalUser> SqliteStorage::fetch_users(const char * sql,
+                                                     const boost::uuids::uuid & user)
+{
+    std::vector<ExternalUser> users;
+
+    auto conn = acquire();
+    Statement rows(*conn, sql);
+
+    rows.bind(1, boost::uuids::to_string(user));
+
+    boost::uuids::string_generator gen;
+
+    while (rows.step())
+    {
+        ExternalUser other;
+        other.user_id = gen(rows.text_at(0));
+        other.username = rows.text_at(1);
+
+        users.push_back(std::move(other));
+    }
+
+    return users;
+}
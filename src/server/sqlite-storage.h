@@ -0,0 +1,156 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#pragma once
+
+#include "storage.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Busy writers wait this long for the write lock before failing.
+constexpr int SQLITE_BUSY_TIMEOUT_MS = 5000;
+
+struct SqliteConnection;
+
+// An embedded database file, for small deployments, CI and load tests
+// that should not need a postgres cluster.
+//
+// The file is created with its schema on first use and kept in WAL mode,
+// so readers never wait on the single writer. Connections are pooled and
+// keep their statements prepared. Calls run in process, so the fetches
+// complete before returning and call their handler inline.
+class SqliteStorage : public Storage
+{
+public:
+    explicit SqliteStorage(std::string path);
+
+    ~SqliteStorage() override;
+
+    std::string name() const override;
+
+    bool supports_write_behind() const override;
+
+    std::unordered_map<std::string, std::chrono::system_clock::time_point>
+    load_ip_bans() override;
+
+    void load_ratings(const RatingVisitor & visit) override;
+
+    std::optional<LoginRecord> find_login(const std::string & username) override;
+
+    LoginData login(const boost::uuids::uuid & user_id,
+                    const std::string & ip) override;
+
+    bool create_user(const boost::uuids::uuid & user_id,
+                     const std::string & username,
+                     const std::array<uint8_t, HASH_LENGTH> & hash,
+                     const std::array<uint8_t, SALT_LENGTH> & salt,
+                     const std::string & ip) override;
+
+    RecordedMatch record_match(const MatchWrite & match) override;
+
+    void ban_ip(const std::string & ip,
+                std::chrono::system_clock::time_point banned_until) override;
+
+    void unban_ip(const std::string & ip) override;
+
+    std::optional<boost::uuids::uuid> find_user_id(const std::string & username) override;
+
+    void ban_user(const boost::uuids::uuid & user_id,
+                  std::chrono::system_clock::time_point banned_until,
+                  const std::string & reason) override;
+
+    void unban_user(uint64_t ban_id) override;
+
+    bool send_friend_request(const boost::uuids::uuid & sender,
+                             const boost::uuids::uuid & receiver,
+                             int max_pending) override;
+
+    std::optional<std::string>
+    accept_friend_request(const boost::uuids::uuid & receiver,
+                          const boost::uuids::uuid & sender) override;
+
+    void decline_friend_request(const boost::uuids::uuid & receiver,
+                                const boost::uuids::uuid & sender) override;
+
+    void block_user(const boost::uuids::uuid & blocker,
+                    const boost::uuids::uuid & blocked) override;
+
+    void unblock_user(const boost::uuids::uuid & blocker,
+                      const boost::uuids::uuid & blocked) override;
+
+    void remove_friend(const boost::uuids::uuid & user,
+                       const boost::uuids::uuid & friend_id) override;
+
+    void fetch_blocks(const boost::uuids::uuid & user,
+                      StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_friends(const boost::uuids::uuid & user,
+                       StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_friend_requests(const boost::uuids::uuid & user,
+                               StorageHandler<std::vector<ExternalUser>> handler) override;
+
+    void fetch_latest_matches(const boost::uuids::uuid & user,
+                              GameMode mode,
+                              const MatchHistoryCursor & after,
+                              int limit,
+                              StorageHandler<std::vector<MatchResultRow>> handler) override;
+
+    void load_ranked_results(const RankedResultVisitor & visit) override;
+
+    void rewrite_ratings(const RatingRewrite & rewrite) override;
+
+    bool migrate_replays(ReplayMigration & progress, size_t limit) override;
+
+    void fetch_replay(uint64_t match_id,
+                      asio::any_io_executor blocking,
+                      StorageHandler<std::optional<StoredReplay>> handler) override;
+
+    bool maintain() override;
+
+    void close() override;
+
+private:
+    // A pooled connection, handed back when it goes out of scope.
+    class Lease
+    {
+    public:
+        Lease(SqliteStorage & storage, std::unique_ptr<SqliteConnection> conn);
+
+        ~Lease();
+
+        SqliteConnection & operator*();
+
+    private:
+        SqliteStorage & storage_;
+        std::unique_ptr<SqliteConnection> conn_;
+    };
+
+    Lease acquire();
+
+    std::vector<ExternalUser> fetch_users(const char * sql,
+                                          const boost::uuids::uuid & user);
+
+private:
+    const std::string path_;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<SqliteConnection>> idle_;
+};
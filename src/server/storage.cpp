@@ -0,0 +1,105 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#include "storage.h"
+#include "postgres-storage.h"
+#include "sqlite-storage.h"
+#include "elo-updates.h"
+#include "console.h"
+
+#include <cmath>
+
+void rate_match(const std::vector<std::optional<int>> & current_elos,
+                const std::vector<uint8_t> & elimination_order,
+                RecordedMatch & match)
+{
+    size_t n_players = current_elos.size();
+    size_t found = 0;
+    int elo_sum = 0;
+
+    match.old_elos.assign(n_players, 0);
+
+    for (size_t i = 0; i < n_players; i++)
+    {
+        if (current_elos[i])
+        {
+            match.old_elos[i] = *current_elos[i];
+            elo_sum += *current_elos[i];
+            found++;
+        }
+    }
+
+    // If a player was missing (not found in table) then
+    // set their elo to the average of the lobby for fairness.
+    //
+    // We do not expect this to occur under normal operation, but
+    // it is good to guard against bad elo updates.
+    if (found < n_players)
+    {
+        std::string lmsg = "Found "
+                            + std::to_string(found)
+                            + " of "
+                            + std::to_string(n_players)
+                            + " players in recording for match "
+                            + std::to_string(match.match_id)
+                            + ".";
+        Console::instance().log(std::move(lmsg),
+                                LogLevel::WARN);
+
+        int average_elo = std::round(
+                                static_cast<double>(elo_sum)
+                                /
+                                static_cast<double>(n_players));
+
+        for (size_t i = 0; i < n_players; i++)
+        {
+            if (!current_elos[i])
+            {
+                match.old_elos[i] = average_elo;
+            }
+        }
+    }
+
+    match.new_elos = elo_updates(match.old_elos, elimination_order);
+}
+
+std::unique_ptr<Storage> make_storage(asio::io_context & io,
+                                      const std::string & spec,
+                                      const std::string & archive_dir)
+{
+    if (spec.empty() || spec == "postgres")
+    {
+        return std::make_unique<PostgresStorage>(io, archive_dir);
+    }
+
+    constexpr std::string_view sqlite_prefix = "sqlite:";
+
+    if (spec.starts_with(sqlite_prefix) && spec.size() > sqlite_prefix.size())
+    {
+        if (!archive_dir.empty())
+        {
+            Console::instance().log("Replay archiving is not supported with sqlite "
+                                    "storage, replays stay in the database.",
+                                    LogLevel::WARN);
+        }
+
+        return std::make_unique<SqliteStorage>(spec.substr(sqlite_prefix.size()));
+    }
+
+    throw std::invalid_argument("Unknown storage \"" + spec + "\", expected "
+                                "postgres or sqlite:<path>");
+}
@@ -0,0 +1,309 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include "cryptography-constants.h"
+#include "external-user.h"
+#include "gamemodes.h"
+#include "match-result-structs.h"
+
+namespace asio = boost::asio;
+
+// Failure inside a storage backend, other backends throw their own.
+class StorageError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// What a login needs before the password is checked.
+struct LoginRecord
+{
+    boost::uuids::uuid user_id;
+    std::array<uint8_t, HASH_LENGTH> hash;
+    std::array<uint8_t, SALT_LENGTH> salt;
+
+    // Set when the user has an active ban.
+    std::optional<std::chrono::system_clock::time_point> banned_until;
+    std::string ban_reason;
+};
+
+// What a login loads once the password matched.
+struct LoginData
+{
+    std::vector<boost::uuids::uuid> friends;
+    std::vector<boost::uuids::uuid> blocks;
+
+    // Game mode and current elo, one entry per ranked mode with a rating.
+    std::vector<std::pair<uint8_t, int>> elos;
+};
+
+// A finished match, indexed by player id.
+struct MatchWrite
+{
+    std::vector<boost::uuids::uuid> user_ids;
+    std::vector<uint8_t> elimination_order;
+    std::vector<int> placements;
+    std::string settings_json;
+
+    // Move list from encode_replay.
+    std::string moves;
+    GameMode mode;
+};
+
+// Elos are empty for unranked modes.
+struct RecordedMatch
+{
+    int64_t match_id;
+    std::chrono::system_clock::time_point finished_at;
+    std::vector<int> old_elos;
+    std::vector<int> new_elos;
+};
+
+struct StoredReplay
+{
+    // Move list from encode_replay, legacy rows are converted on read.
+    std::string moves;
+    std::string settings_json;
+
+    // Player id and who played it.
+    std::vector<std::pair<uint8_t, ExternalUser>> players;
+};
+
+// Progress of re-encoding legacy JSON move lists, carried between batches.
+struct ReplayMigration
+{
+    // Batches resume after this match.
+    int64_t last_match_id{0};
+
+    size_t converted{0};
+
+    // Left as JSON, they still load through the slower path.
+    size_t failed{0};
+};
+
+// One player's result in a stored ranked match.
+struct RankedResult
+{
+    int64_t match_id;
+    GameMode mode;
+    boost::uuids::uuid user_id;
+    uint8_t player_id;
+
+    // One is first, as stored in MatchPlayers.
+    uint16_t placement;
+};
+
+// An elo change in a match, as stored in EloHistory.
+struct EloChange
+{
+    int64_t match_id;
+    boost::uuids::uuid user_id;
+    GameMode mode;
+    int old_elo;
+    int new_elo;
+};
+
+using RankedResultVisitor = std::function<void(const RankedResult & result)>;
+
+using EloVisitor = std::function<void(const boost::uuids::uuid & user_id,
+                                      GameMode mode,
+                                      int elo)>;
+
+using EloChangeVisitor = std::function<void(const EloChange & change)>;
+
+// Ratings rebuilt from every stored match, handed over as callbacks so
+// the backend can stream them without a second copy.
+struct RatingRewrite
+{
+    // Final elo of everyone who played, others go back to DEFAULT_ELO.
+    std::function<void(const EloVisitor & visit)> for_each_elo;
+
+    // Every elo change, replacing all of EloHistory.
+    std::function<void(const EloChangeVisitor & visit)> for_each_change;
+};
+
+// Empty error on success.
+template <typename T>
+using StorageHandler = std::function<void(std::string error, T result)>;
+
+// Called once per stored rating, with the user's id and username.
+using RatingVisitor = std::function<void(const boost::uuids::uuid & user_id,
+                                         const std::string & username,
+                                         GameMode mode,
+                                         int elo)>;
+
+// Where the server keeps its users, relations, bans, matches and elos.
+//
+// Blocking calls are made from the database pool, or a user's strand on
+// it, and report failure by throwing. The fetches are asynchronous so a
+// backend can answer them without holding a pool thread; their handler
+// may run inline or on another thread.
+class Storage
+{
+public:
+    virtual ~Storage() = default;
+
+    virtual std::string name() const = 0;
+
+    // Whether the write-behind match recorder can sit in front of us.
+    virtual bool supports_write_behind() const = 0;
+
+    // Called from the server thread on startup.
+    virtual std::unordered_map<std::string, std::chrono::system_clock::time_point>
+    load_ip_bans() = 0;
+
+    // Every rating in every ranked mode, streamed so the whole table is
+    // never held at once. Called from the server thread on startup.
+    virtual void load_ratings(const RatingVisitor & visit) = 0;
+
+    virtual std::optional<LoginRecord> find_login(const std::string & username) = 0;
+
+    // Records the login and loads the user's relations and elos.
+    virtual LoginData login(const boost::uuids::uuid & user_id,
+                            const std::string & ip) = 0;
+
+    // Creates the user with DEFAULT_ELO in every ranked mode.
+    // Returns false if the username is taken.
+    virtual bool create_user(const boost::uuids::uuid & user_id,
+                             const std::string & username,
+                             const std::array<uint8_t, HASH_LENGTH> & hash,
+                             const std::array<uint8_t, SALT_LENGTH> & salt,
+                             const std::string & ip) = 0;
+
+    // Stores the match and, for ranked modes, rates it in one transaction.
+    virtual RecordedMatch record_match(const MatchWrite & match) = 0;
+
+    virtual void ban_ip(const std::string & ip,
+                        std::chrono::system_clock::time_point banned_until) = 0;
+
+    virtual void unban_ip(const std::string & ip) = 0;
+
+    virtual std::optional<boost::uuids::uuid> find_user_id(const std::string & username) = 0;
+
+    virtual void ban_user(const boost::uuids::uuid & user_id,
+                          std::chrono::system_clock::time_point banned_until,
+                          const std::string & reason) = 0;
+
+    virtual void unban_user(uint64_t ban_id) = 0;
+
+    // Returns false, without sending, if the receiver blocked the sender
+    // or they are already friends. The sender has at most max_pending
+    // requests out at once.
+    virtual bool send_friend_request(const boost::uuids::uuid & sender,
+                                     const boost::uuids::uuid & receiver,
+                                     int max_pending) = 0;
+
+    // Makes them friends if sender asked, returning the sender's username.
+    virtual std::optional<std::string>
+    accept_friend_request(const boost::uuids::uuid & receiver,
+                          const boost::uuids::uuid & sender) = 0;
+
+    virtual void decline_friend_request(const boost::uuids::uuid & receiver,
+                                        const boost::uuids::uuid & sender) = 0;
+
+    // Also drops any friendship or request between the two.
+    virtual void block_user(const boost::uuids::uuid & blocker,
+                            const boost::uuids::uuid & blocked) = 0;
+
+    virtual void unblock_user(const boost::uuids::uuid & blocker,
+                              const boost::uuids::uuid & blocked) = 0;
+
+    virtual void remove_friend(const boost::uuids::uuid & user,
+                               const boost::uuids::uuid & friend_id) = 0;
+
+    virtual void fetch_blocks(const boost::uuids::uuid & user,
+                              StorageHandler<std::vector<ExternalUser>> handler) = 0;
+
+    virtual void fetch_friends(const boost::uuids::uuid & user,
+                               StorageHandler<std::vector<ExternalUser>> handler) = 0;
+
+    virtual void fetch_friend_requests(const boost::uuids::uuid & user,
+                                       StorageHandler<std::vector<ExternalUser>> handler) = 0;
+
+    // Newest first, starting after the cursor, or from the newest match
+    // if it is empty. Match ids are handed out as matches finish, so
+    // backends page on match_id and every page costs the same.
+    virtual void fetch_latest_matches(const boost::uuids::uuid & user,
+                                      GameMode mode,
+                                      const MatchHistoryCursor & after,
+                                      int limit,
+                                      StorageHandler<std::vector<MatchResultRow>> handler) = 0;
+
+    // Nullopt if the match or its players are not stored. Blocking work
+    // left after the query, such as reading an archived replay, is
+    // posted to blocking.
+    virtual void fetch_replay(uint64_t match_id,
+                              asio::any_io_executor blocking,
+                              StorageHandler<std::optional<StoredReplay>> handler) = 0;
+
+    // Every player of every ranked match, ordered by match_id and then
+    // player_id. Match ids are handed out as matches finish, so this is
+    // the order they were rated in.
+    virtual void load_ranked_results(const RankedResultVisitor & visit) = 0;
+
+    // Replaces every ranked elo and all elo history in one transaction.
+    // Offline only, a match recorded meanwhile would be rated from elos
+    // that are about to be overwritten.
+    virtual void rewrite_ratings(const RatingRewrite & rewrite) = 0;
+
+    // Re-encodes up to limit legacy move lists in one transaction.
+    // Returns false once there are none left.
+    virtual bool migrate_replays(ReplayMigration & progress, size_t limit) = 0;
+
+    // Periodic upkeep, run from the database pool. Returns true if there
+    // is more to do right away, so the caller can come back without
+    // holding a pool thread for the whole run.
+    virtual bool maintain() = 0;
+
+    // Fails whatever is in flight, blocking calls are unaffected.
+    virtual void close() = 0;
+};
+
+// Fills in players without a rating with the lobby average, then rates
+// the match into old_elos and new_elos. Every backend rates through here.
+void rate_match(const std::vector<std::optional<int>> & current_elos,
+                const std::vector<uint8_t> & elimination_order,
+                RecordedMatch & match);
+
+// Parses a --storage option:
+//   postgres              the local postgres cluster
+//   sqlite:<path>         an embedded database file, created if missing
+//
+// Old replays are archived to archive_dir when the backend supports it
+// and the directory is not empty.
+//
+// Throws std::invalid_argument for anything else.
+std::unique_ptr<Storage> make_storage(asio::io_context & io,
+                                      const std::string & spec,
+                                      const std::string & archive_dir);
@@ -0,0 +1,168 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "tls-stream.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <openssl/err.h>
+
+bool ktls_requested(asio::ssl::context & ssl_cntx)
+{
+#if defined(SSL_OP_ENABLE_KTLS)
+    return (SSL_CTX_get_options(ssl_cntx.native_handle())
+            & SSL_OP_ENABLE_KTLS) != 0;
+#else
+    return false;
+#endif
+}
+
+TlsStream::TlsStream(asio::io_context & cntx, asio::ssl::context & ssl_cntx)
+:ssl_stream_(cntx, ssl_cntx),
+native_ssl_(nullptr)
+{
+    if (!ktls_requested(ssl_cntx))
+    {
+        return;
+    }
+
+    native_ssl_ = SSL_new(ssl_cntx.native_handle());
+
+    if (!native_ssl_)
+    {
+        throw std::runtime_error("Failed to create native SSL object.");
+    }
+
+    // Allow write_some to return after a partial write.
+    SSL_set_mode(native_ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE);
+}
+
+TlsStream::~TlsStream()
+{
+    if (native_ssl_)
+    {
+        SSL_free(native_ssl_);
+    }
+}
+
+TlsStream::executor_type TlsStream::get_executor()
+{
+    return ssl_stream_.get_executor();
+}
+
+TlsStream::tcp::socket & TlsStream::next_layer()
+{
+    return ssl_stream_.next_layer();
+}
+
+TlsStream::lowest_layer_type & TlsStream::lowest_layer()
+{
+    return ssl_stream_.lowest_layer();
+}
+
+bool TlsStream::ktls_mode() const
+{
+    return native_ssl_ != nullptr;
+}
+
+bool TlsStream::ktls_send() const
+{
+    return native_ssl_ && BIO_get_ktls_send(SSL_get_wbio(native_ssl_));
+}
+
+bool TlsStream::ktls_recv() const
+{
+    return native_ssl_ && BIO_get_ktls_recv(SSL_get_rbio(native_ssl_));
+}
+
+TlsStream::NativeStatus TlsStream::native_step(NativeOp op,
+                                               void * data,
+                                               size_t size,
+                                               size_t & bytes,
+                                               boost::system::error_code & ec)
+{
+    // Bind to the socket the first time we are used, the socket is
+    // only opened once the acceptor hands it to us.
+    if (SSL_get_fd(native_ssl_) == -1)
+    {
+        next_layer().non_blocking(true, ec);
+
+        if (ec)
+        {
+            return NativeStatus::Done;
+        }
+
+        if (SSL_set_fd(native_ssl_, next_layer().native_handle()) != 1)
+        {
+            ec = boost::system::error_code(static_cast<int>(ERR_get_error()),
+                                           asio::error::get_ssl_category());
+            return NativeStatus::Done;
+        }
+    }
+
+    ERR_clear_error();
+    errno = 0;
+
+    int ret = 0;
+
+    switch (op)
+    {
+        case NativeOp::Handshake:
+            ret = SSL_do_handshake(native_ssl_);
+            break;
+        case NativeOp::Read:
+            ret = SSL_read_ex(native_ssl_, data, size, &bytes);
+            break;
+        case NativeOp::Write:
+            ret = SSL_write_ex(native_ssl_, data, size, &bytes);
+            break;
+    }
+
+    if (ret == 1)
+    {
+        return NativeStatus::Done;
+    }
+
+    bytes = 0;
+
+    switch (SSL_get_error(native_ssl_, ret))
+    {
+        case SSL_ERROR_WANT_READ:
+            return NativeStatus::WantRead;
+
+        case SSL_ERROR_WANT_WRITE:
+            return NativeStatus::WantWrite;
+
+        case SSL_ERROR_ZERO_RETURN:
+            ec = asio::error::eof;
+            break;
+
+        case SSL_ERROR_SYSCALL:
+            ec = (errno != 0)
+                 ? boost::system::error_code(errno,
+                                             asio::error::get_system_category())
+                 : asio::ssl::error::stream_truncated;
+            break;
+
+        default:
+            ec = boost::system::error_code(static_cast<int>(ERR_get_error()),
+                                           asio::error::get_ssl_category());
+            break;
+    }
+
+    return NativeStatus::Done;
+}
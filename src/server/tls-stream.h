@@ -0,0 +1,250 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+
+#include <openssl/ssl.h>
+
+namespace asio = boost::asio;
+
+// Returns true if the context was set up for kernel TLS offload.
+bool ktls_requested(asio::ssl::context & ssl_cntx);
+
+// TLS stream used by sessions.
+//
+// By default this forwards to asio::ssl::stream, which encrypts in
+// userspace and copies every record through a memory BIO.
+//
+// When the context has kTLS enabled, OpenSSL is instead driven directly
+// on the socket so that it can hand the record layer to the kernel after
+// the handshake. If the kernel (or cipher) does not support it, OpenSSL
+// keeps encrypting in userspace on the same socket, so the session works
+// either way. Readiness is waited on with the asio socket, and all calls
+// into OpenSSL are made on the handler's executor (the session strand).
+class TlsStream
+{
+public:
+    using tcp = asio::ip::tcp;
+    using executor_type = tcp::socket::executor_type;
+    using lowest_layer_type = tcp::socket::lowest_layer_type;
+
+    TlsStream(asio::io_context & cntx, asio::ssl::context & ssl_cntx);
+
+    ~TlsStream();
+
+    // Disable copy, the native SSL object is owned by us.
+    TlsStream(const TlsStream &) = delete;
+    TlsStream & operator=(const TlsStream &) = delete;
+
+    executor_type get_executor();
+
+    tcp::socket & next_layer();
+
+    lowest_layer_type & lowest_layer();
+
+    // Whether OpenSSL is driven on the socket so kTLS can be used.
+    bool ktls_mode() const;
+
+    // Whether the kernel is doing encryption or decryption for us.
+    // Only meaningful after the handshake.
+    bool ktls_send() const;
+    bool ktls_recv() const;
+
+    template <typename Handler>
+    void async_handshake(asio::ssl::stream_base::handshake_type type,
+                         Handler && handler);
+
+    template <typename MutableBufferSequence, typename Handler>
+    void async_read_some(const MutableBufferSequence & buffers,
+                         Handler && handler);
+
+    template <typename ConstBufferSequence, typename Handler>
+    void async_write_some(const ConstBufferSequence & buffers,
+                          Handler && handler);
+
+private:
+    enum class NativeOp : uint8_t
+    {
+        Handshake,
+        Read,
+        Write
+    };
+
+    // Result of a single non-blocking call into OpenSSL.
+    enum class NativeStatus : uint8_t
+    {
+        Done,
+        WantRead,
+        WantWrite
+    };
+
+    NativeStatus native_step(NativeOp op,
+                             void * data,
+                             size_t size,
+                             size_t & bytes,
+                             boost::system::error_code & ec);
+
+    template <typename Handler>
+    void run_native(NativeOp op, void * data, size_t size, Handler handler);
+
+private:
+    asio::ssl::stream<tcp::socket> ssl_stream_;
+
+    // Only set when kTLS is requested.
+    SSL * native_ssl_;
+};
+
+template <typename Handler>
+void TlsStream::async_handshake(asio::ssl::stream_base::handshake_type type,
+                                Handler && handler)
+{
+    if (!native_ssl_)
+    {
+        ssl_stream_.async_handshake(type, std::forward<Handler>(handler));
+        return;
+    }
+
+    if (type == asio::ssl::stream_base::server)
+    {
+        SSL_set_accept_state(native_ssl_);
+    }
+    else
+    {
+        SSL_set_connect_state(native_ssl_);
+    }
+
+    auto handler_ex = asio::get_associated_executor(handler, get_executor());
+
+    // Adapt to the (ec, bytes) form used by run_native.
+    run_native(NativeOp::Handshake,
+               nullptr,
+               0,
+               asio::bind_executor(
+                   handler_ex,
+                   [h = std::forward<Handler>(handler)]
+                   (boost::system::error_code ec, size_t) mutable
+                   {
+                       h(ec);
+                   }));
+}
+
+template <typename MutableBufferSequence, typename Handler>
+void TlsStream::async_read_some(const MutableBufferSequence & buffers,
+                                Handler && handler)
+{
+    if (!native_ssl_)
+    {
+        ssl_stream_.async_read_some(buffers, std::forward<Handler>(handler));
+        return;
+    }
+
+    // read_some semantics, only the first non-empty buffer is filled.
+    asio::mutable_buffer buf;
+
+    for (auto itr = asio::buffer_sequence_begin(buffers);
+         itr != asio::buffer_sequence_end(buffers);
+         ++itr)
+    {
+        if (asio::mutable_buffer(*itr).size() != 0)
+        {
+            buf = asio::mutable_buffer(*itr);
+            break;
+        }
+    }
+
+    run_native(NativeOp::Read,
+               buf.data(),
+               buf.size(),
+               std::forward<Handler>(handler));
+}
+
+template <typename ConstBufferSequence, typename Handler>
+void TlsStream::async_write_some(const ConstBufferSequence & buffers,
+                                 Handler && handler)
+{
+    if (!native_ssl_)
+    {
+        ssl_stream_.async_write_some(buffers, std::forward<Handler>(handler));
+        return;
+    }
+
+    // write_some semantics, only the first non-empty buffer is sent.
+    asio::const_buffer buf;
+
+    for (auto itr = asio::buffer_sequence_begin(buffers);
+         itr != asio::buffer_sequence_end(buffers);
+         ++itr)
+    {
+        if (asio::const_buffer(*itr).size() != 0)
+        {
+            buf = asio::const_buffer(*itr);
+            break;
+        }
+    }
+
+    run_native(NativeOp::Write,
+               const_cast<void *>(buf.data()),
+               buf.size(),
+               std::forward<Handler>(handler));
+}
+
+template <typename Handler>
+void TlsStream::run_native(NativeOp op, void * data, size_t size, Handler handler)
+{
+    auto handler_ex = asio::get_associated_executor(handler, get_executor());
+
+    size_t bytes = 0;
+    boost::system::error_code ec;
+
+    NativeStatus status = native_step(op, data, size, bytes, ec);
+
+    if (status == NativeStatus::Done)
+    {
+        // Never complete inline, asio composed operations expect this.
+        asio::post(handler_ex,
+            [h = std::move(handler), ec, bytes]() mutable
+            {
+                h(ec, bytes);
+            });
+        return;
+    }
+
+    auto wait_type = (status == NativeStatus::WantRead)
+                     ? tcp::socket::wait_read
+                     : tcp::socket::wait_write;
+
+    // Retry on the handler's executor so OpenSSL is never entered
+    // concurrently for the same connection.
+    next_layer().async_wait(wait_type,
+        asio::bind_executor(handler_ex,
+            [this, op, data, size, h = std::move(handler)]
+            (boost::system::error_code ec) mutable
+            {
+                if (ec)
+                {
+                    h(ec, 0);
+                    return;
+                }
+
+                run_native(op, data, size, std::move(h));
+            }));
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "tls-ticket-keys.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+#include <openssl/core_names.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+
+// Session ID context, required for the server to accept resumed sessions.
+static constexpr std::string_view SESSION_ID_CONTEXT = "SilentTanks";
+
+// We cannot use the context's app data since asio owns that slot, so
+// reserve our own index to find the key ring from the callback.
+static int ticket_key_ring_index()
+{
+    static const int index = SSL_CTX_get_ex_new_index(0,
+                                                      nullptr,
+                                                      nullptr,
+                                                      nullptr,
+                                                      nullptr);
+    return index;
+}
+
+TicketKeyRing::TicketKeyRing()
+{
+    std::lock_guard lock(keys_mutex_);
+    rotate();
+}
+
+void TicketKeyRing::attach(boost::asio::ssl::context & ssl_cntx)
+{
+    SSL_CTX * cntx = ssl_cntx.native_handle();
+
+    // Stateful cache for clients that do not support tickets.
+    SSL_CTX_set_session_cache_mode(cntx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(cntx, TLS_SESSION_CACHE_SIZE);
+    SSL_CTX_set_timeout(cntx, static_cast<long>(TLS_SESSION_LIFETIME.count()));
+
+    SSL_CTX_set_session_id_context(
+        cntx,
+        reinterpret_cast<const unsigned char *>(SESSION_ID_CONTEXT.data()),
+        static_cast<unsigned int>(SESSION_ID_CONTEXT.size()));
+
+    // Stateless tickets, encrypted with our own rotating keys.
+    SSL_CTX_clear_options(cntx, SSL_OP_NO_TICKET);
+    if (SSL_CTX_set_ex_data(cntx, ticket_key_ring_index(), this) != 1)
+    {
+        throw std::runtime_error("Failed to attach TLS ticket keys.");
+    }
+
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(cntx,
+                                         &TicketKeyRing::ticket_key_callback);
+}
+
+// Called by OpenSSL to encrypt (encrypt == 1) or decrypt a ticket.
+//
+// Returns 1 on success, 2 on success when the ticket should be renewed,
+// 0 to fall back to a full handshake and -1 on error.
+int TicketKeyRing::ticket_key_callback(SSL * ssl,
+                                       unsigned char key_name[16],
+                                       unsigned char * iv,
+                                       EVP_CIPHER_CTX * cipher_cntx,
+                                       EVP_MAC_CTX * hmac_cntx,
+                                       int encrypt)
+{
+    auto * ring = static_cast<TicketKeyRing *>(
+                    SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl),
+                                        ticket_key_ring_index()));
+
+    if (!ring)
+    {
+        return -1;
+    }
+
+    std::lock_guard lock(ring->keys_mutex_);
+
+    const TicketKey * key = nullptr;
+    bool is_current = true;
+
+    if (encrypt)
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        if (now - ring->keys_[ring->current_].created_at
+            >= TICKET_KEY_ROTATION_INTERVAL)
+        {
+            ring->rotate();
+        }
+
+        key = &ring->keys_[ring->current_];
+
+        if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1)
+        {
+            return -1;
+        }
+
+        std::copy(key->name.begin(), key->name.end(), key_name);
+    }
+    else
+    {
+        key = ring->find_key(key_name, is_current);
+
+        // Unknown or expired key, do a full handshake.
+        if (!key)
+        {
+            return 0;
+        }
+    }
+
+    OSSL_PARAM params[3];
+    params[0] = OSSL_PARAM_construct_octet_string(
+                    OSSL_MAC_PARAM_KEY,
+                    const_cast<unsigned char *>(key->hmac_key.data()),
+                    key->hmac_key.size());
+    params[1] = OSSL_PARAM_construct_utf8_string(
+                    OSSL_MAC_PARAM_DIGEST,
+                    const_cast<char *>("sha256"),
+                    0);
+    params[2] = OSSL_PARAM_construct_end();
+
+    if (EVP_MAC_CTX_set_params(hmac_cntx, params) != 1)
+    {
+        return -1;
+    }
+
+    int cipher_ok = encrypt
+                    ? EVP_EncryptInit_ex(cipher_cntx,
+                                         EVP_aes_256_cbc(),
+                                         nullptr,
+                                         key->aes_key.data(),
+                                         iv)
+                    : EVP_DecryptInit_ex(cipher_cntx,
+                                         EVP_aes_256_cbc(),
+                                         nullptr,
+                                         key->aes_key.data(),
+                                         iv);
+
+    if (cipher_ok != 1)
+    {
+        return -1;
+    }
+
+    // Tickets made with an old key still resume, but get reissued.
+    return is_current ? 1 : 2;
+}
+
+void TicketKeyRing::rotate()
+{
+    size_t next = (live_keys_ == 0) ? 0 : (current_ + 1) % keys_.size();
+    TicketKey & key = keys_[next];
+
+    if (RAND_bytes(key.name.data(), key.name.size()) != 1
+        || RAND_bytes(key.aes_key.data(), key.aes_key.size()) != 1
+        || RAND_bytes(key.hmac_key.data(), key.hmac_key.size()) != 1)
+    {
+        // Keep using the previous key if we have one.
+        if (live_keys_ > 0)
+        {
+            return;
+        }
+
+        throw std::runtime_error("Failed to generate TLS ticket key.");
+    }
+
+    key.created_at = std::chrono::steady_clock::now();
+
+    current_ = next;
+    live_keys_ = std::min(live_keys_ + 1, keys_.size());
+}
+
+const TicketKeyRing::TicketKey *
+TicketKeyRing::find_key(const unsigned char key_name[16],
+                        bool & is_current) const
+{
+    for (size_t i = 0; i < live_keys_; i++)
+    {
+        const TicketKey & key = keys_[i];
+
+        if (std::equal(key.name.begin(), key.name.end(), key_name))
+        {
+            is_current = (i == current_);
+            return &key;
+        }
+    }
+
+    return nullptr;
+}
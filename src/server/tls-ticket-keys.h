@@ -0,0 +1,100 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include <boost/asio/ssl.hpp>
+#include <openssl/evp.h>
+
+// Number of sessions kept in the server side (stateful) session cache.
+//
+// Only TLS 1.2 clients use this, TLS 1.3 clients resume through tickets.
+static constexpr long TLS_SESSION_CACHE_SIZE = 20000;
+
+// How long a resumable session or ticket is accepted for.
+static constexpr std::chrono::seconds TLS_SESSION_LIFETIME{7200};
+
+// Interval between generating a new ticket encryption key.
+static constexpr std::chrono::seconds TICKET_KEY_ROTATION_INTERVAL{3600};
+
+// Number of keys we keep around for decryption. With the values above,
+// any ticket younger than TLS_SESSION_LIFETIME can still be decrypted.
+static constexpr size_t TICKET_KEY_RING_SIZE = 3;
+
+static_assert(TICKET_KEY_ROTATION_INTERVAL * (TICKET_KEY_RING_SIZE - 1)
+              >= TLS_SESSION_LIFETIME);
+
+// Holds the keys used to encrypt TLS session tickets.
+//
+// Tickets are always issued with the newest key. Older keys are kept only
+// to decrypt tickets handed out before the last rotation, and clients that
+// resume with an older key are issued a fresh ticket.
+//
+// Rotation is done lazily when a ticket is issued, which avoids needing a
+// timer on the io context. OpenSSL calls into this from whichever thread is
+// performing the handshake, so all access is guarded by a mutex.
+class TicketKeyRing
+{
+public:
+    TicketKeyRing();
+
+    // Disable copy and move, OpenSSL holds a pointer to us.
+    TicketKeyRing(const TicketKeyRing &) = delete;
+    TicketKeyRing & operator=(const TicketKeyRing &) = delete;
+
+    // Configures the server side session cache and session tickets on the
+    // given context. The ring must outlive the context.
+    void attach(boost::asio::ssl::context & ssl_cntx);
+
+private:
+    struct TicketKey
+    {
+        std::array<unsigned char, 16> name;
+        std::array<unsigned char, 32> aes_key;
+        std::array<unsigned char, 32> hmac_key;
+        std::chrono::steady_clock::time_point created_at;
+    };
+
+    static int ticket_key_callback(SSL * ssl,
+                                   unsigned char key_name[16],
+                                   unsigned char * iv,
+                                   EVP_CIPHER_CTX * cipher_cntx,
+                                   EVP_MAC_CTX * hmac_cntx,
+                                   int encrypt);
+
+    // Must be called with keys_mutex_ held.
+    void rotate();
+
+    // Must be called with keys_mutex_ held.
+    const TicketKey * find_key(const unsigned char key_name[16],
+                               bool & is_current) const;
+
+private:
+    std::mutex keys_mutex_;
+
+    // Index of the newest key in keys_.
+    size_t current_{0};
+
+    // Number of keys that have been generated, up to the ring size.
+    size_t live_keys_{0};
+
+    std::array<TicketKey, TICKET_KEY_RING_SIZE> keys_;
+};
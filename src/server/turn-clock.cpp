@@ -0,0 +1,156 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#include "turn-clock.h"
+#include "match-instance.h"
+
+#include <functional>
+
+TurnClock::TurnClock(asio::io_context & cntx)
+{
+    shards_.reserve(TURN_CLOCK_SHARDS);
+
+    for (size_t i = 0; i < TURN_CLOCK_SHARDS; i++)
+    {
+        shards_.emplace_back(std::make_unique<Shard>(cntx));
+    }
+}
+
+void TurnClock::schedule(const std::shared_ptr<MatchInstance> & match,
+                         uint32_t turn_id,
+                         steady_clock::time_point deadline)
+{
+    Shard & shard = *shards_[std::hash<MatchInstance *>{}(match.get())
+                             % TURN_CLOCK_SHARDS];
+
+    std::lock_guard lock(shard.mutex);
+
+    if (shard.stopped)
+    {
+        return;
+    }
+
+    if (!shard.running)
+    {
+        shard.running = true;
+        shard.next_tick = steady_clock::now() + TURN_CLOCK_TICK;
+        arm(shard);
+    }
+
+    // Slot cursor + n is processed at next_tick + n ticks, round up
+    // so that we never fire early.
+    auto remaining = deadline - shard.next_tick;
+    auto ticks = (remaining.count() <= 0)
+                 ? 0
+                 : (remaining + TURN_CLOCK_TICK - steady_clock::duration(1))
+                   / TURN_CLOCK_TICK;
+
+    size_t delay = static_cast<size_t>(ticks);
+
+    shard.slots[(shard.cursor + delay) % TURN_CLOCK_SLOTS].push_back(
+        Entry{match,
+              turn_id,
+              static_cast<uint32_t>(delay / TURN_CLOCK_SLOTS)});
+
+    shard.pending++;
+}
+
+void TurnClock::shutdown()
+{
+    for (auto & shard : shards_)
+    {
+        std::lock_guard lock(shard->mutex);
+
+        shard->stopped = true;
+        shard->running = false;
+        shard->timer.cancel();
+
+        for (auto & slot : shard->slots)
+        {
+            slot.clear();
+        }
+
+        shard->pending = 0;
+    }
+}
+
+void TurnClock::arm(Shard & shard)
+{
+    shard.timer.expires_at(shard.next_tick);
+    shard.timer.async_wait(
+        [this, &shard](boost::system::error_code ec)
+        {
+            on_tick(shard, ec);
+        });
+}
+
+void TurnClock::on_tick(Shard & shard, boost::system::error_code ec)
+{
+    std::vector<Entry> due;
+
+    {
+        std::lock_guard lock(shard.mutex);
+
+        if (ec || shard.stopped)
+        {
+            return;
+        }
+
+        std::vector<Entry> & slot = shard.slots[shard.cursor];
+
+        // Split the slot into entries due now and ones waiting on
+        // more revolutions, compacting the latter in place.
+        size_t kept = 0;
+        for (Entry & entry : slot)
+        {
+            if (entry.rounds == 0)
+            {
+                due.push_back(std::move(entry));
+            }
+            else
+            {
+                entry.rounds--;
+                slot[kept++] = std::move(entry);
+            }
+        }
+
+        slot.resize(kept);
+        shard.pending -= due.size();
+
+        shard.cursor = (shard.cursor + 1) % TURN_CLOCK_SLOTS;
+        shard.next_tick += TURN_CLOCK_TICK;
+
+        // Go idle when there is nothing left to time.
+        if (shard.pending == 0)
+        {
+            shard.running = false;
+        }
+        else
+        {
+            arm(shard);
+        }
+    }
+
+    // Dispatch outside of the lock, each match handles its own
+    // deadline on its strand.
+    for (Entry & entry : due)
+    {
+        if (auto match = entry.match.lock())
+        {
+            match->on_turn_deadline(entry.turn_id);
+        }
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Liam Mercier
+//
+// This file is part of SilentTanks.
+//
+// SilentTanks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License Version 3.0
+// as published by the Free Software Foundation.
+//
+// SilentTanks is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License v3.0
+// for more details.
+//
+// You should have received a copy of the GNU Affero General Public License v3.0
+// along with SilentTanks. If not, see <https://www.gnu.org/licenses/agpl-3.0.txt>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace asio = boost::asio;
+
+class MatchInstance;
+
+// Resolution of turn deadlines. Timeouts fire at most one tick late
+// and never early.
+static constexpr std::chrono::milliseconds TURN_CLOCK_TICK{10};
+
+// Slots per wheel, deadlines further out than one revolution
+// wait for extra rounds.
+static constexpr size_t TURN_CLOCK_SLOTS = 512;
+
+static constexpr size_t TURN_CLOCK_SHARDS = 8;
+
+// Owns the turn deadlines of every live match.
+//
+// Instead of each match arming and cancelling its own timer every turn,
+// matches drop a (match, turn ID) entry into a hashed timing wheel. Each
+// shard has a single timer which ticks while it has entries, and posts
+// every deadline in the current slot to its match's strand in one pass.
+//
+// Entries are never cancelled. When a move arrives, the match simply
+// moves on to a new turn ID and the stale entry is ignored when it fires,
+// so re-arming on every move is a constant time insert.
+class TurnClock
+{
+    using steady_clock = std::chrono::steady_clock;
+
+public:
+    explicit TurnClock(asio::io_context & cntx);
+
+    // Disable copy and move, timer handlers refer to the shards.
+    TurnClock(const TurnClock &) = delete;
+    TurnClock & operator=(const TurnClock &) = delete;
+
+    void schedule(const std::shared_ptr<MatchInstance> & match,
+                  uint32_t turn_id,
+                  steady_clock::time_point deadline);
+
+    // Stop all shard timers, pending deadlines are dropped.
+    void shutdown();
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<MatchInstance> match;
+        uint32_t turn_id;
+
+        // Number of full wheel revolutions left before this is due.
+        uint32_t rounds;
+    };
+
+    struct Shard
+    {
+        explicit Shard(asio::io_context & cntx)
+        : timer(cntx)
+        {
+        }
+
+        std::mutex mutex;
+        asio::steady_timer timer;
+
+        // Index of the next slot to be processed.
+        size_t cursor{0};
+        size_t pending{0};
+
+        bool running{false};
+        bool stopped{false};
+
+        steady_clock::time_point next_tick;
+
+        std::array<std::vector<Entry>, TURN_CLOCK_SLOTS> slots;
+    };
+
+    // Must be called with the shard mutex held.
+    void arm(Shard & shard);
+
+    void on_tick(Shard & shard, boost::system::error_code ec);
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
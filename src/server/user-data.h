@@ -17,6 +17,7 @@
 #pragma once
 
 #include "message.h"
+#include "elo-updates.h"
 
 #include <boost/uuid/uuid.hpp>
 #include <string>
@@ -27,7 +28,8 @@ struct UserData
     UserData()
     :user_id()
     {
-
+        // Accounts made before a ranked mode existed have no elo row for it.
+        matching_elos.fill(DEFAULT_ELO);
     }
 
     inline int get_elo(GameMode mode)
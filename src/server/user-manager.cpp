@@ -69,6 +69,8 @@ void UserManager::on_login(UserData data,
         auto inst = user->current_match.lock();
         if (inst)
         {
+            session->bind_match(inst);
+
             // Notify the client that a game exists.
             Message match_found;
             match_found.create_serialized(HeaderType::MatchInProgress);
@@ -147,6 +149,11 @@ void UserManager::notify_match_finished(boost::uuids::uuid user_id,
         // Reset the weak pointer, the game is already over.
         user->current_match.reset();
 
+        if (user->current_session)
+        {
+            user->current_session->bind_match({});
+        }
+
         // If user is not connected, remove their data.
         //
         // This might happen if the user logs out before the
@@ -190,6 +197,12 @@ void UserManager::notify_match_start(boost::uuids::uuid user_id,
         // inside of the user strand, which is true.
         user->current_match = inst;
 
+        // Let the session route commands directly to the match.
+        if (user->current_session)
+        {
+            user->current_session->bind_match(inst);
+        }
+
     });
 
 }
@@ -579,3 +592,41 @@ void UserManager::match_message_user(boost::uuids::uuid sender,
     });
 }
 
+void UserManager::spectate_friend(std::shared_ptr<Session> session,
+                                  boost::uuids::uuid friend_id,
+                                  bool fogged)
+{
+    boost::asio::post(strand_,
+        [this,
+         session = std::move(session),
+         friend_id = std::move(friend_id),
+         fogged]{
+
+        boost::uuids::uuid spectator_id = session->get_user_data().user_id;
+
+        std::shared_ptr<MatchInstance> inst;
+        auto friend_it = this->users_.find(friend_id);
+
+        // Only friends who have not blocked the spectator can be watched.
+        if (friend_it != this->users_.end() && friend_it->second)
+        {
+            auto user = (friend_it->second);
+
+            if (user->friends.find(spectator_id) != user->friends.end()
+                && user->blocked_users.find(spectator_id) == user->blocked_users.end())
+            {
+                inst = user->current_match.lock();
+            }
+        }
+
+        if (!inst)
+        {
+            Message failed;
+            failed.create_serialized(HeaderType::SpectateFailed);
+            session->deliver(std::move(failed));
+            return;
+        }
+
+        inst->add_spectator(session, friend_id, fogged);
+    });
+}
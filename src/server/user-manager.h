@@ -86,6 +86,12 @@ public:
     void match_message_user(boost::uuids::uuid sender,
                             InternalMatchMessage msg);
 
+    // Watch the match a friend is playing, from their perspective
+    // if fogged is set.
+    void spectate_friend(std::shared_ptr<Session> session,
+                         boost::uuids::uuid friend_id,
+                         bool fogged);
+
 private:
 
     asio::strand<asio::io_context::executor_type> strand_;